@@ -1,5 +1,6 @@
 #include "audioanalyzer.hpp"
 #include "misc/log.hpp"
+#include "misc/cpukernel.hpp"
 #include "tmp/algorithm.hpp"
 
 // calculate dynamic audio normalization
@@ -53,9 +54,9 @@ public:
     {
         double sum2 = 0.0;
         for (auto &buffer : d) {
-            auto view = buffer->constView<float>();
-            for (float v : view)
-                sum2 += v * v;
+            const auto rms = AudioAnalyzer::rms(buffer->constView<float>().begin(),
+                                                buffer->samples());
+            sum2 += rms * rms * buffer->samples();
         }
         return sqrt(sum2 / (m_frames * m_format.channels().num));
     }
@@ -72,7 +73,7 @@ struct AudioAnalyzer::Data {
     AudioNormalizerOption option;
     int frames = 0;
     double scale = 1.0;
-    bool normalizer = false;
+    bool normalizer = false, configured = false;
     struct {
         std::deque<double> orig, min, smooth;
         double prev = 1.0, current = 1.0;
@@ -111,20 +112,23 @@ AudioAnalyzer::~AudioAnalyzer()
     delete d;
 }
 
+// gain history is kept since it does not depend on sample format
 auto AudioAnalyzer::setFormat(const AudioBufferFormat &format) -> void
 {
-    d->history.clear();
     if (!_Change(d->format, format))
         return;
-    d->format = format;
     reset();
 }
 
+// drops queued samples only; gains measured so far are kept so that next
+// stream continues from gain which was applied last
 auto AudioAnalyzer::reset() -> void
 {
     d->inputs.clear();
     d->outputs.clear();
+    // smoothed gains belong to dropped chunks
     d->history.smooth.clear();
+    d->history.prev = d->history.current;
     d->frames = d->format.secToFrames(d->option.chunk_sec);
     d->filling = d->chunk();
 }
@@ -162,11 +166,16 @@ auto AudioAnalyzer::delay() const -> double
 
 auto AudioAnalyzer::setNormalizerOption(const AudioNormalizerOption &opt) -> void
 {
-    d->option.use_rms   = opt.use_rms;
-    d->option.smoothing = std::max(1, opt.smoothing);
-    d->option.chunk_sec = qBound(0.1, opt.chunk_sec, 1.0);
-    d->option.max       = std::min(10.0, opt.max);
-    d->option.target    = std::min(0.95, opt.target);
+    AudioNormalizerOption option;
+    option.use_rms   = opt.use_rms;
+    option.smoothing = std::max(1, opt.smoothing);
+    option.chunk_sec = qBound(0.1, opt.chunk_sec, 1.0);
+    option.max       = std::min(10.0, opt.max);
+    option.target    = std::min(0.95, opt.target);
+    if (d->configured && d->option == option)
+        return;
+    d->option = option;
+    d->configured = true;
 
     d->gaussian.setRadius(d->option.smoothing);
     d->history.clear();
@@ -249,3 +258,41 @@ auto AudioAnalyzer::run(AudioBufferPtr &in) -> AudioBufferPtr
 {
     return in;
 }
+
+template<int Lanes>
+CPU_INLINE auto sum2Body(const float *p, int samples) -> double
+{
+    // independent partial sums let compiler vectorize the loop
+    float sum[Lanes] = { };
+    int i = 0;
+    for (; i + Lanes <= samples; i += Lanes) {
+        for (int j = 0; j < Lanes; ++j)
+            sum[j] += p[i + j] * p[i + j];
+    }
+    double sum2 = 0.0;
+    for (int j = 0; j < Lanes; ++j)
+        sum2 += sum[j];
+    for (; i < samples; ++i)
+        sum2 += p[i] * p[i];
+    return sum2;
+}
+
+CPU_KERNEL_VARIANTS(sum2, double, (const float *p, int samples), (p, samples))
+
+static CpuKernel<auto (const float*, int) -> double>
+s_sum2("audio-rms", CPU_KERNEL_LIST(sum2), [] (auto sum2) {
+    static const auto samples = CpuKernels::noise<float>(8192);
+    sum2(samples.data(), samples.size());
+}, [] (auto sum2, auto generic) {
+    const auto samples = CpuKernels::noise<float>(8195);
+    // partial sums are added in other order
+    return CpuKernels::same(sum2(samples.data(), samples.size()),
+                            generic(samples.data(), samples.size()), 1e-5);
+});
+
+auto AudioAnalyzer::rms(const float *p, int samples) -> double
+{
+    if (samples <= 0)
+        return 0.0;
+    return sqrt(s_sum2(p, samples) / samples);
+}
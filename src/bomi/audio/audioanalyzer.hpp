@@ -21,6 +21,8 @@ public:
     auto pull(bool eof = false) -> AudioBufferPtr;
     auto gain() const -> float;
     auto passthrough(const AudioBufferPtr &in) const -> bool override;
+    // level detector shared with mixing stage
+    static auto rms(const float *p, int samples) -> double;
 private:
     auto flush() -> AudioBufferPtr;
     struct Data;
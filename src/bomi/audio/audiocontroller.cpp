@@ -7,16 +7,26 @@
 #include "audioconverter.hpp"
 #include "audioresampler.hpp"
 #include "audioequalizer.hpp"
+#include "audiomixtrack.hpp"
 #include "player/mpv_helper.hpp"
 #include "enum/channellayout.hpp"
 #include "misc/log.hpp"
+#include "misc/dataevent.hpp"
 #include "misc/speedmeasure.hpp"
+#include <QElapsedTimer>
 extern "C" {
 #include <audio/filter/af.h>
 }
 
 DECLARE_LOG_CONTEXT(Audio)
 
+enum EventType { RetireMixTrack = QEvent::User + 1 };
+
+// fade-in after a stage had to drop its state
+static constexpr double FadeSec = 0.02;
+// relative change of normalizer gain which is audible as a step
+static constexpr double GainJump = 0.05;
+
 af_info create_info();
 af_info af_info_dummy = create_info();
 
@@ -50,7 +60,10 @@ enum FilterDirty : quint32 {
     Scale = 32,
     Resample = 64,
     Clip = 128,
-    Equalizer = 256
+    Equalizer = 256,
+    Compensation = 512,
+    MixTrack = 1024,
+    MixLevel = 2048
 };
 
 struct AudioController::Data {
@@ -60,7 +73,7 @@ struct AudioController::Data {
     int srate = 0;
     quint64 samples = 0;
     bool normalizerActivated = false, tempoScalerActivated = false, eof = false;
-    double scale = 1.0, amp = 1.0, gain = 1.0;
+    double scale = 1.0, amp = 1.0, gain = 1.0, syncRatio = 1.0, clockRatio = 1.0;
     mp_chmap chmap;
     af_instance *af = nullptr;
     AudioNormalizerOption normalizerOption;
@@ -80,6 +93,16 @@ struct AudioController::Data {
     AudioMixer mixer;
     AudioConverter converter;
     AudioBufferPtr input;
+    // secondary track and end pts of input pushed into analyzer; mixNext is
+    // owned by GUI thread until filter() takes it with MixTrack flag
+    AudioMixTrack *mix = nullptr, *mixNext = nullptr;
+    double mixGain = 1.0, mixDuck = 0.5;
+    double inPts = MP_NOPTS_VALUE, pushedPts = MP_NOPTS_VALUE;
+    // formats between stages, to reconfigure only what changed
+    struct {
+        AudioBufferFormat from, mixerIn, mixerOut, to;
+    } formats;
+    double reinitGain = -1.0;
     QVector<AudioBufferPtr> forFft;
     QVector<AudioFilter*> filters;
     QVector<AudioFilter*> chain;
@@ -104,6 +127,11 @@ AudioController::AudioController(QObject *parent)
 
 AudioController::~AudioController()
 {
+    // retired tracks are deleted by events
+    qApp->sendPostedEvents(this, RetireMixTrack);
+    if (d->mixNext != d->mix)
+        delete d->mixNext;
+    delete d->mix;
     delete d;
 }
 
@@ -144,18 +172,21 @@ auto AudioController::uninit() -> void
     d->af = nullptr;
     d->layout = ChannelLayoutInfo::default_();
     d->input = AudioBufferPtr();
+    // drop queued samples but keep formats and gain history for next chain;
+    // analyzer continues from last applied gain
+    for (auto filter : d->filters)
+        filter->reset();
+    if (d->mix)
+        d->mix->reset();
+    d->inPts = d->pushedPts = MP_NOPTS_VALUE;
 }
 
 auto AudioController::reinitialize(mp_audio *from) -> int
 {
     if (!from)
         return AF_ERROR;
-    d->measure.reset();
-    d->samples = 0;
-    if (_Change(d->srate, 0))
-        emit samplerateChanged(d->srate);
-    if (_Change(d->gain, 1.0))
-        emit samplerateChanged(d->gain);
+    QElapsedTimer timer;
+    timer.start();
 
     auto makeFormat = [] (const mp_audio *audio) {
         AudioFormat format;
@@ -198,24 +229,62 @@ auto AudioController::reinitialize(mp_audio *from) -> int
     const AudioBufferFormat buf_mixer_out(d->fmt_interm, to->channels, to->rate);
     const AudioBufferFormat buf_to(to);
 
-    d->resampler.setFormat(buf_from, buf_mixer_in);
-    d->analyzer.setFormat(buf_mixer_in);
-    d->scaler.setFormat(buf_mixer_in);
-    d->mixer.setFormat(buf_mixer_in, buf_mixer_out);
-    d->mixer.setChannelLayoutMap(d->map);
-    d->mixer.setSoftClip(d->softClip);
-    d->converter.setFormat(buf_to);
+    // stages whose formats are kept also keep their state, e.g. gain
+    // history of normalizer or equalizer, so track switches stay seamless
+    auto &f = d->formats;
+    const bool first = f.mixerIn.fps() <= 0;
+    const bool input = _Change(f.from, buf_from);
+    const bool interm = _Change(f.mixerIn, buf_mixer_in);
+    const bool mixed = _Change(f.mixerOut, buf_mixer_out);
+    const bool output = _Change(f.to, buf_to);
+    int stages = 0;
+    if (input || interm) {
+        d->resampler.setFormat(buf_from, buf_mixer_in);
+        d->resampler.reset();
+        ++stages;
+    }
+    if (interm) {
+        d->analyzer.setFormat(buf_mixer_in);
+        d->scaler.setFormat(buf_mixer_in);
+        d->vis.reset();
+        stages += 2;
+    }
+    if (interm || mixed) {
+        d->mixer.setFormat(buf_mixer_in, buf_mixer_out);
+        if (!first)
+            d->mixer.fadeIn(buf_mixer_out.secToFrames(FadeSec));
+        ++stages;
+    }
+    if (output) {
+        d->converter.setFormat(buf_to);
+        ++stages;
+    }
+    if (input) {
+        d->measure.reset();
+        d->samples = 0;
+        if (_Change(d->srate, 0))
+            emit samplerateChanged(d->srate);
+    }
 
     d->fmt_to = (af_format)to->format;
-    d->dirty = 0xffffffff;
+    d->mutex.lock();
+    d->dirty |= Normalizer | ChMap | Clip | Equalizer | Compensation;
+    if (interm)
+        d->dirty |= Scale;
+    d->mutex.unlock();
     d->eof = false;
 
-    for (auto filter : d->filters) {
+    for (auto filter : d->filters)
         filter->setPool(d->af->out_pool);
-        filter->reset();
+    if (d->mix) {
+        d->mix->setPool(d->af->out_pool);
+        d->mix->setFormat(buf_mixer_in);
     }
-    d->vis.reset();
-    emit gainChanged(d->gain = d->normalizerActivated ? d->analyzer.gain() : -1);
+    d->reinitGain = d->normalizerActivated ? d->analyzer.gain() : -1.0;
+    if (_Change<double>(d->gain, d->reinitGain))
+        emit gainChanged(d->gain);
+    _Debug("Audio chain reinitialized in %%us with %% stage(s) reconfigured",
+           timer.nsecsElapsed() / 1000, stages);
     return true;
 }
 
@@ -249,6 +318,9 @@ auto AudioController::control(int cmd, void *arg) -> int
     case AF_CONTROL_RESET:
         for (auto filter : d->filters)
             filter->reset();
+        if (d->mix)
+            d->mix->reset();
+        d->inPts = d->pushedPts = MP_NOPTS_VALUE;
         return AF_OK;
     default:
         return AF_UNKNOWN;
@@ -274,6 +346,22 @@ auto AudioController::filter(mp_audio *data) -> int
             d->mixer.setSoftClip(d->softClip);
         if (d->dirty & Equalizer)
             d->mixer.setEqualizer(d->eq);
+        if (d->dirty & Compensation)
+            d->resampler.setCompensation(d->syncRatio * d->clockRatio);
+        if (d->dirty & MixTrack) {
+            // deleting a track joins its decoder thread; not in audio thread
+            if (d->mix)
+                _PostEvent(this, RetireMixTrack, d->mix);
+            d->mix = d->mixNext;
+            if (d->mix && d->af) {
+                d->mix->setPool(d->af->out_pool);
+                d->mix->setFormat(d->formats.mixerIn);
+            }
+        }
+        if ((d->dirty & (MixTrack | MixLevel)) && d->mix) {
+            d->mix->setGain(d->mixGain);
+            d->mix->setDucking(d->mixDuck);
+        }
         d->dirty = 0;
         d->mutex.unlock();
     }
@@ -283,6 +371,7 @@ auto AudioController::filter(mp_audio *data) -> int
         return 0;
     d->measure.push(d->samples += data->samples);
     d->input = AudioBuffer::fromMpAudio(data);
+    d->inPts = d->af->stream->pts;
     return 0;
 }
 
@@ -292,13 +381,27 @@ auto AudioController::output() -> int
         auto buffer = d->resampler.run(d->input);
         d->input = AudioBufferPtr();
         d->analyzer.push(buffer);
+        // latency of swr itself is well below sync tolerance of mixing
+        d->pushedPts = d->inPts;
     }
     do {
         auto buffer = d->analyzer.pull(d->eof);
         if (!buffer || buffer->isEmpty())
             break;
+        if (d->mix && d->pushedPts != MP_NOPTS_VALUE) {
+            const double queued = d->analyzer.delay() * d->scale + buffer->seconds();
+            d->mix->mix(buffer, d->pushedPts - queued);
+        }
         if (d->vis.isActive())
             d->vis.analyze(buffer);
+        if (d->reinitGain >= 0.0) {
+            // gain history is kept across reinitialization
+            const double gain = d->analyzer.gain();
+            if (qAbs(gain - d->reinitGain) > GainJump * d->reinitGain)
+                _Warn("Normalizer gain jumped from %% to %% across reinitialization",
+                      d->reinitGain, gain);
+            d->reinitGain = -1.0;
+        }
         d->mixer.setAmplifier(d->amp * d->analyzer.gain());
         for (auto filter : d->chain) {
             if (!filter->passthrough(buffer))
@@ -402,3 +505,55 @@ auto AudioController::visualizer() const -> AudioVisualizer*
 {
     return &d->vis;
 }
+
+auto AudioController::setSyncRatio(double ratio) -> void
+{
+    d->mutex.lock();
+    d->syncRatio = ratio;
+    d->dirty |= Compensation;
+    d->mutex.unlock();
+}
+
+auto AudioController::setClockRatio(double ratio) -> void
+{
+    d->mutex.lock();
+    d->clockRatio = ratio;
+    d->dirty |= Compensation;
+    d->mutex.unlock();
+}
+
+auto AudioController::setMixTrack(const QString &file, int stream, double offset) -> void
+{
+    AudioMixTrack *track = nullptr;
+    if (!file.isEmpty())
+        track = new AudioMixTrack(file, stream, offset);
+    d->mutex.lock();
+    // replaced before audio thread took it
+    const auto unused = (d->dirty & MixTrack) ? d->mixNext : nullptr;
+    d->mixNext = track;
+    d->dirty |= MixTrack;
+    d->mutex.unlock();
+    delete unused;
+}
+
+auto AudioController::customEvent(QEvent *event) -> void
+{
+    if (event->type() == RetireMixTrack)
+        delete _GetData<AudioMixTrack*>(event);
+}
+
+auto AudioController::setMixGain(double gain) -> void
+{
+    d->mutex.lock();
+    d->mixGain = gain;
+    d->dirty |= MixLevel;
+    d->mutex.unlock();
+}
+
+auto AudioController::setMixDucking(double duck) -> void
+{
+    d->mutex.lock();
+    d->mixDuck = duck;
+    d->dirty |= MixLevel;
+    d->mutex.unlock();
+}
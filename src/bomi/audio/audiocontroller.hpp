@@ -21,6 +21,14 @@ public:
     auto setChannelLayoutMap(const ChannelLayoutMap &map) -> void;
     auto setOutputChannelLayout(ChannelLayout layout) -> void;
     auto setEqualizer(const AudioEqualizer &eq) -> void;
+    // resample continuously to play ratio times faster without telling mpv
+    auto setSyncRatio(double ratio) -> void;
+    // same as sync ratio but for following another clock; both multiply
+    auto setClockRatio(double ratio) -> void;
+    // mix another audio stream into main one; empty file to stop mixing
+    auto setMixTrack(const QString &file, int stream, double offset) -> void;
+    auto setMixGain(double gain) -> void;
+    auto setMixDucking(double duck) -> void;
     auto chmap() const -> mp_chmap*;
     auto inputFormat() const -> AudioFormat;
     auto outputFormat() const -> AudioFormat;
@@ -41,6 +49,7 @@ private:
     auto output() -> int;
     auto uninit() -> void;
     auto control(int cmd, void *arg) -> int;
+    auto customEvent(QEvent *event) -> void final;
     struct Data;
     Data *d;
     friend auto create_info() -> af_info;
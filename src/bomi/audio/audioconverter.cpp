@@ -1,6 +1,7 @@
 #include "audioconverter.hpp"
 
 #include "misc/tmp.hpp"
+#include "misc/cpukernel.hpp"
 #include "tmp/type_traits.hpp"
 extern "C" {
 #include <audio/format.h>
@@ -17,6 +18,50 @@ static auto convert(uchar *dst, float src) -> void
         *value = src * _Max<T>() + 0.5;
 }
 
+template<class T>
+CPU_INLINE auto convertSamples(T *__restrict dst, const float *__restrict src,
+                               int samples) -> void
+{
+    for (int i = 0; i < samples; ++i)
+        dst[i] = src[i] * _Max<T>() + 0.5;
+}
+
+template<int>
+CPU_INLINE auto s16Body(qint16 *dst, const float *src, int samples) -> void
+{ convertSamples(dst, src, samples); }
+
+template<int>
+CPU_INLINE auto s32Body(qint32 *dst, const float *src, int samples) -> void
+{ convertSamples(dst, src, samples); }
+
+CPU_KERNEL_VARIANTS(s16, void, (qint16 *dst, const float *src, int samples), (dst, src, samples))
+CPU_KERNEL_VARIANTS(s32, void, (qint32 *dst, const float *src, int samples), (dst, src, samples))
+
+template<class T>
+SIA benchConvert(auto (*convert)(T*, const float*, int) -> void) -> void
+{
+    static const auto samples = CpuKernels::noise<float>(8192);
+    static std::vector<T> dst(samples.size());
+    convert(dst.data(), samples.data(), samples.size());
+}
+
+template<class T>
+SIA checkConvert(auto (*convert)(T*, const float*, int) -> void,
+                 auto (*generic)(T*, const float*, int) -> void) -> bool
+{
+    const auto samples = CpuKernels::noise<float>(2051);
+    std::vector<T> out(samples.size()), ref(samples.size());
+    convert(out.data(), samples.data(), samples.size());
+    generic(ref.data(), samples.data(), samples.size());
+    return CpuKernels::same(out, ref);
+}
+
+static CpuKernel<auto (qint16*, const float*, int) -> void>
+s_s16("audio-convert-s16", CPU_KERNEL_LIST(s16), benchConvert<qint16>, checkConvert<qint16>);
+
+static CpuKernel<auto (qint32*, const float*, int) -> void>
+s_s32("audio-convert-s32", CPU_KERNEL_LIST(s32), benchConvert<qint32>, checkConvert<qint32>);
+
 
 auto AudioConverter::setFormat(const AudioBufferFormat &format) -> void
 {
@@ -64,6 +109,10 @@ auto AudioConverter::run(AudioBufferPtr &in) -> AudioBufferPtr
                 dst += dest->bps();
             }
         }
+    } else if (m_format.type() == AF_FORMAT_S16) {
+        s_s16((qint16*)dest->data()[0], sview.begin(), sview.end() - sview.begin());
+    } else if (m_format.type() == AF_FORMAT_S32) {
+        s_s32((qint32*)dest->data()[0], sview.begin(), sview.end() - sview.begin());
     } else {
         uchar *dst = dest->data()[0];
         for (auto it = sview.begin(); it != sview.end(); ++it) {
@@ -1,4 +1,5 @@
 #include "audiomixer.hpp"
+#include "misc/cpukernel.hpp"
 
 static auto LambertW1(const double z) -> double {
     const double eps=4.0e-16, em1=0.3678794411714423215955237701614608;
@@ -61,6 +62,28 @@ static auto hardclip(float p) -> float
     return p < -1.0 ? -1.0 : p > 1.0 ? 1.0 : p;
 }
 
+template<int>
+CPU_INLINE auto gainClipBody(float *p, int samples, float gain) -> void
+{
+    for (int i = 0; i < samples; ++i) {
+        const float v = p[i] * gain;
+        p[i] = v < -1.f ? -1.f : v > 1.f ? 1.f : v;
+    }
+}
+
+CPU_KERNEL_VARIANTS(gainClip, void, (float *p, int samples, float gain), (p, samples, gain))
+
+static CpuKernel<auto (float*, int, float) -> void>
+s_gainClip("audio-gain-clip", CPU_KERNEL_LIST(gainClip), [] (auto gainClip) {
+    static auto samples = CpuKernels::noise<float>(8192);
+    gainClip(samples.data(), samples.size(), 1.0f);
+}, [] (auto gainClip, auto generic) {
+    auto out = CpuKernels::noise<float>(2051), ref = out;
+    gainClip(out.data(), out.size(), 1.5f);
+    generic(ref.data(), ref.size(), 1.5f);
+    return CpuKernels::same(out, ref);
+});
+
 static constexpr int Bands = AudioEqualizer::bands();
 
 struct AudioMixer::Data {
@@ -73,6 +96,7 @@ struct AudioMixer::Data {
     ChannelLayoutMap map;
     AudioEqualizer eq;
     bool eq_zero = true;
+    int fade = 0, fadeFrames = 0;
 
     const std::vector<CompressInfo> compressInfo = CompressInfo::create();
 
@@ -189,23 +213,33 @@ auto AudioMixer::run(AudioBufferPtr &src) -> AudioBufferPtr
         return v;
     };
 
+    auto amp = [=] () -> float {
+        if (d->fade >= d->fadeFrames)
+            return d->amp;
+        return d->amp * float(d->fade++) / d->fadeFrames;
+    };
+
     if (d->amp < 1e-8)
         std::fill(dview.begin(), dview.end(), 0);
+    else if (!d->mix && d->eq_zero && !d->softClip && d->fade >= d->fadeFrames)
+        s_gainClip(dview.begin(), dview.end() - dview.begin(), d->amp);
     else if (!d->mix) {
         auto it = dview.begin();
         while (it != dview.end()) {
+            const float a = amp();
             for (int ch = 0; ch < src->channels(); ++ch, ++it)
-                *it = clip(equalize(*it * d->amp, ch));
+                *it = clip(equalize(*it * a, ch));
         }
     } else {
         auto dit = dview.begin();
         for (auto sit = sview.begin(); sit != sview.end(); sit += src->channels()) {
+            const float a = amp();
             for (int dch = 0; dch < dest->channels(); ++dch) {
                 const auto spk = d->out.channels().speaker[dch];
                 auto &map = d->ch_man.sources(spk);
                 double v = 0;
                 for (int i=0; i<map.size(); ++i)
-                    v += sit[d->ch_index_src[map[i]]]*d->amp;
+                    v += sit[d->ch_index_src[map[i]]]*a;
                 if (map.size() > 1) {
                     // ref: http://www.voegler.eu/pub/audio/
                     //      digital-audio-mixing-and-normalization.html
@@ -226,3 +260,9 @@ auto AudioMixer::setSoftClip(bool soft) -> void
 {
     d->softClip = soft;
 }
+
+auto AudioMixer::fadeIn(int frames) -> void
+{
+    d->fade = 0;
+    d->fadeFrames = frames;
+}
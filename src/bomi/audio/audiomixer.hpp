@@ -16,6 +16,8 @@ public:
     auto setEqualizer(const AudioEqualizer &eq) -> void;
     auto setChannelLayoutMap(const ChannelLayoutMap &map) -> void;
     auto setSoftClip(bool soft) -> void;
+    // ramp up from silence where filter state could not be carried over
+    auto fadeIn(int frames) -> void;
     auto delay() const -> double override;
     auto run(AudioBufferPtr &in) -> AudioBufferPtr override;
     auto passthrough(const AudioBufferPtr &in) const -> bool override;
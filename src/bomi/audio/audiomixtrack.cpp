@@ -0,0 +1,544 @@
+#include "audiomixtrack.hpp"
+#include "audioresampler.hpp"
+#include "audioanalyzer.hpp"
+#include "misc/log.hpp"
+#include <QElapsedTimer>
+#include <deque>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+}
+
+DECLARE_LOG_CONTEXT(Audio)
+
+// decoder reads ahead at most this much which bounds latency and memory
+static constexpr double MaxAheadSec = 0.5;
+// larger offset is fixed by dropping or padding instead of resampling
+static constexpr double HardSyncSec = 0.08;
+// larger offset means main stream has jumped so decoder has to seek
+static constexpr double SeekSec = 1.0;
+// small offset is caught up over this time with inaudible ratio
+static constexpr double CatchUpSec = 2.0;
+static constexpr double MaxCompensation = 0.005;
+// level of mixed track which ducks main stream, about -40dBFS
+static constexpr double DuckThreshold = 0.01;
+static constexpr double AttackSec = 0.05;
+static constexpr double ReleaseSec = 0.5;
+// report mixing cost after this much audio
+static constexpr double ReportSec = 30.0;
+
+// dst = dst * duck + src * gain where duck and gain ramp by steps per sample
+SIA mixScalar(float *dst, const float *src, int n,
+              float duck, float dduck, float gain, float dgain) -> void
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i] = dst[i] * duck + src[i] * gain;
+        duck += dduck;
+        gain += dgain;
+    }
+}
+
+SIA mixVector(float *dst, const float *src, int n,
+              float duck, float dduck, float gain, float dgain) -> void
+{
+    int i = 0;
+#ifdef __SSE__
+    auto ramp = [] (float v, float step)
+        { return _mm_setr_ps(v, v + step, v + 2*step, v + 3*step); };
+    __m128 d4 = ramp(duck, dduck), g4 = ramp(gain, dgain);
+    const __m128 dd4 = _mm_set1_ps(4*dduck), dg4 = _mm_set1_ps(4*dgain);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 a = _mm_loadu_ps(dst + i), b = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(a, d4), _mm_mul_ps(b, g4)));
+        d4 = _mm_add_ps(d4, dd4);
+        g4 = _mm_add_ps(g4, dg4);
+    }
+#endif
+    mixScalar(dst + i, src + i, n - i, duck + i*dduck, dduck, gain + i*dgain, dgain);
+}
+
+struct MixChunk {
+    double pts = 0.0;
+    std::vector<float> samples; // interleaved float in target format
+};
+
+class MixDecoder : public QThread {
+public:
+    MixDecoder(const QString &file, int stream, double offset)
+        : m_file(file), m_stream(stream), m_offset(offset) { }
+    ~MixDecoder()
+    {
+        m_mutex.lock();
+        m_stop = true;
+        m_cond.wakeAll();
+        m_mutex.unlock();
+        wait();
+        if (m_swr)
+            swr_free(&m_swr);
+        if (m_frame)
+            av_frame_free(&m_frame);
+        if (m_codec)
+            avcodec_close(m_codec);
+        if (m_fmt)
+            avformat_close_input(&m_fmt);
+    }
+    auto setFormat(const AudioBufferFormat &format) -> void
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_format == format)
+            return;
+        m_format = format;
+        ++m_serial;
+        clear();
+    }
+    // drop queued chunks and decode again from pts
+    auto seek(double pts) -> void
+    {
+        QMutexLocker locker(&m_mutex);
+        m_seekPts = pts;
+        m_seeking = true;
+        ++m_serial;
+        clear();
+    }
+    auto take(MixChunk *chunk) -> bool
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.empty())
+            return false;
+        *chunk = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_queued -= chunk->samples.size();
+        m_cond.wakeAll();
+        return true;
+    }
+private:
+    auto clear() -> void
+    {
+        m_queue.clear();
+        m_queued = 0;
+        m_cond.wakeAll();
+    }
+    auto open() -> bool
+    {
+        if (avformat_open_input(&m_fmt, m_file.toLocal8Bit().constData(), nullptr, nullptr) < 0)
+            return false;
+        if (avformat_find_stream_info(m_fmt, nullptr) < 0)
+            return false;
+        AVCodec *dec = nullptr;
+        if (m_stream < 0) {
+            m_idx = av_find_best_stream(m_fmt, AVMEDIA_TYPE_AUDIO, -1, -1, &dec, 0);
+            const auto start = m_fmt->start_time != AV_NOPTS_VALUE ? m_fmt->start_time : 0;
+            m_shift = m_offset - start / (double)AV_TIME_BASE;
+        } else if (m_stream < (int)m_fmt->nb_streams) {
+            m_idx = m_stream;
+            dec = avcodec_find_decoder(m_fmt->streams[m_idx]->codec->codec_id);
+        }
+        if (m_idx < 0 || !dec)
+            return false;
+        m_st = m_fmt->streams[m_idx];
+        if (m_st->codec->codec_type != AVMEDIA_TYPE_AUDIO)
+            return false;
+        for (unsigned i = 0; i < m_fmt->nb_streams; ++i) {
+            if ((int)i != m_idx)
+                m_fmt->streams[i]->discard = AVDISCARD_ALL;
+        }
+        if (avcodec_open2(m_st->codec, dec, nullptr) < 0)
+            return false;
+        m_codec = m_st->codec;
+        m_frame = av_frame_alloc();
+        return m_frame;
+    }
+    auto run() -> void final
+    {
+        if (!open()) {
+            _Error("Cannot open audio stream %% of '%%' for mixing.", m_stream, m_file);
+            return;
+        }
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr; pkt.size = 0;
+        AudioBufferFormat format;
+        int serial = -1;
+        for (;;) {
+            bool seek = false;
+            double pts = 0.0;
+            m_mutex.lock();
+            auto full = [&] () {
+                return m_eof || m_queued >= m_format.secToFrames(MaxAheadSec)
+                                            * m_format.channels().num;
+            };
+            while (!m_stop && (m_format.fps() <= 0 || (!m_seeking && full())))
+                m_cond.wait(&m_mutex);
+            if (m_stop) {
+                m_mutex.unlock();
+                break;
+            }
+            if (m_seeking) {
+                m_seeking = false;
+                m_eof = false;
+                seek = true;
+                pts = m_seekPts;
+            }
+            if (serial != m_serial && format != m_format) {
+                format = m_format;
+                if (m_swr)
+                    swr_free(&m_swr);
+            }
+            serial = m_serial;
+            m_mutex.unlock();
+
+            if (seek) {
+                const auto ts = (int64_t)((pts - m_shift) / av_q2d(m_st->time_base));
+                av_seek_frame(m_fmt, m_idx, ts, AVSEEK_FLAG_BACKWARD);
+                avcodec_flush_buffers(m_codec);
+                if (m_swr)
+                    swr_free(&m_swr);
+                m_skipUntil = pts;
+            }
+            if (av_read_frame(m_fmt, &pkt) < 0) {
+                m_mutex.lock();
+                m_eof = true;
+                m_mutex.unlock();
+                continue;
+            }
+            if (pkt.stream_index == m_idx) {
+                AVPacket left = pkt;
+                while (left.size > 0) {
+                    int got = 0;
+                    const int len = avcodec_decode_audio4(m_codec, m_frame, &got, &left);
+                    if (len < 0)
+                        break;
+                    left.data += len;
+                    left.size -= len;
+                    if (got)
+                        convert(format, serial);
+                }
+            }
+            av_free_packet(&pkt);
+        }
+    }
+    auto convert(const AudioBufferFormat &format, int serial) -> void
+    {
+        const auto ts = av_frame_get_best_effort_timestamp(m_frame);
+        if (ts == AV_NOPTS_VALUE)
+            return;
+        const int rate = m_frame->sample_rate;
+        const int nch = format.channels().num;
+        const auto in = m_frame->channel_layout ? m_frame->channel_layout
+                      : av_get_default_channel_layout(av_frame_get_channels(m_frame));
+        if (m_swr && (m_in.rate != rate || m_in.layout != in || m_in.format != m_frame->format))
+            swr_free(&m_swr);
+        if (!m_swr) {
+            auto out = mp_chmap_to_lavc(&format.channels());
+            if (!out)
+                out = av_get_default_channel_layout(nch);
+            m_swr = swr_alloc_set_opts(nullptr, out, AV_SAMPLE_FMT_FLT, format.fps(),
+                                       in, (AVSampleFormat)m_frame->format, rate, 0, nullptr);
+            if (!m_swr || swr_init(m_swr) < 0) {
+                if (m_swr)
+                    swr_free(&m_swr);
+                return;
+            }
+            m_in.rate = rate; m_in.layout = in; m_in.format = m_frame->format;
+        }
+        const auto delay = swr_get_delay(m_swr, rate);
+        MixChunk chunk;
+        chunk.pts = ts * av_q2d(m_st->time_base) + m_shift - delay / (double)rate;
+        const int max = av_rescale_rnd(delay + m_frame->nb_samples, format.fps(),
+                                       rate, AV_ROUND_UP);
+        chunk.samples.resize(max * nch);
+        auto dst = reinterpret_cast<uint8_t*>(chunk.samples.data());
+        const int frames = swr_convert(m_swr, &dst, max,
+                                       (const uint8_t**)m_frame->extended_data,
+                                       m_frame->nb_samples);
+        if (frames <= 0)
+            return;
+        // seeking lands before target; keep only what can still be played
+        if (chunk.pts + format.toSeconds(frames) < m_skipUntil)
+            return;
+        chunk.samples.resize(frames * nch);
+        QMutexLocker locker(&m_mutex);
+        if (serial != m_serial)
+            return;
+        m_queued += chunk.samples.size();
+        m_queue.push_back(std::move(chunk));
+    }
+
+    QString m_file;
+    int m_stream = -1, m_idx = -1;
+    double m_offset = 0.0, m_shift = 0.0, m_skipUntil = 0.0;
+    AVFormatContext *m_fmt = nullptr;
+    AVCodecContext *m_codec = nullptr;
+    AVStream *m_st = nullptr;
+    AVFrame *m_frame = nullptr;
+    SwrContext *m_swr = nullptr;
+    struct { int rate = 0, format = -1; uint64_t layout = 0; } m_in;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    std::deque<MixChunk> m_queue;
+    AudioBufferFormat m_format;
+    int m_queued = 0, m_serial = 0; // queued in samples
+    double m_seekPts = 0.0;
+    bool m_seeking = false, m_eof = false, m_stop = false;
+};
+
+struct AudioMixTrack::Data {
+    QString file;
+    int stream = -1;
+    MixDecoder *decoder = nullptr;
+    AudioResampler resampler;
+    AudioBufferFormat format;
+    std::vector<float> fifo;
+    int head = 0, nch = 0;
+    // pts of fifo head and source seconds per output frame
+    double pts = 0.0, step = 0.0, ratio = 1.0, seekedAt = 0.0;
+    bool synced = false, requested = false;
+    double gain = 1.0, duck = 0.5, envelope = 1.0;
+    double appliedGain = 0.0, appliedDuck = 1.0;
+    struct { qint64 total = 0, max = 0; int blocks = 0; double sec = 0.0; } cost;
+
+    auto frames() const -> int { return nch ? ((int)fifo.size() - head) / nch : 0; }
+    auto clear() -> void { fifo.clear(); head = 0; synced = false; }
+    auto consume(int frames) -> void
+    {
+        head += frames * nch;
+        pts += frames * step * ratio;
+        if (head >= (int)fifo.size()) {
+            fifo.clear();
+            head = 0;
+        }
+    }
+    // move a decoded chunk through resampler into fifo
+    auto fill() -> bool
+    {
+        MixChunk chunk;
+        if (!decoder->take(&chunk))
+            return false;
+        const int frames = chunk.samples.size() / nch;
+        if (frames <= 0)
+            return true;
+        if (synced && !fifo.empty()) {
+            // correct estimation of head to make fifo continue to this chunk
+            const double diff = chunk.pts - (pts + this->frames() * step * ratio);
+            if (qAbs(diff) > HardSyncSec)
+                clear();
+            else
+                pts += diff;
+        }
+        if (!synced || fifo.empty()) {
+            fifo.clear(); head = 0;
+            pts = chunk.pts;
+            synced = true;
+        }
+        auto in = resampler.newBuffer(format, frames);
+        auto view = in->view<float>();
+        memcpy(view.begin(), chunk.samples.data(), chunk.samples.size() * sizeof(float));
+        const auto out = resampler.run(in);
+        const auto src = out->constView<float>();
+        if (head > 0 && head * 2 >= (int)fifo.size()) {
+            fifo.erase(fifo.begin(), fifo.begin() + head);
+            head = 0;
+        }
+        fifo.insert(fifo.end(), src.begin(), src.end());
+        return true;
+    }
+    auto ensure(int frames) -> void { while (this->frames() < frames && fill()) { } }
+};
+
+AudioMixTrack::AudioMixTrack(const QString &file, int stream, double offset)
+    : d(new Data)
+{
+    d->file = file;
+    d->stream = stream;
+    d->decoder = new MixDecoder(file, stream, offset);
+    d->decoder->start(QThread::HighPriority);
+}
+
+AudioMixTrack::~AudioMixTrack()
+{
+    delete d->decoder;
+    delete d;
+}
+
+auto AudioMixTrack::file() const -> QString
+{
+    return d->file;
+}
+
+auto AudioMixTrack::stream() const -> int
+{
+    return d->stream;
+}
+
+auto AudioMixTrack::setPool(mp_audio_pool *pool) -> void
+{
+    d->resampler.setPool(pool);
+}
+
+auto AudioMixTrack::setFormat(const AudioBufferFormat &format) -> void
+{
+    if (!_Change(d->format, format))
+        return;
+    d->nch = format.channels().num;
+    d->step = format.fps() > 0 ? 1.0 / format.fps() : 0.0;
+    d->resampler.setFormat(format, format);
+    d->decoder->setFormat(format);
+    reset();
+}
+
+auto AudioMixTrack::setGain(double gain) -> void
+{
+    d->gain = gain;
+}
+
+auto AudioMixTrack::setDucking(double duck) -> void
+{
+    d->duck = duck;
+}
+
+auto AudioMixTrack::reset() -> void
+{
+    d->clear();
+    d->requested = false;
+    d->envelope = 1.0;
+    // fade in from silence after discontinuity
+    d->appliedGain = 0.0;
+    d->resampler.reset();
+}
+
+auto AudioMixTrack::mix(AudioBufferPtr &buffer, double pts) -> void
+{
+    if (d->format.fps() <= 0 || buffer->channels() != d->nch
+            || buffer->fps() != d->format.fps() || buffer->isEmpty())
+        return;
+    QElapsedTimer timer;
+    timer.start();
+
+    const int frames = buffer->frames();
+    if (!d->synced && !d->requested) {
+        d->decoder->seek(pts);
+        d->requested = true;
+        d->seekedAt = pts;
+    }
+    d->ensure(frames);
+
+    int offset = 0;
+    if (d->synced) {
+        d->requested = false;
+        const double drift = d->pts - pts;
+        if (qAbs(drift) > SeekSec && qAbs(pts - d->seekedAt) > SeekSec) {
+            d->clear();
+            d->decoder->seek(pts);
+            d->requested = true;
+            d->seekedAt = pts;
+        } else if (drift < -HardSyncSec) {
+            int drop = qRound(-drift * d->format.fps());
+            while (drop > 0) {
+                d->ensure(1);
+                const int n = qMin(drop, d->frames());
+                if (n <= 0)
+                    break;
+                d->consume(n);
+                drop -= n;
+            }
+            d->ensure(frames);
+        } else if (drift > HardSyncSec) {
+            offset = qMin(frames, qRound(drift * d->format.fps()));
+        } else {
+            // ahead means secondary runs fast so it should be slowed down
+            d->ratio = 1.0 - qBound(-MaxCompensation, drift / CatchUpSec, MaxCompensation);
+            d->resampler.setCompensation(d->ratio);
+        }
+    }
+
+    const int avail = qBound(0, d->frames(), frames - offset);
+    const float *src = d->fifo.data() + d->head;
+    const double level = avail > 0 ? AudioAnalyzer::rms(src, avail * d->nch) : 0.0;
+    const double block = d->format.toSeconds(frames);
+    const double target = level > DuckThreshold ? d->duck : 1.0;
+    const double tau = target < d->envelope ? AttackSec : ReleaseSec;
+    d->envelope += (target - d->envelope) * (1.0 - exp(-block / tau));
+
+    auto view = buffer->view<float>();
+    float *dst = view.begin();
+    const int samples = frames * d->nch;
+    const float dduck = (d->envelope - d->appliedDuck) / samples;
+    const float dgain = (d->gain - d->appliedGain) / samples;
+    auto run = [&] (int from, int to, const float *s) {
+        const int i = from * d->nch, n = (to - from) * d->nch;
+        if (n <= 0)
+            return;
+        const float duck = d->appliedDuck + dduck * i;
+        if (s)
+            mixVector(dst + i, s, n, duck, dduck, d->appliedGain + dgain * i, dgain);
+        else // main stream only
+            mixVector(dst + i, dst + i, n, duck, dduck, 0.f, 0.f);
+    };
+    run(0, offset, nullptr);
+    run(offset, offset + avail, src);
+    run(offset + avail, frames, nullptr);
+    d->appliedDuck = d->envelope;
+    d->appliedGain = d->gain;
+    if (avail > 0)
+        d->consume(avail);
+
+    auto &cost = d->cost;
+    const auto nsec = timer.nsecsElapsed();
+    cost.total += nsec;
+    cost.max = qMax(cost.max, nsec);
+    ++cost.blocks;
+    cost.sec += block;
+    if (cost.sec >= ReportSec) {
+        _Debug("Mixing secondary track took %%us on average and %%us at most "
+               "for blocks of %%ms", cost.total / cost.blocks / 1000, cost.max / 1000,
+               qRound(cost.sec * 1000 / cost.blocks));
+        cost = {};
+    }
+}
+
+auto AudioMixTrack::benchmark() -> void
+{
+    QString line;
+    auto print = [&] () { qDebug().nospace() << line.toLocal8Bit().constData(); };
+    line.sprintf("%-7s %-3s %11s %11s %11s %9s", "frames", "ch",
+                 "scalar(ns)", "vector(ns)", "level(ns)", "load(%)");
+    print();
+    constexpr int fps = 48000;
+    volatile double sink = 0.0;
+    for (int frames : { 256, 1024, 4096 }) {
+        for (int nch : { 2, 6, 8 }) {
+            const int n = frames * nch;
+            std::vector<float> dst(n), src(n);
+            for (int i = 0; i < n; ++i) {
+                dst[i] = sin(i * 0.01);
+                src[i] = cos(i * 0.02);
+            }
+            const int loops = qMax(100, 20000000 / n);
+            auto measure = [&] (auto &&func) {
+                QElapsedTimer timer;
+                timer.start();
+                for (int i = 0; i < loops; ++i)
+                    func();
+                return timer.nsecsElapsed() / (double)loops;
+            };
+            const auto scalar = measure([&] () {
+                mixScalar(dst.data(), src.data(), n, 0.5f, 0.f, 0.5f, 0.f);
+            });
+            const auto vector = measure([&] () {
+                mixVector(dst.data(), src.data(), n, 0.5f, 0.f, 0.5f, 0.f);
+            });
+            const auto level = measure([&] () {
+                sink = sink + AudioAnalyzer::rms(src.data(), n);
+            });
+            const double load = (vector + level) / (frames * 1e9 / fps) * 100.0;
+            line.sprintf("%-7d %-3d %11.0f %11.0f %11.0f %9.4f",
+                         frames, nch, scalar, vector, level, load);
+            print();
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef AUDIOMIXTRACK_HPP
+#define AUDIOMIXTRACK_HPP
+
+#include "audiobuffer.hpp"
+
+// secondary audio stream such as commentary or dub which is decoded in its
+// own thread and mixed into main stream at the same presentation time
+class AudioMixTrack {
+public:
+    // stream is ff-index in file or -1 for best audio stream of external file
+    // whose timestamps are shifted by offset to start with main stream
+    AudioMixTrack(const QString &file, int stream, double offset);
+    ~AudioMixTrack();
+    auto file() const -> QString;
+    auto stream() const -> int;
+    // below are called in audio thread
+    auto setPool(mp_audio_pool *pool) -> void;
+    auto setFormat(const AudioBufferFormat &format) -> void;
+    auto setGain(double gain) -> void;
+    // gain for main stream while this track is audible
+    auto setDucking(double duck) -> void;
+    auto reset() -> void;
+    // buffer should be in the format given by setFormat and start at pts
+    auto mix(AudioBufferPtr &buffer, double pts) -> void;
+    // measure mixing cost per block and print to stdout
+    static auto benchmark() -> void;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // AUDIOMIXTRACK_HPP
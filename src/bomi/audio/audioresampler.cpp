@@ -10,7 +10,8 @@ struct AudioResampler::Data {
     AudioBufferFormat in, out;
     int fps = 1;
     bool resample = false;
-    double delay = 0.0, scale = 1.0;
+    double delay = 0.0, scale = 1.0, compensation = 1.0;
+    auto needsResample() const -> bool { return in != out || compensation != 1.0; }
     auto updateFps() -> void { fps = lrint(in.fps() * scale); }
 };
 
@@ -56,7 +57,7 @@ auto AudioResampler::setFormat(const AudioBufferFormat &in, const AudioBufferFor
     if (!(_Change(d->in, in) | _Change(d->out, out)))
         return;
     Q_ASSERT(d->in.channels().num == d->out.channels().num);
-    d->resample = d->in != d->out;
+    d->resample = d->needsResample();
 
     reconfigure();
 }
@@ -79,8 +80,14 @@ auto AudioResampler::run(AudioBufferPtr &in) -> AudioBufferPtr
     const int frames_delay = swr_get_delay(d->swr, d->in.fps());
     int frames = av_rescale_rnd(frames_delay + in->frames(),
                                 d->out.fps(), d->in.fps(), AV_ROUND_UP);
-    auto dst = newBuffer(d->out, frames);
     d->delay = (double)frames/d->in.fps();
+    if (d->compensation != 1.0 && frames > 0) {
+        // spread the drift over this buffer to avoid audible steps
+        const int delta = lrint(frames / d->compensation) - frames;
+        if (swr_set_compensation(d->swr, delta, frames) >= 0)
+            frames += qMax(0, delta);
+    }
+    auto dst = newBuffer(d->out, frames);
     if (frames > 0) {
         frames = swr_convert(d->swr, dst->data(), frames,
                              in->constData(), in->frames());
@@ -94,6 +101,14 @@ auto AudioResampler::setScale(double scale) -> void
     d->scale = scale;
 }
 
+auto AudioResampler::setCompensation(double ratio) -> void
+{
+    if (!_Change(d->compensation, ratio))
+        return;
+    if (_Change(d->resample, d->needsResample()))
+        reconfigure();
+}
+
 auto AudioResampler::reset() -> void
 {
     if (!d->swr)
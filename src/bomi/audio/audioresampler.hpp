@@ -10,6 +10,8 @@ public:
     auto setFormat(const AudioBufferFormat &in, const AudioBufferFormat &out) -> void;
     auto run(AudioBufferPtr &in) -> AudioBufferPtr override;
     auto setScale(double scale) -> void final;
+    // > 1.0 plays faster by dropping samples continuously
+    auto setCompensation(double ratio) -> void;
     auto delay() const -> double override;
     auto reset() -> void override;
     auto passthrough(const AudioBufferPtr &in) const -> bool override;
@@ -1,9 +1,68 @@
 #include "audioscaler.hpp"
+#include "misc/cpukernel.hpp"
 
 static constexpr const double m_ms_stride = 60.0;
 static constexpr const double m_percent_overlap = 0.20;
 static constexpr const double m_ms_search = 14.0;
 
+template<int Lanes>
+CPU_INLINE auto correlateBody(const float *a, const float *b, int samples) -> float
+{
+    float sum[Lanes] = { };
+    int i = 0;
+    for (; i + Lanes <= samples; i += Lanes) {
+        for (int j = 0; j < Lanes; ++j)
+            sum[j] += a[i + j] * b[i + j];
+    }
+    float corr = 0;
+    for (int j = 0; j < Lanes; ++j)
+        corr += sum[j];
+    for (; i < samples; ++i)
+        corr += a[i] * b[i];
+    return corr;
+}
+
+template<int>
+CPU_INLINE auto blendBody(float *__restrict dst, const float *__restrict from,
+                          const float *__restrict to, const float *__restrict blend,
+                          int samples) -> void
+{
+    for (int i = 0; i < samples; ++i)
+        dst[i] = from[i] - (blend[i] * (from[i] - to[i]));
+}
+
+CPU_KERNEL_VARIANTS(correlate, float, (const float *a, const float *b, int samples),
+                    (a, b, samples))
+CPU_KERNEL_VARIANTS(blend, void, (float *dst, const float *from, const float *to,
+                                  const float *blend, int samples),
+                    (dst, from, to, blend, samples))
+
+static CpuKernel<auto (const float*, const float*, int) -> float>
+s_correlate("audio-correlate", CPU_KERNEL_LIST(correlate), [] (auto correlate) {
+    static const auto samples = CpuKernels::noise<float>(4096);
+    correlate(samples.data(), samples.data() + 2048, 2048);
+}, [] (auto correlate, auto generic) {
+    const auto samples = CpuKernels::noise<float>(4102);
+    const auto a = samples.data(), b = a + 2051;
+    // partial sums are added in other order
+    return CpuKernels::same(correlate(a, b, 2051), generic(a, b, 2051), 1e-4);
+});
+
+static CpuKernel<auto (float*, const float*, const float*, const float*, int) -> void>
+s_blend("audio-blend", CPU_KERNEL_LIST(blend), [] (auto blend) {
+    static const auto samples = CpuKernels::noise<float>(6144);
+    static std::vector<float> dst(2048);
+    blend(dst.data(), samples.data(), samples.data() + 2048, samples.data() + 4096, 2048);
+}, [] (auto blend, auto generic) {
+    const auto samples = CpuKernels::noise<float>(2051 * 3);
+    const auto p = samples.data();
+    std::vector<float> out(2051), ref(2051);
+    blend(out.data(), p, p + 2051, p + 2051 * 2, 2051);
+    generic(ref.data(), p, p + 2051, p + 2051 * 2, 2051);
+    // fused multiply-add rounds once
+    return CpuKernels::same(out, ref, 1e-6);
+});
+
 auto AudioScaler::expand(Vector &vec, int frames) -> void
 {
     if ((int)vec.buffer.size() < f2s(frames))
@@ -24,7 +83,8 @@ auto AudioScaler::move(float *dst, int to, int from, int frames) const -> void
 auto AudioScaler::setFormat(const AudioBufferFormat &format) -> void
 {
     m_delay = 0.0;
-    m_format = format;
+    if (!_Change(m_format, format))
+        return;
     const double frames_per_ms = m_format.fps() / 1000.0;
     m_frames_stride = frames_per_ms * m_ms_stride;
     expand(m_overlap, qMax<int>(0, m_frames_stride * m_percent_overlap));
@@ -111,12 +171,8 @@ auto AudioScaler::run(AudioBufferPtr &in) -> AudioBufferPtr
     auto output_overlap = [this, &dview](int pos, int frames_off) -> void
     {
         const int samples = f2s(m_overlap.frames);
-        auto dit = dview.begin() + f2s(pos);
-        auto bit = _C(m_table_blend).data();
-        auto oit = _C(m_overlap).data();
-        auto qit = _C(m_queue).data() + f2s(frames_off);
-        for (int i = 0; i < samples; ++i, ++oit)
-            *dit++ = *oit - (*bit++ * (*oit - *qit++));
+        s_blend(dview.begin() + f2s(pos), _C(m_overlap).data(),
+                _C(m_queue).data() + f2s(frames_off), _C(m_table_blend).data(), samples);
     };
 
     while (m_frames_queued >= m_queue.frames) {
@@ -173,11 +229,7 @@ auto AudioScaler::best_overlap_frames_offset() -> int
     int best_off = 0;
     float best_corr = _Min<qint64>(), corr;
     for (int off = 0; off < m_frames_search; ++off) {
-        corr = 0;
-        auto cit = _C(m_buf_pre_corr).data();
-        auto qit = _C(m_queue).data() + f2s(1 + off);
-        for (int i = 0; i < samples; ++i)
-            corr += *cit++ * *qit++;
+        corr = s_correlate(_C(m_buf_pre_corr).data(), _C(m_queue).data() + f2s(1 + off), samples);
         if (corr > best_corr) {
             best_corr = corr;
             best_off  = off;
@@ -64,6 +64,7 @@ struct AudioVisualizer::Data {
     qreal min = 20, max = 20000;
     bool active = false, enabled = false;
     int fps = 0, count = 0;
+    QAtomicInt stride{1}; int skipped = 0;
     double minLv = _Max<double>(), maxLv = 0;
     Type type = None;
     QMutex mutex;
@@ -99,6 +100,11 @@ auto AudioVisualizer::analyze(const QSharedPointer<AudioBuffer> &data) -> void
         d->fft.setInputSize(d->fps * 0.1);
     if (!d->fft.push(data))
         return;
+    if (++d->skipped < d->stride.load()) {
+        d->fft.clear();
+        return;
+    }
+    d->skipped = 0;
     d->fft.run();
     auto &cpx = d->fft.output();
 
@@ -158,6 +164,11 @@ auto AudioVisualizer::analyze(const QSharedPointer<AudioBuffer> &data) -> void
     qApp->postEvent(this, new QEvent(UpdateData));
 }
 
+auto AudioVisualizer::setUpdateInterval(int ms) -> void
+{
+    d->stride.store(qMax(1, qRound(ms / 100.0)));
+}
+
 auto AudioVisualizer::min() const -> qreal
 {
     return d->min;
@@ -43,6 +43,8 @@ public:
     auto setYScale(Scale scale) -> void;
     auto setType(Visualization type) -> void;
     auto type() const -> Type;
+    // analysis runs on 100ms windows; longer interval skips windows
+    auto setUpdateInterval(int ms) -> void;
     // in af thread
     auto analyze(const QSharedPointer<AudioBuffer> &data) -> void;
     auto reset() -> void;
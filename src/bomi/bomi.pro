@@ -49,7 +49,7 @@ macx {
     QT += dbus x11extras
 	TARGET = bomi
 	LIBS += -ldl
-	HEADERS += player/mpris.hpp
+	HEADERS += player/mpris.hpp player/mpris_p.hpp
 	SOURCES += player/mpris.cpp
 } else:win32 {
     QT += winextras gui-private core-private
@@ -65,6 +65,28 @@ macx {
     }
 }
 
+# replaces global allocators to count allocations; see --alloc-profiler of
+# configure or pass CONFIG+=alloc_profiler to qmake
+alloc_profiler {
+    DEFINES += BOMI_ALLOC_PROFILER
+    SOURCES += misc/allocprofiler.cpp
+}
+
+# checks run by --self-test with their fixtures; see --self-test of configure
+# or pass CONFIG+=self_test to qmake
+self_test {
+    DEFINES += BOMI_SELF_TEST
+    HEADERS += test/selftest.hpp test/fixture.hpp
+    SOURCES += test/selftest.cpp test/fixture.cpp \
+        test/audioanalyzertest.cpp test/contactsheettest.cpp \
+        test/cpukerneltest.cpp test/decodertunertest.cpp \
+        test/encodersegmentstest.cpp test/framepacertest.cpp \
+        test/mediaservertest.cpp test/memorygovernortest.cpp \
+        test/opensubtitlestest.cpp test/playbacksynctest.cpp \
+        test/playlistmodeltest.cpp test/sessiontracetest.cpp
+    !macx:unix:SOURCES += test/mpristest.cpp
+}
+
 QML_IMPORT_PATH += imports
 
 DEFINES += _LARGEFILE_SOURCE "_FILE_OFFSET_BITS=64" _LARGEFILE64_SOURCE \
@@ -301,7 +323,27 @@ HEADERS += \
     dialog/encoderdialog.hpp \
     misc/filenamegenerator.hpp \
     enum/rotation.hpp \
-    player/videosettings.hpp
+    player/videosettings.hpp \
+    subtitle/opensubtitlescache.hpp \
+    dialog/encodersegments.hpp \
+    video/contactsheet.hpp \
+    video/framepacer.hpp \
+    player/timeshiftindex.hpp \
+    misc/memorygovernor.hpp \
+    player/powerprofile.hpp \
+    player/sessiontrace.hpp \
+    player/decodertuner.hpp \
+    player/mediaprobe.hpp \
+    player/disccache.hpp \
+    audio/audiomixtrack.hpp \
+    quick/propertybatch.hpp \
+    video/renderbenchmark.hpp \
+    misc/allocprofiler.hpp \
+    player/playbacksync.hpp \
+    player/probetuner.hpp \
+    player/mediaserver.hpp \
+    player/livelatency.hpp \
+    misc/cpukernel.hpp
 
 SOURCES += \
 	stdafx.cpp \
@@ -519,7 +561,26 @@ SOURCES += \
     dialog/encoderdialog.cpp \
     misc/filenamegenerator.cpp \
     enum/rotation.cpp \
-    player/videosettings.cpp
+    player/videosettings.cpp \
+    subtitle/opensubtitlescache.cpp \
+    dialog/encodersegments.cpp \
+    video/contactsheet.cpp \
+    video/framepacer.cpp \
+    player/timeshiftindex.cpp \
+    misc/memorygovernor.cpp \
+    player/powerprofile.cpp \
+    player/sessiontrace.cpp \
+    player/decodertuner.cpp \
+    player/mediaprobe.cpp \
+    player/disccache.cpp \
+    audio/audiomixtrack.cpp \
+    quick/propertybatch.cpp \
+    video/renderbenchmark.cpp \
+    player/playbacksync.cpp \
+    player/probetuner.cpp \
+    player/mediaserver.cpp \
+    player/livelatency.cpp \
+    misc/cpukernel.cpp
 
 TRANSLATIONS += translations/bomi_en.ts \
 	translations/bomi_ko.ts \
@@ -7,12 +7,24 @@
 #include "misc/dataevent.hpp"
 #include "misc/osdstyle.hpp"
 #include "player/streamtrack.hpp"
+#include "dialog/encodersegments.hpp"
 #include <QCloseEvent>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <atomic>
 extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+DECLARE_LOG_CONTEXT(Encoder)
+
 static constexpr int TickEvent = QEvent::User + 1;
+static constexpr int ErrorEvent = QEvent::User + 2;
+static constexpr int StageTickEvent = QEvent::User + 3;
+static constexpr int SplitEvent = QEvent::User + 4;
+static constexpr int ConcatEvent = QEvent::User + 5;
+// shorter segments cost more in encoder warm-up than they gain
+static constexpr int MinSegmentLength = 10000;
 
 enum FrameRate { CFRAuto, CFRManual, VFR };
 
@@ -45,10 +57,32 @@ auto operator << (QDebug dbg, const CodecPair &cp) -> QDebug
     return dbg << cp.ac << cp.vc;
 }
 
+// finding keyframes and concatenating segments read whole media
+class SegmentWorker : public QThread {
+public:
+    SegmentWorker(std::function<void()> &&work): m_work(std::move(work)) { }
+private:
+    auto run() -> void final { m_work(); }
+    std::function<void()> m_work;
+};
+
+struct EncoderJob {
+    QSharedPointer<Mpv> mpv;
+    QString file;
+    int start = 0, end = 0, tick = -1;
+    auto progress() const -> int // in 100ms
+        { return tick < 0 ? 0 : qBound(0, tick - start/100, (end - start)/100); }
+};
+
 struct EncoderDialog::Data {
     EncoderDialog *p = nullptr;
     Ui::EncoderDialog ui;
-    QSharedPointer<Mpv> mpv;
+    QVector<EncoderJob> jobs;
+    QTemporaryDir *temp = nullptr;
+    SegmentWorker *worker = nullptr;
+    std::atomic<bool> canceled{false};
+    QElapsedTimer elapsed, total;
+    QString output;
     QByteArray source;
     StreamTrack audio, sub;
     OsdStyle style;
@@ -60,10 +94,281 @@ struct EncoderDialog::Data {
     QMap<QString, CodecPair> fmts;
     QString ext, ac, vc;
     QRect crop;
-    int tick = -1, error = MPV_ERROR_SUCCESS;
+    int error = MPV_ERROR_SUCCESS;
     bool resizing = false;
     auto aspect() const -> double
         { return size.isEmpty() ? 1.0 : size.width() / (double)size.height(); }
+    auto updateProgress() -> void
+    {
+        int done = 0;
+        QStringList tips;
+        for (int i = 0; i < jobs.size(); ++i) {
+            const auto &job = jobs[i];
+            const int length = qMax(1, (job.end - job.start)/100);
+            done += job.progress();
+            tips.push_back(tr("Segment %1: %2 - %3 (%4%)").arg(i + 1)
+                           .arg(_MSecToString(job.start, u"hh:mm:ss.zzz"_q))
+                           .arg(_MSecToString(job.end, u"hh:mm:ss.zzz"_q))
+                           .arg(job.progress() * 100 / length));
+        }
+        ui.prog->setValue(done);
+        ui.prog->setToolTip(tips.join('\n'_q));
+        const int total = ui.prog->maximum();
+        if (done > 0 && total > done) {
+            const qint64 eta = elapsed.elapsed() * (total - done) / done;
+            ui.prog->setFormat("%p% ("_a % tr("ETA %1").arg(_MSecToString(eta)) % ')'_q);
+        }
+    }
+    auto finish(int i) -> void
+    {
+        if (!_InRange0(i, jobs.size()) || !jobs[i].mpv)
+            return;
+        auto &job = jobs[i];
+        job.mpv->destroy();
+        job.mpv.clear();
+        job.tick = job.end / 100;
+        updateProgress();
+        for (auto &j : jobs) {
+            if (j.mpv)
+                return;
+        }
+        if (error != MPV_ERROR_SUCCESS)
+            done(QString::fromUtf8(mpv_error_string(error)));
+        else if (jobs.size() > 1)
+            concat();
+        else
+            done(QString());
+    }
+    auto done(const QString &msg) -> void
+    {
+        const auto length = jobs.last().end - jobs.first().start;
+        _Info("Encoded %%ms of media in %%ms with %% segment(s) on %% core(s).",
+              length, total.elapsed(), jobs.size(), QThread::idealThreadCount());
+        jobs.clear();
+        _Delete(temp);
+        start->setEnabled(true);
+        ui.prog->setFormat(u"%p%"_q);
+        ui.prog->setToolTip(QString());
+        if (!msg.isEmpty())
+            MBox::error(p, tr("Encoder"), msg, { BBox::Ok }, BBox::Ok);
+        p->hide();
+    }
+    // runs on worker thread which reports progress by StageTickEvent
+    auto work(std::function<void(const SegmentProgress&)> &&run) -> void
+    {
+        Q_ASSERT(!worker);
+        canceled = false;
+        worker = new SegmentWorker([this, run] () {
+            int last = -1;
+            run([&] (int msec) {
+                if (_Change(last, msec / 100))
+                    _PostEvent(p, StageTickEvent, last);
+                return !canceled;
+            });
+        });
+        worker->start();
+    }
+    auto join() -> void
+    {
+        if (!worker)
+            return;
+        worker->wait();
+        _Delete(worker);
+    }
+    auto setStage(const QString &name, int length) -> void
+    {
+        ui.prog->setRange(0, length/100);
+        ui.prog->setValue(0);
+        ui.prog->setFormat(name % " %p%"_a);
+        ui.prog->setToolTip(QString());
+    }
+    auto split(int a, int b) -> void
+    {
+        const auto source = this->source;
+        setStage(tr("Finding keyframes"), b - a);
+        work([=] (const SegmentProgress &progress) {
+            const auto points = _KeyframeSplits(source, a, b, QThread::idealThreadCount(),
+                                                MinSegmentLength, progress);
+            _PostEvent(p, SplitEvent, points);
+        });
+    }
+    auto concat() -> void
+    {
+        QStringList files;
+        QVector<int> lengths;
+        for (auto &j : jobs) {
+            files.push_back(j.file);
+            lengths.push_back(j.end - j.start);
+        }
+        const auto output = this->output;
+        setStage(tr("Joining segments"), jobs.last().end - jobs.first().start);
+        work([=] (const SegmentProgress &progress) {
+            _PostEvent(p, ConcatEvent, _ConcatSegments(files, lengths, output, progress));
+        });
+    }
+    auto encode(const QVector<int> &points) -> QString
+    {
+        jobs.resize(points.size() - 1);
+        if (jobs.size() > 1) {
+            _Renew(temp, QDir::tempPath() % "/bomi-encoder-XXXXXX"_a);
+            if (!temp->isValid()) {
+                jobs.clear();
+                _Delete(temp);
+                start->setEnabled(true);
+                return tr("Failed to create file.");
+            }
+        }
+        const auto ext = QFileInfo(output).suffix();
+        for (int i = 0; i < jobs.size(); ++i) {
+            auto &job = jobs[i];
+            job.start = points[i];
+            job.end = points[i + 1];
+            job.file = jobs.size() == 1 ? output
+                : temp->path() % "/segment-"_a % _N(i) % '.'_q % ext;
+            job.mpv.reset(new Mpv);
+            auto mpv = job.mpv.data();
+            QObject::connect(mpv, &QThread::finished, p, [=] () { finish(i); });
+            mpv->setLogContext("mpv/encoder/"_b + QByteArray::number(i));
+            mpv->create();
+            mpv->setObserver(p);
+            // post only when progress moves to spare GUI thread of per-frame events
+            const auto last = std::make_shared<int>(-1); // touched by mpv thread only
+            mpv->request(MPV_EVENT_TICK, [=] (mpv_event*) {
+                if (_Change<int>(*last, mpv->get<double>("time-pos") * 10))
+                    _PostEvent(p, TickEvent, i, *last);
+            });
+            mpv->request(MPV_EVENT_END_FILE, [=] (mpv_event *e) {
+                const auto ev = static_cast<mpv_event_end_file*>(e->data);
+                if (ev->reason == MPV_END_FILE_REASON_ERROR)
+                    _PostEvent(p, ErrorEvent, i, ev->error);
+                mpv->tellAsync("quit");
+            });
+            setup(mpv, job.file, job.start, job.end);
+        }
+
+        const int length = points.last() - points.first();
+        ui.prog->setRange(0, length/100);
+        ui.prog->setValue(0);
+        ui.prog->setFormat(u"%p%"_q);
+        elapsed.start();
+        for (auto &job : jobs) {
+            job.mpv->initialize(Log::Debug, false);
+            job.mpv->start();
+            job.mpv->tell("loadfile", source);
+        }
+        _Info("Start encoding %%ms of media with %% segment(s).", length, jobs.size());
+        return QString();
+    }
+    auto setup(Mpv *mpv, const QString &file, int a, int b) -> void
+    {
+        auto _n = [] (auto n) { return QByteArray::number(n); };
+
+        mpv->setOption("o", MpvFile(file).toMpv());
+        switch (ui.fps->currentIndex()) {
+        case CFRManual:
+            mpv->setOption("ofps", _n(ui.fps_value->value()));
+            break;
+        case CFRAuto:
+            mpv->setOption("oautofps", "yes");
+            break;
+        }
+
+        const QRect orig(0, 0, size.width(), size.height());
+        auto area = crop & orig;
+        area.setWidth((area.width() / 2) * 2);
+        area.setHeight((area.height() / 2) * 2);
+        QByteArray vf;
+        if (area != orig) {
+            vf = "crop=" + _n(area.width()) + ':' + _n(area.height())
+                    + ':' + _n(area.x())
+                    + ':' + _n(area.y());
+        }
+        const auto outSize = area.size() * ui.scale->value() * 1e-2;
+        if (outSize != area.size()) {
+            if (!vf.isEmpty())
+                vf += ',';
+            vf += "scale=" + _n(outSize.width()) + ':' + _n(outSize.height());
+        }
+        if (!vf.isEmpty())
+            mpv->setOption("vf", vf);
+
+        if (ui.ext->currentText() == u"gif"_q) {
+            mpv->setOption("ovc", "gif"_b);
+            if (!ui.vcopts->text().isEmpty())
+                mpv->setOption("ovcopts", ui.vcopts->text().toUtf8());
+            mpv->setOption("aid", "no"_b);
+        } else {
+            mpv->setOption("ovc", ui.vc->currentText().toLatin1());
+            mpv->setOption("oac", ui.ac->currentText().toLatin1());
+            if (!ui.vcopts->text().isEmpty())
+                mpv->setOption("ovcopts", ui.vcopts->text().toUtf8());
+            if (!ui.acopts->text().isEmpty())
+                mpv->setOption("oacopts", ui.acopts->text().toUtf8());
+            if (audio.isValid()) {
+                if (audio.isExternal())
+                    mpv->setOption("audio-file", MpvFile(audio.file()).toMpv());
+                else
+                    mpv->setOption("aid", _n(audio.id()));
+            }
+        }
+
+        if (!ui.subtitle->isChecked())
+            mpv->setOption("sid", "no");
+        else {
+            const auto color = [] (const QColor &color) { return color.name(QColor::HexArgb).toLatin1(); };
+            const auto &font = style.font;
+            mpv->setOption("sub-text-color", color(font.color));
+            QStringList fontStyles;
+            if (font.bold())
+                fontStyles.append(u"Bold"_q);
+            if (font.italic())
+                fontStyles.append(u"Italic"_q);
+            QString family = font.family();
+            if (!fontStyles.isEmpty())
+                family += ":style="_a % fontStyles.join(' '_q);
+            const double factor = font.size * 720.0;
+            mpv->setOption("sub-text-font", family.toUtf8());
+            mpv->setOption("sub-text-font-size", _n(factor));
+            const auto &outline = style.outline;
+            const auto scaled = [factor] (double v)
+                { return qBound(0., v*factor, 10.); };
+            if (outline.enabled) {
+                mpv->setOption("sub-text-border-size", _n(scaled(outline.width)));
+                mpv->setOption("sub-text-border-color", color(outline.color));
+            } else
+                mpv->setOption("sub-text-border-size", "0.0");
+            const auto &bbox = style.bbox;
+            if (bbox.enabled)
+                mpv->setOption("sub-text-back-color", color(bbox.color));
+            else
+                mpv->setOption("sub-text-back-color", color(Qt::transparent));
+            auto norm = [] (const QPointF &p) { return sqrt(p.x()*p.x() + p.y()*p.y()); };
+            const auto &shadow = style.shadow;
+            if (shadow.enabled) {
+                mpv->setOption("sub-text-shadow-color", color(shadow.color));
+                mpv->setOption("sub-text-shadow-offset", _n(scaled(norm(shadow.offset))));
+            } else {
+                mpv->setOption("sub-text-shadow-color", color(Qt::transparent));
+                mpv->setOption("sub-text-shadow-offset", "0.0");
+            }
+            // these should be applied?
+            //    mpv.setAsync("ass-force-margins", vr->overlayOnLetterbox() && override); };
+            //    mpv->setAsync("sub-pos", o || !isAss() ? qRound(p * 100) : 100);
+            //    mpv->setAsync("sub-scale", o || !isAss() ? qMax(0., 1. + s) : 1.);
+            //    mpv->setAsync("ass-style-override", o ? "force"_b : "yes"_b);
+            if (sub.isValid()) {
+                if (sub.isExternal()) {
+                    mpv->setOption("sub-file", MpvFile(sub.file()).toMpv());
+                    auto cp = sub.encoding().name().replace("Windows-"_a, "cp"_a, Qt::CaseInsensitive);
+                    mpv->setOption("subcp", cp.toLatin1());
+                } else
+                    mpv->setOption("sid", _n(sub.id()));
+            }
+        }
+
+        mpv->setOption("start", _n(a * 1e-3));
+        mpv->setOption("end", _n(b * 1e-3));
+    }
 };
 
 EncoderDialog::EncoderDialog(QWidget *parent)
@@ -76,6 +381,7 @@ EncoderDialog::EncoderDialog(QWidget *parent)
     d->storage.add("fps", d->ui.fps, "currentIndex");
     d->storage.add(d->ui.fps_value);
     d->storage.add(d->ui.subtitle);
+    d->storage.add(d->ui.segmented);
     d->storage.add(d->ui.cx);
     d->storage.add(d->ui.cy);
     d->storage.add(d->ui.cw);
@@ -152,6 +458,7 @@ EncoderDialog::EncoderDialog(QWidget *parent)
         d->ui.ac->setCurrentText(av.ac);
         d->ui.vc->setCurrentText(av.vc);
         const auto gif = ext == u"gif"_q;
+        d->ui.segmented->setEnabled(!gif);
         d->ui.vc->setEnabled(!gif);
         d->ui.ac->setEnabled(!gif);
         d->ui.acopts->setEnabled(!gif);
@@ -198,19 +505,31 @@ auto EncoderDialog::updateCropArea() -> void
 
 auto EncoderDialog::cancel() -> void
 {
-    if (d->mpv) {
-        if (d->mpv->isRunning()) {
-            d->mpv->tellAsync("quit");
-            d->mpv->wait(30000);
+    if (d->worker) {
+        d->canceled = true;
+        d->join();
+        for (int type : { StageTickEvent, SplitEvent, ConcatEvent })
+            qApp->removePostedEvents(this, type);
+    }
+    for (auto &job : d->jobs) {
+        if (!job.mpv)
+            continue;
+        job.mpv->disconnect(this);
+        if (job.mpv->isRunning()) {
+            job.mpv->tellAsync("quit");
+            job.mpv->wait(30000);
         }
-        d->mpv->destroy();
-        d->mpv.clear();
+        job.mpv->destroy();
     }
+    d->jobs.clear();
+    _Delete(d->temp);
+    d->start->setEnabled(true);
+    d->ui.prog->setFormat(u"%p%"_q);
 }
 
 auto EncoderDialog::isBusy() const -> bool
 {
-    return d->mpv;
+    return !d->jobs.isEmpty() || d->worker;
 }
 
 auto EncoderDialog::setSource(const QByteArray &mrl, const QSize &size,
@@ -271,148 +590,16 @@ auto EncoderDialog::run() -> QString
     const auto file = d->g.get(folder, d->ui.file->text(), d->ui.ext->currentText());
     if (file.isEmpty())
         return tr("Failed to create file.");
-    Q_ASSERT(!d->mpv);
-    d->mpv.reset(new Mpv);
-    connect(d->mpv.data(), &QThread::finished, this, [=] () {
-        d->mpv->destroy();
-        d->mpv.clear();
-        d->start->setEnabled(true);
-        if (d->error != MPV_ERROR_SUCCESS)
-            MBox::error(this, tr("Encoder"), QString::fromUtf8(mpv_error_string(d->error)),
-                        { BBox::Ok }, BBox::Ok);
-        hide();
-    });
-    d->mpv->setLogContext("mpv/encoder"_b);
-    d->mpv->create();
-    d->mpv->setObserver(this);
-    d->mpv->observe("time-pos", [=] (double s) { qDebug() << s; });
-    d->mpv->request(MPV_EVENT_TICK, [=] (mpv_event*) {
-        if (_Change<int>(d->tick, d->mpv->get<double>("time-pos") * 10))
-            _PostEvent(this, TickEvent, d->tick);
-    });
-    d->mpv->request(MPV_EVENT_END_FILE, [=] (mpv_event *e) {
-        const auto ev = static_cast<mpv_event_end_file*>(e->data);
-        if (ev->reason == MPV_END_FILE_REASON_ERROR)
-            d->error = ev->error;
-        d->mpv->tellAsync("quit");
-    });
-
-    auto _n = [] (auto n) { return QByteArray::number(n); };
+    Q_ASSERT(!isBusy());
 
-    d->mpv->setOption("o", MpvFile(file).toMpv());
-    switch (d->ui.fps->currentIndex()) {
-    case CFRManual:
-        d->mpv->setOption("ofps", _n(d->ui.fps_value->value()));
-        break;
-    case CFRAuto:
-        d->mpv->setOption("oautofps", "yes");
-        break;
-    }
-
-    const QRect orig(0, 0, d->size.width(), d->size.height());
-    auto crop = d->crop & orig;
-    crop.setWidth((crop.width() / 2) * 2);
-    crop.setHeight((crop.height() / 2) * 2);
-    QByteArray vf;
-    if (crop != orig) {
-        vf = "crop=" + _n(crop.width()) + ':' + _n(crop.height())
-                + ':' + _n(crop.x())
-                + ':' + _n(crop.y());
-    }
-    const auto size = crop.size() * d->ui.scale->value() * 1e-2;
-    if (size != crop.size()) {
-        if (!vf.isEmpty())
-            vf += ',';
-        vf += "scale=" + _n(size.width()) + ':' + _n(size.height());
-    }
-    if (!vf.isEmpty())
-        d->mpv->setOption("vf", vf);
-
-    if (d->ui.ext->currentText() == u"gif"_q) {
-        d->mpv->setOption("ovc", "gif"_b);
-        if (!d->ui.vcopts->text().isEmpty())
-            d->mpv->setOption("ovcopts", d->ui.vcopts->text().toUtf8());
-        d->mpv->setOption("aid", "no"_b);
-    } else {
-        d->mpv->setOption("ovc", d->ui.vc->currentText().toLatin1());
-        d->mpv->setOption("oac", d->ui.ac->currentText().toLatin1());
-        if (!d->ui.vcopts->text().isEmpty())
-            d->mpv->setOption("ovcopts", d->ui.vcopts->text().toUtf8());
-        if (!d->ui.acopts->text().isEmpty())
-            d->mpv->setOption("oacopts", d->ui.acopts->text().toUtf8());
-        if (d->audio.isValid()) {
-            if (d->audio.isExternal())
-                d->mpv->setOption("audio-file", MpvFile(d->audio.file()).toMpv());
-            else
-                d->mpv->setOption("aid", _n(d->audio.id()));
-        }
-    }
-
-    if (!d->ui.subtitle->isChecked())
-        d->mpv->setOption("sid", "no");
-    else {
-        const auto color = [] (const QColor &color) { return color.name(QColor::HexArgb).toLatin1(); };
-        const auto &style = d->style;
-        const auto &font = style.font;
-        d->mpv->setOption("sub-text-color", color(font.color));
-        QStringList fontStyles;
-        if (font.bold())
-            fontStyles.append(u"Bold"_q);
-        if (font.italic())
-            fontStyles.append(u"Italic"_q);
-        QString family = font.family();
-        if (!fontStyles.isEmpty())
-            family += ":style="_a % fontStyles.join(' '_q);
-        const double factor = font.size * 720.0;
-        d->mpv->setOption("sub-text-font", family.toUtf8());
-        d->mpv->setOption("sub-text-font-size", _n(factor));
-        const auto &outline = style.outline;
-        const auto scaled = [factor] (double v)
-            { return qBound(0., v*factor, 10.); };
-        if (outline.enabled) {
-            d->mpv->setOption("sub-text-border-size", _n(scaled(outline.width)));
-            d->mpv->setOption("sub-text-border-color", color(outline.color));
-        } else
-            d->mpv->setOption("sub-text-border-size", "0.0");
-        const auto &bbox = style.bbox;
-        if (bbox.enabled)
-            d->mpv->setOption("sub-text-back-color", color(bbox.color));
-        else
-            d->mpv->setOption("sub-text-back-color", color(Qt::transparent));
-        auto norm = [] (const QPointF &p) { return sqrt(p.x()*p.x() + p.y()*p.y()); };
-        const auto &shadow = style.shadow;
-        if (shadow.enabled) {
-            d->mpv->setOption("sub-text-shadow-color", color(shadow.color));
-            d->mpv->setOption("sub-text-shadow-offset", _n(scaled(norm(shadow.offset))));
-        } else {
-            d->mpv->setOption("sub-text-shadow-color", color(Qt::transparent));
-            d->mpv->setOption("sub-text-shadow-offset", "0.0");
-        }
-        // these should be applied?
-        //    d->mpv.setAsync("ass-force-margins", d->vr->overlayOnLetterbox() && override); };
-        //    d->d->mpv->setAsync("sub-pos", o || !isAss() ? qRound(p * 100) : 100);
-        //    d->d->mpv->setAsync("sub-scale", o || !isAss() ? qMax(0., 1. + s) : 1.);
-        //    d->d->mpv->setAsync("ass-style-override", o ? "force"_b : "yes"_b);
-        if (d->sub.isValid()) {
-            if (d->sub.isExternal()) {
-                d->mpv->setOption("sub-file", MpvFile(d->sub.file()).toMpv());
-                auto cp = d->sub.encoding().name().replace("Windows-"_a, "cp"_a, Qt::CaseInsensitive);
-                d->mpv->setOption("subcp", cp.toLatin1());
-            } else
-                d->mpv->setOption("sid", _n(d->sub.id()));
-        }
-    }
-
-    d->mpv->setOption("start", _n(a * 1e-3));
-    d->mpv->setOption("end", _n(b * 1e-3));
-
-    d->tick = -1;
+    d->output = file;
     d->error = MPV_ERROR_SUCCESS;
     d->start->setEnabled(false);
-    d->ui.prog->setRange(a/100, b/100);
-    d->mpv->initialize(Log::Debug, false);
-    d->mpv->start();
-    d->mpv->tell("loadfile", d->source);
+    d->total.start();
+    // gif cannot be concatenated without re-encoding
+    if (!d->ui.segmented->isChecked() || d->ui.ext->currentText() == u"gif"_q)
+        return d->encode({ a, b });
+    d->split(a, b);
     return QString();
 }
 
@@ -430,8 +617,36 @@ auto EncoderDialog::closeEvent(QCloseEvent *event) -> void
 
 auto EncoderDialog::customEvent(QEvent *event) -> void
 {
-    if (event->type() == TickEvent)
+    switch ((int)event->type()) {
+    case TickEvent: {
+        int i, tick;
+        _TakeData(event, i, tick);
+        if (_InRange0(i, d->jobs.size()) && _Change(d->jobs[i].tick, tick))
+            d->updateProgress();
+        break;
+    } case ErrorEvent: {
+        int i, error;
+        _TakeData(event, i, error);
+        d->error = error;
+        break;
+    } case StageTickEvent:
         d->ui.prog->setValue(_GetData<int>(event));
+        break;
+    case SplitEvent: {
+        const auto points = _MoveData<QVector<int>>(event);
+        d->join();
+        const auto error = d->encode(points);
+        if (!error.isEmpty())
+            MBox::error(this, tr("Encoder"), error, { BBox::Ok }, BBox::Ok);
+        break;
+    } case ConcatEvent: {
+        const auto error = _MoveData<QString>(event);
+        d->join();
+        d->done(error);
+        break;
+    } default:
+        break;
+    }
 }
 
 auto EncoderDialog::setSubtitle(const StreamTrack &sub, const OsdStyle &style) -> void
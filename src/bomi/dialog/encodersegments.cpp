@@ -0,0 +1,198 @@
+#include "encodersegments.hpp"
+#include "misc/log.hpp"
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+DECLARE_LOG_CONTEXT(Encoder)
+
+static constexpr AVRational MSec = { 1, 1000 };
+static constexpr AVRational USec = { 1, AV_TIME_BASE };
+static constexpr int MaxPacketsToKeyframe = 5000;
+
+static auto avError(int error) -> QString
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {0};
+    av_strerror(error, buffer, sizeof(buffer));
+    return QString::fromLocal8Bit(buffer);
+}
+
+struct InputContext {
+    ~InputContext() { if (ctx) avformat_close_input(&ctx); }
+    // interrupted is polled while waiting for I/O
+    auto open(const QByteArray &file, std::function<bool()> &&interrupted) -> int
+    {
+        this->interrupted = std::move(interrupted);
+        ctx = avformat_alloc_context();
+        if (!ctx)
+            return AVERROR(ENOMEM);
+        ctx->interrupt_callback.callback = [] (void *p) -> int
+            { return static_cast<InputContext*>(p)->interrupted(); };
+        ctx->interrupt_callback.opaque = this;
+        int ret = avformat_open_input(&ctx, file.constData(), nullptr, nullptr);
+        if (ret >= 0)
+            ret = avformat_find_stream_info(ctx, nullptr);
+        return ret;
+    }
+    AVFormatContext *ctx = nullptr;
+    std::function<bool()> interrupted;
+};
+
+auto _KeyframeSplits(const QByteArray &source, int start, int end, int count,
+                     int minLength, const SegmentProgress &progress) -> QVector<int>
+{
+    QVector<int> points;
+    points.push_back(start);
+    if (count < 2 || end - start < 2 * minLength)
+        return points << end;
+    auto report = [&] (int msec) { return !progress || progress(msec); };
+    av_register_all();
+    InputContext in;
+    if (in.open(source, [&] () { return !report(points.last() - start); }) < 0) {
+        if (report(0))
+            _Error("Cannot open %% to find keyframes.", source);
+        return points << end;
+    }
+    const int idx = av_find_best_stream(in.ctx, AVMEDIA_TYPE_VIDEO,
+                                        -1, -1, nullptr, 0);
+    if (idx < 0)
+        return points << end;
+    const auto st = in.ctx->streams[idx];
+    const auto offset = st->start_time == AV_NOPTS_VALUE ? 0 : st->start_time;
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = nullptr; pkt.size = 0;
+    for (int i = 1; i < count; ++i) {
+        const qint64 target = start + qint64(end - start) * i / count;
+        if (target - points.last() < minLength)
+            continue;
+        if (!report(target - start))
+            break;
+        const auto ts = av_rescale_q(target, MSec, st->time_base) + offset;
+        if (av_seek_frame(in.ctx, idx, ts, 0) < 0)
+            break;
+        int key = -1;
+        for (int n = 0; n < MaxPacketsToKeyframe && key < 0; ++n) {
+            if (av_read_frame(in.ctx, &pkt) < 0)
+                break;
+            if (pkt.stream_index == idx && (pkt.flags & AV_PKT_FLAG_KEY)) {
+                const auto pts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+                if (pts != AV_NOPTS_VALUE)
+                    key = av_rescale_q(pts - offset, st->time_base, MSec);
+            }
+            av_free_packet(&pkt);
+        }
+        if (key > points.last() + minLength && key < end - minLength)
+            points.push_back(key);
+    }
+    points.push_back(end);
+    report(end - start);
+    return points;
+}
+
+auto _ConcatSegments(const QStringList &segments, const QVector<int> &lengths,
+                     const QString &output, const SegmentProgress &progress) -> QString
+{
+    if (segments.isEmpty() || segments.size() != lengths.size())
+        return qApp->translate("EncoderDialog", "No segments to concatenate.");
+    av_register_all();
+    const auto file = output.toLocal8Bit();
+    AVFormatContext *out = nullptr;
+    int ret = avformat_alloc_output_context2(&out, nullptr, nullptr, file.constData());
+    if (ret < 0)
+        return avError(ret);
+    QVector<qint64> offsets, last;
+    qint64 base = 0; // where current segment starts in output in AV_TIME_BASE
+    int done = 0;    // msec written to output
+    auto report = [&] () { return !progress || progress(done); };
+    auto close = [&] () {
+        if (!(out->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&out->pb);
+        avformat_free_context(out);
+    };
+    for (int i = 0; i < segments.size(); ++i) {
+        InputContext in;
+        if ((ret = in.open(segments[i].toLocal8Bit(), [&] () { return !report(); })) < 0)
+            break;
+        if (i == 0) {
+            for (uint s = 0; s < in.ctx->nb_streams; ++s) {
+                const auto ist = in.ctx->streams[s];
+                auto ost = avformat_new_stream(out, ist->codec->codec);
+                if (!ost) {
+                    ret = AVERROR(ENOMEM);
+                    break;
+                }
+                if ((ret = avcodec_copy_context(ost->codec, ist->codec)) < 0)
+                    break;
+                ost->time_base = ist->time_base;
+                ost->codec->codec_tag = 0;
+                if (out->oformat->flags & AVFMT_GLOBALHEADER)
+                    ost->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+            }
+            if (ret < 0)
+                break;
+            if (!(out->oformat->flags & AVFMT_NOFILE)
+                    && (ret = avio_open(&out->pb, file.constData(), AVIO_FLAG_WRITE)) < 0)
+                break;
+            if ((ret = avformat_write_header(out, nullptr)) < 0)
+                break;
+            offsets.resize(out->nb_streams);
+            last.fill(AV_NOPTS_VALUE, out->nb_streams);
+        } else if (in.ctx->nb_streams != out->nb_streams) {
+            close();
+            return qApp->translate("EncoderDialog", "Segments have different streams.");
+        }
+        // one offset for all streams keeps gap between audio and video of
+        // segment; planned length is used because last packets of streams
+        // end at different times
+        const auto start = in.ctx->start_time == AV_NOPTS_VALUE ? 0 : in.ctx->start_time;
+        for (int s = 0; s < offsets.size(); ++s)
+            offsets[s] = av_rescale_q(base - start, USec, out->streams[s]->time_base);
+        base += av_rescale_q(lengths[i], MSec, USec);
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr; pkt.size = 0;
+        while ((ret = av_read_frame(in.ctx, &pkt)) >= 0) {
+            const int s = pkt.stream_index;
+            const auto ist = in.ctx->streams[s];
+            const auto ost = out->streams[s];
+            const auto shift = [&] (qint64 ts) -> qint64 {
+                if (ts == AV_NOPTS_VALUE)
+                    return ts;
+                return av_rescale_q(ts, ist->time_base, ost->time_base) + offsets[s];
+            };
+            pkt.pts = shift(pkt.pts);
+            pkt.dts = shift(pkt.dts);
+            pkt.duration = av_rescale_q(pkt.duration, ist->time_base, ost->time_base);
+            // muxer rejects non-monotonic dts at segment boundaries
+            if (pkt.dts != AV_NOPTS_VALUE && last[s] != AV_NOPTS_VALUE
+                    && pkt.dts <= last[s]) {
+                const auto fix = last[s] + 1 - pkt.dts;
+                pkt.dts += fix;
+                if (pkt.pts != AV_NOPTS_VALUE)
+                    pkt.pts += fix;
+            }
+            if (pkt.dts != AV_NOPTS_VALUE) {
+                last[s] = pkt.dts;
+                done = qMax<qint64>(done, av_rescale_q(pkt.dts, ost->time_base, MSec));
+            }
+            ret = report() ? av_interleaved_write_frame(out, &pkt) : AVERROR_EXIT;
+            av_free_packet(&pkt);
+            if (ret < 0)
+                break;
+        }
+        if (ret == AVERROR_EOF)
+            ret = 0;
+        if (ret < 0)
+            break;
+    }
+    if (ret >= 0)
+        ret = av_write_trailer(out);
+    close();
+    if (ret < 0) {
+        if (ret != AVERROR_EXIT)
+            _Error("Cannot concatenate segments: %%", avError(ret));
+        return avError(ret);
+    }
+    return QString();
+}
@@ -0,0 +1,18 @@
+#ifndef ENCODERSEGMENTS_HPP
+#define ENCODERSEGMENTS_HPP
+
+#include <functional>
+
+// called with msec of media done so far; returning false cancels the work
+using SegmentProgress = std::function<bool(int msec)>;
+
+// split [start, end) in msec into at most count ranges which begin at keyframes
+auto _KeyframeSplits(const QByteArray &source, int start, int end, int count,
+                     int minLength, const SegmentProgress &progress = nullptr) -> QVector<int>;
+// concatenate encoded segments without re-encoding, returns error string;
+// lengths are planned durations of segments in msec
+auto _ConcatSegments(const QStringList &segments, const QVector<int> &lengths,
+                     const QString &output,
+                     const SegmentProgress &progress = nullptr) -> QString;
+
+#endif // ENCODERSEGMENTS_HPP
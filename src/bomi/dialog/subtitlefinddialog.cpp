@@ -69,6 +69,9 @@ SIA language(const QString &langCode) -> QString
     return lang.isEmpty() ? langCode : lang;
 }
 
+// each file is read in background for hashing
+static constexpr int MaxPrefetch = 30;
+
 struct SubtitleFindDialog::Data {
     SubtitleFindDialog *p = nullptr;
     Ui::SubtitleFindDialog ui;
@@ -194,6 +197,19 @@ struct SubtitleFindDialog::Data {
         }
         return file;
     }
+    // other videos in folder such as rest of a season are likely to be
+    // looked up next; batch them now so that they come from cache
+    auto prefetch() -> void
+    {
+        const auto dir = mediaFile.dir();
+        auto files = dir.entryList(_ToNameFilter(VideoExt), QDir::Files, QDir::Name);
+        files.removeOne(mediaFile.fileName());
+        if (files.size() > MaxPrefetch)
+            files = files.mid(0, MaxPrefetch);
+        for (auto &file : files)
+            file = dir.absoluteFilePath(file);
+        finder->prefetch(files);
+    }
     auto writeData(const DownloadInfo &info, const QByteArray &data) -> void
     {
         if (data.isEmpty() || info.fileName.isEmpty())
@@ -332,7 +348,8 @@ auto SubtitleFindDialog::find(const Mrl &mrl) -> void
         MBox::warn(this, tr("Find Subtitle"),
                    tr("Cannot find subtitles for %1.").arg(name),
                    { BBox::Ok });
-    }
+    } else
+        d->prefetch();
 }
 
 auto SubtitleFindDialog::setLoadFunc(Load &&load) -> void
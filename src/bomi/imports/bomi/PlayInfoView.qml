@@ -45,6 +45,10 @@ Item {
             readonly property string suffix: qsTr("core")
             content: formatBracket(name, usage.toFixed(1) + "%", avg.toFixed(1) + '%/' + suffix)
         }
+        PlayInfoText {
+            readonly property string name: qsTr("Property Updates")
+            content: name + ": " + App.bindings.evaluations + "/s"
+        }
         PlayInfoText {
             readonly property real usage: Alg.trunc(App.memory.usage, 1)
             readonly property string name: qsTr("RAM Usage")
@@ -175,7 +175,9 @@ Item {
                     color: "white"; font.pixelSize: 12
                     verticalAlignment: Text.AlignVCenter
                 }
-                content: '[' + B.Format.listNumber(pl.currentNumber, pl.length) + ']'
+                content: '[' + B.Format.listNumber(pl.currentNumber, pl.length)
+                         + (pl.totalDuration > 0 ? ', ' + B.Format.time(pl.totalDuration, false, true) : '')
+                         + ']'
                 width: contentWidth + 2; height: parent.height
             }
             Item {
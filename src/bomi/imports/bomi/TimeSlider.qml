@@ -111,18 +111,24 @@ Slider {
         property bool ticking: true
         function target(x) { return (min + (x/seeker.width)*(max - min)); }
         function sync() {
-            seeker.min = e.begin
-            seeker.max = e.end
+            // live stream recorded into timeshift ring: only the ring is seekable
+            var shift = e.cache.timeshiftEnd > e.cache.timeshiftBegin
+            seeker.min = shift ? e.cache.timeshiftBegin : e.begin
+            seeker.max = shift ? e.cache.timeshiftEnd : e.end
             seeker.value = e.time
         }
     }
 
     Connections {
         target: d.e
-        onTick: { d.ticking = true; time = d.e.time; d.ticking = false; }
+        onTimeChanged: { d.ticking = true; time = d.e.time; d.ticking = false; }
         onEndChanged: { d.ticking = true; d.sync(); d.ticking = false; }
         onBeginChanged: { d.ticking = true; d.sync(); d.ticking = false; }
     }
+    Connections {
+        target: d.e.cache
+        onTimeshiftChanged: { d.ticking = true; d.sync(); d.ticking = false; }
+    }
     onValueChanged: { if (!d.ticking) d.e.seek(value); }
     Component.onCompleted: { d.sync(); d.ticking = false; }
 
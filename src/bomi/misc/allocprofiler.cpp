@@ -0,0 +1,446 @@
+#include "allocprofiler.hpp"
+#include "log.hpp"
+#include <QElapsedTimer>
+#include <atomic>
+#include <new>
+#ifdef __GLIBC__
+#include <errno.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <sys/prctl.h>
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+#endif
+
+DECLARE_LOG_CONTEXT(Alloc)
+
+// nothing here may allocate while counting: all tables are static and
+// zero-initialized so that they are usable before any constructor runs
+
+// 0 is for allocations outside any scope and the last one for overflow
+static constexpr int MaxScopes = 64;
+// last one is shared by threads started after the table was full
+static constexpr int MaxThreads = 64;
+static constexpr int MaxSites = 4096;
+// allocations between refreshing thread name which may be set after start
+static constexpr int NamePeriod = 4096;
+
+using Count = std::atomic<quint64>;
+
+struct Counter { Count count, bytes; };
+
+struct ThreadRow {
+    char name[16];
+    Counter scopes[MaxScopes];
+};
+
+// direct caller of allocator: unwinding is not safe inside malloc
+// because unwinder may allocate or take locks held by interrupted code
+struct Site {
+    std::atomic<int> state; // 0: free, 1: being filled, 2: ready
+    const char *scope;
+    void *caller;
+    Count count, bytes;
+};
+
+struct ThreadState {
+    ThreadRow *row;
+    const char *cached;
+    int index, names;
+    bool busy;
+};
+
+thread_local const char *AllocScope::s_current = nullptr;
+
+static std::atomic<bool> s_running;
+static std::atomic<const char*> s_names[MaxScopes];
+static ThreadRow s_threads[MaxThreads];
+static std::atomic<int> s_threadCount;
+static thread_local ThreadState t_state;
+static Site s_sites[MaxSites];
+static Count s_lostSites;
+
+SIA updateName(ThreadState &t, int index) -> void
+{
+    if (index >= MaxThreads - 1) {
+        if (index == MaxThreads - 1)
+            qstrcpy(t.row->name, "others");
+        return;
+    }
+#ifdef __GLIBC__
+    char name[16] = {0};
+    prctl(PR_GET_NAME, name);
+    qstrncpy(t.row->name, name, sizeof(t.row->name));
+#else
+    qsnprintf(t.row->name, sizeof(t.row->name), "thread-%d", index);
+#endif
+}
+
+SIA scopeIndex(ThreadState &t, const char *name) -> int
+{
+    if (!name)
+        return 0;
+    if (t.cached == name)
+        return t.index;
+    constexpr int slots = MaxScopes - 2;
+    int index = MaxScopes - 1;
+    const int start = (reinterpret_cast<quintptr>(name) >> 3) % slots;
+    for (int n = 0; n < slots; ++n) {
+        const int i = 1 + (start + n) % slots;
+        const char *cur = s_names[i].load(std::memory_order_acquire);
+        if (!cur && s_names[i].compare_exchange_strong(cur, name))
+            cur = name;
+        if (cur == name) {
+            index = i;
+            break;
+        }
+    }
+    t.cached = name;
+    t.index = index;
+    return index;
+}
+
+SIA addSite(size_t size, const char *scope, void *caller) -> void
+{
+    quint32 hash = 2166136261u;
+    hash = (hash ^ quint32(reinterpret_cast<quintptr>(caller))) * 16777619u;
+    hash = (hash ^ quint32(quint64(reinterpret_cast<quintptr>(caller)) >> 32)) * 16777619u;
+    hash = (hash ^ quint32(reinterpret_cast<quintptr>(scope))) * 16777619u;
+    for (int probe = 0; probe < 16; ++probe) {
+        auto &site = s_sites[(hash + probe) % MaxSites];
+        int state = site.state.load(std::memory_order_acquire);
+        if (!state && site.state.compare_exchange_strong(state, 1)) {
+            site.scope = scope;
+            site.caller = caller;
+            site.state.store(state = 2, std::memory_order_release);
+        } else if (state != 2 || site.caller != caller || site.scope != scope)
+            continue;
+        site.count.fetch_add(1, std::memory_order_relaxed);
+        site.bytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    s_lostSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+Q_NEVER_INLINE static auto record(size_t size, void *caller) -> void
+{
+    auto &t = t_state;
+    if (t.busy)
+        return;
+    t.busy = true;
+    if (!t.row) {
+        const int index = s_threadCount.fetch_add(1, std::memory_order_relaxed);
+        t.row = &s_threads[qMin(index, MaxThreads - 1)];
+        t.names = index < MaxThreads - 1 ? 0 : -1;
+        updateName(t, index);
+    } else if (t.names >= 0 && ++t.names >= NamePeriod) {
+        t.names = 0;
+        updateName(t, 0);
+    }
+    const auto scope = AllocScope::current();
+    auto &c = t.row->scopes[scopeIndex(t, scope)];
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    addSite(size, scope, caller);
+    t.busy = false;
+}
+
+// must be expanded in hook itself to take its return address
+#define RECORD(size) \
+    { if (s_running.load(std::memory_order_relaxed)) \
+          record(size, __builtin_return_address(0)); }
+
+#ifdef __GLIBC__
+// glibc allows replacing malloc family in executable; Qt containers, QImage
+// and libmpv allocate with these. Every entry point calls __libc_* directly
+// so that each allocation is counted once with its real caller.
+extern "C" {
+
+void *malloc(size_t size)
+{
+    RECORD(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    RECORD(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    RECORD(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    RECORD(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    RECORD(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (!alignment || (alignment & (alignment - 1)) || alignment % sizeof(void*))
+        return EINVAL;
+    RECORD(size);
+    auto p = __libc_memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+}
+
+#define ALLOC(size) __libc_malloc(size ? size : 1)
+#else
+#define ALLOC(size) ::malloc(size ? size : 1)
+#endif
+
+auto operator new(size_t size) -> void*
+{
+    RECORD(size);
+    if (auto p = ALLOC(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+auto operator new[](size_t size) -> void*
+{
+    RECORD(size);
+    if (auto p = ALLOC(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+auto operator new(size_t size, const std::nothrow_t&) noexcept -> void*
+{
+    RECORD(size);
+    return ALLOC(size);
+}
+
+auto operator new[](size_t size, const std::nothrow_t&) noexcept -> void*
+{
+    RECORD(size);
+    return ALLOC(size);
+}
+
+#undef ALLOC
+
+auto operator delete(void *p) noexcept -> void { ::free(p); }
+auto operator delete[](void *p) noexcept -> void { ::free(p); }
+auto operator delete(void *p, const std::nothrow_t&) noexcept -> void { ::free(p); }
+auto operator delete[](void *p, const std::nothrow_t&) noexcept -> void { ::free(p); }
+#ifdef __cpp_sized_deallocation
+auto operator delete(void *p, size_t) noexcept -> void { ::free(p); }
+auto operator delete[](void *p, size_t) noexcept -> void { ::free(p); }
+#endif
+
+/******************************************************************************/
+
+struct Stat {
+    QByteArray name;
+    quint64 count = 0, bytes = 0;
+};
+
+struct Totals {
+    QMap<QByteArray, Stat> scopes, threads;
+};
+
+SIA collect() -> Totals
+{
+    Totals totals;
+    const int threads = qMin(s_threadCount.load(), MaxThreads);
+    for (int i = 0; i < threads; ++i) {
+        auto &row = s_threads[i];
+        const auto thread = QByteArray(row.name) + '#' + QByteArray::number(i);
+        auto &tstat = totals.threads[thread];
+        tstat.name = thread;
+        for (int s = 0; s < MaxScopes; ++s) {
+            const quint64 count = row.scopes[s].count.load();
+            if (!count)
+                continue;
+            const quint64 bytes = row.scopes[s].bytes.load();
+            tstat.count += count;
+            tstat.bytes += bytes;
+            QByteArray name;
+            if (!s)
+                name = "-";
+            else if (s == MaxScopes - 1)
+                name = "others";
+            else
+                name = s_names[s].load();
+            auto &stat = totals.scopes[name];
+            stat.name = name;
+            stat.count += count;
+            stat.bytes += bytes;
+        }
+    }
+    return totals;
+}
+
+// differences to prev in descending order of count
+SIA sorted(const QMap<QByteArray, Stat> &stats,
+           const QMap<QByteArray, Stat> &prev = {}) -> QVector<Stat>
+{
+    QVector<Stat> list;
+    list.reserve(stats.size());
+    for (auto &stat : stats) {
+        Stat diff = stat;
+        const auto it = prev.find(stat.name);
+        if (it != prev.end()) {
+            diff.count -= it->count;
+            diff.bytes -= it->bytes;
+        }
+        if (diff.count)
+            list.push_back(diff);
+    }
+    std::sort(list.begin(), list.end(), [] (const Stat &lhs, const Stat &rhs)
+        { return lhs.count > rhs.count; });
+    return list;
+}
+
+SIA format(const QVector<Stat> &stats, int top, double secs, bool rate) -> QByteArray
+{
+    QByteArray text;
+    for (int i = 0; i < qMin(top, stats.size()); ++i) {
+        const auto &s = stats[i];
+        if (!text.isEmpty())
+            text += ", ";
+        if (rate)
+            text += s.name + ' ' + QByteArray::number(qRound64(s.count / secs))
+                    + "/s " + QByteArray::number(s.bytes / secs / 1024.0, 'f', 1) + "KiB/s";
+        else
+            text += s.name + ' ' + QByteArray::number(s.count)
+                    + ' ' + QByteArray::number(s.bytes / 1024.0, 'f', 1) + "KiB";
+    }
+    return text;
+}
+
+#ifdef __GLIBC__
+SIA symbol(void *addr) -> QByteArray
+{
+    Dl_info info;
+    if (!addr || !dladdr(addr, &info))
+        return _ToLog(static_cast<const void*>(addr));
+    const auto p = reinterpret_cast<quintptr>(addr);
+    if (info.dli_sname) {
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        QByteArray name = status ? QByteArray(info.dli_sname) : QByteArray(demangled);
+        free(demangled);
+        const int paren = name.indexOf('(');
+        if (paren > 0)
+            name.truncate(paren);
+        return name + "+0x" + QByteArray::number(p - quintptr(info.dli_saddr), 16);
+    }
+    // no exported symbol: resolve later with addr2line
+    auto module = QByteArray(info.dli_fname);
+    module = module.mid(module.lastIndexOf('/') + 1);
+    return module + "+0x" + QByteArray::number(p - quintptr(info.dli_fbase), 16);
+}
+#else
+SIA symbol(void *addr) -> QByteArray
+{
+    return _ToLog(static_cast<const void*>(addr));
+}
+#endif
+
+struct ProfilerData {
+    QTimer *timer = nullptr;
+    QElapsedTimer elapsed, interval;
+    Totals prev;
+};
+
+static ProfilerData *s_data = nullptr;
+
+auto AllocProfiler::isRunning() -> bool
+{
+    return s_running.load();
+}
+
+auto AllocProfiler::start() -> void
+{
+    if (s_data)
+        return;
+    AllocScope scope("alloc-profiler");
+    s_data = new ProfilerData;
+    s_data->elapsed.start();
+    s_data->interval.start();
+    s_data->timer = new QTimer;
+    s_data->timer->setInterval(1000);
+    QObject::connect(s_data->timer, &QTimer::timeout, [] () {
+        AllocScope scope("alloc-profiler");
+        const auto totals = collect();
+        const double secs = s_data->interval.restart() / 1000.0;
+        const auto scopes = sorted(totals.scopes, s_data->prev.scopes);
+        const auto threads = sorted(totals.threads, s_data->prev.threads);
+        Stat all;
+        for (auto &s : scopes) {
+            all.count += s.count;
+            all.bytes += s.bytes;
+        }
+        s_data->prev = totals;
+        if (!all.count || secs <= 0)
+            return;
+        all.name = "all";
+        _Info("Rates: %%; scopes: %%; threads: %%", format({all}, 1, secs, true),
+              format(scopes, 8, secs, true), format(threads, 5, secs, true));
+    });
+    s_data->timer->start();
+    s_running.store(true);
+    _Info("Allocation profiling started.");
+}
+
+auto AllocProfiler::report() -> QString
+{
+    AllocScope scope("alloc-profiler");
+    const auto totals = collect();
+    const double secs = s_data ? s_data->elapsed.elapsed() / 1000.0 : 0.0;
+    QByteArray text = "Allocations in " + QByteArray::number(secs, 'f', 1) + "s\n";
+    text += "Scopes: " + format(sorted(totals.scopes), 20, 1, false) + '\n';
+    text += "Threads: " + format(sorted(totals.threads), 20, 1, false) + '\n';
+    QVector<const Site*> sites;
+    for (auto &site : s_sites) {
+        if (site.state.load(std::memory_order_acquire) == 2)
+            sites.push_back(&site);
+    }
+    std::sort(sites.begin(), sites.end(), [] (const Site *lhs, const Site *rhs)
+        { return lhs->count.load() > rhs->count.load(); });
+    text += "Top callers of allocator (" + QByteArray::number(s_lostSites.load())
+            + " allocations in full table not attributed):\n";
+    for (int i = 0; i < qMin(20, sites.size()); ++i) {
+        const auto site = sites[i];
+        text += "  " + QByteArray::number(site->count.load()) + " allocs, "
+                + QByteArray::number(site->bytes.load() / 1024.0, 'f', 1)
+                + "KiB [" + (site->scope ? site->scope : "-") + "] "
+                + symbol(site->caller) + '\n';
+    }
+    text.chop(1);
+    return QString::fromUtf8(text);
+}
+
+auto AllocProfiler::finish() -> void
+{
+    if (!s_data)
+        return;
+    s_running.store(false);
+    delete s_data->timer;
+    const auto text = report();
+    for (auto &line : text.split('\n'_q))
+        _Info("%%", line);
+    delete s_data;
+    s_data = nullptr;
+}
@@ -0,0 +1,52 @@
+#ifndef ALLOCPROFILER_HPP
+#define ALLOCPROFILER_HPP
+
+// Profiler replaces global allocators, so it is built only when configured
+// with --alloc-profiler; otherwise scopes compile to nothing.
+#ifdef BOMI_ALLOC_PROFILER
+
+// names allocations made by current thread until destruction;
+// innermost scope wins and name must be a string literal
+class AllocScope {
+public:
+    AllocScope(const char *name): m_prev(s_current) { s_current = name; }
+    ~AllocScope() { s_current = m_prev; }
+    static auto current() -> const char* { return s_current; }
+private:
+    const char *m_prev;
+    static thread_local const char *s_current;
+};
+
+// counts allocations and bytes per scope, thread and caller from global
+// allocators; hooks do nothing until start() is called
+class AllocProfiler {
+public:
+    static auto isAvailable() -> bool { return true; }
+    static auto isRunning() -> bool;
+    // begins counting and logs rates every second; call in GUI thread
+    static auto start() -> void;
+    // logs totals and top call sites and stops
+    static auto finish() -> void;
+    // totals since start() as text
+    static auto report() -> QString;
+};
+
+#else
+
+class AllocScope {
+public:
+    AllocScope(const char*) { }
+};
+
+class AllocProfiler {
+public:
+    static auto isAvailable() -> bool { return false; }
+    static auto isRunning() -> bool { return false; }
+    static auto start() -> void { }
+    static auto finish() -> void { }
+    static auto report() -> QString { return QString(); }
+};
+
+#endif
+
+#endif // ALLOCPROFILER_HPP
@@ -0,0 +1,164 @@
+#include "cpukernel.hpp"
+#include "log.hpp"
+#include <QElapsedTimer>
+
+DECLARE_LOG_CONTEXT(Cpu)
+
+// time spent on each variant while benchmarking
+static constexpr qint64 BenchTime = 3000000; // nsec
+
+SIA registry() -> std::vector<CpuKernelBase*>&
+{
+    // filled during static initialization in any order of translation units
+    static std::vector<CpuKernelBase*> kernels;
+    return kernels;
+}
+
+SIA levelFromName(const QString &name) -> int
+{
+    return CpuKernels::levelNames().indexOf(name);
+}
+
+CpuKernelBase::CpuKernelBase(const char *name)
+    : m_name(name)
+{
+    registry().push_back(this);
+}
+
+/******************************************************************************/
+
+auto CpuKernels::detect() -> CpuLevel
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // cpuid bits are combined with xgetbv so that levels whose registers are
+    // not saved by OS are rejected
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq"))
+        return CpuLevel::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return CpuLevel::Avx2;
+#endif
+    return CpuLevel::Generic;
+}
+
+auto CpuKernels::levelNames() -> QStringList
+{
+    return { u"generic"_q, u"avx2"_q, u"avx512"_q };
+}
+
+auto CpuKernels::levelName(CpuLevel level) -> QString
+{
+    return levelNames().value((int)level);
+}
+
+auto CpuKernels::list() -> const std::vector<CpuKernelBase*>&
+{
+    return registry();
+}
+
+auto CpuKernels::time(const std::function<void()> &run) -> double
+{
+    run(); // warm up caches and page in buffers
+    double best = -1.0;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        const auto begin = timer.nsecsElapsed();
+        run();
+        const double usec = (timer.nsecsElapsed() - begin) * 1e-3;
+        if (best < 0.0 || usec < best)
+            best = usec;
+    } while (timer.nsecsElapsed() < BenchTime);
+    return best;
+}
+
+SIA fastest(CpuKernelBase *kernel, CpuLevel cap) -> CpuLevel
+{
+    CpuLevel best = cap;
+    double bestTime = -1.0;
+    QStringList times;
+    for (int i = 0; i <= (int)cap; ++i) {
+        const auto level = (CpuLevel)i;
+        const double usec = kernel->measure(level);
+        if (usec < 0.0)
+            continue;
+        times.push_back(CpuKernels::levelName(level) % ' '_q % _N(usec, 2) % "us"_a);
+        if (bestTime < 0.0 || usec < bestTime) {
+            bestTime = usec;
+            best = level;
+        }
+    }
+    if (!times.isEmpty())
+        _Debug("Benchmark %%: %%", kernel->name(), times.join(u", "_q));
+    return best;
+}
+
+auto CpuKernels::initialize(const QString &mode) -> void
+{
+    auto spec = mode;
+    if (spec.isEmpty())
+        spec = QString::fromLocal8Bit(qgetenv("BOMI_CPU_LEVEL"));
+    const auto detected = detect();
+    auto cap = detected;
+    bool benchmark = false;
+    QMap<QString, CpuLevel> overrides;
+    // unsupported instructions would crash, so every request is capped
+    auto capped = [&] (const QString &name) -> CpuLevel {
+        const auto level = (CpuLevel)levelFromName(name);
+        if (level > detected)
+            _Warn("%% is not supported by this CPU. Use %% instead.",
+                  name, levelName(detected));
+        return qMin(level, detected);
+    };
+    for (auto token : spec.split(','_q, QString::SkipEmptyParts)) {
+        token = token.trimmed().toLower();
+        const int eq = token.indexOf('='_q);
+        const auto level = eq < 0 ? token : token.mid(eq + 1);
+        if (token == "auto"_a)
+            cap = detected;
+        else if (token == "benchmark"_a)
+            benchmark = true;
+        else if (levelFromName(level) < 0)
+            _Error("Unknown CPU level '%%'. Use one of %%.", level, levelNames().join(u", "_q));
+        else if (eq < 0)
+            cap = capped(level);
+        else
+            overrides[token.left(eq)] = capped(level);
+    }
+
+    for (auto kernel : registry()) {
+        const auto it = overrides.find(_L(kernel->name()));
+        if (it != overrides.end()) {
+            kernel->select(*it);
+            overrides.erase(it);
+        } else
+            kernel->select(benchmark ? fastest(kernel, cap) : cap);
+    }
+    for (auto it = overrides.cbegin(); it != overrides.cend(); ++it)
+        _Warn("No CPU kernel named '%%'.", it.key());
+
+    _Info("CPU supports %%. Kernels use %%%%.", levelName(detected), levelName(cap),
+          benchmark ? " or faster variant by benchmark" : "");
+    for (auto &line : report().split('\n'_q, QString::SkipEmptyParts))
+        _Debug("%%", line);
+}
+
+auto CpuKernels::report() -> QString
+{
+    int width = 0;
+    for (auto kernel : registry())
+        width = std::max(width, (int)qstrlen(kernel->name()));
+    QString text;
+    for (auto kernel : registry()) {
+        QStringList variants;
+        for (int i = 0; i < CpuLevelCount; ++i) {
+            if (kernel->has((CpuLevel)i))
+                variants.push_back(levelName((CpuLevel)i));
+        }
+        text += QString(_L(kernel->name())).leftJustified(width) % ' '_q
+                % levelName(kernel->level()).leftJustified(8)
+                % " ("_a % variants.join(u", "_q) % ")\n"_a;
+    }
+    return text;
+}
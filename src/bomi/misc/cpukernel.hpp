@@ -0,0 +1,173 @@
+#ifndef CPUKERNEL_HPP
+#define CPUKERNEL_HPP
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// instruction sets which kernels are built for, in ascending order
+enum class CpuLevel { Generic, Avx2, Avx512 };
+static constexpr int CpuLevelCount = 3;
+
+// Kernel bodies are written once as plain loops in
+//   template<int Lanes> CPU_INLINE auto nameBody(...) -> ...
+// and CPU_KERNEL_VARIANTS() compiles them once per target so that the
+// compiler vectorizes each copy for that target. Lanes is the number of
+// floats in a vector register of the target; use it for independent partial
+// sums so that reductions can be vectorized without -ffast-math.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_INLINE inline __attribute__((always_inline))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx2,fma")))
+#define CPU_KERNEL_VARIANTS(name, ret, params, args) \
+    static auto name##Generic params -> ret { return name##Body<4> args; } \
+    CPU_TARGET_AVX2 static auto name##Avx2 params -> ret { return name##Body<8> args; } \
+    CPU_TARGET_AVX512 static auto name##Avx512 params -> ret { return name##Body<16> args; }
+#define CPU_KERNEL_LIST(name) { { name##Generic, name##Avx2, name##Avx512 } }
+#else
+#define CPU_INLINE inline
+#define CPU_KERNEL_VARIANTS(name, ret, params, args) \
+    static auto name##Generic params -> ret { return name##Body<4> args; }
+#define CPU_KERNEL_LIST(name) { { name##Generic, nullptr, nullptr } }
+#endif
+
+class CpuKernelBase {
+public:
+    // registers itself; define kernels as static objects only
+    CpuKernelBase(const char *name);
+    CpuKernelBase(const CpuKernelBase&) = delete;
+    virtual ~CpuKernelBase() = default;
+    auto operator = (const CpuKernelBase&) -> CpuKernelBase& = delete;
+    auto name() const -> const char* { return m_name; }
+    auto level() const -> CpuLevel { return m_level; }
+    virtual auto has(CpuLevel level) const -> bool = 0;
+    // takes best variant which is not above level
+    virtual auto select(CpuLevel level) -> void = 0;
+    // usec per benchmark run of given variant or negative if not available
+    virtual auto measure(CpuLevel level) -> double = 0;
+    virtual auto isCheckable() const -> bool = 0;
+    // false if variant gives other result than generic one on check input;
+    // true if it agrees or is not available
+    virtual auto check(CpuLevel level) const -> bool = 0;
+protected:
+    CpuLevel m_level = CpuLevel::Generic;
+private:
+    const char *m_name = nullptr;
+};
+
+class CpuKernels {
+public:
+    // highest level which both CPU and OS support
+    static auto detect() -> CpuLevel;
+    static auto levelName(CpuLevel level) -> QString;
+    static auto levelNames() -> QStringList;
+    // selects variants for every kernel; mode is comma-separated list of
+    //   auto           highest detected level (default)
+    //   <level>        highest level to use, capped by detected one
+    //   benchmark      fastest variant measured for each kernel
+    //   <kernel>=<level> override for single kernel
+    // BOMI_CPU_LEVEL in environment is used if mode is empty
+    static auto initialize(const QString &mode = QString()) -> void;
+    static auto list() -> const std::vector<CpuKernelBase*>&;
+    // selected variant of every kernel, one per line
+    static auto report() -> QString;
+    // best time of single run in usec repeated for a few msec
+    static auto time(const std::function<void()> &run) -> double;
+    // same noise on every call for benchmark inputs: [-1, 1] for floating
+    // point and full range for integers
+    template<class T>
+    static auto noise(int size) -> std::vector<T>;
+    // true if values differ by at most tolerance relative to larger
+    // magnitude, or absolutely below 1; 0 for exact match
+    template<class T>
+    static auto same(T lhs, T rhs, double tolerance = 0.0) -> bool;
+    template<class T>
+    static auto same(const std::vector<T> &lhs, const std::vector<T> &rhs,
+                     double tolerance = 0.0) -> bool;
+};
+
+template<class T>
+inline auto CpuKernels::noise(int size) -> std::vector<T>
+{
+    std::vector<T> data(size);
+    quint32 x = 2463534242u;
+    for (auto &v : data) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5; // xorshift
+        if (std::is_floating_point<T>::value)
+            v = x / 2147483648.0 - 1.0;
+        else
+            v = (T)x;
+    }
+    return data;
+}
+
+template<class T>
+inline auto CpuKernels::same(T lhs, T rhs, double tolerance) -> bool
+{
+    const double a = lhs, b = rhs;
+    return std::abs(a - b) <= tolerance * qMax(1.0, qMax(std::abs(a), std::abs(b)));
+}
+
+template<class T>
+inline auto CpuKernels::same(const std::vector<T> &lhs, const std::vector<T> &rhs,
+                             double tolerance) -> bool
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!same(lhs[i], rhs[i], tolerance))
+            return false;
+    }
+    return true;
+}
+
+// function pointer to variant which is selected by CpuKernels::initialize();
+// generic variant is used until then
+template<class F>
+class CpuKernel : public CpuKernelBase {
+public:
+    using Variants = std::array<F*, CpuLevelCount>;
+    // runs variant once on representative input for benchmark
+    using Bench = std::function<void(F*)>;
+    // runs variant and generic one on noise with length not a multiple of
+    // any vector width and tells if results agree
+    using Check = std::function<bool(F *variant, F *generic)>;
+    CpuKernel(const char *name, const Variants &variants,
+              Bench &&bench = Bench(), Check &&check = Check())
+        : CpuKernelBase(name), m_variants(variants)
+        , m_bench(std::move(bench)), m_check(std::move(check))
+        { m_current = m_variants[0]; }
+    template<class... Args>
+    auto operator () (Args&&... args) const { return m_current(std::forward<Args>(args)...); }
+    auto has(CpuLevel level) const -> bool final { return m_variants[(int)level]; }
+    auto select(CpuLevel level) -> void final
+    {
+        int i = (int)level;
+        while (i > 0 && !m_variants[i])
+            --i;
+        m_level = (CpuLevel)i;
+        m_current = m_variants[i];
+    }
+    auto measure(CpuLevel level) -> double final
+    {
+        const auto f = m_variants[(int)level];
+        if (!f || !m_bench)
+            return -1.0;
+        return CpuKernels::time([&] () { m_bench(f); });
+    }
+    auto isCheckable() const -> bool final { return (bool)m_check; }
+    auto check(CpuLevel level) const -> bool final
+    {
+        const auto f = m_variants[(int)level];
+        return !f || !m_check || m_check(f, m_variants[0]);
+    }
+private:
+    Variants m_variants;
+    F *m_current = nullptr;
+    Bench m_bench;
+    Check m_check;
+};
+
+#endif // CPUKERNEL_HPP
@@ -1,6 +1,8 @@
 #ifndef DATAEVENT_HPP
 #define DATAEVENT_HPP
 
+#include "allocprofiler.hpp"
+
 template<class... Args>
 class DataEvent : public QEvent {
 public:
@@ -23,12 +25,14 @@ private:
 template<class... Args>
 SIA _PostEvent(QObject *obj, int type,
                               const Args&... args) -> void {
+    AllocScope scope("event");
     qApp->postEvent(obj, new DataEvent<Args...>(type, args...));
 }
 
 template<class... Args>
 SIA _PostEvent(Qt::EventPriority priority,QObject *obj, int type,
                               const Args&... args) -> void {
+    AllocScope scope("event");
     qApp->postEvent(obj, new DataEvent<Args...>(type, args...), priority);
 }
 
@@ -1,6 +1,8 @@
 #ifndef LOG_HPP
 #define LOG_HPP
 
+#include "allocprofiler.hpp"
+
 struct LogOption;
 
 SIA _ToLog(char n) -> QByteArray { return QByteArray::number(n); }
@@ -61,15 +63,19 @@ public:
     template<class F>
     static auto write(Level level, F &&getLogText) -> void
     {
-        if (level <= maximumLevel())
+        if (level <= maximumLevel()) {
+            AllocScope scope("log");
             print(level, std::move(getLogText() += '\n'));
+        }
     }
     template<class... Args>
     static auto write(const char *ctx, Level level, const QByteArray &format,
                       const Args &... args) -> void
     {
-        if (level <= maximumLevel())
+        if (level <= maximumLevel()) {
+            AllocScope scope("log");
             print(level, std::move(Helper(level, ctx, format, args...).log() += '\n'));
+        }
     }
     template<class... Args>
     static auto parse(Level lv, const char *ctx, const QByteArray &fmt, const Args &... args) -> QByteArray
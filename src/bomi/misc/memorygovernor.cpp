@@ -0,0 +1,279 @@
+#include "memorygovernor.hpp"
+#include "misc/log.hpp"
+#include <QElapsedTimer>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+DECLARE_LOG_CONTEXT(Memory)
+
+static constexpr int CheckInterval = 2000;
+static constexpr double Target = 0.9;       // reclaim down to this much of budget
+static constexpr double Relax = 0.8;        // restore below this much of budget
+static constexpr qint64 Cooldown = 10000;   // msec after reclaim to let rss settle
+static constexpr double HighPressure = 10.0;// %, from /proc/pressure/memory
+
+static auto toMiB(qint64 bytes) -> QString
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) % "MiB"_a;
+}
+
+MemoryConsumer::MemoryConsumer(const QString &name, MemoryPriority priority)
+    : m_name(name), m_priority(priority)
+{
+    MemoryGovernor::instance().add(this);
+}
+
+MemoryConsumer::~MemoryConsumer()
+{
+    MemoryGovernor::instance().remove(this);
+}
+
+/******************************************************************************/
+
+// callback taken out of consumer so that it can run without lock
+struct MemoryCall {
+    MemoryConsumer *consumer;
+    QString name;
+    MemoryConsumer::Reclaim reclaim;
+    MemoryConsumer::Restore restore;
+};
+
+struct MemoryGovernor::Data {
+    mutable QMutex mutex;
+    QList<MemoryConsumer*> consumers; // sorted by priority
+    qint64 budget = 0;
+    QTimer *timer = nullptr;
+    QElapsedTimer lastReclaim;
+    bool reclaimed = false;
+};
+
+MemoryGovernor::MemoryGovernor()
+    : d(new Data)
+{
+
+}
+
+MemoryGovernor::~MemoryGovernor()
+{
+    delete d->timer;
+    delete d;
+}
+
+auto MemoryGovernor::instance() -> MemoryGovernor&
+{
+    static MemoryGovernor governor;
+    return governor;
+}
+
+auto MemoryGovernor::add(MemoryConsumer *consumer) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    auto it = std::upper_bound(d->consumers.begin(), d->consumers.end(), consumer,
+        [] (const MemoryConsumer *lhs, const MemoryConsumer *rhs)
+            { return lhs->priority() < rhs->priority(); });
+    d->consumers.insert(it, consumer);
+}
+
+auto MemoryGovernor::remove(MemoryConsumer *consumer) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->consumers.removeOne(consumer);
+}
+
+auto MemoryGovernor::setBudget(qint64 bytes) -> void
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!_Change(d->budget, qMax(0LL, bytes)) && d->timer)
+            return;
+    }
+    if (!d->timer) {
+        d->timer = new QTimer;
+        d->timer->setInterval(CheckInterval);
+        QObject::connect(d->timer, &QTimer::timeout, [this] () { check(); });
+    }
+    // no budget means no management at all, pressure included
+    if (bytes > 0)
+        d->timer->start();
+    else
+        d->timer->stop();
+    d->lastReclaim.invalidate(); // new budget applies at once
+    _Info("Memory budget: %%", bytes > 0 ? toMiB(bytes) : u"unlimited"_q);
+    check();
+}
+
+auto MemoryGovernor::budget() const -> qint64
+{
+    QMutexLocker locker(&d->mutex);
+    return d->budget;
+}
+
+auto MemoryGovernor::accounted() const -> qint64
+{
+    QMutexLocker locker(&d->mutex);
+    qint64 sum = 0;
+    for (auto c : d->consumers)
+        sum += c->usage();
+    return sum;
+}
+
+auto MemoryGovernor::allowance(const MemoryConsumer *consumer,
+                               qint64 def) const -> qint64
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->budget <= 0)
+        return def;
+    qint64 others = 0;
+    for (auto c : d->consumers) {
+        if (c != consumer)
+            others += c->usage();
+    }
+    return qBound(0LL, d->budget - others, def);
+}
+
+auto MemoryGovernor::breakdown() const -> QVector<MemoryUsage>
+{
+    QMutexLocker locker(&d->mutex);
+    QVector<MemoryUsage> list;
+    list.reserve(d->consumers.size());
+    for (auto c : d->consumers) {
+        MemoryUsage u;
+        u.name = c->name();
+        u.priority = c->priority();
+        u.bytes = c->usage();
+        u.reclaimed = c->m_reclaimed;
+        list.push_back(u);
+    }
+    return list;
+}
+
+auto MemoryGovernor::report() const -> QString
+{
+    // consumers of the same kind are summed up
+    QMap<MemoryPriority, MemoryUsage> sum;
+    for (auto &u : breakdown()) {
+        auto &s = sum[u.priority];
+        s.name = u.name;
+        s.bytes += u.bytes;
+        s.reclaimed |= u.reclaimed;
+    }
+    QStringList list;
+    qint64 total = 0;
+    for (auto &s : sum) {
+        list.push_back(s.name % ": "_a % toMiB(s.bytes)
+                       % (s.reclaimed ? "(reclaimed)"_a : ""_a));
+        total += s.bytes;
+    }
+    const auto rss = residentSize();
+    list.push_back("total: "_a % toMiB(total));
+    if (rss >= 0)
+        list.push_back("rss: "_a % toMiB(rss));
+    const auto psi = pressure();
+    if (psi >= 0)
+        list.push_back("pressure: "_a % QString::number(psi, 'f', 2) % '%'_q);
+    return list.join(u", "_q);
+}
+
+auto MemoryGovernor::residentSize() -> qint64
+{
+#ifdef Q_OS_LINUX
+    QFile file(u"/proc/self/statm"_q);
+    if (!file.open(QFile::ReadOnly))
+        return -1;
+    const auto fields = file.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+auto MemoryGovernor::pressure() -> double
+{
+#ifdef Q_OS_LINUX
+    QFile file(u"/proc/pressure/memory"_q);
+    if (!file.open(QFile::ReadOnly))
+        return -1;
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    const auto line = file.readLine();
+    const int from = line.indexOf("avg10=");
+    if (!line.startsWith("some") || from < 0)
+        return -1;
+    const int to = line.indexOf(' ', from);
+    bool ok = false;
+    const auto avg = line.mid(from + 6, to - from - 6).toDouble(&ok);
+    return ok ? avg : -1;
+#else
+    return -1;
+#endif
+}
+
+auto MemoryGovernor::check() -> void
+{
+    // callbacks run on copies without mutex because they may ask for
+    // allowance() or (un)register consumers
+    QMutexLocker locker(&d->mutex);
+    qint64 total = 0;
+    for (auto c : d->consumers)
+        total += c->usage();
+    const qint64 rss = residentSize();
+    const double psi = d->budget > 0 ? pressure() : -1;
+    const qint64 used = qMax(total, rss);
+    // freed memory shows up in rss only after a while
+    const bool cooling = d->lastReclaim.isValid()
+            && d->lastReclaim.elapsed() < Cooldown;
+
+    // reclaim a bit more than needed so that it doesn't start again at once
+    qint64 excess = 0;
+    if (d->budget > 0 && used > d->budget)
+        excess = used - d->budget * Target;
+    if (psi >= HighPressure)
+        excess = qMax(excess, total / 4);
+
+    if (excess > 0) {
+        if (cooling)
+            return;
+        d->lastReclaim.start();
+        QVector<MemoryCall> calls;
+        for (auto c : d->consumers) {
+            if (c->m_reclaim && c->usage() > 0)
+                calls.push_back({ c, c->name(), c->m_reclaim, nullptr });
+        }
+        locker.unlock();
+        _Info("Reclaiming %% under pressure; %%", toMiB(excess), report());
+        for (auto &call : calls) {
+            if (excess <= 0)
+                break;
+            const auto freed = call.reclaim(excess);
+            if (freed > 0) {
+                locker.relock();
+                // consumer may have gone while its callback ran
+                if (d->consumers.contains(call.consumer))
+                    call.consumer->m_reclaimed = true;
+                d->reclaimed = true;
+                locker.unlock();
+                excess -= freed;
+                _Debug("%% gave back %%", call.name, toMiB(freed));
+            }
+        }
+        if (excess > 0)
+            _Warn("Still %% over budget after reclaim", toMiB(excess));
+        return;
+    }
+
+    if (!d->reclaimed || cooling || psi >= HighPressure * Relax
+            || (d->budget > 0 && used > d->budget * Relax))
+        return;
+    d->reclaimed = false;
+    QVector<MemoryCall> calls;
+    for (auto c : d->consumers) {
+        if (_Change(c->m_reclaimed, false) && c->m_restore)
+            calls.push_back({ c, c->name(), nullptr, c->m_restore });
+    }
+    locker.unlock();
+    for (auto &call : calls)
+        call.restore();
+    _Info("Memory pressure relieved; %%", toMiB(used));
+}
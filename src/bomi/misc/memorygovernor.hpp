@@ -0,0 +1,75 @@
+#ifndef MEMORYGOVERNOR_HPP
+#define MEMORYGOVERNOR_HPP
+
+// consumers with lower priority are asked to give memory back first
+enum class MemoryPriority {
+    Preview = 0, History, SubtitleCache, StreamCache, Video
+};
+
+struct MemoryUsage {
+    QString name;
+    MemoryPriority priority;
+    qint64 bytes = 0;
+    bool reclaimed = false;
+};
+
+// handle which a memory consumer keeps for its lifetime;
+// setUsage() is lock-free and may be called from any thread
+class MemoryConsumer {
+public:
+    using Reclaim = std::function<qint64(qint64 excess)>;
+    using Restore = std::function<void()>;
+    MemoryConsumer(const QString &name, MemoryPriority priority);
+    ~MemoryConsumer();
+    auto name() const -> QString { return m_name; }
+    auto priority() const -> MemoryPriority { return m_priority; }
+    auto setUsage(qint64 bytes) -> void { m_usage.store(bytes); }
+    auto addUsage(qint64 bytes) -> void { m_usage.fetchAndAddOrdered(bytes); }
+    auto usage() const -> qint64 { return m_usage.load(); }
+    // called in GUI thread under pressure without lock of governor; should free
+    // up to excess bytes and return how many were (or will soon be) freed
+    auto setReclaim(Reclaim &&cb) -> void { m_reclaim = std::move(cb); }
+    // called in GUI thread when pressure is gone after reclaim
+    auto setRestore(Restore &&cb) -> void { m_restore = std::move(cb); }
+private:
+    friend class MemoryGovernor;
+    QString m_name;
+    MemoryPriority m_priority;
+    QAtomicInteger<qint64> m_usage{0};
+    Reclaim m_reclaim;
+    Restore m_restore;
+    bool m_reclaimed = false;
+};
+
+// keeps registered consumers and process RSS under a common budget
+class MemoryGovernor {
+public:
+    static auto instance() -> MemoryGovernor&;
+    // bytes, 0 for unlimited; call in GUI thread
+    auto setBudget(qint64 bytes) -> void;
+    auto budget() const -> qint64;
+    // sum of usages reported by consumers
+    auto accounted() const -> qint64;
+    // largest usage which consumer may grow to without exceeding budget,
+    // or def when no budget is set
+    auto allowance(const MemoryConsumer *consumer, qint64 def) const -> qint64;
+    auto breakdown() const -> QVector<MemoryUsage>;
+    auto report() const -> QString;
+    // resident set size of this process, -1 if unknown
+    static auto residentSize() -> qint64;
+    // share of time stalled on memory over last 10s in %, -1 if unknown;
+    // only acted on while budget is set
+    static auto pressure() -> double;
+    // evaluate budget and pressure now; runs periodically once budget is set
+    auto check() -> void;
+private:
+    MemoryGovernor();
+    ~MemoryGovernor();
+    friend class MemoryConsumer;
+    auto add(MemoryConsumer *consumer) -> void;
+    auto remove(MemoryConsumer *consumer) -> void;
+    struct Data;
+    Data *d;
+};
+
+#endif // MEMORYGOVERNOR_HPP
@@ -1,55 +1,127 @@
 #include "xmlrpcclient.hpp"
 #include "misc/log.hpp"
-#include <QDomNode>
+#include <QXmlStreamWriter>
+#include <QXmlStreamReader>
 
 DECLARE_LOG_CONTEXT(XML-RPC)
 
-static QDomNode toValueNode(QDomDocument &doc, const QVariant &var) {
-    auto value = doc.createElement(u"value"_q);
-    QDomElement elem;
-    auto el = [&doc] (const QString &tag) { return doc.createElement(tag); };
-    auto tn = [&doc] (const QString &text) { return doc.createTextNode(text); };
-    auto te = [el, tn] (const QString &tag, const QString &text)
-        { auto e = el(tag); e.appendChild(tn(text)); return e; };
+static auto writeValue(QXmlStreamWriter &xml, const QVariant &var) -> void
+{
+    xml.writeStartElement(u"value"_q);
     switch (var.type()) {
     case QVariant::String:
-        elem = te(u"string"_q, var.toString());
+        xml.writeTextElement(u"string"_q, var.toString());
         break;
     case QVariant::Double:
-        elem = te(u"double"_q, var.toString());
+        xml.writeTextElement(u"double"_q, var.toString());
         break;
     case QVariant::Int:
     case QVariant::UInt:
     case QVariant::LongLong:
     case QVariant::ULongLong:
-        elem = te(u"int"_q, var.toString());
+        xml.writeTextElement(u"int"_q, var.toString());
         break;
     case QVariant::Bool:
-        elem = te(u"boolean"_q, QString::number(var.toInt()));
+        xml.writeTextElement(u"boolean"_q, QString::number(var.toInt()));
         break;
     case QVariant::List: {
         const auto list = var.toList();
-        elem = doc.createElement(u"array"_q);
-        auto data = elem.appendChild(doc.createElement(u"data"_q));
+        xml.writeStartElement(u"array"_q);
+        xml.writeStartElement(u"data"_q);
         for (auto &it : list)
-            data.appendChild(toValueNode(doc, it));
+            writeValue(xml, it);
+        xml.writeEndElement();
+        xml.writeEndElement();
         break;
     } case QVariant::Map: {
         const auto map = var.toMap();
-        elem = doc.createElement(u"struct"_q);
+        xml.writeStartElement(u"struct"_q);
         for (auto it = map.begin(); it != map.end(); ++it) {
-            auto member = elem.appendChild(el(u"member"_q));
-            member.appendChild(te(u"name"_q, it.key()));
-            member.appendChild(toValueNode(doc, *it));
+            xml.writeStartElement(u"member"_q);
+            xml.writeTextElement(u"name"_q, it.key());
+            writeValue(xml, *it);
+            xml.writeEndElement();
         }
+        xml.writeEndElement();
         break;
     } default:
         _Error("%% was not handle. Convert it to string...", var.typeName());
-        elem = te(u"string"_q, var.toString());
+        xml.writeTextElement(u"string"_q, var.toString());
         break;
     }
-    value.appendChild(elem);
-    return value;
+    xml.writeEndElement();
+}
+
+// reader should be positioned at <value>; leaves it at </value>
+static auto readValue(QXmlStreamReader &xml) -> QVariant
+{
+    Q_ASSERT(xml.isStartElement() && xml.name() == "value"_a);
+    QVariant ret;
+    QString text;
+    bool typed = false;
+    while (!xml.atEnd()) {
+        switch (xml.readNext()) {
+        case QXmlStreamReader::Characters:
+            if (!typed)
+                text += xml.text();
+            break;
+        case QXmlStreamReader::EndElement:
+            return typed ? ret : QVariant(text);
+        case QXmlStreamReader::StartElement: {
+            typed = true;
+            const auto tag = xml.name();
+            if (tag == "string"_a) {
+                ret = xml.readElementText();
+            } else if (tag == "double"_a) {
+                ret = xml.readElementText().toDouble();
+            } else if (tag == "boolean"_a) {
+                ret = !!xml.readElementText().toInt();
+            } else if (tag == "int"_a || tag == "i4"_a) {
+                ret = xml.readElementText().toInt();
+            } else if (tag == "array"_a) {
+                QVariantList list;
+                while (xml.readNextStartElement()) {
+                    if (xml.name() != "data"_a) {
+                        xml.skipCurrentElement();
+                        continue;
+                    }
+                    while (xml.readNextStartElement()) {
+                        if (xml.name() == "value"_a)
+                            list.append(readValue(xml));
+                        else
+                            xml.skipCurrentElement();
+                    }
+                }
+                ret = list;
+            } else if (tag == "struct"_a) {
+                QVariantMap map;
+                while (xml.readNextStartElement()) {
+                    if (xml.name() != "member"_a) {
+                        xml.skipCurrentElement();
+                        continue;
+                    }
+                    QString name; QVariant value;
+                    while (xml.readNextStartElement()) {
+                        if (xml.name() == "name"_a)
+                            name = xml.readElementText();
+                        else if (xml.name() == "value"_a)
+                            value = readValue(xml);
+                        else
+                            xml.skipCurrentElement();
+                    }
+                    map[name] = value;
+                }
+                ret = map;
+            } else {
+                _Error("'%%' element was not handle.", tag.toString());
+                xml.skipCurrentElement();
+            }
+            break;
+        } default:
+            break;
+        }
+    }
+    return ret;
 }
 
 struct XmlRpcClient::Data {
@@ -67,6 +139,9 @@ XmlRpcClient::XmlRpcClient(QObject *parent)
                          u"CMPlayerXmlRpcClient/0.1"_q);
     d->request.setHeader(QNetworkRequest::ContentTypeHeader,
                          u"text/xml"_q);
+    // calls are independent; let them share one keep-alive connection
+    d->request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute,
+                            true);
 }
 
 XmlRpcClient::~XmlRpcClient()
@@ -79,99 +154,118 @@ auto XmlRpcClient::setUrl(const QUrl &url) -> void
     d->request.setUrl(url);
 }
 
-auto XmlRpcClient::postCall(const QString &method,
-                            const QVariantList &args) -> QNetworkReply*
+auto XmlRpcClient::serialize(const QString &method,
+                             const QVariantList &args) -> QByteArray
 {
-    QDomDocument doc;
-    doc.appendChild(doc.createProcessingInstruction(
-                        u"xml"_q, uR"(version="1.0" encoding="UTF-8")"_q
-                    ));
-
-    auto call = doc.createElement(u"methodCall"_q);
-    doc.appendChild(call);
-
-    auto name = doc.createElement(u"methodName"_q);
-    name.appendChild(doc.createTextNode(method));
-    call.appendChild(name);
-
+    QByteArray data;
+    data.reserve(512);
+    QXmlStreamWriter xml(&data);
+    xml.writeStartDocument();
+    xml.writeStartElement(u"methodCall"_q);
+    xml.writeTextElement(u"methodName"_q, method);
     if (!args.isEmpty()) {
-        auto params = doc.createElement(u"params"_q);
-        for (int i=0; i<args.size(); ++i)
-            params.appendChild(doc.createElement(u"param"_q))
-                  .appendChild(toValueNode(doc, args[i]));
-        call.appendChild(params);
+        xml.writeStartElement(u"params"_q);
+        for (int i=0; i<args.size(); ++i) {
+            xml.writeStartElement(u"param"_q);
+            writeValue(xml, args[i]);
+            xml.writeEndElement();
+        }
+        xml.writeEndElement();
     }
-    d->lastCall = doc.toString();
-    return d->nam.post(d->request, d->lastCall.toUtf8());
+    xml.writeEndElement();
+    xml.writeEndDocument();
+    return data;
 }
 
-QVariant parseValue(const QDomElement &elem) {
-    Q_ASSERT(elem.tagName() == "value"_a);
-    auto type = elem.firstChildElement();
-    if (type.isNull())
-        return elem.text();
-    auto tag = type.tagName();
-    if (tag == "string"_a) {
-        return type.text();
-    } else if (tag == "double"_a) {
-        return type.text().toDouble();
-    } else if (tag == "boolean"_a) {
-        return !!type.text().toInt();
-    } else if (tag == "array"_a) {
-        QVariantList list;
-        auto data = type.firstChildElement(u"data"_q);
-        auto value = data.firstChildElement(u"value"_q);
-        while (!value.isNull()) {
-            list.append(parseValue(value));
-            value = value.nextSiblingElement(u"value"_q);
-        }
-        return list;
-    } else if (tag == "struct"_a) {
-        QMap<QString, QVariant> map;
-        auto member = type.firstChildElement(u"member"_q);
-        while (!member.isNull()) {
-            auto name = member.firstChildElement(u"name"_q).text();
-            auto value = parseValue(member.firstChildElement(u"value"_q));
-            map[name] = value;
-            member = member.nextSiblingElement(u"member"_q);
+auto XmlRpcClient::postCall(const QString &method,
+                            const QVariantList &args) -> QNetworkReply*
+{
+    const auto data = serialize(method, args);
+    d->lastCall = QString::fromUtf8(data);
+    return d->nam.post(d->request, data);
+}
+
+// reader should be positioned at <params>; leaves it at </params>
+static auto readParams(QXmlStreamReader &xml, QVariantList *params) -> bool
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() != "param"_a) {
+            xml.skipCurrentElement();
+            continue;
         }
-        return map;
-    } else if (tag == "int"_a)
-        return type.text().toInt();
-    else {
-        _Error("'%%' element was not handle.", tag);
+        if (!xml.readNextStartElement() || xml.name() != "value"_a)
+            return false;
+        params->append(readValue(xml));
+        xml.skipCurrentElement(); // </param>
     }
-    return QVariant();
+    return true;
 }
 
-auto XmlRpcClient::parseResponse(const QByteArray &reply,
-                                 bool compressed) -> QVariantList
+auto XmlRpcClient::parse(const QByteArray &data) -> QVariantList
 {
-    QDomDocument doc;
-    if (compressed)
-        doc.setContent(_Uncompress(reply));
-    else
-        doc.setContent(reply);
-    auto elem = doc.firstChildElement(u"methodResponse"_q);
-    if (elem.isNull())
+    QXmlStreamReader xml(data);
+    if (!xml.readNextStartElement() || xml.name() != "methodResponse"_a)
         return QVariantList();
-    elem = elem.firstChildElement(u"params"_q);
-    if (elem.isNull()) {
-        // fault
+    QVariantList params;
+    while (xml.readNextStartElement()) {
+        if (xml.name() != "params"_a) {
+            // fault
+            return QVariantList();
+        }
+        if (!readParams(xml, &params))
+            return QVariantList();
+    }
+    if (xml.hasError()) {
+        _Error("Cannot parse response: %%", xml.errorString());
         return QVariantList();
     }
+    return params;
+}
+
+auto XmlRpcClient::parseCall(const QByteArray &data, QString *method) -> QVariantList
+{
+    QXmlStreamReader xml(data);
+    if (!xml.readNextStartElement() || xml.name() != "methodCall"_a)
+        return QVariantList();
     QVariantList params;
-    auto param = elem.firstChildElement(u"param"_q);
-    while (!param.isNull()) {
-        auto value = param.firstChildElement(u"value"_q);
-        if (value.isNull())
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "methodName"_a)
+            *method = xml.readElementText();
+        else if (xml.name() != "params"_a)
+            xml.skipCurrentElement();
+        else if (!readParams(xml, &params))
             return QVariantList();
-        params.append(parseValue(value));
-        param = param.nextSiblingElement();
     }
+    if (xml.hasError())
+        return QVariantList();
     return params;
 }
 
+auto XmlRpcClient::serializeResponse(const QVariantList &params) -> QByteArray
+{
+    QByteArray data;
+    data.reserve(512);
+    QXmlStreamWriter xml(&data);
+    xml.writeStartDocument();
+    xml.writeStartElement(u"methodResponse"_q);
+    xml.writeStartElement(u"params"_q);
+    for (auto &param : params) {
+        xml.writeStartElement(u"param"_q);
+        writeValue(xml, param);
+        xml.writeEndElement();
+    }
+    xml.writeEndElement();
+    xml.writeEndElement();
+    xml.writeEndDocument();
+    return data;
+}
+
+auto XmlRpcClient::parseResponse(const QByteArray &reply,
+                                 bool compressed) -> QVariantList
+{
+    return parse(compressed ? _Uncompress(reply) : reply);
+}
+
 auto XmlRpcClient::lastCall() const -> QString
 {
     return d->lastCall;
@@ -20,6 +20,12 @@ public:
     auto postCall(const QString &method,
                   const QVariantList &args = QVariantList()) -> QNetworkReply*;
     auto lastCall() const -> QString;
+    static auto serialize(const QString &method,
+                          const QVariantList &args) -> QByteArray;
+    static auto parse(const QByteArray &response) -> QVariantList;
+    // server side of codec
+    static auto parseCall(const QByteArray &call, QString *method) -> QVariantList;
+    static auto serializeResponse(const QVariantList &params) -> QByteArray;
 private:
     static auto parseResponse(const QByteArray &reply,
                               bool compressed) -> QVariantList;
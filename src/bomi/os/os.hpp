@@ -27,6 +27,8 @@ auto processTime() -> quint64; // us
 auto systemTime()  -> quint64; // us
 auto totalMemory() -> double;
 auto usingMemory() -> double;
+auto contextSwitches() -> qint64; // all threads, -1 if unknown
+auto isOnBattery() -> bool;
 
 auto defaultFont() -> QFont;
 auto defaultFixedFont() -> QFont;
@@ -522,6 +522,19 @@ auto usingMemory() -> double
     return counters.WorkingSetSize/double(1024*1024);
 }
 
+auto contextSwitches() -> qint64
+{
+    return -1;
+}
+
+auto isOnBattery() -> bool
+{
+    SYSTEM_POWER_STATUS status;
+    if (!GetSystemPowerStatus(&status))
+        return false;
+    return status.ACLineStatus == 0;
+}
+
 auto canShutdown() -> bool
 {
     if (d->shutdownToken)
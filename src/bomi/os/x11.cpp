@@ -575,6 +575,47 @@ auto usingMemory() -> double
     return resident * sysconf(_SC_PAGESIZE) / double(1024*1024);
 }
 
+auto contextSwitches() -> qint64
+{
+    QDir dir(u"/proc/self/task"_q);
+    if (!dir.exists())
+        return -1;
+    qint64 sum = 0;
+    for (auto &task : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile file(dir.filePath(task % "/status"_a));
+        if (!file.open(QFile::ReadOnly))
+            continue;
+        // voluntary_ctxt_switches and nonvoluntary_ctxt_switches
+        for (auto &line : file.readAll().split('\n')) {
+            if (!line.contains("ctxt_switches:"))
+                continue;
+            sum += line.mid(line.indexOf(':') + 1).trimmed().toLongLong();
+        }
+    }
+    return sum;
+}
+
+auto isOnBattery() -> bool
+{
+    // on battery if there is a mains supply and none is online
+    QDir dir(u"/sys/class/power_supply"_q);
+    bool mains = false;
+    for (auto &supply : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot
+                                      | QDir::System)) {
+        auto read = [&] (const char *name) {
+            QFile file(dir.filePath(supply % '/'_q % _L(name)));
+            return file.open(QFile::ReadOnly) ? file.readAll().trimmed()
+                                              : QByteArray();
+        };
+        if (read("type") != "Mains")
+            continue;
+        if (read("online") == "1")
+            return false;
+        mains = true;
+    }
+    return mains;
+}
+
 /******************************************************************************/
 
 struct HwAccCodec {
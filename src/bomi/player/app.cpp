@@ -8,6 +8,18 @@
 #include "misc/objectstorage.hpp"
 #include "quick/appobject.hpp"
 #include "rootmenu.hpp"
+#include "sessiontrace.hpp"
+#include "playbacksync.hpp"
+#include "audio/audiomixtrack.hpp"
+#include "video/renderbenchmark.hpp"
+#include "video/contactsheet.hpp"
+#include "probetuner.hpp"
+#include "livelatency.hpp"
+#include "misc/allocprofiler.hpp"
+#include "misc/cpukernel.hpp"
+#ifdef BOMI_SELF_TEST
+#include "test/selftest.hpp"
+#endif
 #include "os/os.hpp"
 #include <clocale>
 #include <QStyleFactory>
@@ -43,6 +55,9 @@ enum class LineCmd {
     Wake, Open, Action, LogLevel, Debug,
     DumpApiTree, DumpActionList, WinAssoc, WinUnassoc, WinAssocDefault,
     SetSubtitle, AddSubtitle,
+    RecordTrace, ReplayTrace, TraceReport, CompareReport, BenchmarkAudioMix,
+    BenchmarkRender, ProfileAllocations, SyncLead, SyncFollow, BenchmarkProbe,
+    MeasureLatency, CpuLevel, DumpCpuKernels, SelfTest, ContactSheets
 };
 
 static const QCommandLineOption s_dummy{u"__dummy__"_q};
@@ -146,6 +161,7 @@ struct App::Data {
     QFont fixedFont = OS::defaultFixedFont();
     LocalConnection connection;
     CommandParser *parser = nullptr;
+    LatencyGenerator latency;
 
     auto open(const Mrl &mrl, const QString &sub) -> void
     {
@@ -256,6 +272,57 @@ App::App(int &argc, char **argv)
                          u"Dump API structure tree to stdout."_q);
     d->parser->addOption(LineCmd::DumpActionList, u"dump-action-list"_q,
                          u"Dump executable action list to stdout."_q);
+    d->parser->addOption(LineCmd::RecordTrace, u"record-trace"_q,
+                         u"Record commands and state changes of this session into %1."_q, u"file"_q);
+    d->parser->addOption(LineCmd::ReplayTrace, u"replay-trace"_q,
+                         u"Replay commands recorded in %1 and quit. "
+                         "Set QT_QPA_PLATFORM=offscreen to run without display."_q, u"file"_q);
+    d->parser->addOption(LineCmd::TraceReport, u"trace-report"_q,
+                         u"Write metrics of replayed steps into %1."_q, u"file"_q);
+    d->parser->addOption(LineCmd::CompareReport, u"compare-report"_q,
+                         u"Compare two replay reports given by %1 twice."_q, u"file"_q);
+    d->parser->addOption(LineCmd::BenchmarkAudioMix, u"benchmark-audio-mix"_q,
+                         u"Measure cost of mixing audio tracks per block."_q);
+    d->parser->addOption(LineCmd::BenchmarkRender, u"benchmark-render"_q,
+                         u"Measure video, OSD and subtitle rendering on synthetic frames "
+                         "offscreen and write results "
+                         "into %1 as JSON, or stdout for -. "
+                         "Set LIBGL_ALWAYS_SOFTWARE=1 to run on software rasterizer."_q, u"file"_q);
+    d->parser->addOption(LineCmd::BenchmarkProbe, u"benchmark-probe"_q,
+                         u"Measure opening %1 through a slow local HTTP server "
+                         "with default and tuned stream probing."_q, u"file"_q);
+    d->parser->addOption(LineCmd::ProfileAllocations, u"profile-allocations"_q,
+                         u"Log allocation rates per scope and thread every second "
+                         "and top call sites on exit. Requires build configured "
+                         "with --alloc-profiler."_q);
+    d->parser->addOption(LineCmd::SyncLead, u"sync-lead"_q,
+                         u"Serve playback clock on UDP %1 for other instances to follow. "
+                         "Port alone listens on loopback only."_q, u"[ip:]port"_q);
+    d->parser->addOption(LineCmd::SyncFollow, u"sync-follow"_q,
+                         u"Keep playback in sync with instance leading at %1."_q, u"host:port"_q);
+    d->parser->addOption(LineCmd::MeasureLatency, u"measure-latency"_q,
+                         u"Play timestamped test pattern from a local pipe in low latency "
+                         "mode for %1 seconds, then print latency until frames are "
+                         "displayed and quit."_q, u"sec"_q);
+    d->parser->addOption(LineCmd::CpuLevel, u"cpu-level"_q,
+                         u"Select variants of audio and video kernels by %1, which is "
+                         "comma-separated list of auto, benchmark, highest level to use "
+                         "or <kernel>=<level> for single kernel. Levels are "_q
+                         % CpuKernels::levelNames().join(u", "_q)
+                         % u". BOMI_CPU_LEVEL is used if not given."_q, u"mode"_q);
+    d->parser->addOption(LineCmd::DumpCpuKernels, u"dump-cpu-kernels"_q,
+                         u"Dump selected variant of every CPU kernel to stdout."_q);
+    d->parser->addOption(LineCmd::ContactSheets, u"contact-sheets"_q,
+                         u"Write contact sheet of video %1, or of every video in folder "
+                         "%1, next to it without window, print throughput and quit with "
+                         "number of failed files as exit code. Set QT_QPA_PLATFORM=offscreen "
+                         "to run without display."_q, u"path"_q);
+#ifdef BOMI_SELF_TEST
+    d->parser->addOption(LineCmd::SelfTest, u"self-test"_q,
+                         u"Run built-in checks given by comma-separated %1, or all, "
+                         "and quit with number of failed checks as exit code. "
+                         "Checks are "_q % SelfTest::names().join(u", "_q) % '.'_q, u"names"_q);
+#endif
 #ifdef Q_OS_WIN
     d->parser->addOption(LineCmd::WinAssoc, u"win-assoc"_q,
                          u"Associate given comma-separated extension list."_q, u"ext"_q);
@@ -287,6 +354,16 @@ App::App(int &argc, char **argv)
         logOption.setLevel(LogOutput::StdOut, lvStdOut);
     Log::setOption(logOption);
 
+    if (d->parser->isSet(LineCmd::RecordTrace))
+        SessionTrace::instance().startRecording(d->parser->value(LineCmd::RecordTrace));
+    if (d->parser->isSet(LineCmd::ProfileAllocations)) {
+        if (AllocProfiler::isAvailable())
+            AllocProfiler::start();
+        else
+            _Warn("Allocation profiler is not built. Configure with --alloc-profiler.");
+    }
+    CpuKernels::initialize(d->parser->value(LineCmd::CpuLevel));
+
     setQuitOnLastWindowClosed(false);
 #ifndef Q_OS_MAC
     setWindowIcon(defaultIcon());
@@ -325,6 +402,7 @@ App::~App() {
     delete d;
     OS::finalize();
     RootMenu::finalize();
+    SessionTrace::finalize();
     delete d->parser;
 }
 
@@ -335,9 +413,10 @@ auto App::version() -> const char*
 
 auto _CommonExtList(ExtTypes ext) -> QStringList;
 
-auto App::executeToQuit() -> bool
+auto App::executeToQuit(int &exitCode) -> bool
 {
     bool done = false;
+    exitCode = 0;
     auto isSet = [&] (LineCmd cmd) {
         const auto set = d->parser->isSet(cmd);
         done |= set; return set;
@@ -346,13 +425,45 @@ auto App::executeToQuit() -> bool
         AppObject::dumpInfo();
     if (isSet(LineCmd::DumpActionList))
         RootMenu::dumpInfo();
+    if (isSet(LineCmd::DumpCpuKernels)) {
+        for (auto &line : CpuKernels::report().split('\n'_q, QString::SkipEmptyParts))
+            qDebug().nospace() << line.toLocal8Bit().constData();
+    }
     if (isSet(LineCmd::WinAssoc))
         OS::associateFileTypes(nullptr, true, d->parser->value(LineCmd::WinAssoc).split(','_q));
     if (isSet(LineCmd::WinAssocDefault))
         OS::associateFileTypes(nullptr, true, _CommonExtList(VideoExt | AudioExt));
     if (isSet(LineCmd::WinUnassoc))
         OS::unassociateFileTypes(nullptr, true);
-    if (isUnique() && sendMessage(CommandLine, d->parser->toJson())) {
+    if (isSet(LineCmd::CompareReport)) {
+        const auto files = d->parser->values(LineCmd::CompareReport);
+        if (files.size() == 2)
+            SessionTrace::compare(files[0], files[1]);
+        else
+            _Error("Two reports are required to compare.");
+    }
+#ifdef BOMI_SELF_TEST
+    if (isSet(LineCmd::SelfTest)) {
+        const auto names = d->parser->value(LineCmd::SelfTest);
+        exitCode = SelfTest::run(names.split(','_q, QString::SkipEmptyParts));
+    }
+#endif
+    if (isSet(LineCmd::BenchmarkAudioMix))
+        AudioMixTrack::benchmark();
+    if (isSet(LineCmd::BenchmarkRender))
+        RenderBenchmark::run(d->parser->value(LineCmd::BenchmarkRender));
+    if (isSet(LineCmd::BenchmarkProbe))
+        ProbeTuner::benchmark(d->parser->value(LineCmd::BenchmarkProbe));
+    if (isSet(LineCmd::ContactSheets))
+        exitCode = ContactSheetEngine::run(d->parser->value(LineCmd::ContactSheets),
+                                           ContactSheetOption());
+    // traced, synced and measuring sessions must run in this process
+    const auto traced = d->parser->isSet(LineCmd::RecordTrace)
+                        || d->parser->isSet(LineCmd::ReplayTrace)
+                        || d->parser->isSet(LineCmd::SyncLead)
+                        || d->parser->isSet(LineCmd::SyncFollow)
+                        || d->parser->isSet(LineCmd::MeasureLatency);
+    if (!traced && isUnique() && sendMessage(CommandLine, d->parser->toJson())) {
         done = true;
         _Info("Another instance of bomi is already running. Exit this...");
     }
@@ -399,10 +510,37 @@ auto App::setMainWindow(MainWindow *mw) -> void
 #ifndef Q_OS_MAC
     d->main->setIcon(defaultIcon());
 #endif
+    SessionTrace::instance().attach(d->main);
+    if (d->parser->isSet(LineCmd::SyncLead)) {
+        auto sync = new PlaybackSync(d->main->engine(), this);
+        sync->lead(d->parser->value(LineCmd::SyncLead));
+    } else if (d->parser->isSet(LineCmd::SyncFollow)) {
+        auto sync = new PlaybackSync(d->main->engine(), this);
+        sync->follow(d->parser->value(LineCmd::SyncFollow));
+    }
+    if (d->parser->isSet(LineCmd::MeasureLatency) && d->latency.start()) {
+        auto engine = d->main->engine();
+        engine->setLatencyProbe(true);
+        d->open(QUrl::fromLocalFile(d->latency.path()), QString());
+        const int secs = qMax(1, d->parser->value(LineCmd::MeasureLatency).toInt());
+        QTimer::singleShot(secs * 1000, this, [=] () {
+            const auto text = engine->latencyStats().toString();
+            qDebug().nospace() << ("Pipe to display: "_a % text).toLocal8Bit().constData();
+            engine->setLatencyProbe(false);
+            d->latency.stop();
+            d->main->exit();
+        });
+    }
     connect(d->main, &MainWindow::sceneGraphInitialized, this, [this] () {
         if (!d->pended.mrl.isEmpty())
             d->main->openFromFileManager(d->pended.mrl, d->pended.sub);
         d->pended.clear();
+        if (d->parser->isSet(LineCmd::ReplayTrace)) {
+            auto &trace = SessionTrace::instance();
+            if (!trace.isReplaying())
+                trace.replay(d->parser->value(LineCmd::ReplayTrace),
+                             d->parser->value(LineCmd::TraceReport));
+        }
     }, Qt::QueuedConnection);
 }
 
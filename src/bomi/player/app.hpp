@@ -21,7 +21,8 @@ public:
     auto mainWindow() const -> MainWindow*;
     auto styleName() const -> QString;
     auto isUnique() const -> bool;
-    auto executeToQuit() -> bool;
+    // exitCode is set when returning true
+    auto executeToQuit(int &exitCode) -> bool;
     auto availableStyleNames() const -> QStringList;
     auto setUseLocalConfig(bool local) -> void;
     auto useLocalConfig() const -> bool;
@@ -3,6 +3,7 @@
 
 #include "enum/colorrange.hpp"
 #include "enum/colorspace.hpp"
+#include "quick/propertybatch.hpp"
 #include <QQmlListProperty>
 
 class AudioFormat;                      class StreamTrack;
@@ -161,12 +162,18 @@ public:
     auto output() -> AudioFormatObject* { return &m_output; }
     auto normalizer() const -> double { return m_gain; }
     auto setNormalizer(double gain) -> void
-        { if (_Change(m_gain, gain)) emit normalizerChanged(); }
+    {
+        if (_Change(m_gain, gain))
+            PropertyBatch::notify(this, &AudioObject::normalizerChanged);
+    }
     auto device() const -> QString;
     auto driver() const -> QString { return m_driver; }
     auto spectrum() const -> QList<qreal> { return m_spectrum; }
     auto setSpectrum(const QList<qreal> &spectrum) -> void
-        { emit spectrumChanged(m_spectrum = spectrum); }
+    {
+        m_spectrum = spectrum;
+        PropertyBatch::notify(this, &AudioObject::spectrumChanged, m_spectrum);
+    }
 public slots:
     void setDriver(const QString &driver);
     void setDevice(const QString &device);
@@ -299,7 +306,10 @@ public:
     auto setFrameCount(qint64 count) -> void
         { if (_Change(m_frameCount, count)) emit frameCountChanged(); }
     auto setFrameNumber(qint64 n) -> void
-        { if (_Change(m_frameNumber, n)) emit frameNumberChanged(); }
+    {
+        if (_Change(m_frameNumber, n))
+            PropertyBatch::notify(this, &VideoObject::frameNumberChanged);
+    }
     auto frameNumber() const -> qint64 { return m_frameNumber; }
     auto frameCount() const -> qint64 { return m_frameCount; }
     auto screen() const -> VideoRenderer* { return m_screen; }
@@ -0,0 +1,245 @@
+#include "decodertuner.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+
+DECLARE_LOG_CONTEXT(Video)
+
+static constexpr int TableVersion = 2;
+static constexpr int MaxEntries = 200;
+// Time spent in decode() is how long playback waited for a frame. With frame
+// threads, decoding of a frame overlaps with previous calls, so this is not
+// the cost of a frame and cannot be scaled by thread count. It only tells
+// whether the decoder keeps up: it falls behind when waiting takes most of
+// the frame interval and has spare threads when it hardly waits at all.
+static constexpr double Behind = 0.85;
+static constexpr double Idle = 0.1;
+// frames to average over before judging
+static constexpr int MinFrames = 60;
+static constexpr int MaxRestarts = 2;
+
+// least is the smallest count not known to fall behind
+struct Entry { int threads = 0, least = 1; qint64 time = 0; };
+
+struct DecoderTuner::Data {
+    mutable QMutex mutex;
+    bool enabled = true, loaded = false, dirty = false;
+    int max = qBound(1, QThread::idealThreadCount(), 16);
+    QString fileName, key;
+    QHash<QString, Entry> table;
+    // current stream
+    double interval = 1.0/25.0, lastTime = 0;
+    int threads = 0, least = 1, restarts = 0, samples = 0, idle = 0;
+    bool behind = false;
+    qint64 lastDecoded = 0, lastDropped = -1;
+
+    static auto keyOf(const QString &codec, const QSize &size, double fps) -> QString
+    {
+        static const int heights[] = {480, 576, 720, 1080, 1440, 2160, 4320};
+        int h = size.height();
+        for (auto height : heights) {
+            if (h <= height) {
+                h = height;
+                break;
+            }
+        }
+        return codec % '@'_q % _N(h) % (fps > 35 ? "p60"_a : "p30"_a);
+    }
+    // first guess: pixel rate relative to 1080p30 weighted by codec
+    auto guess(const QString &codec, const QSize &size, double fps) const -> int
+    {
+        double weight = 1.0;
+        if (codec == "hevc"_a || codec == "vp9"_a || codec == "av1"_a)
+            weight = 2.0;
+        else if (codec.startsWith("mpeg"_a) || codec.startsWith("msmpeg"_a)
+                 || codec == "h263"_a || codec == "theora"_a)
+            weight = 0.5;
+        const double rate = size.width() * size.height() * (fps > 0 ? fps : 25.0);
+        return qBound(1, qCeil(rate / (1920.0 * 1080.0 * 30.0) * weight * 2.0), max);
+    }
+    auto load() -> void
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        if (fileName.isEmpty())
+            return;
+        JsonStorage storage(fileName);
+        const auto json = storage.read();
+        if (storage.hasError() || json[u"version"_q].toInt() != TableVersion)
+            return;
+        const auto entries = json[u"entries"_q].toObject();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            const auto obj = it.value().toObject();
+            Entry e;
+            e.threads = obj[u"threads"_q].toInt();
+            e.least = qBound(1, obj[u"least"_q].toInt(), e.threads);
+            e.time = obj[u"time"_q].toVariant().toLongLong();
+            if (e.threads > 0)
+                table.insert(it.key(), e);
+        }
+    }
+    auto save() -> void
+    {
+        if (!dirty || fileName.isEmpty())
+            return;
+        while (table.size() > MaxEntries) {
+            auto oldest = table.begin();
+            for (auto it = table.begin(); it != table.end(); ++it) {
+                if (it->time < oldest->time)
+                    oldest = it;
+            }
+            table.erase(oldest);
+        }
+        QJsonObject entries;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            QJsonObject obj;
+            obj[u"threads"_q] = it->threads;
+            obj[u"least"_q] = it->least;
+            obj[u"time"_q] = (double)it->time;
+            entries.insert(it.key(), obj);
+        }
+        QJsonObject json;
+        json[u"version"_q] = TableVersion;
+        json[u"entries"_q] = entries;
+        JsonStorage storage(fileName);
+        if (storage.write(json))
+            dirty = false;
+    }
+};
+
+DecoderTuner::DecoderTuner()
+    : DecoderTuner(_WritablePath(Location::Cache) % "/decoder-threads.json"_a)
+{
+}
+
+DecoderTuner::DecoderTuner(const QString &fileName)
+    : d(new Data)
+{
+    d->fileName = fileName;
+}
+
+DecoderTuner::~DecoderTuner()
+{
+    d->save();
+    delete d;
+}
+
+auto DecoderTuner::setEnabled(bool enabled) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->enabled = enabled;
+}
+
+auto DecoderTuner::isEnabled() const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    return d->enabled;
+}
+
+auto DecoderTuner::setMaximum(int threads) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->max = qBound(1, qMin(threads, QThread::idealThreadCount()), 16);
+}
+
+auto DecoderTuner::maximum() const -> int
+{
+    QMutexLocker locker(&d->mutex);
+    return d->max;
+}
+
+auto DecoderTuner::threads() const -> int
+{
+    QMutexLocker locker(&d->mutex);
+    return d->threads;
+}
+
+auto DecoderTuner::start(const QString &codec, const QSize &size, double fps) -> int
+{
+    QMutexLocker locker(&d->mutex);
+    d->key.clear();
+    d->threads = 0;
+    if (!d->enabled || codec.isEmpty() || size.isEmpty())
+        return 0;
+    d->load();
+    d->key = Data::keyOf(codec, size, fps);
+    d->interval = 1.0 / (fps > 0 ? fps : 25.0);
+    d->lastTime = 0;
+    d->restarts = d->samples = d->idle = 0;
+    d->behind = false;
+    d->lastDecoded = 0;
+    d->lastDropped = -1;
+    const auto it = d->table.constFind(d->key);
+    if (it != d->table.cend()) {
+        d->threads = qMin(it->threads, d->max);
+        d->least = it->least;
+    } else {
+        d->threads = d->guess(codec, size, fps);
+        d->least = 1;
+    }
+    _Debug("Use %% decoder thread(s) for %%", d->threads, d->key);
+    return d->threads;
+}
+
+auto DecoderTuner::update(double decodeTime, qint64 decoded, qint64 dropped) -> int
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->key.isEmpty() || d->threads <= 0)
+        return 0;
+    if (decoded < d->lastDecoded) { // decoder restarted
+        d->lastDecoded = 0;
+        d->lastTime = 0;
+    }
+    const auto frames = decoded - d->lastDecoded;
+    if (frames < MinFrames)
+        return 0;
+    const auto wait = (decodeTime - d->lastTime) / frames;
+    const bool dropping = d->lastDropped >= 0 && dropped > d->lastDropped;
+    d->lastDecoded = decoded;
+    d->lastTime = decodeTime;
+    d->lastDropped = dropped;
+    ++d->samples;
+
+    if (wait <= Behind * d->interval && !dropping) {
+        if (wait < Idle * d->interval)
+            ++d->idle;
+        return 0;
+    }
+    d->behind = true;
+    d->least = qMax(d->least, d->threads + 1);
+    // how much a thread adds is unknown, so search by doubling
+    const auto threads = qMin(d->threads * 2, d->max);
+    if (threads <= d->threads || d->restarts >= MaxRestarts)
+        return 0;
+    _Info("Decoder waits %%ms of %%ms per frame with %% thread(s), use %%",
+          qRound(wait * 1e3), qRound(d->interval * 1e3), d->threads, threads);
+    d->threads = threads;
+    d->behind = false;
+    ++d->restarts;
+    d->samples = d->idle = 0;
+    return threads;
+}
+
+auto DecoderTuner::stop() -> void
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->key.isEmpty() && (d->samples > 0 || d->restarts > 0)) {
+        // lower count is only tried next time, restarting for it would cost
+        // more than the idle cores; never below a count which fell behind
+        auto &e = d->table[d->key];
+        auto threads = d->threads;
+        if (d->samples > 0 && !d->behind && d->idle == d->samples)
+            threads = qMax(d->least, threads - 1);
+        const auto least = qMin(d->least, threads);
+        if (e.threads != threads || e.least != least) {
+            _Debug("Remember %% decoder thread(s) for %%", threads, d->key);
+            e.threads = threads;
+            e.least = least;
+            d->dirty = true;
+        }
+        e.time = QDateTime::currentMSecsSinceEpoch() / 1000;
+        d->save();
+    }
+    d->key.clear();
+    d->threads = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef DECODERTUNER_HPP
+#define DECODERTUNER_HPP
+
+// chooses software decoder threads for each stream from measured decoding
+// cost and remembers what was enough for each codec and resolution
+class DecoderTuner {
+public:
+    DecoderTuner();
+    // table is kept in memory only for empty fileName
+    DecoderTuner(const QString &fileName);
+    ~DecoderTuner();
+    auto setEnabled(bool enabled) -> void;
+    auto isEnabled() const -> bool;
+    // upper bound, e.g. lowered while saving power
+    auto setMaximum(int threads) -> void;
+    auto maximum() const -> int;
+    // returns threads to open decoder with, 0 to let decoder decide
+    auto start(const QString &codec, const QSize &size, double fps) -> int;
+    // feed cumulative time spent in decode() calls and frame counts; returns
+    // threads to restart decoder with when it cannot keep up, 0 otherwise
+    auto update(double decodeTime, qint64 decoded, qint64 dropped) -> int;
+    // stream ended, store what was learned
+    auto stop() -> void;
+    auto threads() const -> int;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // DECODERTUNER_HPP
@@ -0,0 +1,342 @@
+#include "disccache.hpp"
+#include "mrl.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <dvdread/dvd_reader.h>
+#include <dvdread/ifo_types.h>
+#include <dvdread/ifo_read.h>
+#include <libbluray/bluray.h>
+
+DECLARE_LOG_CONTEXT(Disc)
+
+static constexpr int CacheVersion = 1;
+static constexpr int MaxEntries = 100;
+
+auto DiscInfo::title(int number) const -> const DiscTitle*
+{
+    for (auto &title : titles) {
+        if (title.number == number)
+            return &title;
+    }
+    return nullptr;
+}
+
+static auto toJson(const DiscInfo &info) -> QJsonObject
+{
+    QJsonArray titles;
+    for (auto &title : info.titles) {
+        QJsonArray chapters;
+        for (auto time : title.chapters)
+            chapters.append((double)time);
+        QJsonObject obj;
+        obj[u"number"_q] = title.number;
+        obj[u"playlist"_q] = title.playlist;
+        obj[u"duration"_q] = (double)title.duration;
+        obj[u"angles"_q] = title.angles;
+        obj[u"chapters"_q] = chapters;
+        obj[u"audio"_q] = QJsonArray::fromStringList(title.audio);
+        obj[u"subtitles"_q] = QJsonArray::fromStringList(title.subtitles);
+        titles.append(obj);
+    }
+    QJsonObject json;
+    json[u"main"_q] = info.main;
+    json[u"titles"_q] = titles;
+    return json;
+}
+
+static auto fromJson(const QJsonObject &json) -> DiscInfo
+{
+    auto strings = [] (const QJsonValue &value) {
+        QStringList list;
+        for (auto v : value.toArray())
+            list.push_back(v.toString());
+        return list;
+    };
+    DiscInfo info;
+    info.main = json[u"main"_q].toInt(-1);
+    for (auto v : json[u"titles"_q].toArray()) {
+        const auto obj = v.toObject();
+        DiscTitle title;
+        title.number = obj[u"number"_q].toInt(-1);
+        title.playlist = obj[u"playlist"_q].toInt(-1);
+        title.duration = obj[u"duration"_q].toVariant().toLongLong();
+        title.angles = obj[u"angles"_q].toInt(1);
+        for (auto c : obj[u"chapters"_q].toArray())
+            title.chapters.push_back(c.toVariant().toLongLong());
+        title.audio = strings(obj[u"audio"_q]);
+        title.subtitles = strings(obj[u"subtitles"_q]);
+        info.titles.push_back(title);
+    }
+    return info;
+}
+
+// the longest title is the main feature; among Blu-ray playlists of the same
+// length, the one with most chapters is least likely to be a decoy
+static auto findMain(const DiscInfo &info) -> int
+{
+    const DiscTitle *main = nullptr;
+    for (auto &title : info.titles) {
+        if (!main || title.duration > main->duration
+                || (title.duration == main->duration
+                    && title.chapters.size() > main->chapters.size()))
+            main = &title;
+    }
+    return main && main->duration > 0 ? main->number : -1;
+}
+
+/******************************************************************************/
+
+static auto dvdTime(const dvd_time_t &t) -> qint64
+{
+    auto bcd = [] (uint8_t v) { return (v >> 4) * 10 + (v & 0x0f); };
+    static const int rates[4] = { 0, 2500, 0, 2997 };
+    const int rate = rates[(t.frame_u & 0xc0) >> 6];
+    qint64 msec = ((bcd(t.hour) * 60 + bcd(t.minute)) * 60 + bcd(t.second)) * 1000;
+    if (rate > 0)
+        msec += bcd(t.frame_u & 0x3f) * 100000 / rate;
+    return msec;
+}
+
+static auto dvdLang(uint16_t code) -> QString
+{
+    if (!code || code == 0xffff)
+        return QString();
+    return QString(QChar(code >> 8)) % QChar(code & 0xff);
+}
+
+// sum of cell times before given cell, counting first cell of angle blocks
+static auto dvdCellOffset(const pgc_t *pgc, int cell) -> qint64
+{
+    qint64 time = 0;
+    for (int i = 0; i < cell && i < pgc->nr_of_cells; ++i) {
+        const auto &c = pgc->cell_playback[i];
+        if (c.block_type == BLOCK_TYPE_ANGLE_BLOCK && c.block_mode != BLOCK_MODE_FIRST_CELL)
+            continue;
+        time += dvdTime(c.playback_time);
+    }
+    return time;
+}
+
+static auto scanDvd(const QString &device) -> DiscInfo
+{
+    DiscInfo info;
+    auto dvd = DVDOpen(device.toLocal8Bit().constData());
+    if (!dvd)
+        return info;
+    auto vmg = ifoOpen(dvd, 0);
+    if (!vmg || !vmg->tt_srpt) {
+        if (vmg)
+            ifoClose(vmg);
+        DVDClose(dvd);
+        return info;
+    }
+    QHash<int, ifo_handle_t*> vtss;
+    const auto srpt = vmg->tt_srpt;
+    for (int i = 0; i < srpt->nr_of_srpts; ++i) {
+        const auto &t = srpt->title[i];
+        auto &vts = vtss[t.title_set_nr];
+        if (!vts)
+            vts = ifoOpen(dvd, t.title_set_nr);
+        if (!vts || !vts->vts_ptt_srpt || !vts->vts_pgcit
+                || t.vts_ttn < 1 || t.vts_ttn > vts->vts_ptt_srpt->nr_of_srpts)
+            continue;
+        DiscTitle title;
+        title.number = i;
+        title.angles = qMax<int>(1, t.nr_of_angles);
+        const auto &ttu = vts->vts_ptt_srpt->title[t.vts_ttn - 1];
+        int lastPgcn = -1;
+        qint64 offset = 0;
+        for (int k = 0; k < ttu.nr_of_ptts; ++k) {
+            const auto &ptt = ttu.ptt[k];
+            if (ptt.pgcn < 1 || ptt.pgcn > vts->vts_pgcit->nr_of_pgci_srp)
+                continue;
+            const auto pgc = vts->vts_pgcit->pgci_srp[ptt.pgcn - 1].pgc;
+            if (!pgc || ptt.pgn < 1 || ptt.pgn > pgc->nr_of_programs)
+                continue;
+            if (ptt.pgcn != lastPgcn) {
+                if (lastPgcn > 0)
+                    offset += dvdTime(vts->vts_pgcit->pgci_srp[lastPgcn - 1].pgc->playback_time);
+                lastPgcn = ptt.pgcn;
+            }
+            const int cell = pgc->program_map[ptt.pgn - 1] - 1;
+            title.chapters.push_back(offset + dvdCellOffset(pgc, cell));
+        }
+        if (lastPgcn > 0)
+            title.duration = offset + dvdTime(vts->vts_pgcit->pgci_srp[lastPgcn - 1].pgc->playback_time);
+        if (const auto mat = vts->vtsi_mat) {
+            for (int k = 0; k < mat->nr_of_vts_audio_streams; ++k)
+                title.audio.push_back(dvdLang(mat->vts_audio_attr[k].lang_code));
+            for (int k = 0; k < mat->nr_of_vts_subp_streams; ++k)
+                title.subtitles.push_back(dvdLang(mat->vts_subp_attr[k].lang_code));
+        }
+        info.titles.push_back(title);
+    }
+    for (auto vts : vtss) {
+        if (vts)
+            ifoClose(vts);
+    }
+    ifoClose(vmg);
+    DVDClose(dvd);
+    return info;
+}
+
+static auto scanBluray(const QString &device) -> DiscInfo
+{
+    DiscInfo info;
+    auto bd = bd_open(device.toLocal8Bit().constData(), nullptr);
+    if (!bd)
+        return info;
+    // same enumeration as bd:// of mpv so that title numbers match
+    const int count = bd_get_titles(bd, TITLES_RELEVANT, 0);
+    for (int i = 0; i < count; ++i) {
+        auto ti = bd_get_title_info(bd, i, 0);
+        if (!ti)
+            continue;
+        DiscTitle title;
+        title.number = i;
+        title.playlist = ti->playlist;
+        title.duration = ti->duration / 90;
+        title.angles = qMax<int>(1, ti->angle_count);
+        for (uint32_t k = 0; k < ti->chapter_count; ++k)
+            title.chapters.push_back(ti->chapters[k].start / 90);
+        if (ti->clip_count > 0) {
+            const auto &clip = ti->clips[0];
+            auto lang = [] (const BLURAY_STREAM_INFO &s)
+                { return QString::fromLatin1((const char*)s.lang, 3).remove(QChar(0)); };
+            for (int k = 0; k < clip.audio_stream_count; ++k)
+                title.audio.push_back(lang(clip.audio_streams[k]));
+            for (int k = 0; k < clip.pg_stream_count; ++k)
+                title.subtitles.push_back(lang(clip.pg_streams[k]));
+        }
+        bd_free_title_info(ti);
+        info.titles.push_back(title);
+    }
+    bd_close(bd);
+    return info;
+}
+
+/******************************************************************************/
+
+struct DiscCache::Data {
+    mutable QMutex mutex;
+    QHash<QByteArray, QPair<DiscInfo, qint64>> entries;
+    QSet<QByteArray> running;
+    QThreadPool pool;
+    QString fileName;
+    bool loaded = false;
+
+    auto load() -> void
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        JsonStorage storage(fileName);
+        const auto json = storage.read();
+        if (storage.hasError() || json[u"version"_q].toInt() != CacheVersion)
+            return;
+        const auto discs = json[u"discs"_q].toObject();
+        for (auto it = discs.begin(); it != discs.end(); ++it) {
+            const auto obj = it.value().toObject();
+            const auto info = fromJson(obj);
+            const auto time = obj[u"time"_q].toVariant().toLongLong();
+            if (!info.isEmpty())
+                entries.insert(it.key().toLatin1(), qMakePair(info, time));
+        }
+    }
+    auto save() -> void
+    {
+        while (entries.size() > MaxEntries) {
+            auto oldest = entries.begin();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second < oldest->second)
+                    oldest = it;
+            }
+            entries.erase(oldest);
+        }
+        QJsonObject discs;
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            auto obj = toJson(it->first);
+            obj[u"time"_q] = (double)it->second;
+            discs.insert(QString::fromLatin1(it.key()), obj);
+        }
+        QJsonObject json;
+        json[u"version"_q] = CacheVersion;
+        json[u"discs"_q] = discs;
+        JsonStorage storage(fileName);
+        storage.write(json);
+    }
+};
+
+class DiscScanJob : public QRunnable {
+public:
+    DiscScanJob(DiscCache::Data *d, const Mrl &mrl): d(d), m_mrl(mrl) { }
+private:
+    auto run() -> void final
+    {
+        QElapsedTimer timer;
+        timer.start();
+        auto info = DiscCache::scan(m_mrl);
+        const auto now = QDateTime::currentMSecsSinceEpoch() / 1000;
+        QMutexLocker locker(&d->mutex);
+        d->running.remove(m_mrl.hash());
+        if (info.isEmpty()) {
+            _Warn("Cannot analyze disc: %%", m_mrl.device());
+            return;
+        }
+        _Info("Analyzed %% title(s) in %%ms, main title is %%",
+              info.titles.size(), timer.elapsed(), info.main);
+        d->entries[m_mrl.hash()] = qMakePair(info, now);
+        d->save();
+    }
+    DiscCache::Data *d = nullptr;
+    Mrl m_mrl;
+};
+
+DiscCache::DiscCache()
+    : d(new Data)
+{
+    d->fileName = _WritablePath(Location::Cache) % "/disc-titles.json"_a;
+    d->pool.setMaxThreadCount(1);
+}
+
+DiscCache::~DiscCache()
+{
+    d->pool.clear();
+    d->pool.waitForDone();
+    delete d;
+}
+
+auto DiscCache::find(const QByteArray &hash) const -> DiscInfo
+{
+    if (hash.isEmpty())
+        return DiscInfo();
+    QMutexLocker locker(&d->mutex);
+    d->load();
+    auto it = d->entries.find(hash);
+    if (it == d->entries.end())
+        return DiscInfo();
+    it->second = QDateTime::currentMSecsSinceEpoch() / 1000;
+    return it->first;
+}
+
+auto DiscCache::analyze(const Mrl &mrl) -> void
+{
+    const auto hash = mrl.hash();
+    if (hash.isEmpty() || mrl.device().isEmpty())
+        return;
+    QMutexLocker locker(&d->mutex);
+    d->load();
+    if (d->entries.contains(hash) || d->running.contains(hash))
+        return;
+    d->running.insert(hash);
+    d->pool.start(new DiscScanJob(d, mrl));
+}
+
+auto DiscCache::scan(const Mrl &mrl) -> DiscInfo
+{
+    auto info = mrl.isDvd() ? scanDvd(mrl.device()) : scanBluray(mrl.device());
+    info.main = findMain(info);
+    return info;
+}
@@ -0,0 +1,40 @@
+#ifndef DISCCACHE_HPP
+#define DISCCACHE_HPP
+
+class Mrl;
+
+struct DiscTitle {
+    int number = -1;      // as disc-title of mpv
+    int playlist = -1;    // mpls number for Blu-ray
+    qint64 duration = 0;  // msec
+    int angles = 1;
+    QVector<qint64> chapters;
+    QStringList audio, subtitles; // language codes
+};
+
+struct DiscInfo {
+    QVector<DiscTitle> titles;
+    int main = -1;
+    auto isEmpty() const -> bool { return titles.isEmpty(); }
+    auto title(int number) const -> const DiscTitle*;
+};
+
+// remembers titles of discs by hash of their structure so that reopened
+// disc does not need to be scanned again; filled by one background pass
+class DiscCache {
+public:
+    DiscCache();
+    ~DiscCache();
+    // thread-safe; empty if not analyzed yet
+    auto find(const QByteArray &hash) const -> DiscInfo;
+    // thread-safe; scan in background unless cached or running
+    auto analyze(const Mrl &mrl) -> void;
+    // read all titles with libdvdread or libbluray; runs in caller's thread
+    static auto scan(const Mrl &mrl) -> DiscInfo;
+private:
+    friend class DiscScanJob;
+    struct Data;
+    Data *d;
+};
+
+#endif // DISCCACHE_HPP
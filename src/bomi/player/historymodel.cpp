@@ -1,6 +1,7 @@
 #include "historymodel.hpp"
 #include "mrlstatesqlfield.hpp"
 #include "misc/log.hpp"
+#include "misc/memorygovernor.hpp"
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QQuickItem>
@@ -42,6 +43,7 @@ private:
 struct RowCache { Mrl mrl; int row = -1; };
 
 static constexpr auto currentVersion = MrlState::Version;
+static constexpr qint64 RowBytes = 256; // rough size of a row cached by loader
 
 struct HistoryModel::Data {
     HistoryModel *p = nullptr;
@@ -57,6 +59,7 @@ struct HistoryModel::Data {
     bool mediaTitleLocal = false, mediaTitleUrl = false;
     int idx_mrl, idx_name, idx_last, idx_device, idx_star, rows = 0;
     QMutex mutex;
+    MemoryConsumer memory{u"history"_q, MemoryPriority::History};
     auto check(const QSqlQuery &query) -> bool
     {
         if (!query.lastError().isValid())
@@ -107,6 +110,7 @@ struct HistoryModel::Data {
         p->endResetModel();
         reload = false;
         rowCache = RowCache();
+        memory.setUsage(rows * RowBytes);
         return true;
     }
     auto import(const QVector<MrlState*> &states) -> void
@@ -135,6 +139,18 @@ struct HistoryModel::Data {
 HistoryModel::HistoryModel(QObject *parent)
 : QAbstractTableModel(parent), d(new Data) {
     d->p = this;
+    d->memory.setReclaim([=] (qint64) -> qint64 {
+        // rows fetched by loader are kept until query is finished
+        QMutexLocker locker(&d->mutex);
+        if (d->visible || d->reload)
+            return 0;
+        const auto usage = d->memory.usage();
+        d->loader.finish();
+        d->rowCache = RowCache();
+        d->reload = true;
+        d->memory.setUsage(0);
+        return usage;
+    });
     auto &metaObject = MrlState::staticMetaObject;
     const int count = metaObject.propertyCount();
     const int offset = metaObject.propertyOffset();
@@ -1,4 +1,5 @@
 #include "jrplayer.hpp"
+#include "sessiontrace.hpp"
 #include "quick/appobject.hpp"
 #include "json/jrcommon.hpp"
 #include "misc/jsonstorage.hpp"
@@ -83,6 +84,9 @@ JrPlayer::~JrPlayer()
 auto JrPlayer::request(const JrRequest &request) -> JrResponse
 {
     Q_ASSERT(request.isValid());
+    AllocScope scope("json-rpc");
+    SessionTrace::instance().record(TraceEvent::Call, request.method(), request.params());
+    SessionTrace::CallScope calling;
     QObject *object = &d->app;
     int pos = 0;
     const auto jrMethod = request.method();
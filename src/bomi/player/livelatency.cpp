@@ -0,0 +1,375 @@
+#include "livelatency.hpp"
+#include "misc/log.hpp"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#endif
+
+DECLARE_LOG_CONTEXT(Live)
+
+// backlog tolerated before dropping; bursts shorter than DropAfter are kept
+static constexpr double MinBacklog = 0.1;          // sec
+static constexpr int BacklogFrames = 4;
+static constexpr qint64 DropAfter = 1000000;       // usec
+static constexpr qint64 DropInterval = 2000000;    // usec
+
+// test frame: 64 bars of 8px, 16 bits of sync word and 48 bits of stamp
+static constexpr int Width = 512, Height = 32, Bits = 64, BarWidth = Width / Bits;
+static constexpr quint64 Sync = 0xb3a5;
+static constexpr quint64 StampMask = (quint64(1) << 48) - 1;
+static constexpr uchar Black = 16, White = 235;
+
+SIA paintStamp(uchar *luma, quint64 stamp) -> void
+{
+    const quint64 word = (Sync << 48) | (stamp & StampMask);
+    for (int i = 0; i < Bits; ++i) {
+        const uchar y = (word >> (Bits - 1 - i)) & 1 ? White : Black;
+        memset(luma + i * BarWidth, y, BarWidth);
+    }
+    for (int r = 1; r < Height; ++r)
+        memcpy(luma + r * Width, luma, Width);
+}
+
+// frame may be scaled, so bars are sampled at their centers
+SIA decodeStamp(const uchar *rgba, int width, quint64 *stamp) -> bool
+{
+    if (width < Bits)
+        return false;
+    quint64 word = 0;
+    for (int i = 0; i < Bits; ++i) {
+        const int x = (i * BarWidth + BarWidth / 2) * width / Width;
+        const uchar *px = rgba + x * 4;
+        word = (word << 1) | (px[0] + px[1] + px[2] > 3 * 128);
+    }
+    if ((word >> 48) != Sync)
+        return false;
+    *stamp = word & StampMask;
+    return true;
+}
+
+auto LiveLatencyStats::toString() const -> QString
+{
+    QString text;
+    text.sprintf("%d frames, latency min %.1fms, avg %.1fms, p95 %.1fms, "
+                 "max %.1fms, %d backlog drop(s)", frames, min, avg, p95, max, drops);
+    return text;
+}
+
+/******************************************************************************/
+
+struct LiveLatency::Data {
+    std::atomic<bool> enabled{false}, active{false}, probing{false};
+    // start() in mpv thread asks check() to forget backlog of previous source
+    std::atomic<bool> restarted{false};
+    std::atomic<int> drops{0};
+
+    // check() only
+    qint64 overSince = -1, lastDrop = -DropInterval;
+
+    // render thread
+    quint64 lastStamp = 0;
+    qint64 pending = -1;
+    qint64 reported = 0;
+    int reportedFrames = 0;
+
+    mutable QMutex mutex;
+    QVector<double> samples; // msec
+};
+
+LiveLatency::LiveLatency()
+    : d(new Data)
+{
+}
+
+LiveLatency::~LiveLatency()
+{
+    delete d;
+}
+
+auto LiveLatency::now() -> qint64
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+auto LiveLatency::setEnabled(bool enabled) -> void
+{
+    d->enabled = enabled;
+}
+
+auto LiveLatency::isEnabled() const -> bool
+{
+    return d->enabled;
+}
+
+auto LiveLatency::isLive(const QString &url) -> bool
+{
+    if (url == "-"_a || url.startsWith("fd://"_a) || url.startsWith("pipe:"_a))
+        return true;
+    // av:// opens libavdevice inputs such as v4l2 or x11grab
+    static const QStringList schemes = {
+        u"v4l2"_q, u"tv"_q, u"pvr"_q, u"dvb"_q, u"udp"_q, u"rtp"_q, u"rtsp"_q, u"av"_q
+    };
+    const int colon = url.indexOf("://"_a);
+    if (colon > 0 && !url.startsWith("file://"_a, Qt::CaseInsensitive))
+        return schemes.contains(url.left(colon).toLower());
+#ifdef Q_OS_WIN
+    return false;
+#else
+    const auto path = colon > 0 ? QUrl(url).toLocalFile() : url;
+    struct stat st;
+    return !::stat(QFile::encodeName(path).constData(), &st) && S_ISFIFO(st.st_mode);
+#endif
+}
+
+auto LiveLatency::start(const QString &url) -> bool
+{
+    const bool active = (d->enabled || d->probing) && isLive(url);
+    d->active = active;
+    d->restarted = true;
+    if (active)
+        _Info("Use low latency profile for '%%'.", url);
+    return active;
+}
+
+auto LiveLatency::isActive() const -> bool
+{
+    return d->active;
+}
+
+auto LiveLatency::options() -> QVector<QPair<QByteArray, QByteArray>>
+{
+    return {
+        { "cache"_b, "no"_b },
+        // nothing to wait for; late data is dropped later instead
+        { "cache-pause"_b, "no"_b },
+        { "initial-audio-sync"_b, "no"_b },
+        { "framedrop"_b, "vo"_b },
+        { "demuxer-lavf-probesize"_b, "32768"_b },
+        { "demuxer-lavf-analyzeduration"_b, "0.1"_b },
+        { "demuxer-lavf-o"_b, "fflags=+nobuffer"_b },
+        // drain the source as soon as data arrives so that whatever waits
+        // for playback shows up as demuxer backlog and can be dropped
+        { "demuxer-readahead-secs"_b, "5"_b },
+        // frame threads delay output by one frame each
+        { "vd-lavc-threads"_b, "1"_b },
+        { "vd-lavc-o"_b, "flags=+low_delay"_b },
+        // takes effect when audio output opens for this file
+        { "audio-buffer"_b, "0.05"_b }
+    };
+}
+
+auto LiveLatency::check(double backlog, double fps) -> bool
+{
+    if (d->restarted.exchange(false))
+        d->overSince = -1;
+    if (!d->active)
+        return false;
+    const double frame = fps > 1.0 ? 1.0 / fps : 0.04;
+    if (backlog <= qMax(MinBacklog, BacklogFrames * frame)) {
+        d->overSince = -1;
+        return false;
+    }
+    const auto t = now();
+    if (d->overSince < 0)
+        d->overSince = t;
+    if (t - d->overSince < DropAfter || t - d->lastDrop < DropInterval)
+        return false;
+    d->overSince = -1;
+    d->lastDrop = t;
+    ++d->drops;
+    _Debug("Drop %%ms of backlog", backlog * 1e3);
+    return true;
+}
+
+auto LiveLatency::setProbing(bool on) -> void
+{
+    d->probing = on;
+}
+
+auto LiveLatency::isProbing() const -> bool
+{
+    return d->probing;
+}
+
+auto LiveLatency::probe(const uchar *rgba, int width) -> void
+{
+    quint64 stamp = 0;
+    // redraws of same frame are not new samples
+    if (decodeStamp(rgba, width, &stamp) && _Change(d->lastStamp, stamp))
+        d->pending = stamp;
+}
+
+auto LiveLatency::swapped() -> void
+{
+    if (d->pending < 0)
+        return;
+    const auto t = now();
+    qint64 usec = (t & StampMask) - d->pending;
+    if (usec < 0)
+        usec += StampMask + 1;
+    d->pending = -1;
+    QMutexLocker locker(&d->mutex);
+    d->samples.push_back(usec * 1e-3);
+    if (t - d->reported < 1000000)
+        return;
+    const int frames = d->samples.size() - d->reportedFrames;
+    if (frames > 0) {
+        double sum = 0.0;
+        for (int i = d->reportedFrames; i < d->samples.size(); ++i)
+            sum += d->samples[i];
+        _Info("Latency %%ms over %% frame(s)", sum / frames, frames);
+    }
+    d->reported = t;
+    d->reportedFrames = d->samples.size();
+}
+
+auto LiveLatency::stats() const -> LiveLatencyStats
+{
+    LiveLatencyStats stats;
+    stats.drops = d->drops;
+    QMutexLocker locker(&d->mutex);
+    auto samples = d->samples;
+    locker.unlock();
+    if (samples.isEmpty())
+        return stats;
+    std::sort(samples.begin(), samples.end());
+    stats.frames = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.p95 = samples[qMin(samples.size() - 1, samples.size() * 95 / 100)];
+    stats.avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    return stats;
+}
+
+/******************************************************************************/
+
+struct LatencyGenerator::Data {
+    QString path;
+    std::thread thread;
+    std::atomic<bool> quit{false};
+    int fps = 60;
+
+    auto run() -> void;
+};
+
+#ifndef Q_OS_WIN
+
+auto LatencyGenerator::Data::run() -> void
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    const auto header = QByteArray("YUV4MPEG2 W") + QByteArray::number(Width)
+            + " H" + QByteArray::number(Height) + " F" + QByteArray::number(fps)
+            + ":1 Ip A1:1 C420\n";
+    const int lumaSize = Width * Height, chromaSize = lumaSize / 4;
+    QByteArray frame("FRAME\n");
+    const int luma = frame.size();
+    frame.append(QByteArray(lumaSize, Black));
+    frame.append(QByteArray(chromaSize * 2, char(128)));
+
+    auto writeAll = [&] (int fd, const QByteArray &data) -> bool {
+        int written = 0;
+        while (written < data.size() && !quit) {
+            const auto n = ::write(fd, data.constData() + written, data.size() - written);
+            if (n >= 0) {
+                written += n;
+                continue;
+            }
+            if (errno != EAGAIN && errno != EINTR)
+                return false;
+            pollfd p = { fd, POLLOUT, 0 };
+            ::poll(&p, 1, 100);
+        }
+        return written == data.size();
+    };
+
+    using namespace std::chrono;
+    const auto interval = microseconds(1000000 / fps);
+    const auto fifo = QFile::encodeName(path);
+    while (!quit) {
+        // fails until a reader opens it
+        const int fd = ::open(fifo.constData(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            std::this_thread::sleep_for(milliseconds(50));
+            continue;
+        }
+        _Debug("Reader opened test pattern.");
+        bool ok = writeAll(fd, header);
+        auto next = steady_clock::now();
+        while (ok && !quit) {
+            paintStamp((uchar*)frame.data() + luma, LiveLatency::now());
+            ok = writeAll(fd, frame);
+            next += interval;
+            std::this_thread::sleep_until(next);
+            // reader stalled: keep rate instead of catching up in bursts
+            if (steady_clock::now() > next + interval)
+                next = steady_clock::now();
+        }
+        ::close(fd);
+    }
+}
+
+#endif
+
+LatencyGenerator::LatencyGenerator()
+    : d(new Data)
+{
+}
+
+LatencyGenerator::~LatencyGenerator()
+{
+    stop();
+    delete d;
+}
+
+auto LatencyGenerator::start(int fps) -> bool
+{
+    stop();
+#ifdef Q_OS_WIN
+    Q_UNUSED(fps);
+    _Error("Latency test pattern needs FIFO which is not available on this platform.");
+    return false;
+#else
+    const QString name = "bomi-latency-"_a
+            % _N((quint64)QCoreApplication::applicationPid()) % ".y4m"_a;
+    d->path = QDir::temp().filePath(name);
+    QFile::remove(d->path);
+    if (::mkfifo(QFile::encodeName(d->path).constData(), 0600) < 0) {
+        _Error("Cannot create FIFO '%%': %%", d->path, QString::fromLocal8Bit(strerror(errno)));
+        d->path.clear();
+        return false;
+    }
+    d->fps = qBound(1, fps, 240);
+    d->quit = false;
+    d->thread = std::thread([=] () { d->run(); });
+    _Info("Write test pattern into '%%' at %%fps.", d->path, d->fps);
+    return true;
+#endif
+}
+
+auto LatencyGenerator::stop() -> void
+{
+    d->quit = true;
+    if (d->thread.joinable())
+        d->thread.join();
+    if (!d->path.isEmpty()) {
+        QFile::remove(d->path);
+        d->path.clear();
+    }
+}
+
+auto LatencyGenerator::path() const -> QString
+{
+    return d->path;
+}
@@ -0,0 +1,57 @@
+#ifndef LIVELATENCY_HPP
+#define LIVELATENCY_HPP
+
+struct LiveLatencyStats {
+    int frames = 0, drops = 0;  // measured test frames, backlog drops
+    double min = 0.0, avg = 0.0, max = 0.0, p95 = 0.0; // msec
+    auto toString() const -> QString;
+};
+
+// low latency profile for live sources: every buffering stage is kept
+// minimal while opening and backlog from clock drift is dropped instead of
+// played late; measures latency of timestamped test frames while probing
+class LiveLatency {
+public:
+    LiveLatency();
+    ~LiveLatency();
+    auto setEnabled(bool enabled) -> void;
+    auto isEnabled() const -> bool;
+    // capture devices, broadcast, network streams without end and pipes
+    static auto isLive(const QString &url) -> bool;
+    // returns true if profile applies to url; inactive until next start()
+    // otherwise
+    auto start(const QString &url) -> bool;
+    auto isActive() const -> bool;
+    // file-local mpv options of profile
+    static auto options() -> QVector<QPair<QByteArray, QByteArray>>;
+    // called periodically with seconds demuxed ahead of playback;
+    // returns true if queued data should be dropped
+    auto check(double backlog, double fps) -> bool;
+    auto setProbing(bool on) -> void;
+    auto isProbing() const -> bool;
+    // render thread: row of rendered frame in RGBA and its swap
+    auto probe(const uchar *rgba, int width) -> void;
+    auto swapped() -> void;
+    auto stats() const -> LiveLatencyStats;
+    // monotonic clock in usec which test frames are stamped with
+    static auto now() -> qint64;
+private:
+    struct Data;
+    Data *d;
+};
+
+// writes test frames stamped with LiveLatency::now() into a FIFO
+// as YUV4MPEG2, reopening it whenever the reader goes away
+class LatencyGenerator {
+public:
+    LatencyGenerator();
+    ~LatencyGenerator();
+    auto start(int fps = 60) -> bool;
+    auto stop() -> void;
+    auto path() const -> QString;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // LIVELATENCY_HPP
@@ -2,11 +2,15 @@
 #include "dialog/mbox.hpp"
 #include "json/jrserver.hpp"
 #include "player/jrplayer.hpp"
+#include "misc/allocprofiler.hpp"
 #include <QCryptographicHash>
 #include <QElapsedTimer>
 #ifdef Q_OS_LINUX
 #include <signal.h>
 #endif
+extern "C" {
+#include <libavformat/avformat.h>
+}
 
 extern "C" void _exit(int);
 
@@ -44,6 +48,8 @@ int main(int argc, char **argv) {
     QApplication::setApplicationVersion(_L(cApp.version()));
 
     registerType();
+    // not thread-safe; do it before any worker opens files with libavformat
+    av_register_all();
 
     QScopedPointer<App> app(new App(argc, argv));
 
@@ -58,8 +64,9 @@ int main(int argc, char **argv) {
     for (auto fmt : QImageWriter::supportedImageFormats())
         writableImageExts.push_back(QString::fromLatin1(fmt));
 
-    if (app->executeToQuit())
-        return 0;
+    int exitCode = 0;
+    if (app->executeToQuit(exitCode))
+        return exitCode;
 
     const auto error = OGL::check();
     if (!error.isEmpty()) {
@@ -83,6 +90,7 @@ int main(int argc, char **argv) {
     _Debug("Start main event loop.");
 
     auto ret = app->exec();
+    AllocProfiler::finish();
     app->sendPostedEvents(nullptr, QEvent::DeferredDelete);
     app.reset();
     _Debug("Exit...");
@@ -3,7 +3,9 @@
 #include "misc/trayicon.hpp"
 #include "dialog/mbox.hpp"
 #include "dialog/encoderdialog.hpp"
+#include "pref/prefdialog.hpp"
 #include "quick/appobject.hpp"
+#include "quick/propertybatch.hpp"
 #include <QSessionManager>
 
 //DECLARE_LOG_CONTEXT(Main)
@@ -40,6 +42,7 @@ MainWindow::MainWindow()
     AppObject::setDownloader(&d->downloader);
     AppObject::setTheme(&d->theme);
     AppObject::setWindow(this);
+    PropertyBatch::instance()->setWindow(this);
 
     d->playlist.setDownloader(&d->downloader);
     d->e.setHistory(&d->history);
@@ -96,6 +99,7 @@ MainWindow::~MainWindow() {
     if (d->jrServer)
         d->jrServer->setInterface(nullptr);
     delete d->jrServer;
+    delete d->mediaServer;
     exit();
     setPersistentOpenGLContext(false);
     setPersistentSceneGraph(false);
@@ -114,6 +118,7 @@ auto MainWindow::postInitialize() -> void
     d->applyPref();
     cApp.runCommands();
     d->noMessage = false;
+    PrefDialog::prefetch();
 }
 
 auto MainWindow::adapter() const -> OS::WindowAdapter*
@@ -5,6 +5,8 @@
 #include "misc/actiongroup.hpp"
 #include "subtitle/subtitleviewer.hpp"
 #include "subtitle/subtitlemodel.hpp"
+#include "video/contactsheet.hpp"
+#include "quick/appobject.hpp"
 #include "dialog/fileassocdialog.hpp"
 #include "dialog/mbox.hpp"
 #include "dialog/audioequalizerdialog.hpp"
@@ -22,6 +24,7 @@
 #include "audio/visualizer.hpp"
 #include "misc/filenamegenerator.hpp"
 #include <QThreadPool>
+#include <QInputDialog>
 #include <QClipboard>
 
 template<class T, class Func>
@@ -663,6 +666,22 @@ auto MainWindow::Data::plugMenu() -> void
     connect(atrack[u"auto-load"_q], &QAction::triggered, &e, &PlayEngine::autoloadAudioFiles);
     connect(atrack[u"reload"_q], &QAction::triggered, &e, &PlayEngine::reloadAudioFiles);
     connect(atrack[u"clear"_q], &QAction::triggered, &e, &PlayEngine::clearAudioFiles);
+    connect(atrack[u"mix"_q], &QAction::triggered, p, [=] () {
+        // cycle through tracks other than selected one and then off
+        const auto tracks = e.params()->audio_tracks();
+        QList<int> ids;
+        for (auto &track : tracks) {
+            if (!track.isSelected())
+                ids.push_back(track.id());
+        }
+        const int idx = ids.indexOf(e.audioMixTrack()) + 1;
+        e.setAudioMixTrack(idx < ids.size() ? ids[idx] : -1);
+        const auto title = menu(u"audio"_q)(u"track"_q)[u"mix"_q]->text();
+        if (auto track = tracks.track(e.audioMixTrack()))
+            showMessage(title, track->name());
+        else
+            showMessage(title, false);
+    });
 
     Menu &sub = menu(u"subtitle"_q);
     auto &strack = sub(u"track"_q);
@@ -789,6 +808,31 @@ auto MainWindow::Data::plugMenu() -> void
         if (playlist.swap(idx, idx+1))
             playlist.select(idx+1);
     });
+    connect(pl[u"sort-name"_q], &QAction::triggered, p,
+            [=] () { playlist.sort(PlaylistModel::NameRole); });
+    connect(pl[u"sort-duration"_q], &QAction::triggered, p,
+            [=] () { playlist.sort(PlaylistModel::DurationRole); });
+    connect(pl[u"sort-resolution"_q], &QAction::triggered, p,
+            [=] () { playlist.sort(PlaylistModel::ResolutionRole, true); });
+    connect(pl[u"filter-duration"_q], &QAction::triggered, p, [=] () {
+        bool ok = false;
+        const int min = QInputDialog::getInt(nullptr, tr("Remove Shorter Than"),
+                                             tr("Minimum duration in minutes"),
+                                             10, 1, 24 * 60, 1, &ok);
+        if (ok)
+            showMessage(tr("Removed Entries"),
+                        _N(playlist.filter(PlaylistModel::DurationRole, min * 60000LL)));
+    });
+    connect(pl[u"filter-resolution"_q], &QAction::triggered, p, [=] () {
+        const QStringList heights = { u"480p"_q, u"720p"_q, u"1080p"_q, u"2160p"_q };
+        bool ok = false;
+        const auto item = QInputDialog::getItem(nullptr, tr("Remove Lower Resolution Than"),
+                                                tr("Minimum resolution"),
+                                                heights, 1, false, &ok);
+        if (ok)
+            showMessage(tr("Removed Entries"), _N(playlist.filter(
+                PlaylistModel::ResolutionRole, item.left(item.size() - 1).toInt())));
+    });
     auto action = pl[u"shuffle"_q];
     connect(action, &QAction::triggered, p, [=] (bool new_) {
         const bool old = playlist.isShuffled();
@@ -872,6 +916,42 @@ auto MainWindow::Data::plugMenu() -> void
         subFindDlg->find(e.mrl());
         subFindDlg->show();
     });
+    connect(tool[u"contact-sheet"_q], &QAction::triggered, p, [this] () {
+        if (sheets && sheets->isRunning()) {
+            if (MBox::ask(nullptr, tr("Export Contact Sheets"),
+                          tr("Do you want to cancel exporting contact sheets?"),
+                          {BBox::Yes, BBox::No}, BBox::No) == BBox::Yes)
+                sheets->cancel();
+            return;
+        }
+        const auto dir = _GetOpenDir(nullptr, tr("Export Contact Sheets"));
+        if (dir.isEmpty())
+            return;
+        QStringList files;
+        for (auto &info : QDir(dir).entryInfoList(_ToNameFilter(VideoExt), QDir::Files, QDir::Name))
+            files.push_back(info.absoluteFilePath());
+        if (files.isEmpty()) {
+            showMessage(tr("Export Contact Sheets"), tr("No video files"));
+            return;
+        }
+        if (!sheets) {
+            sheets.reset(new ContactSheetEngine);
+            connect(sheets.data(), &ContactSheetEngine::progressed, p, [=] (int done, int total) {
+                showMessage(tr("Export Contact Sheets"), u"%1/%2"_q.arg(done).arg(total));
+            });
+            connect(sheets.data(), &ContactSheetEngine::finished, p, [=] () {
+                const auto result = sheets->result();
+                showMessage(tr("Export Contact Sheets"), tr("%1/%2 in %3 files/min")
+                            .arg(result.made).arg(result.total)
+                            .arg(result.filesPerMinute(), 0, 'f', 1));
+            });
+        }
+        auto option = sheets->option();
+        option.format = pref.quick_snapshot_format();
+        option.quality = pref.quick_snapshot_quality();
+        sheets->setOption(option);
+        sheets->start(files, dir);
+    });
     connect(tool[u"reload-skin"_q], &QAction::triggered,
             p, [=] () { reloadSkin(); });
     connect(tool[u"auto-exit"_q], &QAction::triggered, p, [this] (bool on) {
@@ -896,6 +976,15 @@ auto MainWindow::Data::plugMenu() -> void
         } else
             showMessage(tr("Auto-shutdown is canceled."));
     });
+    connect(tool[u"low-power"_q], &QAction::triggered, p, [this] (bool on) {
+        power.setRequested(on);
+        showMessage(tr("Low Power Mode"), on);
+    });
+    connect(&power, &PowerProfile::lowPowerChanged, p, [this] (bool on) {
+        // optional work is cut down together, see PlayEngine::setLowPower()
+        e.setLowPower(on);
+        AppObject::setPollingInterval(on ? 2000 : 500);
+    });
     connect(&playlist, &PlaylistModel::finished, p, [=, &tool] () {
         if (tool[u"auto-exit"_q]->isChecked())     p->exit();
         if (tool[u"auto-shutdown"_q]->isChecked()) OS::shutdown();
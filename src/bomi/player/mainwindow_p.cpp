@@ -17,8 +17,11 @@
 #include "dialog/subtitlefinddialog.hpp"
 #include "dialog/encoderdialog.hpp"
 #include "avinfoobject.hpp"
+#include "sessiontrace.hpp"
+#include "mediaprobe.hpp"
 #include "misc/smbauth.hpp"
 #include "misc/filenamegenerator.hpp"
+#include "misc/memorygovernor.hpp"
 #include <QSessionManager>
 #include <QScreen>
 
@@ -116,6 +119,8 @@ auto MainWindow::Data::plugEngine() -> void
         }
         if (state != PlayEngine::Paused)
             pausedByHiding = false;
+        power.setPlaying(state == PlayEngine::Playing);
+        playlist.probe()->setYielding(state == PlayEngine::Playing);
 #ifdef Q_OS_WIN
         auto prog = taskbar.progress();
         switch (state) {
@@ -193,7 +198,7 @@ auto MainWindow::Data::plugEngine() -> void
     connect(&e, &PlayEngine::finished, p, [=] (const Mrl &/*mrl*/, bool eof) {
         if (!eof) return;
         const auto next = playlist.checkNextMrl();
-        if (!next.isEmpty()) load(next, true, !pref.resume_ignore_in_playlist());
+        if (!next.isEmpty()) e.load(next, !pref.resume_ignore_in_playlist());
     });
 
     connect(e.media(), &MediaObject::nameChanged, p, [=] () { updateTitle(); });
@@ -622,6 +627,28 @@ auto MainWindow::Data::applyPref() -> void
     } else
         _Delete(jrServer);
 
+    // applying other preferences keeps clients connected
+    const auto mediaServerTo = qMakePair(p.media_server_address(), p.media_server_port());
+    if (!p.media_server_use())
+        _Delete(mediaServer);
+    else if (!mediaServer || mediaServerAt != mediaServerTo) {
+        mediaServerAt = mediaServerTo;
+        _Renew(mediaServer);
+        auto updatePlaylist = [=] ()
+            { mediaServer->setPlaylist(playlist.list(), playlist.loaded()); };
+        updatePlaylist();
+        connect(&playlist, &QAbstractItemModel::modelReset, mediaServer, updatePlaylist);
+        connect(&playlist, &QAbstractItemModel::rowsInserted, mediaServer, updatePlaylist);
+        connect(&playlist, &QAbstractItemModel::rowsRemoved, mediaServer, updatePlaylist);
+        connect(&playlist, &QAbstractItemModel::rowsMoved, mediaServer, updatePlaylist);
+        connect(&playlist, &PlaylistModel::loadedChanged, mediaServer, updatePlaylist);
+        connect(&e, &PlayEngine::timeChanged, mediaServer,
+                [=] () { mediaServer->setPosition(e.time()); });
+        if (!mediaServer->listen(mediaServerAt.first, mediaServerAt.second))
+            MBox::error(nullptr, tr("Media Server Error"),
+                        mediaServer->errorString(), {BBox::Ok});
+    }
+
     MouseBehavior context = MouseBehavior::NoBehavior;
     contextMenuModifier = KeyModifier::None;
     const auto map = p.mouse_action_map();
@@ -698,6 +725,7 @@ auto MainWindow::Data::applyPref() -> void
         cache.network.file = p.cache_network_file();
         cache.disc.file = p.cache_disc_file();
         cache.file_kb = p.cache_file_size_mb() * 1024.0;
+        cache.timeshift = p.cache_timeshift();
         cache.min_playback_kb = p.cache_min_playback_kb();
         cache.min_seeking_kb = p.cache_min_seeking_kb();
         cache.remotes = p.network_folders();
@@ -719,17 +747,25 @@ auto MainWindow::Data::applyPref() -> void
         return smb;
     };
 
+    MemoryGovernor::instance().setBudget(p.memory_budget_mb() * 1024LL * 1024LL);
+    power.setAutomatic(p.power_save_on_battery());
+
     e.lock();
     e.preview()->setActive(controls.showPreviewOnMouseOverSeekBar);
 
     e.setResume_locked(p.remember_stopped());
     e.setPreciseSeeking_locked(p.precise_seeking());
+    e.setFramePacing_locked(p.frame_pacing());
+    e.setAutoDecoderThreads_locked(p.auto_decoder_threads());
+    e.setAdaptiveProbe_locked(p.adaptive_probe());
+    e.setLowLatencyLive_locked(p.live_low_latency());
     e.setCache_locked(cache());
     e.setSmbAuth_locked(smb());
     e.setPriority_locked(p.audio_priority(), p.sub_priority());
     e.setAutoloader_locked(p.audio_autoload(), p.sub_autoload_v2());
 
     e.setHwAcc_locked(p.enable_hwaccel(), p.hwaccel_codecs());
+    e.setLowPowerHwAcc_locked(p.power_save_hwdec());
     e.setDeintOptions_locked(p.deinterlacing());
     e.setMotionIntrplOption_locked(p.motion_interpolation());
 
@@ -770,9 +806,10 @@ auto MainWindow::Data::videoSize(const WindowSize &hint) -> QSize
 auto MainWindow::Data::load(const Mrl &mrl, bool play, bool tryResume,
                             const QString &sub) -> void
 {
-    if (play)
+    if (play) {
+        SessionTrace::instance().record(TraceEvent::Open, mrl.toString());
         e.load(mrl, tryResume, sub);
-    else
+    } else
         e.setMrl(mrl);
 }
 
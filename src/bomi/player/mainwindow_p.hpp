@@ -27,6 +27,8 @@
 #include "misc/dataevent.hpp"
 #include "json/jrserver.hpp"
 #include "player/jrplayer.hpp"
+#include "player/powerprofile.hpp"
+#include "player/mediaserver.hpp"
 #include <QUndoCommand>
 #include <QMimeData>
 #include <QQmlProperty>
@@ -65,6 +67,7 @@ class PrefDialog;                       class SubtitleViewer;
 class TrayIcon;                         class AudioEqualizerDialog;
 class IntrplDialog;                     class VideoColorDialog;
 class EncoderDialog;                    class FileNameGenerator;
+class ContactSheetEngine;
 
 struct MainWindow::Data {
     Data(MainWindow *p): p(p) { }
@@ -106,12 +109,14 @@ struct MainWindow::Data {
     } ph;
     QTimer waiter, hider, dialogWorkaround;
     ABRepeatChecker ab;
+    PowerProfile power;
     QMenu contextMenu;
     QSharedPointer<PrefDialog> prefDlg;
     QSharedPointer<SubtitleFindDialog> subFindDlg;
     QSharedPointer<LogViewer> logViewer;
     QSharedPointer<SnapshotDialog> snapshot;
     QSharedPointer<SubtitleViewer> sview;
+    QSharedPointer<ContactSheetEngine> sheets;
     QSharedPointer<AudioEqualizerDialog> eq;
     QSharedPointer<VideoColorDialog> color;
     QSharedPointer<IntrplDialog> intrpl, chroma, intrplDown;
@@ -131,6 +136,8 @@ struct MainWindow::Data {
     OS::WindowAdapter *adapter = nullptr;
     JrServer *jrServer = nullptr;
     JrPlayer jrPlayer;
+    MediaServer *mediaServer = nullptr;
+    QPair<QString, int> mediaServerAt; // address and port of mediaServer
     Qt::WindowState prevWindowState = Qt::WindowNoState;
     int wheelAngles = 0;
 
@@ -2,6 +2,7 @@
 #define MEDIAMISC_HPP
 
 #include "mrl.hpp"
+#include "quick/propertybatch.hpp"
 
 class PlayEngine;
 
@@ -110,21 +111,39 @@ class CacheInfoObject : public QObject {
     Q_PROPERTY(int size READ size NOTIFY sizeChanged)
     Q_PROPERTY(int used READ used NOTIFY usedChanged)
     Q_PROPERTY(int time READ time NOTIFY timeChanged)
+    Q_PROPERTY(int timeshiftBegin READ timeshiftBegin NOTIFY timeshiftChanged)
+    Q_PROPERTY(int timeshiftEnd READ timeshiftEnd NOTIFY timeshiftChanged)
 public:
     auto size() const -> int { return m_size; }
     auto used() const -> int { return m_used; }
     auto time() const -> int { return m_time; }
+    auto timeshiftBegin() const -> int { return m_shiftBegin; }
+    auto timeshiftEnd() const -> int { return m_shiftEnd; }
+    auto isTimeshifting() const -> bool { return m_shiftEnd > m_shiftBegin; }
 signals:
     void sizeChanged(int size);
     void usedChanged(int used);
     void timeChanged(int time);
+    void timeshiftChanged();
 private:
     friend class PlayEngine;
     auto setSize(int s) -> void { if (_Change(m_size, s)) emit sizeChanged(s); }
-    auto setUsed(int s) -> void { if (_Change(m_used, s)) emit usedChanged(s); }
+    auto setUsed(int s) -> void
+    {
+        if (_Change(m_used, s))
+            PropertyBatch::notify(this, &CacheInfoObject::usedChanged, s);
+    }
     Q_INVOKABLE void setTime(int s)
-        { if (_Change(m_time, s)) emit timeChanged(s); }
-    int m_size = 0, m_used = 0, m_time = 0;
+    {
+        if (_Change(m_time, s))
+            PropertyBatch::notify(this, &CacheInfoObject::timeChanged, s);
+    }
+    Q_INVOKABLE void setTimeshift(int begin, int end)
+    {
+        if (_Change(m_shiftBegin, begin) | _Change(m_shiftEnd, end))
+            PropertyBatch::notify(this, &CacheInfoObject::timeshiftChanged);
+    }
+    int m_size = 0, m_used = 0, m_time = 0, m_shiftBegin = 0, m_shiftEnd = 0;
 };
 
 #endif // MEDIAMISC_HPP
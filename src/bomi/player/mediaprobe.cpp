@@ -0,0 +1,288 @@
+#include "mediaprobe.hpp"
+#include "mrl.hpp"
+#include "misc/dataevent.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+#include <QThreadPool>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+DECLARE_LOG_CONTEXT(Playlist)
+
+enum EventType { ProbeDone = QEvent::User + 1 };
+
+static constexpr int CacheVersion = 1;
+static constexpr int MaxEntries = 20000;
+static constexpr int MaxThreads = 2;
+// pause before each file while playback is running
+static constexpr int YieldPause = 200;
+// delay to collect results before notifying
+static constexpr int NotifyDelay = 250;
+
+struct CacheEntry {
+    qint64 size = 0, mtime = 0, time = 0;
+    ProbeInfo info;
+};
+
+struct ProbeCache {
+    QMutex mutex;
+    QHash<QString, CacheEntry> entries;
+    bool dirty = false;
+};
+
+class ProbeJob : public QRunnable {
+public:
+    ProbeJob(QObject *probe, const QAtomicInt *serial, const QString &file,
+             ProbeCache *cache, const QAtomicInt *yielding)
+        : m_probe(probe), m_current(serial), m_serial(serial->load()), m_file(file)
+        , m_cache(cache), m_yielding(yielding) { }
+private:
+    // cancel() moved on to another serial
+    auto isStale() const -> bool { return m_current->load() != m_serial; }
+    auto run() -> void final
+    {
+        if (isStale())
+            return;
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        if (m_yielding->load())
+            QThread::msleep(YieldPause);
+        if (isStale())
+            return;
+        const QFileInfo file(m_file);
+        const auto now = QDateTime::currentMSecsSinceEpoch() / 1000;
+        CacheEntry entry;
+        entry.size = file.size();
+        entry.mtime = file.lastModified().toMSecsSinceEpoch() / 1000;
+        entry.time = now;
+        m_cache->mutex.lock();
+        auto it = m_cache->entries.find(m_file);
+        const bool hit = it != m_cache->entries.end()
+                && it->size == entry.size && it->mtime == entry.mtime;
+        if (hit) {
+            it->time = now;
+            entry.info = it->info;
+        }
+        m_cache->mutex.unlock();
+        if (!hit) {
+            entry.info = MediaProbe::probe(m_file);
+            m_cache->mutex.lock();
+            m_cache->entries[m_file] = entry;
+            m_cache->dirty = true;
+            m_cache->mutex.unlock();
+        }
+        _PostEvent(m_probe, ProbeDone, m_serial, m_file, entry.info);
+    }
+    QObject *m_probe = nullptr;
+    const QAtomicInt *m_current = nullptr;
+    int m_serial = 0;
+    QString m_file;
+    ProbeCache *m_cache = nullptr;
+    const QAtomicInt *m_yielding = nullptr;
+};
+
+struct MediaProbe::Data {
+    QThreadPool pool;
+    // changed only in GUI thread; jobs of older serial are stale
+    QAtomicInt serial, yielding;
+    ProbeCache cache;
+    QString fileName;
+    QHash<QString, ProbeInfo> results;
+    QSet<QString> queued;
+    QTimer notifier;
+    bool loaded = false;
+
+    auto load() -> void
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        JsonStorage storage(fileName);
+        const auto json = storage.read();
+        if (storage.hasError() || json[u"version"_q].toInt() != CacheVersion)
+            return;
+        const auto entries = json[u"entries"_q].toObject();
+        QMutexLocker locker(&cache.mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            const auto obj = it.value().toObject();
+            CacheEntry e;
+            e.size = obj[u"size"_q].toVariant().toLongLong();
+            e.mtime = obj[u"mtime"_q].toVariant().toLongLong();
+            e.time = obj[u"time"_q].toVariant().toLongLong();
+            e.info.duration = obj[u"duration"_q].toVariant().toLongLong();
+            e.info.size = QSize(obj[u"width"_q].toInt(), obj[u"height"_q].toInt());
+            e.info.video = obj[u"video"_q].toString();
+            e.info.audio = obj[u"audio"_q].toString();
+            e.info.title = obj[u"title"_q].toString();
+            e.info.artist = obj[u"artist"_q].toString();
+            e.info.album = obj[u"album"_q].toString();
+            cache.entries.insert(it.key(), e);
+        }
+    }
+};
+
+MediaProbe::MediaProbe(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->fileName = _WritablePath(Location::Cache) % "/media-probe.json"_a;
+    d->pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, MaxThreads));
+    d->notifier.setSingleShot(true);
+    d->notifier.setInterval(NotifyDelay);
+    connect(&d->notifier, &QTimer::timeout, this, [=] () {
+        emit updated();
+        if (d->queued.isEmpty())
+            save();
+    });
+}
+
+MediaProbe::~MediaProbe()
+{
+    cancel();
+    // running jobs post to this object
+    d->pool.waitForDone();
+    save();
+    delete d;
+}
+
+auto MediaProbe::request(const QList<Mrl> &mrls) -> void
+{
+    d->load();
+    int count = 0;
+    for (auto &mrl : mrls) {
+        if (!mrl.isLocalFile())
+            continue;
+        const auto file = mrl.toLocalFile();
+        if (d->results.contains(file) || d->queued.contains(file))
+            continue;
+        d->queued.insert(file);
+        d->pool.start(new ProbeJob(this, &d->serial, file, &d->cache, &d->yielding));
+        ++count;
+    }
+    if (count > 0)
+        _Debug("Probe %% file(s) in background.", count);
+}
+
+auto MediaProbe::cancel() -> void
+{
+    // running jobs finish their file on their own; results are dropped
+    d->serial.ref();
+    d->pool.clear();
+    d->queued.clear();
+}
+
+auto MediaProbe::info(const Mrl &mrl) const -> const ProbeInfo*
+{
+    if (!mrl.isLocalFile())
+        return nullptr;
+    const auto it = d->results.constFind(mrl.toLocalFile());
+    return it != d->results.cend() ? &(*it) : nullptr;
+}
+
+auto MediaProbe::pending() const -> int
+{
+    return d->queued.size();
+}
+
+auto MediaProbe::setYielding(bool yield) -> void
+{
+    d->yielding = yield;
+    d->pool.setMaxThreadCount(yield ? 1 : qBound(1, QThread::idealThreadCount() / 2, MaxThreads));
+}
+
+auto MediaProbe::save() -> void
+{
+    QMutexLocker locker(&d->cache.mutex);
+    auto &entries = d->cache.entries;
+    if (!d->cache.dirty)
+        return;
+    if (entries.size() > MaxEntries) {
+        QVector<qint64> times; times.reserve(entries.size());
+        for (auto &e : entries)
+            times.push_back(e.time);
+        std::nth_element(times.begin(), times.begin() + (entries.size() - MaxEntries),
+                         times.end());
+        const auto limit = times[entries.size() - MaxEntries];
+        for (auto it = entries.begin(); it != entries.end(); ) {
+            if (it->time < limit)
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+    QJsonObject json;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        const auto &e = *it;
+        QJsonObject obj;
+        obj[u"size"_q] = (double)e.size;
+        obj[u"mtime"_q] = (double)e.mtime;
+        obj[u"time"_q] = (double)e.time;
+        obj[u"duration"_q] = (double)e.info.duration;
+        obj[u"width"_q] = e.info.size.width();
+        obj[u"height"_q] = e.info.size.height();
+        obj[u"video"_q] = e.info.video;
+        obj[u"audio"_q] = e.info.audio;
+        obj[u"title"_q] = e.info.title;
+        obj[u"artist"_q] = e.info.artist;
+        obj[u"album"_q] = e.info.album;
+        json.insert(it.key(), obj);
+    }
+    QJsonObject root;
+    root[u"version"_q] = CacheVersion;
+    root[u"entries"_q] = json;
+    JsonStorage storage(d->fileName);
+    if (storage.write(root))
+        d->cache.dirty = false;
+}
+
+auto MediaProbe::customEvent(QEvent *event) -> void
+{
+    if (event->type() != ProbeDone)
+        return;
+    int serial; QString file; ProbeInfo info;
+    _TakeData(event, serial, file, info);
+    if (serial != d->serial.load())
+        return;
+    d->queued.remove(file);
+    d->results.insert(file, info);
+    if (!d->notifier.isActive())
+        d->notifier.start();
+}
+
+auto MediaProbe::probe(const QString &file) -> ProbeInfo
+{
+    ProbeInfo info;
+    AVFormatContext *fmt = nullptr;
+    AVDictionary *options = nullptr;
+    // headers are enough for duration and stream parameters
+    av_dict_set(&options, "probesize", "262144", 0);
+    av_dict_set(&options, "analyzeduration", "500000", 0);
+    const int ret = avformat_open_input(&fmt, file.toLocal8Bit().constData(),
+                                        nullptr, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+        return info;
+    if (avformat_find_stream_info(fmt, nullptr) >= 0) {
+        if (fmt->duration > 0)
+            info.duration = fmt->duration / 1000;
+        for (unsigned i = 0; i < fmt->nb_streams; ++i) {
+            const auto st = fmt->streams[i];
+            const auto codec = st->codec;
+            if (codec->codec_type == AVMEDIA_TYPE_VIDEO && info.video.isEmpty()
+                    && !(st->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+                info.size = QSize(codec->width, codec->height);
+                info.video = _L(avcodec_get_name(codec->codec_id));
+            } else if (codec->codec_type == AVMEDIA_TYPE_AUDIO && info.audio.isEmpty())
+                info.audio = _L(avcodec_get_name(codec->codec_id));
+        }
+        auto tag = [&] (const char *key) {
+            const auto e = av_dict_get(fmt->metadata, key, nullptr, 0);
+            return e ? QString::fromUtf8(e->value) : QString();
+        };
+        info.title = tag("title");
+        info.artist = tag("artist");
+        info.album = tag("album");
+    }
+    avformat_close_input(&fmt);
+    return info;
+}
@@ -0,0 +1,40 @@
+#ifndef MEDIAPROBE_HPP
+#define MEDIAPROBE_HPP
+
+class Mrl;
+
+struct ProbeInfo {
+    qint64 duration = -1; // msec
+    QSize size;           // empty if no video
+    QString video, audio; // codec names
+    QString title, artist, album;
+};
+
+// reads duration, resolution, codecs and tags of local files in background
+// and keeps them in a cache keyed by path, size and modification time
+class MediaProbe : public QObject {
+    Q_OBJECT
+public:
+    MediaProbe(QObject *parent = nullptr);
+    ~MediaProbe();
+    // queue local files which are not probed yet in this session
+    auto request(const QList<Mrl> &mrls) -> void;
+    // drops queued files without waiting for running ones
+    auto cancel() -> void;
+    // nullptr until the file is probed or found in cache
+    auto info(const Mrl &mrl) const -> const ProbeInfo*;
+    auto pending() const -> int;
+    // leave disk to playback: one file at a time with pauses in between
+    auto setYielding(bool yield) -> void;
+    auto save() -> void;
+    // lightweight probing with libavformat; runs in caller's thread
+    static auto probe(const QString &file) -> ProbeInfo;
+signals:
+    void updated();
+private:
+    auto customEvent(QEvent *event) -> void final;
+    struct Data;
+    Data *d;
+};
+
+#endif // MEDIAPROBE_HPP
@@ -0,0 +1,642 @@
+#include "mediaserver.hpp"
+#include "mrl.hpp"
+#include "http-parser/http_parser.h"
+#include "misc/log.hpp"
+#include <QMimeDatabase>
+#include <QElapsedTimer>
+#include <thread>
+#include <atomic>
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+DECLARE_LOG_CONTEXT(MediaServer)
+
+static constexpr int MaxClients = 64;
+static constexpr qint64 IdleTimeout = 30000;            // msec
+static constexpr int MaxRequest = 64 * 1024;
+// bytes per sendfile() call before looking at other clients
+static constexpr qint64 SendChunk = 4 * 1024 * 1024;
+static constexpr int CopyChunk = 256 * 1024;
+
+struct Entry { QString name, path, location; };
+
+struct Client {
+    int fd = -1, file = -1;
+    QString peer;
+    http_parser parser;
+    QByteArray url, field, value, pending, out;
+    QHash<QByteArray, QByteArray> headers; // lower case names
+    bool requested = false, keepAlive = true;
+    int written = 0;
+    qint64 offset = 0, end = 0, active = 0;
+    auto isBusy() const -> bool
+        { return written < out.size() || (file >= 0 && offset < end); }
+    auto fillHeader() -> void
+    {
+        if (!field.isEmpty())
+            headers.insert(field.toLower(), value.trimmed());
+        field.clear();
+        value.clear();
+    }
+};
+
+struct Account {
+    qint64 bytes = 0, last = 0;
+    int connections = 0, requests = 0;
+    double rate = 0.0;
+};
+
+struct MediaServer::Data {
+    int listener = -1, wake[2] = { -1, -1 };
+    std::thread thread;
+    std::atomic<bool> quit{false};
+    std::atomic<int> position{0};
+    QString name, error;
+
+    mutable QMutex mutex; // guards below
+    QVector<Entry> entries;
+    int current = -1;
+    QHash<QString, Account> accounts;
+
+    // server thread only
+    std::vector<Client*> clients;
+    http_parser_settings settings;
+    QMimeDatabase mime;
+    QElapsedTimer clock;
+
+    auto run() -> void;
+    auto accept() -> void;
+    auto read(Client *c) -> bool;
+    auto parse(Client *c, QByteArray data) -> bool;
+    auto write(Client *c) -> bool;
+    auto respond(Client *c) -> void;
+    auto serve(Client *c, const QString &path, bool head) -> void;
+    auto drop(Client *c) -> void;
+    auto account(Client *c, qint64 bytes) -> void
+    {
+        c->active = clock.elapsed();
+        QMutexLocker locker(&mutex);
+        accounts[c->peer].bytes += bytes;
+    }
+    auto reply(Client *c, int status, const QByteArray &text,
+               const QByteArray &headers, qint64 length) -> void
+    {
+        c->out = "HTTP/1.1 " + QByteArray::number(status) + ' ' + text + "\r\n"
+                 "Server: bomi\r\nContent-Length: " + QByteArray::number(length) + "\r\n"
+                 "Connection: " + (c->keepAlive ? "keep-alive" : "close") + "\r\n"
+                 + headers + "\r\n";
+        c->written = 0;
+    }
+    auto reply(Client *c, int status, const QByteArray &text, const QByteArray &headers,
+               const QByteArray &type, const QByteArray &body, bool head) -> void
+    {
+        reply(c, status, text, headers + "Content-Type: " + type + "\r\n", body.size());
+        if (!head)
+            c->out += body;
+    }
+    auto error(Client *c, int status, const QByteArray &text) -> void
+        { reply(c, status, text, QByteArray(), "text/plain", text + '\n', false); }
+    auto updateRates(qint64 elapsed) -> double
+    {
+        QMutexLocker locker(&mutex);
+        double total = 0.0;
+        for (auto &a : accounts) {
+            a.rate = a.rate * 0.5 + (a.bytes - a.last) * 1e3 / elapsed * 0.5;
+            a.last = a.bytes;
+            total += a.rate;
+        }
+        return total;
+    }
+};
+
+// media fragment for browsers; remote locations may have one already
+SIA withTime(const QByteArray &url, double pos) -> QByteArray
+{
+    const auto t = "t=" + QByteArray::number(pos, 'f', 3);
+    const int hash = url.indexOf('#');
+    if (hash < 0)
+        return url + '#' + t;
+    QByteArray fragment;
+    for (auto &part : url.mid(hash + 1).split('&')) {
+        if (!part.isEmpty() && !part.startsWith("t="))
+            fragment += part + '&';
+    }
+    return url.left(hash + 1) + fragment + t;
+}
+
+#ifndef Q_OS_WIN
+
+SIA setNonBlocking(int fd) -> void
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+SIA wouldBlock() -> bool
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+auto MediaServer::Data::run() -> void
+{
+    // peers closing early must not kill the player
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    http_parser_settings_init(&settings);
+#define GET_CLIENT() static_cast<Client*>(parser->data)
+    settings.on_message_begin = [] (http_parser *parser) -> int {
+        auto c = GET_CLIENT();
+        c->url.clear();
+        c->field.clear();
+        c->value.clear();
+        c->headers.clear();
+        return 0;
+    };
+    settings.on_url = [] (http_parser *parser, const char *at, size_t len) -> int
+        { GET_CLIENT()->url.append(at, len); return 0; };
+    settings.on_header_field = [] (http_parser *parser, const char *at, size_t len) -> int {
+        auto c = GET_CLIENT();
+        if (!c->value.isEmpty())
+            c->fillHeader();
+        c->field.append(at, len);
+        return 0;
+    };
+    settings.on_header_value = [] (http_parser *parser, const char *at, size_t len) -> int
+        { GET_CLIENT()->value.append(at, len); return 0; };
+    settings.on_headers_complete = [] (http_parser *parser) -> int {
+        auto c = GET_CLIENT();
+        c->fillHeader();
+        c->keepAlive = http_should_keep_alive(parser);
+        return 0;
+    };
+    settings.on_message_complete = [] (http_parser *parser) -> int {
+        // one request at a time; rest waits until the reply is sent
+        auto c = GET_CLIENT();
+        c->requested = true;
+        http_parser_pause(parser, 1);
+        return 0;
+    };
+#undef GET_CLIENT
+
+    std::vector<pollfd> fds;
+    qint64 reported = clock.elapsed(), logged = reported;
+    double rate = 0.0;
+    while (!quit) {
+        fds.clear();
+        fds.push_back({ listener, POLLIN, 0 });
+        fds.push_back({ wake[0], POLLIN, 0 });
+        for (auto c : clients)
+            fds.push_back({ c->fd, short(c->isBusy() ? POLLOUT : POLLIN), 0 });
+        if (::poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            _Error("Cannot poll sockets: %%", QString::fromLocal8Bit(strerror(errno)));
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            char buf[16];
+            while (::read(wake[0], buf, sizeof buf) > 0) { }
+        }
+        if (quit)
+            break;
+        if (fds[0].revents & POLLIN)
+            accept();
+        const auto now = clock.elapsed();
+        // accept() only appends so indices of polled clients hold
+        for (size_t i = 2; i < fds.size(); ++i) {
+            auto &c = clients[i - 2];
+            const auto events = fds[i].revents;
+            bool ok = true;
+            if (events & (POLLERR | POLLNVAL))
+                ok = false;
+            else if (events & POLLOUT)
+                ok = write(c);
+            else if (events & (POLLIN | POLLHUP))
+                ok = read(c) && (!c->isBusy() || write(c));
+            else if (now - c->active > IdleTimeout)
+                ok = false;
+            if (!ok) {
+                drop(c);
+                c = nullptr;
+            }
+        }
+        clients.erase(std::remove(clients.begin(), clients.end(), nullptr), clients.end());
+        if (now - reported >= 1000) {
+            rate = updateRates(now - reported);
+            reported = now;
+        }
+        if (now - logged >= 10000 && !clients.empty()) {
+            _Info("Sending %% MiB/s over %% connection(s)", rate / (1024 * 1024), clients.size());
+            logged = now;
+        }
+    }
+    for (auto c : clients)
+        drop(c);
+    clients.clear();
+}
+
+auto MediaServer::Data::accept() -> void
+{
+    for (;;) {
+        sockaddr_storage addr;
+        socklen_t len = sizeof addr;
+        const int fd = ::accept(listener, (sockaddr*)&addr, &len);
+        if (fd < 0)
+            break;
+        if ((int)clients.size() >= MaxClients) {
+            ::close(fd);
+            continue;
+        }
+        setNonBlocking(fd);
+        char host[NI_MAXHOST] = "";
+        getnameinfo((sockaddr*)&addr, len, host, sizeof host, nullptr, 0, NI_NUMERICHOST);
+        auto c = new Client;
+        c->fd = fd;
+        c->peer = QString::fromLatin1(host);
+        c->active = clock.elapsed();
+        http_parser_init(&c->parser, HTTP_REQUEST);
+        c->parser.data = c;
+        clients.push_back(c);
+        QMutexLocker locker(&mutex);
+        ++accounts[c->peer].connections;
+    }
+}
+
+auto MediaServer::Data::drop(Client *c) -> void
+{
+    _Debug("Connection from %% closed.", c->peer);
+    if (c->file >= 0)
+        ::close(c->file);
+    ::close(c->fd);
+    delete c;
+}
+
+auto MediaServer::Data::read(Client *c) -> bool
+{
+    char buf[4096];
+    for (;;) {
+        const auto n = ::recv(c->fd, buf, sizeof buf, 0);
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return wouldBlock();
+        c->active = clock.elapsed();
+        if (c->requested) {
+            c->pending.append(buf, n);
+            if (c->pending.size() > MaxRequest)
+                return false;
+        } else if (!parse(c, QByteArray(buf, n)))
+            return false;
+    }
+}
+
+auto MediaServer::Data::parse(Client *c, QByteArray data) -> bool
+{
+    const auto parsed = http_parser_execute(&c->parser, &settings,
+                                            data.constData(), data.size());
+    const auto errno_ = HTTP_PARSER_ERRNO(&c->parser);
+    if (errno_ == HPE_PAUSED) {
+        c->pending = data.mid(parsed);
+        respond(c);
+        return true;
+    }
+    return errno_ == HPE_OK && (int)parsed == data.size()
+           && c->url.size() + c->field.size() + c->value.size() < MaxRequest
+           && c->headers.size() < 100;
+}
+
+auto MediaServer::Data::write(Client *c) -> bool
+{
+    for (;;) {
+        if (c->written < c->out.size()) {
+            const auto n = ::send(c->fd, c->out.constData() + c->written,
+                                  c->out.size() - c->written, MSG_NOSIGNAL);
+            if (n < 0)
+                return wouldBlock();
+            c->written += n;
+            account(c, n);
+            continue;
+        }
+        if (c->file >= 0 && c->offset < c->end) {
+#ifdef Q_OS_LINUX
+            off_t offset = c->offset;
+            const auto n = ::sendfile(c->fd, c->file, &offset,
+                                      qMin(c->end - c->offset, SendChunk));
+            if (n < 0)
+                return wouldBlock();
+            if (n == 0) // truncated meanwhile
+                return false;
+            c->offset = offset;
+            account(c, n);
+            // back to poll() so that other clients get their turn
+            return true;
+#else
+            c->out.resize(qMin<qint64>(CopyChunk, c->end - c->offset));
+            const auto n = ::pread(c->file, c->out.data(), c->out.size(), c->offset);
+            if (n <= 0)
+                return false;
+            c->out.resize(n);
+            c->written = 0;
+            c->offset += n;
+            continue;
+#endif
+        }
+        // reply sent
+        if (c->file >= 0) {
+            ::close(c->file);
+            c->file = -1;
+        }
+        c->out.clear();
+        c->written = 0;
+        if (!c->keepAlive)
+            return false;
+        c->requested = false;
+        http_parser_pause(&c->parser, 0);
+        const auto pending = std::move(c->pending);
+        c->pending.clear();
+        if (!pending.isEmpty() && !parse(c, pending))
+            return false;
+        if (!c->isBusy())
+            return true;
+    }
+}
+
+auto MediaServer::Data::respond(Client *c) -> void
+{
+    const bool head = c->parser.method == HTTP_HEAD;
+    {
+        QMutexLocker locker(&mutex);
+        ++accounts[c->peer].requests;
+    }
+    if (!head && c->parser.method != HTTP_GET) {
+        c->keepAlive = false;
+        error(c, 405, "Method Not Allowed");
+        return;
+    }
+    const int query = c->url.indexOf('?');
+    const auto path = QString::fromUtf8(QByteArray::fromPercentEncoding(c->url.left(query)));
+    auto host = c->headers.value("host");
+    if (host.isEmpty())
+        host = name.toLatin1();
+    const QByteArray base = "http://" + host;
+
+    QMutexLocker locker(&mutex);
+    const auto entries = this->entries;
+    const int current = this->current;
+    locker.unlock();
+
+    auto urlOf = [&] (int i) -> QByteArray {
+        const auto &e = entries[i];
+        if (e.path.isEmpty())
+            return e.location.toUtf8();
+        return base + "/media/" + QByteArray::number(i) + '/'
+               + QUrl::toPercentEncoding(QFileInfo(e.path).fileName());
+    };
+    auto extinf = [&] (int i) -> QByteArray
+        { return "#EXTINF:-1," + entries[i].name.toUtf8() + '\n' + urlOf(i) + '\n'; };
+    const bool valid = 0 <= current && current < entries.size();
+    const double pos = position * 1e-3;
+
+    if (path == "/"_a || path == "/playlist.m3u8"_a || path == "/playlist.m3u"_a) {
+        QByteArray body = "#EXTM3U\n";
+        for (int i = 0; i < entries.size(); ++i)
+            body += extinf(i);
+        reply(c, 200, "OK", QByteArray(), "audio/x-mpegurl; charset=utf-8", body, head);
+    } else if (path == "/current"_a || path == "/live"_a) {
+        if (!valid)
+            return error(c, 404, "Not Found");
+        auto location = urlOf(current);
+        if (path == "/live"_a)
+            location = withTime(location, pos);
+        reply(c, 302, "Found", "Location: " + location + "\r\n",
+              "text/plain", location + '\n', head);
+    } else if (path == "/live.m3u8"_a || path == "/live.m3u"_a) {
+        if (!valid)
+            return error(c, 404, "Not Found");
+        const auto body = "#EXTM3U\n#EXTVLCOPT:start-time="
+                          + QByteArray::number(pos, 'f', 3) + '\n' + extinf(current);
+        reply(c, 200, "OK", "Cache-Control: no-cache\r\n",
+              "audio/x-mpegurl; charset=utf-8", body, head);
+    } else if (path.startsWith("/media/"_a)) {
+        bool ok = false;
+        const int i = path.section('/'_q, 2, 2).toInt(&ok);
+        if (!ok || i < 0 || i >= entries.size() || entries[i].path.isEmpty())
+            return error(c, 404, "Not Found");
+        serve(c, entries[i].path, head);
+    } else
+        error(c, 404, "Not Found");
+}
+
+auto MediaServer::Data::serve(Client *c, const QString &path, bool head) -> void
+{
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0)
+            ::close(fd);
+        return error(c, 404, "Not Found");
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    const qint64 size = st.st_size;
+    qint64 from = 0, to = size - 1;
+    bool partial = false;
+    const auto range = c->headers.value("range");
+    // single range only; others may be answered with the whole file
+    static const QRegEx rx(uR"(^bytes=(\d*)-(\d*)$)"_q);
+    const auto m = rx.match(QString::fromLatin1(range));
+    if (m.hasMatch() && !(m.capturedRef(1).isEmpty() && m.capturedRef(2).isEmpty())) {
+        if (m.capturedRef(1).isEmpty()) { // last n bytes
+            from = qMax(0LL, size - m.capturedRef(2).toLongLong());
+        } else {
+            from = m.capturedRef(1).toLongLong();
+            if (!m.capturedRef(2).isEmpty())
+                to = qMin(to, m.capturedRef(2).toLongLong());
+        }
+        if (from >= size || from > to) {
+            ::close(fd);
+            return reply(c, 416, "Range Not Satisfiable",
+                         "Content-Range: bytes */" + QByteArray::number(size) + "\r\n", 0);
+        }
+        partial = true;
+    }
+    QByteArray headers = "Accept-Ranges: bytes\r\nContent-Type: "
+            + mime.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name().toLatin1()
+            + "\r\n";
+    if (partial)
+        headers += "Content-Range: bytes " + QByteArray::number(from) + '-'
+                   + QByteArray::number(to) + '/' + QByteArray::number(size) + "\r\n";
+    reply(c, partial ? 206 : 200, partial ? "Partial Content" : "OK", headers, to - from + 1);
+    if (head) {
+        ::close(fd);
+        return;
+    }
+    c->file = fd;
+    c->offset = from;
+    c->end = to + 1;
+}
+
+#endif
+
+/******************************************************************************/
+
+MediaServer::MediaServer(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->clock.start();
+}
+
+MediaServer::~MediaServer()
+{
+    close();
+    delete d;
+}
+
+auto MediaServer::listen(const QString &address, int port) -> bool
+{
+    close();
+#ifdef Q_OS_WIN
+    Q_UNUSED(address); Q_UNUSED(port);
+    d->error = u"Media server is not available on this platform."_q;
+    _Error("%%", d->error);
+    return false;
+#else
+    auto host = address.trimmed().toLatin1();
+    if (host == "*")
+        host.clear();
+    else if (!host.compare("localhost", Qt::CaseInsensitive))
+        host = "127.0.0.1";
+    addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo *res = nullptr;
+    const auto service = QByteArray::number(port);
+    const int gai = getaddrinfo(host.isEmpty() ? nullptr : host.constData(),
+                                service.constData(), &hints, &res);
+    if (gai) {
+        d->error = QString::fromLocal8Bit(gai_strerror(gai));
+        _Error("Cannot resolve '%%': %%", address, d->error);
+        return false;
+    }
+    int fd = -1;
+    for (auto ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 || ::listen(fd, 64) < 0) {
+            d->error = QString::fromLocal8Bit(strerror(errno));
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0 || ::pipe(d->wake) < 0) {
+        if (fd >= 0)
+            ::close(fd);
+        _Error("Cannot listen on '%%:%%': %%", address, port, d->error);
+        return false;
+    }
+    setNonBlocking(fd);
+    setNonBlocking(d->wake[0]);
+    setNonBlocking(d->wake[1]);
+    d->listener = fd;
+
+    sockaddr_storage addr;
+    socklen_t len = sizeof addr;
+    char name[NI_MAXHOST] = "", serv[NI_MAXSERV] = "";
+    getsockname(fd, (sockaddr*)&addr, &len);
+    getnameinfo((sockaddr*)&addr, len, name, sizeof name, serv, sizeof serv,
+                NI_NUMERICHOST | NI_NUMERICSERV);
+    d->name = _L(name) % ':'_q % _L(serv);
+    d->error.clear();
+    d->quit = false;
+    d->thread = std::thread([=] () { d->run(); });
+    _Info("Serving media on %%.", d->name);
+    return true;
+#endif
+}
+
+auto MediaServer::close() -> void
+{
+#ifndef Q_OS_WIN
+    if (d->listener < 0)
+        return;
+    d->quit = true;
+    const char c = 0;
+    if (::write(d->wake[1], &c, 1) < 0)
+        _Warn("Cannot wake media server thread.");
+    if (d->thread.joinable())
+        d->thread.join();
+    ::close(d->listener);
+    ::close(d->wake[0]);
+    ::close(d->wake[1]);
+    d->listener = d->wake[0] = d->wake[1] = -1;
+    _Info("Closed media server.");
+#endif
+}
+
+auto MediaServer::isListening() const -> bool
+{
+    return d->listener >= 0;
+}
+
+auto MediaServer::serverName() const -> QString
+{
+    return d->name;
+}
+
+auto MediaServer::errorString() const -> QString
+{
+    return d->error;
+}
+
+auto MediaServer::setPlaylist(const QList<Mrl> &list, int current) -> void
+{
+    QVector<Entry> entries;
+    entries.reserve(list.size());
+    for (auto &mrl : list)
+        entries.push_back({ mrl.displayName(), mrl.toLocalFile(), mrl.toString() });
+    QMutexLocker locker(&d->mutex);
+    d->entries = std::move(entries);
+    d->current = current;
+}
+
+auto MediaServer::setPosition(int msec) -> void
+{
+    d->position = msec;
+}
+
+auto MediaServer::clients() const -> QVector<MediaClientStats>
+{
+    QMutexLocker locker(&d->mutex);
+    QVector<MediaClientStats> stats;
+    stats.reserve(d->accounts.size());
+    for (auto it = d->accounts.begin(); it != d->accounts.end(); ++it) {
+        MediaClientStats s;
+        s.peer = it.key();
+        s.bytes = it->bytes;
+        s.connections = it->connections;
+        s.requests = it->requests;
+        s.rate = it->rate;
+        stats.push_back(s);
+    }
+    return stats;
+}
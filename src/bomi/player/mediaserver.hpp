@@ -0,0 +1,41 @@
+#ifndef MEDIASERVER_HPP
+#define MEDIASERVER_HPP
+
+class Mrl;
+
+struct MediaClientStats {
+    QString peer;
+    qint64 bytes = 0;       // sent to this address so far
+    int connections = 0, requests = 0;
+    double rate = 0.0;      // bytes per sec, recent
+};
+
+// serves playing file and playlist entries over HTTP to other devices;
+// one thread multiplexes non-blocking connections and file data goes out
+// with sendfile() where the platform has it
+//   /, /playlist.m3u8  playlist with URLs of every entry
+//   /media/<n>/<name>  local file of entry n with range support
+//   /current           redirect to entry being played
+//   /live, /live.m3u8  current entry starting from current position
+class MediaServer : public QObject {
+    Q_OBJECT
+public:
+    MediaServer(QObject *parent = nullptr);
+    ~MediaServer();
+    // empty address or * for all interfaces
+    auto listen(const QString &address, int port) -> bool;
+    auto close() -> void;
+    auto isListening() const -> bool;
+    auto serverName() const -> QString;
+    auto errorString() const -> QString;
+    // entries which are not local files are listed with their own location
+    auto setPlaylist(const QList<Mrl> &list, int current) -> void;
+    // position of current entry in msec for live URLs
+    auto setPosition(int msec) -> void;
+    auto clients() const -> QVector<MediaClientStats>;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // MEDIASERVER_HPP
@@ -1,10 +1,15 @@
-#include "mpris.hpp"
+#include "mpris_p.hpp"
 #include "playengine.hpp"
 #include "playlistmodel.hpp"
 #include "app.hpp"
 #include "mainwindow.hpp"
 #include "player/avinfoobject.hpp"
 #include "misc/dataevent.hpp"
+#include "misc/log.hpp"
+#include <QCache>
+#include <QElapsedTimer>
+
+DECLARE_LOG_CONTEXT(MPRIS)
 
 namespace mpris {
 
@@ -41,40 +46,73 @@ RootObject::~RootObject()
 
 static auto dbusTrackId(const Mrl &mrl) -> QString
 {
+    // md5 for every metadata update is a waste; remember the last few ids
+    static QCache<QString, QString> cache(16);
+    const auto key = mrl.toString();
+    if (auto id = cache.object(key))
+        return *id;
     using Hash = QCryptographicHash;
-    const auto hash = Hash::hash(mrl.toString().toUtf8(), Hash::Md5);
-    return "/net/xylosper/bomi/track_"_a % _L(hash.toHex().constData());
+    const auto hash = Hash::hash(key.toUtf8(), Hash::Md5);
+    auto id = new QString("/net/xylosper/bomi/track_"_a % _L(hash.toHex().constData()));
+    cache.insert(key, id);
+    return *id;
 }
 
-static auto sendPropertiesChanged(const QDBusAbstractAdaptor *adaptor,
-                                  const QVariantMap &properties) -> void
+static auto interfaceName(const QDBusAbstractAdaptor *adaptor) -> QString
 {
-    const auto iface = _L(adaptor->metaObject()->classInfo(0).value());
-    auto sig = QDBusMessage::createSignal(u"/org/mpris/MediaPlayer2"_q,
-                                          u"org.freedesktop.DBus.Properties"_q,
-                                          u"PropertiesChanged"_q);
-    sig << iface << properties << QStringList();
-    QDBusConnection::sessionBus().send(sig);
+    return _L(adaptor->metaObject()->classInfo(0).value());
 }
 
-SIA sendPropertiesChanged(const QDBusAbstractAdaptor *adaptor,
-                          const char *property, const QVariant &value) -> void
+PropertiesPublisher::PropertiesPublisher(const QString &iface, const QDBusConnection &bus)
+    : m_iface(iface), m_bus(bus)
 {
-    QVariantMap props;
-    props.insert(_L(property), value);
-    sendPropertiesChanged(adaptor, props);
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(Window);
+    QObject::connect(&m_timer, &QTimer::timeout, [=] () { flush(); });
+}
+
+auto PropertiesPublisher::set(const QString &property, const QVariant &value) -> void
+{
+    auto it = m_sent.constFind(property);
+    if (it != m_sent.cend() && *it == value) {
+        m_pending.remove(property);
+        return;
+    }
+    m_pending[property] = value;
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+auto PropertiesPublisher::flush() -> void
+{
+    m_timer.stop();
+    if (m_pending.isEmpty())
+        return;
+    auto sig = QDBusMessage::createSignal(u"/org/mpris/MediaPlayer2"_q,
+                                          u"org.freedesktop.DBus.Properties"_q,
+                                          u"PropertiesChanged"_q);
+    sig << m_iface << m_pending << QStringList();
+    m_bus.send(sig);
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+        m_sent[it.key()] = *it;
+    ++m_signals;
+    _Trace("Sent PropertiesChanged with %% properties (%% signals)",
+           m_pending.size(), m_signals);
+    m_pending.clear();
 }
 
 struct MediaPlayer2::Data {
+    Data(MediaPlayer2 *p): publisher(interfaceName(p)) { }
     MainWindow *mw = nullptr;
+    PropertiesPublisher publisher;
 };
 
 MediaPlayer2::MediaPlayer2(QObject *parent)
-: QDBusAbstractAdaptor(parent), d(new Data) {
+: QDBusAbstractAdaptor(parent), d(new Data(this)) {
     d->mw = cApp.mainWindow();
     Q_ASSERT(d->mw);
     connect(d->mw, &MainWindow::fullscreenChanged,
-            [this] (bool fs) { sendPropertiesChanged(this, "Fullscreen", fs); });
+            [this] (bool fs) { d->publisher.set("Fullscreen", fs); });
 }
 
 MediaPlayer2::~MediaPlayer2() {
@@ -182,7 +220,28 @@ private:
     QSharedPointer<QTemporaryFile> m_albumArt[2];
 };
 
+static constexpr int SeekedInterval = 100;
+
+static auto isSameMetaData(const QVariantMap &lhs, const QVariantMap &rhs) -> bool
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    static const auto trackId = u"mpris:trackid"_q;
+    for (auto it = lhs.begin(), it2 = rhs.begin(); it != lhs.end(); ++it, ++it2) {
+        if (it.key() != it2.key())
+            return false;
+        if (it.key() == trackId) {
+            if (it->value<QDBusObjectPath>().path()
+                    != it2->value<QDBusObjectPath>().path())
+                return false;
+        } else if (*it != *it2)
+            return false;
+    }
+    return true;
+}
+
 struct Player::Data {
+    Data(Player *p, const QDBusConnection &bus): publisher(interfaceName(p), bus) { }
     double volume = 1.0;
     MainWindow *mw = nullptr;
     PlayEngine *engine = nullptr;
@@ -190,6 +249,11 @@ struct Player::Data {
     QString playbackStatus, albumArt;
     QVariantMap metaData;
     Thread thread;
+    PropertiesPublisher publisher;
+    struct {
+        QElapsedTimer last;
+        QTimer timer;
+    } seeked;
     struct {
         QTimer timer;
         bool flag = false;
@@ -227,14 +291,21 @@ struct Player::Data {
 };
 
 Player::Player(QObject *parent)
+    : Player(cApp.mainWindow()->engine(), cApp.mainWindow()->playlist(),
+             QDBusConnection::sessionBus(), parent)
+{
+    d->mw = cApp.mainWindow();
+}
+
+Player::Player(PlayEngine *engine, PlaylistModel *playlist,
+               const QDBusConnection &bus, QObject *parent)
     : QDBusAbstractAdaptor(parent)
-    , d(new Data)
+    , d(new Data(this, bus))
 {
     d->thread.p = this;
     d->thread.start();
-    d->mw = cApp.mainWindow();
-    d->engine = d->mw->engine();
-    d->playlist = d->mw->playlist();
+    d->engine = engine;
+    d->playlist = playlist;
 
     d->playbackStatus = d->toDBus(d->engine->state());
     d->volume = d->engine->volume();
@@ -243,31 +314,43 @@ Player::Player(QObject *parent)
     connect(d->engine, &PlayEngine::stateChanged, this,
             [this] (PlayEngine::State state) {
         d->playbackStatus = d->toDBus(d->engine->state());
-        QVariantMap map;
-        map[u"PlaybackStatus"_q] = d->playbackStatus;
-        map[u"CanPause"_q] = map[u"CanPlay"_q] = state != PlayEngine::Error;
-        sendPropertiesChanged(this, map);
+        d->publisher.set("PlaybackStatus", d->playbackStatus);
+        d->publisher.set("CanPause", state != PlayEngine::Error);
+        d->publisher.set("CanPlay", state != PlayEngine::Error);
     });
     connect(d->engine, &PlayEngine::speedChanged, this, [this] () {
-        sendPropertiesChanged(this, "Rate", d->engine->speed());
+        d->publisher.set("Rate", d->engine->speed());
     });
     auto checkNextPrevious = [this] () {
-        QVariantMap map;
-        map[u"CanGoNext"_q] = d->playlist->hasNext();
-        map[u"CanGoPrevious"_q] = d->playlist->hasPrevious();
-        sendPropertiesChanged(this, map);
+        d->publisher.set("CanGoNext", d->playlist->hasNext());
+        d->publisher.set("CanGoPrevious", d->playlist->hasPrevious());
     };
     connect(d->playlist, &PlaylistModel::loadedChanged,
             this, checkNextPrevious);
     connect(d->engine, &PlayEngine::seekableChanged, this,
-            [this] (bool seekable) {
-        sendPropertiesChanged(this, "CanSeek", seekable);
-    });
+            [this] (bool seekable) { d->publisher.set("CanSeek", seekable); });
     connect(d->engine, &PlayEngine::volumeChanged, this, [=] () {
-        sendPropertiesChanged(this, "volume", d->engine->volume());
+        d->volume = d->engine->volume();
+        d->publisher.set("Volume", d->volume);
+    });
+
+    // Seeked is emitted at most once per interval with the latest position
+    d->seeked.timer.setSingleShot(true);
+    d->seeked.timer.setInterval(SeekedInterval);
+    connect(&d->seeked.timer, &QTimer::timeout, this, [this] () {
+        d->seeked.last.start();
+        emit Seeked(time());
+    });
+    connect(d->engine, &PlayEngine::sought, this, [this] () {
+        if (d->seeked.timer.isActive())
+            return;
+        if (!d->seeked.last.isValid()
+                || d->seeked.last.elapsed() >= SeekedInterval) {
+            d->seeked.last.start();
+            emit Seeked(time());
+        } else
+            d->seeked.timer.start(SeekedInterval - d->seeked.last.elapsed());
     });
-    connect(d->engine, &PlayEngine::sought, this,
-            [this] () { emit Seeked(time()); });
 
     // hack for nonsense interfere from MPRIS
     d->started.timer.setSingleShot(true);
@@ -396,7 +479,8 @@ auto Player::Pause() -> void
 
 auto Player::PlayPause() -> void
 {
-    d->mw->togglePlayPause();
+    if (d->mw)
+        d->mw->togglePlayPause();
 }
 
 auto Player::Stop() -> void
@@ -406,7 +490,8 @@ auto Player::Stop() -> void
 
 auto Player::Play() -> void
 {
-    d->mw->play();
+    if (d->mw)
+        d->mw->play();
 }
 
 auto Player::Seek(qint64 offset) -> void
@@ -421,7 +506,8 @@ auto Player::Seek(qint64 offset) -> void
 
 auto Player::OpenUri(const QString &url) -> void
 {
-    d->mw->openFromFileManager(Mrl(QUrl(url)));
+    if (d->mw)
+        d->mw->openFromFileManager(Mrl(QUrl(url)));
 }
 
 auto Player::SetPosition(const QDBusObjectPath &track, qint64 position) -> void
@@ -436,8 +522,11 @@ auto Player::SetPosition(const QDBusObjectPath &track, qint64 position) -> void
 
 auto Player::updateMetaData() -> void
 {
-    d->metaData = d->toDBus(d->engine->metaData());
-    sendPropertiesChanged(this, "Metadata", d->metaData);
+    auto metaData = d->toDBus(d->engine->metaData());
+    if (isSameMetaData(d->metaData, metaData))
+        return;
+    d->metaData = metaData;
+    d->publisher.set("Metadata", d->metaData);
 }
 
 auto Player::customEvent(QEvent *ev) -> void
@@ -1,6 +1,8 @@
 #ifndef MPRIS_HPP
 #define MPRIS_HPP
 
+class PlayEngine;                       class PlaylistModel;
+
 namespace mpris {
 
 class MediaPlayer2 : public QDBusAbstractAdaptor {
@@ -55,7 +57,12 @@ class Player : public QDBusAbstractAdaptor {
     Q_PROPERTY(bool CanSeek READ isSeekable)
     Q_PROPERTY(bool CanControl READ isControllable)
 public:
+    // adaptor of main window on session bus
     Player(QObject *parent);
+    // adaptor of engine and playlist alone, which cannot raise, play or
+    // open anything by itself
+    Player(PlayEngine *engine, PlaylistModel *playlist,
+           const QDBusConnection &bus, QObject *parent);
     ~Player();
     auto playbackStatus() const -> QString;
     auto loopStatus() const -> QString;
@@ -0,0 +1,29 @@
+#ifndef MPRIS_P_HPP
+#define MPRIS_P_HPP
+
+#include "mpris.hpp"
+
+namespace mpris {
+
+// collects property changes within a frame window and sends them at once
+class PropertiesPublisher {
+public:
+    static constexpr int Window = 16;
+    PropertiesPublisher(const QString &iface,
+                        const QDBusConnection &bus = QDBusConnection::sessionBus());
+    auto set(const QString &property, const QVariant &value) -> void;
+    auto set(const char *property, const QVariant &value) -> void
+        { set(_L(property), value); }
+    auto flush() -> void;
+    auto signalCount() const -> int { return m_signals; }
+private:
+    QString m_iface;
+    QDBusConnection m_bus;
+    QVariantMap m_pending, m_sent;
+    QTimer m_timer;
+    int m_signals = 0;
+};
+
+}
+
+#endif // MPRIS_P_HPP
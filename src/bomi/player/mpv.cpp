@@ -145,6 +145,11 @@ auto Mpv::frameSwapped() -> void
     mpv_opengl_cb_report_flip(d->gl, 0);
 }
 
+auto Mpv::framePts(bool next, double *pts) const -> bool
+{
+    return d->gl && mpv_opengl_cb_frame_pts(d->gl, next, pts) >= 0;
+}
+
 auto Mpv::initializeGL(QOpenGLContext *ctx) -> void
 {
     auto getProcAddr = [] (void *ctx, const char *name) -> void* {
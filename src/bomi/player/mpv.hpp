@@ -94,6 +94,8 @@ public:
     auto initializeGL(QOpenGLContext *ctx) -> void;
     auto finalizeGL() -> void;
     auto frameSwapped() -> void;
+    // pts in sec of the frame to be drawn by next render() or drawn lastly
+    auto framePts(bool next, double *pts) const -> bool;
 private:
     static auto e2s(int error) -> const char* { return mpv_error_string(error); }
     static auto e2l(int error) -> Log::Level;
@@ -142,6 +144,7 @@ template<class T>
 auto Mpv::get(const char *name, T &def) const -> bool
 {
     if (!m_handle) return false;
+    AllocScope scope("mpv-property");
     MpvGetScopedData<T> data;
     int error = mpv_get_property(m_handle, name, data.format(), data.raw());
     if (!MPV_CHECK(error, "get %%", name))
@@ -19,7 +19,8 @@ Mrl::Mrl(const QString &location, const QString &name) {
         m_loc = "file://"_a % _ToAbsFilePath(location);
     else if (startsWith("file://"_a))
         m_loc = QUrl::fromPercentEncoding(location.toUtf8());
-    else if (startsWith("dvdnav://"_a) || startsWith("bdnav://"_a) || startsWith("cue://"_a))
+    else if (startsWith("dvdnav://"_a) || startsWith("bdnav://"_a)
+             || startsWith("bd://"_a) || startsWith("cue://"_a))
         m_loc = location;
     else
         m_loc = QUrl::fromPercentEncoding(location.toUtf8());
@@ -84,8 +85,9 @@ auto Mrl::isEmpty() const -> bool
     return (idx < 0) || !(idx+3 < m_loc.size());
 }
 
+// bd is used to play a title directly without navigation
 static const QStringList discSchemes = QStringList()
-        << u"dvdnav"_q << u"bdnav"_q;
+        << u"dvdnav"_q << u"bdnav"_q << u"bd"_q;
 
 auto Mrl::isDisc() const -> bool
 {
@@ -156,7 +158,10 @@ auto Mrl::toCueTrack() const -> CueTrack
 
 auto Mrl::titleMrl(int title) const -> Mrl
 {
-    auto mrl = fromDisc(scheme(), device(), title, false);
+    auto scheme = this->scheme();
+    if (title < 0 && scheme == "bd"_a) // menu needs navigation
+        scheme = u"bdnav"_q;
+    auto mrl = fromDisc(scheme, device(), title, false);
     mrl.m_hash = m_hash;
     return mrl;
 }
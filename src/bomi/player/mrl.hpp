@@ -21,7 +21,8 @@ public:
         { return m_loc.startsWith(s, Qt::CaseInsensitive); }
     auto isLocalFile() const -> bool { return startsWith("file://"_a); }
     auto isDvd() const -> bool { return startsWith("dvdnav://"_a); }
-    auto isBluray() const -> bool { return startsWith("bdnav://"_a); }
+    auto isBluray() const -> bool
+        { return startsWith("bdnav://"_a) || startsWith("bd://"_a); }
     auto isDisc() const -> bool;
     auto isCueTrack() const -> bool;
     auto isRemoteUrl() const -> bool { return !isLocalFile() && !isDisc(); }
@@ -42,6 +43,7 @@ public:
     auto toUtf8() const -> QByteArray { return m_loc.toUtf8(); }
     auto hash() const -> QByteArray { return m_hash; }
     auto updateHash() -> void;
+    auto setHash(const QByteArray &hash) -> void { m_hash = hash; }
     auto isUnique() const -> bool { return !isDisc() || !m_hash.isEmpty(); }
     auto toUnique() const -> Mrl;
     auto isDir() const -> bool;
@@ -45,6 +45,7 @@ struct CacheInfo {
         { return qBound<qint64>(0, min_seeking_kb, cache * 0.5); }
     Item local, network, disc;
     qint64 file_kb = 1024 * 1024, min_playback_kb = 0, min_seeking_kb = 500;
+    bool timeshift = true; // ring buffer in cache file for live streams
     QStringList remotes;
 };
 
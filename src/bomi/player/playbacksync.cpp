@@ -0,0 +1,457 @@
+#include "playbacksync.hpp"
+#include "playengine.hpp"
+#include "misc/log.hpp"
+#include <QUdpSocket>
+#include <QHostInfo>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+
+DECLARE_LOG_CONTEXT(Sync)
+
+static constexpr quint32 Magic = 0x626d7379; // bmsy
+static constexpr quint8 Version = 2;
+enum PacketType : quint8 { Ping = 1, Pong = 2 };
+
+static constexpr int TickInterval = 50;             // msec
+static constexpr int PingTicks = 2;
+// offset is taken from the sample with shortest round trip among these
+static constexpr int OffsetSamples = 8;
+static constexpr qint64 LeaderTimeout = 2000000;    // usec
+// ratio corrections stay inaudible; larger errors are seeked away
+static constexpr double MaxAdjust = 0.005;
+static constexpr double Kp = 0.1, Ki = 0.01;
+static constexpr double DeadBand = 0.001;           // sec
+static constexpr double SeekThreshold = 0.2, PausedThreshold = 0.02;
+static constexpr qint64 SeekInterval = 3000000, Settle = 1000000;
+static constexpr double Discontinuity = 0.25;
+
+// continuous clock from frame-quantized positions by second-order PLL
+struct MediaClock {
+    bool valid = false;
+    double pos = 0.0, rate = 1.0;
+    qint64 t = 0;
+    auto at(qint64 usec) const -> double { return pos + (usec - t) * 1e-6 * rate; }
+    auto update(qint64 usec, double sample, double nominal) -> void
+    {
+        if (valid) {
+            pos = at(usec);
+            const double e = sample - pos;
+            if (qAbs(e) < Discontinuity) {
+                pos += 0.1 * e;
+                rate = qBound(nominal * 0.95, rate + 0.05 * e, nominal * 1.05);
+            } else
+                valid = false;
+        }
+        if (!valid) {
+            pos = sample;
+            rate = nominal;
+            valid = true;
+        }
+        t = usec;
+    }
+};
+
+struct LeaderClock {
+    qint64 t = 0, received = -1; // leader time of sample, local receive time
+    double pos = 0.0, rate = 0.0;
+    bool playing = false;
+    quint64 media = 0;
+    // position at leader time
+    auto at(qint64 usec) const -> double
+        { return pos + (playing ? (usec - t) * 1e-6 * rate : 0.0); }
+};
+
+struct OffsetSample { qint64 offset = 0, delay = -1; };
+
+// copies of a local file on other machines have other paths, so name and
+// size identify it; anything else is identified by its full location
+SIA mediaId(const Mrl &mrl) -> quint64
+{
+    if (mrl.isEmpty())
+        return 0;
+    QByteArray key;
+    if (mrl.isLocalFile()) {
+        const QFileInfo info(mrl.toLocalFile());
+        key = info.fileName().toUtf8() + '/' + QByteArray::number(info.size());
+    } else
+        key = mrl.toUtf8();
+    const auto hash = QCryptographicHash::hash(key, QCryptographicHash::Md5);
+    quint64 id = 0;
+    memcpy(&id, hash.constData(), sizeof(id));
+    return id ? id : 1;
+}
+
+struct EnginePlayer : public PlaybackSync::Player {
+    EnginePlayer(PlayEngine *engine): engine(engine) { }
+    auto isPlaying() const -> bool final { return engine->isPlaying(); }
+    auto isPaused() const -> bool final { return engine->isPaused(); }
+    auto clockTime() const -> double final { return engine->clockTime(); }
+    auto speed() const -> double final { return engine->speed(); }
+    auto media() const -> quint64 final
+    {
+        const auto mrl = engine->mrl();
+        if (mrl != this->mrl) {
+            this->mrl = mrl;
+            id = mediaId(mrl);
+        }
+        return id;
+    }
+    auto pause() -> void final { engine->pause(); }
+    auto unpause() -> void final { engine->unpause(); }
+    auto seek(int msec) -> void final { engine->seek(msec); }
+    auto setClockRatio(double ratio) -> void final { engine->setClockRatio(ratio); }
+    PlayEngine *engine = nullptr;
+    mutable Mrl mrl;
+    mutable quint64 id = 0;
+};
+
+// host:port, or port alone keeping host as given
+SIA splitAddress(const QString &address, QString *host, quint16 *port) -> bool
+{
+    const int colon = address.lastIndexOf(':'_q);
+    bool ok = false;
+    *port = address.midRef(colon + 1).toUShort(&ok);
+    if (!ok || colon == 0)
+        return false;
+    if (colon > 0)
+        *host = address.left(colon);
+    return !host->isEmpty();
+}
+
+struct PlaybackSync::Data {
+    PlaybackSync *p = nullptr;
+    QScopedPointer<Player> own;
+    Player *player = nullptr;
+    Role role = Off;
+    QUdpSocket socket;
+    int lookup = -1;
+    QTimer timer;
+    QElapsedTimer clock;
+    MediaClock local;
+    bool playing = false;
+
+    QHostAddress host;
+    quint16 port = 0;
+    quint32 seq = 0;
+    int ticks = 0;
+    LeaderClock leader;
+    OffsetSample samples[OffsetSamples];
+    int sampleIndex = 0;
+    qint64 offset = 0, delay = 0; // leader - follower, round trip
+    double integral = 0.0, ratio = 1.0, error = 0.0, seekLead = 0.0;
+    qint64 lastSeek = -SeekInterval, settle = 0;
+    bool seeked = false, mismatch = false;
+
+    qint64 reported = 0;
+    double sumAbs = 0.0, maxAbs = 0.0;
+    int count = 0, seeks = 0;
+    QSet<QString> peers;
+
+    auto now() const -> qint64 { return clock.nsecsElapsed() / 1000; }
+    auto bind(const QHostAddress &address, quint16 port) -> bool
+    {
+        if (socket.bind(address, port))
+            return true;
+        _Error("Cannot open UDP socket on %%:%%: %%", address.toString(),
+               port, socket.errorString());
+        return false;
+    }
+    auto follow(const QHostAddress &leader) -> bool
+    {
+        // answers come from leader only, so listen where they arrive
+        QHostAddress local = QHostAddress::AnyIPv4;
+        if (leader.isLoopback())
+            local = leader;
+        else if (leader.protocol() == QAbstractSocket::IPv6Protocol)
+            local = QHostAddress::AnyIPv6;
+        if (!bind(local, 0))
+            return false;
+        host = leader;
+        role = Follower;
+        timer.start();
+        _Info("Follow playback of %%:%%.", host.toString(), port);
+        return true;
+    }
+    auto setRatio(double r) -> void
+    {
+        // avoid flooding audio chain or mpv with tiny changes
+        if (_Change(ratio, qRound(r * 1e4) * 1e-4))
+            player->setClockRatio(ratio);
+    }
+    auto release() -> void
+    {
+        integral = 0.0;
+        setRatio(1.0);
+    }
+    auto ping(qint64 t) -> void
+    {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << Magic << Version << quint8(Ping) << ++seq << t;
+        socket.writeDatagram(data, host, port);
+    }
+    auto pong(const QHostAddress &from, quint16 port, quint32 seq,
+              qint64 t0, qint64 t1) -> void
+    {
+        const bool valid = local.valid;
+        const qint64 t2 = now();
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << Magic << Version << quint8(Pong) << seq << t0 << t1 << t2
+            << (valid ? local.at(t2) : 0.0) << (playing ? local.rate : 0.0)
+            << (valid && playing) << (valid ? player->media() : quint64(0));
+        socket.writeDatagram(data, from, port);
+        peers.insert(from.toString() % ':'_q % _N(port));
+    }
+    auto addOffset(qint64 offset, qint64 delay) -> void
+    {
+        samples[sampleIndex] = { offset, delay };
+        sampleIndex = (sampleIndex + 1) % OffsetSamples;
+        const OffsetSample *best = nullptr;
+        for (auto &s : samples) {
+            if (s.delay >= 0 && (!best || s.delay < best->delay))
+                best = &s;
+        }
+        this->offset = best->offset;
+        this->delay = best->delay;
+    }
+    auto control(qint64 t, bool running) -> void
+    {
+        if (++ticks >= PingTicks) {
+            ticks = 0;
+            ping(t);
+        }
+        if (leader.received < 0 || t - leader.received > LeaderTimeout
+                || !running || !leader.media) {
+            release();
+            return;
+        }
+        if (_Change(mismatch, leader.media != player->media())) {
+            if (mismatch)
+                _Warn("Leader plays other media. Stop following until it plays same one.");
+        }
+        if (mismatch) {
+            release();
+            return;
+        }
+        if (t < settle)
+            return;
+        if (leader.playing != playing) {
+            if (leader.playing)
+                player->unpause();
+            else
+                player->pause();
+            settle = t + Settle / 2;
+            release();
+            return;
+        }
+        const double target = leader.at(t + offset);
+        const double e = local.at(t) - target;
+        if (seeked) {
+            // learn how long seeking takes to land where leader will be
+            if (leader.playing)
+                seekLead = qBound(0.0, seekLead - e, 2.0);
+            seeked = false;
+        }
+        const double threshold = leader.playing ? SeekThreshold : PausedThreshold;
+        if (qAbs(e) > threshold) {
+            if (leader.playing && t - lastSeek < SeekInterval)
+                return;
+            _Debug("Seek to catch up %%ms.", e * 1e3);
+            player->seek(qRound((target + (leader.playing ? seekLead : 0.0)) * 1e3));
+            lastSeek = t;
+            settle = t + Settle;
+            seeked = true;
+            local.valid = false;
+            ++seeks;
+            release();
+            return;
+        }
+        error = e;
+        sumAbs += qAbs(e);
+        maxAbs = qMax(maxAbs, qAbs(e));
+        ++count;
+        emit p->errorChanged(e * 1e3);
+        if (!leader.playing)
+            return;
+        integral = qBound(-MaxAdjust, integral + Ki * e * TickInterval * 1e-3, MaxAdjust);
+        const double adjust = qAbs(e) < DeadBand ? integral : Kp * e + integral;
+        setRatio(1.0 - qBound(-MaxAdjust, adjust, MaxAdjust));
+    }
+    auto report(qint64 t) -> void
+    {
+        if (role == Leader) {
+            if (t - reported < 10000000)
+                return;
+            if (!peers.isEmpty())
+                _Info("Answered %% follower(s): %%", peers.size(), QStringList(peers.toList()).join(u", "_q));
+            peers.clear();
+        } else {
+            if (t - reported < 1000000)
+                return;
+            if (count > 0)
+                _Info("Error: avg %%ms, max %%ms, offset %%ms, rtt %%ms, ratio %%, seeks %%",
+                      sumAbs / count * 1e3, maxAbs * 1e3, offset * 1e-3, delay * 1e-3, ratio, seeks);
+            sumAbs = maxAbs = 0.0;
+            count = seeks = 0;
+        }
+        reported = t;
+    }
+};
+
+PlaybackSync::PlaybackSync(PlayEngine *engine, QObject *parent)
+    : PlaybackSync(new EnginePlayer(engine), parent)
+{
+    d->own.reset(d->player);
+}
+
+PlaybackSync::PlaybackSync(Player *player, QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->p = this;
+    d->player = player;
+    d->clock.start();
+    d->timer.setInterval(TickInterval);
+    d->timer.setTimerType(Qt::PreciseTimer);
+    connect(&d->timer, &QTimer::timeout, this, &PlaybackSync::tick);
+    connect(&d->socket, &QUdpSocket::readyRead, this, &PlaybackSync::receive);
+}
+
+PlaybackSync::~PlaybackSync()
+{
+    stop();
+    delete d;
+}
+
+auto PlaybackSync::role() const -> Role
+{
+    return d->role;
+}
+
+auto PlaybackSync::error() const -> double
+{
+    return d->error * 1e3;
+}
+
+auto PlaybackSync::port() const -> quint16
+{
+    return d->socket.localPort();
+}
+
+auto PlaybackSync::delay() const -> double
+{
+    return d->delay * 1e-3;
+}
+
+auto PlaybackSync::stop() -> void
+{
+    d->timer.stop();
+    if (d->lookup >= 0)
+        QHostInfo::abortHostLookup(d->lookup);
+    d->lookup = -1;
+    d->socket.close();
+    if (d->role == Follower)
+        d->release();
+    d->role = Off;
+    d->leader = LeaderClock();
+    for (auto &s : d->samples)
+        s = OffsetSample();
+}
+
+auto PlaybackSync::lead(const QString &address) -> bool
+{
+    stop();
+    QString name = u"127.0.0.1"_q;
+    quint16 port = 0;
+    const QHostAddress host(splitAddress(address, &name, &port) ? name : QString());
+    if (host.isNull()) {
+        _Error("Invalid address '%%' to lead. Use port alone or ip:port.", address);
+        return false;
+    }
+    if (!d->bind(host, port))
+        return false;
+    d->role = Leader;
+    d->timer.start();
+    _Info("Lead playback on %%:%%.", host.toString(), d->socket.localPort());
+    return true;
+}
+
+auto PlaybackSync::follow(const QString &address) -> bool
+{
+    stop();
+    QString name;
+    if (!splitAddress(address, &name, &d->port)) {
+        _Error("Invalid leader address '%%'. Use host:port.", address);
+        return false;
+    }
+    const QHostAddress host(name);
+    if (host.isNull()) {
+        d->lookup = QHostInfo::lookupHost(name, this, SLOT(resolve(QHostInfo)));
+        return true;
+    }
+    return d->follow(host);
+}
+
+void PlaybackSync::resolve(const QHostInfo &info)
+{
+    if (info.lookupId() != d->lookup)
+        return;
+    d->lookup = -1;
+    if (info.addresses().isEmpty()) {
+        _Error("Cannot resolve leader host '%%'.", info.hostName());
+        return;
+    }
+    // leader listens on IPv4 loopback unless told otherwise
+    const auto addresses = info.addresses();
+    auto it = std::find_if(addresses.begin(), addresses.end(), [] (const QHostAddress &a)
+        { return a.protocol() == QAbstractSocket::IPv4Protocol; });
+    d->follow(it != addresses.end() ? *it : addresses.first());
+}
+
+auto PlaybackSync::receive() -> void
+{
+    while (d->socket.hasPendingDatagrams()) {
+        QByteArray data(d->socket.pendingDatagramSize(), 0);
+        QHostAddress from;
+        quint16 port = 0;
+        d->socket.readDatagram(data.data(), data.size(), &from, &port);
+        const auto t = d->now();
+        QDataStream in(data);
+        quint32 magic = 0, seq = 0;
+        quint8 version = 0, type = 0;
+        qint64 t0 = 0;
+        in >> magic >> version >> type >> seq >> t0;
+        if (in.status() != QDataStream::Ok || magic != Magic || version != Version)
+            continue;
+        if (type == Ping && d->role == Leader) {
+            d->pong(from, port, seq, t0, t);
+        } else if (type == Pong && d->role == Follower) {
+            qint64 t1 = 0, t2 = 0;
+            LeaderClock leader;
+            in >> t1 >> t2 >> leader.pos >> leader.rate >> leader.playing >> leader.media;
+            const qint64 delay = (t - t0) - (t2 - t1);
+            if (in.status() != QDataStream::Ok || delay < 0)
+                continue;
+            d->addOffset(((t1 - t0) + (t2 - t)) / 2, delay);
+            leader.t = t2;
+            leader.received = t;
+            d->leader = leader;
+        }
+    }
+}
+
+auto PlaybackSync::tick() -> void
+{
+    const auto t = d->now();
+    const bool playing = d->player->isPlaying();
+    const bool running = playing || d->player->isPaused();
+    if (_Change(d->playing, playing))
+        d->local.valid = false;
+    if (running)
+        d->local.update(t, d->player->clockTime(), playing ? d->player->speed() : 0.0);
+    else
+        d->local.valid = false;
+    if (d->role == Follower)
+        d->control(t, running && d->local.valid);
+    d->report(t);
+}
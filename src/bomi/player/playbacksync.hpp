@@ -0,0 +1,56 @@
+#ifndef PLAYBACKSYNC_HPP
+#define PLAYBACKSYNC_HPP
+
+class PlayEngine;                       class QHostInfo;
+
+// keeps playback of several instances in lockstep over UDP;
+// leader answers clock requests and followers estimate clock offset
+// NTP-style and correct drift by playing slightly faster or slower
+class PlaybackSync : public QObject {
+    Q_OBJECT
+public:
+    // playback under control: engine in application, simulated in self-test
+    struct Player {
+        virtual ~Player() { }
+        virtual auto isPlaying() const -> bool = 0;
+        virtual auto isPaused() const -> bool = 0;
+        // media position in sec
+        virtual auto clockTime() const -> double = 0;
+        virtual auto speed() const -> double = 0;
+        // same for same media on other machines and 0 for nothing
+        virtual auto media() const -> quint64 = 0;
+        virtual auto pause() -> void = 0;
+        virtual auto unpause() -> void = 0;
+        virtual auto seek(int msec) -> void = 0;
+        virtual auto setClockRatio(double ratio) -> void = 0;
+    };
+    enum Role { Off, Leader, Follower };
+    PlaybackSync(PlayEngine *engine, QObject *parent = nullptr);
+    // player is not owned
+    PlaybackSync(Player *player, QObject *parent = nullptr);
+    ~PlaybackSync();
+    // address:port to listen on or port alone for loopback
+    auto lead(const QString &address) -> bool;
+    // host:port of leader; host name is resolved in background and
+    // role becomes Follower after that
+    auto follow(const QString &address) -> bool;
+    auto stop() -> void;
+    auto role() const -> Role;
+    // local UDP port
+    auto port() const -> quint16;
+    // follower ahead of leader in msec, smoothed
+    auto error() const -> double;
+    // round trip time to leader in msec
+    auto delay() const -> double;
+signals:
+    void errorChanged(double error);
+private slots:
+    void resolve(const QHostInfo &info);
+private:
+    auto receive() -> void;
+    auto tick() -> void;
+    struct Data;
+    Data *d;
+};
+
+#endif // PLAYBACKSYNC_HPP
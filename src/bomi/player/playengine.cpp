@@ -3,6 +3,8 @@
 #include "app.hpp"
 #include "audio/audionormalizeroption.hpp"
 #include "subtitle/subtitlemodel.hpp"
+#include "subtitle/subtitlerenderingthread.hpp"
+#include "audio/visualizer.hpp"
 #include "os/os.hpp"
 #include "videosettings.hpp"
 #include <QQuickWindow>
@@ -18,8 +20,27 @@ PlayEngine::PlayEngine()
     d->vr->setOverlay(d->sr);
     d->vr->setRenderFrameFunction([this] (Fbo *frame, Fbo* osd, const QMargins &m)
         { d->renderVideoFrame(frame, osd, m); });
+    d->sr->setFrameTimeFunction([this] (int *ms) {
+        double pts = 0.0;
+        if (!d->mpv.framePts(true, &pts))
+            return false;
+        *ms = s2ms(pts) - d->t.offset;
+        return true;
+    });
+    connect(d->vr, &VideoRenderer::frameQueued, d->sr, &SubtitleRenderer::syncToFrame);
     d->updateVideoRendererFboFormat();
     d->info.video.setScreen(d->vr);
+    d->swapClock.start();
+    d->pacer.setRatioCallback([=] (double ratio) { d->ac->setSyncRatio(ratio); });
+    d->cacheMemory.setReclaim([=] (qint64 excess) -> qint64 {
+        // shrinking takes effect immediately; next file gets full size again
+        const qint64 size = d->info.cache.size() * 1024LL;
+        const qint64 target = qMax(size / 4, size - excess);
+        if (target >= size)
+            return 0;
+        d->mpv.setAsync("cache-size", int(target / 1024));
+        return size - target;
+    });
 
     d->params.m_mutex = &d->mutex;
 
@@ -60,6 +81,7 @@ PlayEngine::PlayEngine()
     connect(&d->params, &MrlState::audio_volume_changed, this, &PlayEngine::volumeChanged);
     connect(&d->params, &MrlState::audio_muted_changed, this, &PlayEngine::mutedChanged);
     connect(&d->params, &MrlState::play_speed_changed, this, &PlayEngine::speedChanged);
+    connect(&d->params, &MrlState::play_speed_changed, this, [=] () { d->updateFramePacer(); });
     connect(&d->params, &MrlState::audio_tracks_changed, this,
             [=] (StreamList list) { d->info.audio.setTracks(list); });
 //    connect(&d->params, &MrlState::audio_volume_normalizer_changed,
@@ -139,7 +161,7 @@ PlayEngine::PlayEngine()
             d->mpv.setAsync("pause", false);
             d->mpv.setAsync("speed", 100.0);
         } else {
-            d->mpv.setAsync("speed", d->params.play_speed());
+            d->mpv.setAsync("speed", d->params.play_speed() * d->speedRatio);
             d->mpv.setAsync("pause", d->pauseAfterSkip);
             d->mpv.setAsync("mute", d->params.audio_muted());
         }
@@ -149,6 +171,8 @@ PlayEngine::PlayEngine()
     connect(d->vp, &VideoProcessor::seekRequested, this, &PlayEngine::seek);
     connect(d->vp, &VideoProcessor::fpsManimulated, &d->info.video,
             &VideoObject::setFpsManimulation, Qt::QueuedConnection);
+    connect(d->vp, &VideoProcessor::fpsManimulated, this, [=] (double fps)
+        { d->fpsScale = fps; d->updateFramePacer(); }, Qt::QueuedConnection);
     connect(d->vp, &VideoProcessor::hwdecChanged, this, [=] (const QString &api)
     {
         auto &video = d->info.video;
@@ -195,6 +219,13 @@ PlayEngine::PlayEngine()
         d->info.video.decoder()->setBitrate(d->mpv.get<int>("video-bitrate"));
         d->info.video.setDelayedFrames(d->info.delayed);
         d->info.video.setDroppedFrames(d->mpv.get<int64_t>("vo-drop-frame-count"));
+        if (d->live.isActive() && d->live.check(d->mpv.get<double>("demuxer-cache-duration"),
+                                                d->info.video.decoder()->fps()))
+            d->mpv.tellAsync("drop-buffers");
+        if (++d->tuneTicks >= 20) {
+            d->tuneTicks = 0;
+            d->tuneDecoder();
+        }
     });
     connect(d->info.video.output(), &VideoFormatObject::sizeChanged,
             d->preview, &VideoPreview::setSizeHint);
@@ -278,6 +309,11 @@ auto PlayEngine::initializeGL(const QQuickWindow *w, QOpenGLContext *ctx) -> voi
     d->mpv.initializeGL(ctx);
     connect(w, &QQuickWindow::frameSwapped,
             &d->mpv, &Mpv::frameSwapped, Qt::DirectConnection);
+    connect(w, &QQuickWindow::frameSwapped, this, [=] () {
+        d->pacer.frameSwapped(d->swapClock.nsecsElapsed() / 1000, d->frames.pending);
+        d->frames.pending = false;
+        d->live.swapped();
+    }, Qt::DirectConnection);
 }
 
 auto PlayEngine::finalizeGL(QOpenGLContext */*ctx*/) -> void
@@ -458,6 +494,39 @@ auto PlayEngine::setAudioTrackSelected(int id, bool s) -> void
         d->mpv.setAsync("aid", -1);
 }
 
+auto PlayEngine::setAudioMixTrack(int id) -> void
+{
+    d->mutex.lock();
+    const auto tracks = d->params.audio_tracks();
+    d->mutex.unlock();
+    const auto track = tracks.track(id);
+    QString file; int stream = -1;
+    if (track && !track->isSelected()) {
+        if (track->isExternal())
+            file = track->file();
+        else if (track->ffIndex() >= 0) {
+            // discs cannot be opened by libavformat directly
+            if (!d->mrl.isDisc())
+                file = d->mrl.isLocalFile() ? d->mrl.toLocalFile() : d->mrl.toString();
+            stream = track->ffIndex();
+        }
+    }
+    if (file.isEmpty())
+        id = -1;
+    if (!_Change(d->mixTrack, id))
+        return;
+    // external file starts with main stream as mpv does
+    const double offset = stream < 0 ? d->mpv.get<double>("time-start") : 0.0;
+    d->ac->setMixTrack(file, stream, offset);
+    if (id != -1)
+        _Info("Mix audio track %% over selected one.", id);
+}
+
+auto PlayEngine::audioMixTrack() const -> int
+{
+    return d->mixTrack;
+}
+
 auto PlayEngine::run() -> void
 {
     d->mpv.start();
@@ -477,7 +546,24 @@ auto PlayEngine::speed() const -> double
 auto PlayEngine::setSpeed(double s) -> void
 {
     if (d->params.set_play_speed(s))
-        d->mpv.setAsync("speed", speed());
+        d->mpv.setAsync("speed", speed() * d->speedRatio);
+}
+
+auto PlayEngine::clockTime() const -> double
+{
+    double pts = 0.0;
+    if (!d->hasVideo || !d->mpv.framePts(false, &pts))
+        pts = d->mpv.get<double>("time-pos");
+    return pts - d->t.offset * 1e-3;
+}
+
+auto PlayEngine::setClockRatio(double ratio) -> void
+{
+    // audio is master clock if exists and resampling is smoother than speed
+    const bool audio = d->params.audio_tracks().selectionId() >= 0;
+    d->ac->setClockRatio(audio ? ratio : 1.0);
+    if (_Change(d->speedRatio, audio ? 1.0 : ratio))
+        d->mpv.setAsync("speed", speed() * d->speedRatio);
 }
 
 auto PlayEngine::setSubtitleScale(double by) -> void
@@ -584,12 +670,32 @@ auto PlayEngine::setHwAcc_locked(bool use, const QList<CodecId> &codecs) -> void
 {
     d->hwdec = use;
     d->hwCodecs = codecs;
+    d->updateHwdecCodecs();
+}
 
+auto PlayEngine::setLowPowerHwAcc_locked(bool use) -> void
+{
+    d->lowPowerHwdec = use;
+    d->updateHwdecCodecs();
+}
+
+auto PlayEngine::Data::updateHwdecCodecs() -> void
+{
+    // low power turns on hardware decoding only if user allowed it
+    const bool forced = !hwdec && lowPower && lowPowerHwdec;
+    auto codecs = hwCodecs;
+    if (forced && OS::hwAcc()->isAvailable()) {
+        codecs.clear();
+        for (auto c : OS::HwAcc::fullCodecList()) {
+            if (OS::hwAcc()->supports(c))
+                codecs.push_back(c);
+        }
+    }
     QByteArray hwcdc;
     for (auto c : codecs)
         hwcdc += _EnumData(c).toLatin1() + ',';
     hwcdc.chop(1);
-    d->mpv.setAsync("options/hwdec-codecs", use ? hwcdc : ""_b);
+    mpv.setAsync("options/hwdec-codecs", hwdec || forced ? hwcdc : ""_b);
 }
 
 auto PlayEngine::avSync() const -> int
@@ -657,8 +763,16 @@ auto PlayEngine::seekChapter(int number) -> void
 auto PlayEngine::seekEdition(int number, int from) -> void
 {
     const auto mrl = d->mrl;
-    if (number == DVDMenu && mrl.isDisc())
-        d->mpv.tellAsync("discnav", "menu"_b);
+    if (number == DVDMenu && mrl.isDisc()) {
+        d->mutex.lock();
+        const bool direct = d->discDirect;
+        d->discMenu = direct;
+        d->mutex.unlock();
+        if (direct) // title was opened without navigation
+            d->loadfile(mrl, false, QString());
+        else
+            d->mpv.tellAsync("discnav", "menu"_b);
+    }
     else if (0 <= number && number < d->info.editions.size()) {
         d->mpv.setAsync(mrl.isDisc() ? "disc-title"_b : "edition"_b, number);
         seek(from);
@@ -704,6 +818,62 @@ auto PlayEngine::setResume_locked(bool resume) -> void
     d->resume = resume;
 }
 
+auto PlayEngine::setLowPower(bool on) -> void
+{
+    if (!_Change(d->lowPower, on))
+        return;
+    d->ac->visualizer()->setUpdateInterval(on ? 500 : 100);
+    d->vp->setScanStride(on ? 4 : 1);
+    SubCompSelection::setPrefetchEnabled(!on);
+    const int threads = on ? qMin(2, QThread::idealThreadCount()) : 0;
+    d->mpv.setAsync("options/vd-lavc-threads", threads);
+    d->tuner.setMaximum(on ? 2 : 16);
+    d->updateHwdecCodecs();
+    if (d->params.video_motion_interpolation()) {
+        d->mpv.tellAsync("vf", "set"_b, d->vf(&d->params));
+        d->updateVideoSubOptions();
+    }
+    _Info("Low power mode: %%", on ? u"on"_q : u"off"_q);
+}
+
+auto PlayEngine::isLowPower() const -> bool
+{
+    return d->lowPower;
+}
+
+auto PlayEngine::setFramePacing_locked(bool on) -> void
+{
+    d->pacer.setDisplayRate(OS::refreshRate());
+    d->pacer.setActive(on);
+    if (!on)
+        d->ac->setSyncRatio(1.0);
+}
+
+auto PlayEngine::setAutoDecoderThreads_locked(bool on) -> void
+{
+    d->tuner.setEnabled(on);
+}
+
+auto PlayEngine::setAdaptiveProbe_locked(bool on) -> void
+{
+    d->prober.setEnabled(on);
+}
+
+auto PlayEngine::setLowLatencyLive_locked(bool on) -> void
+{
+    d->live.setEnabled(on);
+}
+
+auto PlayEngine::setLatencyProbe(bool on) -> void
+{
+    d->live.setProbing(on);
+}
+
+auto PlayEngine::latencyStats() const -> LiveLatencyStats
+{
+    return d->live.stats();
+}
+
 auto PlayEngine::setPreciseSeeking_locked(bool on) -> void
 {
     if (_Change(d->preciseSeeking, on))
@@ -34,6 +34,7 @@ struct Autoloader;                      struct CacheInfo;
 struct IntrplParamSet;                  struct MotionIntrplOption;
 class AudioVisualizer;                  class QQuickWindow;
 class VideoSettings;                    class IntrplParamSetMap;
+struct LiveLatencyStats;
 
 struct StringPair { QString s1, s2; };
 
@@ -56,8 +57,8 @@ class PlayEngine : public QObject {
     Q_PROPERTY(int begin READ begin NOTIFY beginChanged)
     Q_PROPERTY(int end READ end NOTIFY endChanged)
     Q_PROPERTY(int duration READ duration NOTIFY durationChanged)
-    Q_PROPERTY(int time READ time WRITE seek NOTIFY tick)
-    Q_PROPERTY(qreal rate READ rate WRITE setRate NOTIFY tick)
+    Q_PROPERTY(int time READ time WRITE seek NOTIFY timeChanged)
+    Q_PROPERTY(qreal rate READ rate WRITE setRate NOTIFY timeChanged)
 
     Q_PROPERTY(int begin_s READ begin_s NOTIFY begin_sChanged)
     Q_PROPERTY(int end_s READ end_s NOTIFY end_sChanged)
@@ -112,6 +113,13 @@ public:
     auto isStopped() const -> bool {return state() & Stopped;}
     auto isRunning() const -> bool { return state() & Running; }
     auto speed() const -> double;
+    // position in sec of presented frame, finer than time() for sync
+    auto clockTime() const -> double;
+    // play ratio times faster to follow another clock without changing speed
+    auto setClockRatio(double ratio) -> void;
+    // decode timestamped test pattern from rendered frames of live sources
+    auto setLatencyProbe(bool on) -> void;
+    auto latencyStats() const -> LiveLatencyStats;
     auto state() const -> State;
     auto load(const Mrl &mrl, bool tryResume = true, const QString &sub = QString()) -> void;
     auto setMrl(const Mrl &mrl) -> void;
@@ -148,9 +156,13 @@ public:
 
     auto clearAllSubtitleSelection() -> void;
     auto setTrackSelected(StreamType type, int id, bool s) -> void;
+    // mix audio track of id over selected one, -1 to stop mixing
+    auto setAudioMixTrack(int id) -> void;
+    auto audioMixTrack() const -> int;
 
     auto lock() -> void;
     auto setHwAcc_locked(bool use, const QList<CodecId> &codecs) -> void;
+    auto setLowPowerHwAcc_locked(bool use) -> void;
     auto setSubtitleStyle_locked(const OsdStyle &style) -> void;
     auto setAutoselectMode_locked(bool enable, AutoselectMode mode,
                                   const QString &ext, bool preferExternal) -> void;
@@ -165,6 +177,10 @@ public:
     auto setAutoloader_locked(const Autoloader &audio, const Autoloader &sub) -> void;
     auto setResume_locked(bool resume) -> void;
     auto setPreciseSeeking_locked(bool on) -> void;
+    auto setFramePacing_locked(bool on) -> void;
+    auto setAutoDecoderThreads_locked(bool on) -> void;
+    auto setAdaptiveProbe_locked(bool on) -> void;
+    auto setLowLatencyLive_locked(bool on) -> void;
     auto setResyncAvWhenFilterToggled_locked(bool on) -> void;
     auto setMotionIntrplOption_locked(const MotionIntrplOption &option) -> void;
     auto unlock() -> void;
@@ -278,6 +294,8 @@ public:
     auto setChromaUpscaler(const IntrplParamSet &params) -> void;
     auto setChromaUpscalerMap(const IntrplParamSetMap &map) -> void;
     auto setMotionInterpolation(bool on) -> void;
+    auto setLowPower(bool on) -> void;
+    auto isLowPower() const -> bool;
     auto setVideoDithering(Dithering dithering) -> void;
     auto setVideoEffects(VideoEffects effects) -> void;
     auto setVideoRotation(Rotation r) -> void;
@@ -308,6 +326,8 @@ signals:
     void started(Mrl mrl);
     void finished(Mrl mrl, bool eof);
     void tick(int pos);
+    // batched tick for bindings
+    void timeChanged();
     void mrlChanged(const Mrl &mrl);
     void stateChanged(PlayEngine::State state);
     void seekableChanged(bool seekable);
@@ -54,8 +54,9 @@ auto PlayEngine::Data::af(const MrlState *s) const -> QByteArray
 {
     OptionList af(':');
     af.add("dummy:address"_b, ac);
-    af.add("use_scaler"_b, (int)s->audio_tempo_scaler());
-    af.add("use_normalizer"_b, (int)s->audio_volume_normalizer());
+    // both stages hold audio back while live sources need it out at once
+    af.add("use_scaler"_b, (int)(s->audio_tempo_scaler() && !live.isActive()));
+    af.add("use_normalizer"_b, (int)(s->audio_volume_normalizer() && !live.isActive()));
     af.add("layout"_b, (int)s->audio_channel_layout());
     return af.get();
 }
@@ -66,7 +67,7 @@ auto PlayEngine::Data::vf(const MrlState *s) const -> QByteArray
     vf.add("noformat:address"_b, vp);
     vf.add("swdec_deint"_b, s->d->deint.swdec.toString().toLatin1());
     vf.add("hwdec_deint"_b, s->d->deint.hwdec.toString().toLatin1());
-    vf.add("interpolate"_b, (int)s->video_motion_interpolation());
+    vf.add("interpolate"_b, (int)interpolates(s));
     vf.add("color_space"_b, (int)s->video_space());
     vf.add("color_range"_b, (int)s->video_range());
     return vf.get();
@@ -78,6 +79,7 @@ auto PlayEngine::Data::vo(const MrlState *s) const -> QByteArray
 }
 
 #include "misc/json.hpp"
+#include "quick/propertybatch.hpp"
 
 auto PlayEngine::Data::videoSubOptions(const MrlState *s) const -> QByteArray
 {
@@ -130,11 +132,11 @@ auto PlayEngine::Data::videoSubOptions(const MrlState *s) const -> QByteArray
         opts.add("dscale", s->d->intrplDown[s->video_interpolator_down()].toMpvOption("dscale"));
     opts.add("dither-depth", "auto"_b);
     opts.add("dither", _EnumData(s->video_dithering()));
-    opts.add("frame-queue-size", s->video_motion_interpolation() || vp->isSkipping() ? 1 : 3);
-    opts.add("frame-drop-mode", s->video_motion_interpolation() ? "block"_b : "clear"_b);
+    opts.add("frame-queue-size", interpolates(s) || vp->isSkipping() || live.isActive() ? 1 : 3);
+    opts.add("frame-drop-mode", interpolates(s) ? "block"_b : "clear"_b);
     opts.add("fancy-downscaling", s->video_hq_downscaling());
     opts.add("sigmoid-upscaling", s->video_hq_upscaling() && OGL::is16bitFramebufferFormatSupported());
-    opts.add("interpolation", s->video_motion_interpolation());
+    opts.add("interpolation", interpolates(s));
     const bool rgba16 = vr->framebufferObjectFormat() == OGL::RGBA16_UNorm;
     opts.add("fbo-format", rgba16 ? "rgba16"_b : "rgba"_b);
     const auto cmat = c_matrix();
@@ -171,6 +173,13 @@ auto PlayEngine::Data::loadfile(const Mrl &mrl, bool resume, const QString &sub)
     QString file = mrl.isLocalFile() ? mrl.toLocalFile() : mrl.toString();
     if (file.isEmpty())
         return;
+    mutex.lock();
+    discHash = mrl.hash();
+    mutex.unlock();
+    if (mixTrack != -1) {
+        mixTrack = -1;
+        ac->setMixTrack(QString(), -1, 0.0);
+    }
     OptionList opts;
     opts.add("pause"_b, p->isPaused() || hasImage);
     opts.add("resume-playback", resume);
@@ -197,6 +206,7 @@ auto PlayEngine::Data::updateMediaName(const QString &name) -> void
 }
 
 static constexpr const auto QCI = Qt::CaseInsensitive;
+static constexpr const qint64 MinCacheKb = 8 * 1024;
 
 auto PlayEngine::Data::onLoad() -> void
 {
@@ -211,6 +221,8 @@ auto PlayEngine::Data::onLoad() -> void
     Mrl mrl(file);
     local->set_mrl(mrl.toUnique());
     local->d->disc = mrl.isDisc();
+    // before vo and af are set since the profile changes both
+    const bool lowLatency = live.start(file.data);
 
     mutex.lock();
     auto reload = this->reload;
@@ -342,7 +354,7 @@ auto PlayEngine::Data::onLoad() -> void
         start = -1;
 
     const auto deint = local->video_deinterlacing() != DeintMode::None;
-    mpv.setAsync("speed", local->play_speed());
+    mpv.setAsync("speed", local->play_speed() * speedRatio);
     mpv.setAsync("video-rotate", _EnumData(local->video_rotation()));
 
     mpv.setAsync("options/vo", vo(local));
@@ -360,14 +372,29 @@ auto PlayEngine::Data::onLoad() -> void
     mpv.setAsync("options/sub-delay", local->sub_sync() * 1e-3);
 
     const auto cache = local->d->cache.get(mrl);
-    t.caching = cache.kb > 0LL;
+    qint64 kb = cache.kb;
+    if (kb > 0 && !lowLatency) {
+        // memory budget is a hard ceiling: shrink to what is left in it and
+        // give up caching if that is too small to be usable
+        kb = MemoryGovernor::instance().allowance(&cacheMemory, kb * 1024) / 1024;
+        if (kb < qMin<qint64>(cache.kb, MinCacheKb)) {
+            _Info("Cache is disabled by memory budget");
+            kb = 0;
+        } else if (kb < cache.kb)
+            _Info("Cache is limited to %%KiB by memory budget", kb);
+    }
+    t.caching = kb > 0 && !lowLatency;
+    t.timeshift = t.caching && cache.file && local->d->cache.timeshift;
+    t.shift.clear();
+    t.shift.setRingSize(local->d->cache.file_kb * 1024);
     if (t.caching) {
-        mpv.setAsync("file-local-options/cache", cache.kb);
-        mpv.setAsync("file-local-options/cache-initial", local->d->cache.playback_kb(cache.kb));
-        mpv.setAsync("file-local-options/cache-seek-min", local->d->cache.seeking_kb(cache.kb));
+        mpv.setAsync("file-local-options/cache", kb);
+        mpv.setAsync("file-local-options/cache-initial", local->d->cache.playback_kb(kb));
+        mpv.setAsync("file-local-options/cache-seek-min", local->d->cache.seeking_kb(kb));
         mpv.setAsync("file-local-options/cache-secs", cache.sec);
         mpv.setAsync("file-local-options/cache-file", cache.file ? "TMP"_b : ""_b);
         mpv.setAsync("file-local-options/cache-file-size", local->d->cache.file_kb);
+        mpv.setAsync("file-local-options/cache-file-ring", t.timeshift ? "yes"_b : "no"_b);
     } else
         mpv.setAsync("file-local-options/cache", "no"_b);
 
@@ -426,7 +453,27 @@ auto PlayEngine::Data::onLoad() -> void
         ytResult.clear();
 
     if (local->d->disc) {
-        file = mrl.titleMrl(edition >= 0 ? edition : -1).toString();
+        mutex.lock();
+        const auto hash = discHash;
+        const bool menu = discMenu;
+        discMenu = false;
+        mutex.unlock();
+        auto disc = mrl.titleMrl(edition >= 0 ? edition : -1);
+        const auto cached = discs.find(hash);
+        if (cached.isEmpty()) {
+            Mrl unique = disc;
+            unique.setHash(hash);
+            discs.analyze(unique);
+        } else if (edition < 0 && !menu && cached.main >= 0) {
+            // analyzed before: skip menu and long title scanning
+            _Info("Start main title %% of analyzed disc", cached.main);
+            disc = Mrl::fromDisc(mrl.isDvd() ? u"dvdnav"_q : u"bd"_q,
+                                 mrl.device(), cached.main, false);
+        }
+        mutex.lock();
+        discDirect = disc.startsWith("bd://"_a);
+        mutex.unlock();
+        file = disc.toString();
         t.start = start;
     } else {
         if (edition >= 0)
@@ -438,6 +485,18 @@ auto PlayEngine::Data::onLoad() -> void
         t.start = -1;
     }
 
+    // live profile probes minimally by itself
+    const auto probe = prober.start(lowLatency ? QString() : file.data);
+    if (probe.isTuned()) {
+        mpv.setAsync("file-local-options/demuxer-lavf-probesize", probe.size);
+        mpv.setAsync("file-local-options/demuxer-lavf-analyzeduration", probe.duration);
+    }
+    if (lowLatency) {
+        for (auto &option : LiveLatency::options())
+            mpv.setAsync("file-local-options/" + option.first, option.second);
+    }
+    openClock.start();
+
     mpv.setAsync("stream-open-filename", file.toMpv());
     mpv.flush();
     _PostEvent(p, SyncMrlState, t.local, loads, ytResult);
@@ -450,6 +509,7 @@ auto PlayEngine::Data::onLoad() -> void
 
 auto PlayEngine::Data::onUnload() -> void
 {
+    tuner.stop();
     t.local = localCopy();
     t.local->set_name(mpv.get<MpvUtf8>("media-title").data);
     t.local->set_resume_position(time);
@@ -457,10 +517,72 @@ auto PlayEngine::Data::onUnload() -> void
     t.local->set_edition(info.edition.number());
 }
 
+auto PlayEngine::Data::onPreloaded() -> void
+{
+    const auto tracks = mpv.get<QVariant>("track-list").toList();
+    // live profile decodes with a single thread
+    if (!checkProbe(tracks) || !tuner.isEnabled() || live.isActive())
+        return;
+    for (auto &var : tracks) {
+        const auto track = var.toMap();
+        if (track[u"type"_q].toString() != "video"_a || !track[u"selected"_q].toBool()
+                || track[u"albumart"_q].toBool())
+            continue;
+        const QSize size(track[u"demux-w"_q].toInt(), track[u"demux-h"_q].toInt());
+        const int threads = tuner.start(track[u"codec"_q].toString(), size,
+                                        track[u"demux-fps"_q].toDouble());
+        if (threads > 0) {
+            mpv.setAsync("file-local-options/vd-lavc-threads", threads);
+            mpv.flush();
+        }
+        break;
+    }
+}
+
+auto PlayEngine::Data::checkProbe(const QVariantList &tracks) -> bool
+{
+    if (!prober.isActive())
+        return true;
+    ProbeOutcome outcome;
+    outcome.format = mpv.get<MpvLatin1>("file-format").data;
+    outcome.bytes = mpv.get<qint64>("demuxer-probe-bytes");
+    for (auto &var : tracks) {
+        const auto track = var.toMap();
+        if (track[u"external"_q].toBool() || track[u"albumart"_q].toBool())
+            continue;
+        const auto type = track[u"type"_q].toString();
+        const auto codec = track[u"codec"_q].toString();
+        outcome.streams.push_back(type % ':'_q % codec);
+        if (codec.isEmpty()
+                || (type == "video"_a && track[u"demux-w"_q].toInt() <= 0)
+                || (type == "audio"_a && (track[u"demux-samplerate"_q].toInt() <= 0
+                                         || track[u"demux-channels"_q].toInt() <= 0)))
+            outcome.complete = false;
+    }
+    if (prober.finish(outcome, openClock.elapsed()))
+        return true;
+    // parameters are missing; decoders would fail or guess
+    _PostEvent(p, ReopenSource);
+    return false;
+}
+
+auto PlayEngine::Data::tuneDecoder() -> void
+{
+    if (tuner.threads() <= 0 || !vp->hwdec().isEmpty())
+        return;
+    const auto dropped = mpv.get<qint64>("drop-frame-count")
+                         + mpv.get<qint64>("vo-drop-frame-count");
+    const int threads = tuner.update(mpv.get<double>("decoder-time"),
+                                     mpv.get<qint64>("decoder-frame-count"), dropped);
+    if (threads > 0)
+        mpv.setAsync("vd-lavc-threads", threads);
+}
+
 auto PlayEngine::Data::hook() -> void
 {
     mpv.hook("on_load", [=] () { onLoad(); });
     mpv.hook("on_unload", [=] () { onUnload(); });
+    mpv.hook("on_preloaded", [=] () { onPreloaded(); });
 }
 
 SCA calcFrameCount(double fps, int ms) -> qint64
@@ -480,7 +602,7 @@ auto PlayEngine::Data::observe() -> void
     mpv.observe("cache-used", [=] () { return t.caching ? mpv.get<int>("cache-used") : 0; },
                 [=] (int v) { info.cache.setUsed(v); });
     mpv.observe("cache-size", [=] () { return t.caching ? mpv.get<int>("cache-size") : 0; },
-                [=] (int v) { info.cache.setSize(v); });
+                [=] (int v) { info.cache.setSize(v); cacheMemory.setUsage(v * 1024LL); });
 
     mpv.observe("seekable", [=] () {
         return t.seekable >= 0 ? !!t.seekable : mpv.get<bool>("seekable");
@@ -504,13 +626,24 @@ auto PlayEngine::Data::observe() -> void
         if (ctime != info.cache.time())
             QMetaObject::invokeMethod(&info.cache, "setTime",
                                       Qt::QueuedConnection, Q_ARG(int, ctime));
+        if (t.timeshift) {
+            t.shift.add(mpv.get<qint64>("stream-pos"), ctime,
+                        mpv.get<qint64>("stream-end"));
+            const auto w = t.shift.window();
+            if (w.first != info.cache.timeshiftBegin()
+                    || w.second != info.cache.timeshiftEnd())
+                QMetaObject::invokeMethod(&info.cache, "setTimeshift",
+                                          Qt::QueuedConnection,
+                                          Q_ARG(int, w.first), Q_ARG(int, w.second));
+        }
         return s2ms(mpv.get<double>("time-pos")) - t.offset;
     }, [=] (int pos) {
         if (!_Change(time, pos))
             return;
         emit p->tick(time);
+        PropertyBatch::notify(p, &PlayEngine::timeChanged);
         if (_Change(time_s, time/1000))
-            emit p->time_sChanged();
+            PropertyBatch::notify(p, &PlayEngine::time_sChanged);
         sr->render(time);
         info.video.setFrameNumber(calcFrameCount(info.video.decoder()->fps(), time - begin));
     });
@@ -625,6 +758,7 @@ auto PlayEngine::Data::observe() -> void
         info.video.decoder()->setFps(fps);
         info.video.filter()->setFps(fps);
         sr->setFPS(fps);
+        updateFramePacer();
         info.video.setFrameCount(calcFrameCount(fps, duration));
         info.video.setFrameNumber(calcFrameCount(fps, time - begin));
     });
@@ -703,9 +837,21 @@ auto PlayEngine::Data::request() -> void
         const int list = mpv.get<int>(listprop);
         QVector<EditionData> editions(list);
         auto name = disc ? tr("Title %1") : tr("Edition %1");
+        DiscInfo analyzed;
+        if (disc) {
+            // bdnav counts titles differently from analysis
+            mutex.lock();
+            const bool same = params.mrl().isDvd() || discDirect;
+            const auto hash = discHash;
+            mutex.unlock();
+            if (same)
+                analyzed = discs.find(hash);
+        }
         for (int i = 0; i < list; ++i) {
             editions[i].number = i;
             editions[i].name = name.arg(i+1);
+            if (const auto title = analyzed.title(i))
+                editions[i].name += " ("_a % _MSecToString((int)title->duration) % ')'_q;
         }
         EditionData edition;
         if (list > 0) {
@@ -768,6 +914,10 @@ auto PlayEngine::Data::request() -> void
         t.local.clear();
     });
     mpv.request(MPV_EVENT_PLAYBACK_RESTART, [=] () {
+        if (openClock.isValid()) {
+            _Debug("First frame after %%ms from opening", openClock.elapsed());
+            openClock.invalidate();
+        }
         _PostEvent(p, NotifySeek);
     });
 }
@@ -834,6 +984,9 @@ auto PlayEngine::Data::process(QEvent *event) -> void
     } case NotifySeek:
         emit p->sought();
         break;
+    case ReopenSource:
+        p->load(mrl);
+        break;
     case SyncMrlState: {
         QSharedPointer<MrlState> ms;
         QVector<SubComp> loads;
@@ -885,6 +1038,17 @@ auto PlayEngine::Data::renderVideoFrame(Fbo *frame, Fbo *osd, const QMargins &m)
 {
     info.delayed = mpv.render(frame, osd, m);
     frames.measure.push(++frames.drawn);
+    frames.pending = true;
+
+    if (live.isProbing() && frame->isValid()) {
+        // pattern is made of vertical bars, so any row carries the stamp
+        QVector<uchar> row(frame->width() * 4);
+        frame->bind();
+        QOpenGLContext::currentContext()->functions()->glReadPixels(
+            0, frame->height() / 2, frame->width(), 1, GL_RGBA, GL_UNSIGNED_BYTE, row.data());
+        frame->release();
+        live.probe(row.data(), frame->width());
+    }
 
     _Trace("PlayEngine::Data::renderVideoFrame(): "
            "render queued frame(%%), avgfps: %%",
@@ -1072,6 +1236,9 @@ auto PlayEngine::Data::clearTimings() -> void
     info.video.setDelayedFrames(0);
     info.video.output()->setFps(0);
     frames.drawn = 0;
+    const auto stats = pacer.reset();
+    if (stats.frames > 0)
+        _Debug("Frame pacing: %%", stats.toString());
 }
 
 auto PlayEngine::Data::sub_add(const QString &file, const EncodingInfo &enc, bool select) -> void
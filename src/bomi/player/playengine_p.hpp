@@ -8,17 +8,24 @@
 #include "avinfoobject.hpp"
 #include "streamtrack.hpp"
 #include "historymodel.hpp"
+#include "timeshiftindex.hpp"
+#include "decodertuner.hpp"
+#include "probetuner.hpp"
+#include "livelatency.hpp"
+#include "disccache.hpp"
 #include "misc/autoloader.hpp"
 #include "misc/youtubedl.hpp"
 #include "misc/osdstyle.hpp"
 #include "misc/speedmeasure.hpp"
 #include "misc/yledl.hpp"
 #include "misc/charsetdetector.hpp"
+#include "misc/memorygovernor.hpp"
 #include "audio/audiocontroller.hpp"
 #include "audio/audioformat.hpp"
 #include "video/videorenderer.hpp"
 #include "video/videoprocessor.hpp"
 #include "video/videopreview.hpp"
+#include "video/framepacer.hpp"
 #include "subtitle/subtitle.hpp"
 #include "subtitle/subtitlerenderer.hpp"
 #include "enum/codecid.hpp"
@@ -37,7 +44,7 @@ auto _ChmapNameFromLayout(ChannelLayout layout) -> QByteArray;
 enum EventType {
     UserType = QEvent::User, StateChange, WaitingChange,
     PreparePlayback,EndPlayback, StartPlayback, NotifySeek,
-    SyncMrlState,
+    SyncMrlState, ReopenSource,
     EventTypeMax
 };
 
@@ -101,7 +108,8 @@ struct PlayEngine::Data {
     YouTubeDL *youtube = nullptr;
 
     struct {
-        bool caching = false;
+        bool caching = false, timeshift = false;
+        TimeshiftIndex shift;
         int start = -1, begin = -1, duration = -1, offset = 0, seekable = -1;
         QSharedPointer<MrlState> local;
     } t; // thread local
@@ -110,6 +118,7 @@ struct PlayEngine::Data {
     bool pauseAfterSkip = false, resume = false, hwdec = false;
     bool quit = false, preciseSeeking = false, mouseOnButton = false;
     bool filterResync = false, audioOnly = false, useIntrplDown = false;
+    bool lowPower = false, lowPowerHwdec = false;
 
     QList<CodecId> hwCodecs;
 
@@ -130,8 +139,32 @@ struct PlayEngine::Data {
     struct {
         quint64 drawn = 0, dropped = 0, delayed = 0;
         SpeedMeasure<quint64> measure{5, 20};
+        bool pending = false; // drawn but not swapped yet
     } frames;
 
+    MemoryConsumer cacheMemory{u"stream cache"_q, MemoryPriority::StreamCache};
+
+    DecoderTuner tuner;
+    int tuneTicks = 0;
+
+    ProbeTuner prober;
+    QElapsedTimer openClock;
+
+    LiveLatency live;
+
+    DiscCache discs;
+    // guarded by mutex
+    QByteArray discHash;
+    bool discMenu = false, discDirect = false;
+
+    int mixTrack = -1;
+
+    FramePacer pacer;
+    QElapsedTimer swapClock;
+    double fpsScale = 1.0;
+    // ratio applied through mpv speed when there is no audio to resample
+    double speedRatio = 1.0;
+
     struct { QImage osd, frame; bool take = false; int time = 0; } ss;
     QPoint mouse;
 
@@ -140,6 +173,10 @@ struct PlayEngine::Data {
     auto updateState(State s) -> void;
     auto setWaitings(Waitings w, bool set) -> void;
     auto clearTimings() -> void;
+    auto updateFramePacer() -> void
+    {
+        pacer.setFrameRate(info.video.decoder()->fps() * fpsScale * params.play_speed());
+    }
     auto setInclusiveSubtitles(const QVector<SubComp> &loaded) -> void
         { setInclusiveSubtitles(&params, loaded); }
     auto setInclusiveSubtitles(MrlState *s, const QVector<SubComp> &loaded) -> void
@@ -158,6 +195,10 @@ struct PlayEngine::Data {
 
     auto af(const MrlState *s) const -> QByteArray;
     auto vf(const MrlState *s) const -> QByteArray;
+    // motion interpolation is optional work skipped in low power mode
+    auto interpolates(const MrlState *s) const -> bool
+        { return s->video_motion_interpolation() && !lowPower; }
+    auto updateHwdecCodecs() -> void;
     auto vo(const MrlState *s) const -> QByteArray;
     auto updateVideoScaler() -> void;
     auto videoSubOptions(const MrlState *s) const -> QByteArray;
@@ -189,6 +230,9 @@ struct PlayEngine::Data {
     auto localCopy() -> QSharedPointer<MrlState>;
     auto onLoad() -> void;
     auto onUnload() -> void;
+    auto onPreloaded() -> void;
+    auto checkProbe(const QVariantList &tracks) -> bool;
+    auto tuneDecoder() -> void;
     auto request() -> void;
 
     static auto encoding(const StreamTrack &track, const EncodingInfo &enc, bool detect) -> EncodingInfo
@@ -1,4 +1,5 @@
 #include "playlistmodel.hpp"
+#include "mediaprobe.hpp"
 #include "misc/downloader.hpp"
 #include "misc/encodinginfo.hpp"
 #include <random>
@@ -11,6 +12,31 @@ PlaylistModel::PlaylistModel(QObject *parent)
     connect(this, &PlaylistModel::rowsChanged, this, &PlaylistModel::countChanged);
     connect(this, &PlaylistModel::specialRowChanged, this, &PlaylistModel::loadedChanged);
     connect(this, &PlaylistModel::loadedChanged, this, &PlaylistModel::nextChanged);
+
+    m_probe = new MediaProbe(this);
+    connect(this, &PlaylistModel::modelReset, this, [=] () {
+        m_probe->cancel();
+        m_probe->request(list());
+    });
+    connect(this, &PlaylistModel::rowsInserted, this,
+            [=] (const QModelIndex &, int first, int last) {
+        m_probe->request(list().mid(first, last - first + 1));
+    });
+    connect(m_probe, &MediaProbe::updated, this, [=] () {
+        if (isEmpty())
+            return;
+        static const QVector<int> roles = {
+            DurationRole, ResolutionRole, VideoCodecRole, AudioCodecRole,
+            TitleRole, ArtistRole, AlbumRole
+        };
+        emit QAbstractItemModel::dataChanged(index(0), index(rows() - 1), roles);
+        emit probed();
+        updateTotalDuration();
+    });
+    // setList() of sort() and filter() resets model
+    connect(this, &PlaylistModel::modelReset, this, &PlaylistModel::updateTotalDuration);
+    connect(this, &PlaylistModel::rowsInserted, this, &PlaylistModel::updateTotalDuration);
+    connect(this, &PlaylistModel::rowsRemoved, this, &PlaylistModel::updateTotalDuration);
 }
 
 PlaylistModel::~PlaylistModel() {}
@@ -89,6 +115,13 @@ auto PlaylistModel::roleNames() const -> QHash<int, QByteArray>
     names[NameRole] = "name";
     names[LocationRole] = "location";
     names[LoadedRole] = "isLoaded";
+    names[DurationRole] = "duration";
+    names[ResolutionRole] = "resolution";
+    names[VideoCodecRole] = "videoCodec";
+    names[AudioCodecRole] = "audioCodec";
+    names[TitleRole] = "title";
+    names[ArtistRole] = "artist";
+    names[AlbumRole] = "album";
     return names;
 }
 
@@ -126,7 +159,109 @@ auto PlaylistModel::roleData(int row, int, int role) const -> QVariant
         return location(row);
     } else if (role == LoadedRole)
         return loaded() == row;
-    return QVariant();
+    const auto info = m_probe->info(at(row));
+    if (!info)
+        return QVariant();
+    switch (role) {
+    case DurationRole:
+        return info->duration;
+    case ResolutionRole:
+        return info->size;
+    case VideoCodecRole:
+        return info->video;
+    case AudioCodecRole:
+        return info->audio;
+    case TitleRole:
+        return info->title;
+    case ArtistRole:
+        return info->artist;
+    case AlbumRole:
+        return info->album;
+    default:
+        return QVariant();
+    }
+}
+
+auto PlaylistModel::updateTotalDuration() -> void
+{
+    qint64 total = 0;
+    for (auto &mrl : list()) {
+        const auto info = m_probe->info(mrl);
+        if (info && info->duration > 0)
+            total += info->duration;
+    }
+    if (_Change(m_total, total))
+        emit totalDurationChanged();
+}
+
+auto PlaylistModel::sort(int role, bool descending) -> void
+{
+    if (rows() < 2)
+        return;
+    struct Item { Mrl mrl; QString text; qint64 number; bool known; };
+    QVector<Item> items; items.reserve(rows());
+    for (auto &mrl : list()) {
+        Item item{mrl, QString(), 0, true};
+        const auto info = m_probe->info(mrl);
+        switch (role) {
+        case DurationRole:
+            item.known = info && info->duration > 0;
+            item.number = item.known ? info->duration : 0;
+            break;
+        case ResolutionRole:
+            item.known = info && !info->size.isEmpty();
+            item.number = item.known ? info->size.width() * info->size.height() : 0;
+            break;
+        case LocationRole:
+            item.text = mrl.isLocalFile() ? mrl.toLocalFile() : mrl.toString();
+            break;
+        default:
+            item.text = mrl.displayName();
+            break;
+        }
+        items.push_back(item);
+    }
+    const bool numeric = role == DurationRole || role == ResolutionRole;
+    std::stable_sort(items.begin(), items.end(), [&] (const Item &l, const Item &r) {
+        if (l.known != r.known)
+            return l.known;
+        int cmp = 0;
+        if (numeric)
+            cmp = l.number < r.number ? -1 : (l.number > r.number ? 1 : 0);
+        else
+            cmp = QString::localeAwareCompare(l.text, r.text);
+        return descending ? cmp > 0 : cmp < 0;
+    });
+    const auto current = loadedMrl();
+    Playlist sorted;
+    for (auto &item : items)
+        sorted.push_back(item.mrl);
+    setList(sorted);
+    setLoaded(current);
+}
+
+auto PlaylistModel::filter(int role, qint64 minimum) -> int
+{
+    if (role != DurationRole && role != ResolutionRole)
+        return 0;
+    const auto current = loadedMrl();
+    Playlist kept;
+    for (auto &mrl : list()) {
+        const auto info = m_probe->info(mrl);
+        bool keep = !info || mrl == current;
+        if (!keep && role == DurationRole)
+            keep = info->duration <= 0 || info->duration >= minimum;
+        else if (!keep)
+            keep = info->size.isEmpty() || info->size.height() >= minimum;
+        if (keep)
+            kept.push_back(mrl);
+    }
+    const int removed = rows() - kept.size();
+    if (removed > 0) {
+        setList(kept);
+        setLoaded(current);
+    }
+    return removed;
 }
 
 auto PlaylistModel::setLoaded(int row) -> void
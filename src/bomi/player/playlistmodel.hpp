@@ -5,6 +5,7 @@
 #include "misc/simplelistmodel.hpp"
 
 class Downloader;                       class EncodingInfo;
+class MediaProbe;
 
 class PlaylistModel : public SimpleListModel<Mrl, Playlist> {
     Q_OBJECT
@@ -18,9 +19,12 @@ class PlaylistModel : public SimpleListModel<Mrl, Playlist> {
     Q_PROPERTY(int selected READ selected WRITE select NOTIFY selectedChanged)
     Q_PROPERTY(bool shuffled READ isShuffled NOTIFY shuffledChanged)
     Q_PROPERTY(bool repetitive READ repeat NOTIFY repeatChanged)
+    Q_PROPERTY(qint64 totalDuration READ totalDuration NOTIFY totalDurationChanged)
     Q_ENUMS(Role)
 public:
-    enum Role {NameRole = Qt::UserRole + 1, LocationRole, LoadedRole};
+    enum Role {NameRole = Qt::UserRole + 1, LocationRole, LoadedRole,
+               DurationRole, ResolutionRole, VideoCodecRole, AudioCodecRole,
+               TitleRole, ArtistRole, AlbumRole};
     PlaylistModel(QObject *parent = 0);
     ~PlaylistModel();
 
@@ -41,6 +45,9 @@ public:
     auto isShuffled() const -> bool { return m_shuffled; }
     auto selected() const -> int { return m_selected; }
     auto repeat() const -> bool { return m_repeat; }
+    auto probe() const -> MediaProbe* { return m_probe; }
+    // sum of probed durations in msec
+    auto totalDuration() const -> qint64 { return m_total; }
     Q_INVOKABLE QString name(int row) const {return value(row).displayName();}
     Q_INVOKABLE QString location(int row) const;
     Q_INVOKABLE QString number(int row) const;
@@ -62,6 +69,11 @@ public:
     auto setShuffled(bool shuffled) -> void;
     auto setRepeat(bool repeat) -> void;
     Q_INVOKABLE void play(int row);
+    // entries without probed value go last
+    Q_INVOKABLE void sort(int role, bool descending = false);
+    // removes entries whose duration in msec or video height is below
+    // minimum; loaded entry and entries without probed value are kept
+    Q_INVOKABLE int filter(int role, qint64 minimum);
 signals:
     void finished() const;
     void loadedChanged(int row);
@@ -75,10 +87,13 @@ signals:
     void shuffledChanged();
     void repeatChanged();
     void nextChanged();
+    void probed();
+    void totalDurationChanged();
 private:
     friend class PlayEngine;
     auto setLoaded(int row) -> void;
     auto shuffle() const -> void;
+    auto updateTotalDuration() -> void;
     QChar m_fill = QChar::Null;
     bool m_visible = false;
     int m_selected = -1;
@@ -86,6 +101,8 @@ private:
     EncodingInfo m_enc;
     bool m_shuffled = false, m_repeat = false;
     mutable QVector<int> m_shuffledIdx;
+    MediaProbe *m_probe = nullptr;
+    qint64 m_total = 0;
 };
 
 inline auto PlaylistModel::setFillChar(QChar c) -> void
@@ -0,0 +1,144 @@
+#include "powerprofile.hpp"
+#include "os/os.hpp"
+#include "misc/log.hpp"
+
+DECLARE_LOG_CONTEXT(Power)
+
+static constexpr int PollInterval = 30000;
+
+struct PowerProfile::Data {
+    bool automatic = false, requested = false, battery = false, low = false;
+    bool playing = false;
+    QTimer poller;
+    // totals while playing and the point where current period started
+    quint64 playedUs = 0, cpuUs = 0, wallStart = 0, cpuStart = 0;
+    qint64 switches = 0, switchStart = -1;
+    bool countSwitches = true;
+};
+
+PowerProfile::PowerProfile(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->poller.setInterval(PollInterval);
+    connect(&d->poller, &QTimer::timeout, this, [=] () {
+        if (d->automatic && _Change(d->battery, OS::isOnBattery()))
+            update();
+        if (d->playing)
+            sample();
+    });
+    d->countSwitches = OS::contextSwitches() >= 0;
+}
+
+PowerProfile::~PowerProfile()
+{
+    delete d;
+}
+
+auto PowerProfile::setAutomatic(bool on) -> void
+{
+    if (!_Change(d->automatic, on))
+        return;
+    d->battery = on && OS::isOnBattery();
+    if (on || d->playing)
+        d->poller.start();
+    else
+        d->poller.stop();
+    update();
+}
+
+auto PowerProfile::setRequested(bool on) -> void
+{
+    if (_Change(d->requested, on))
+        update();
+}
+
+auto PowerProfile::isRequested() const -> bool
+{
+    return d->requested;
+}
+
+auto PowerProfile::isOnBattery() const -> bool
+{
+    return d->battery;
+}
+
+auto PowerProfile::isLowPower() const -> bool
+{
+    return d->low;
+}
+
+auto PowerProfile::update() -> void
+{
+    const bool low = d->requested || (d->automatic && d->battery);
+    if (low == d->low)
+        return;
+    // keep figures of each profile apart
+    if (d->playing) {
+        sample();
+        _Info("Playback cost: %%", report());
+    }
+    d->playedUs = d->cpuUs = 0;
+    d->switches = 0;
+    d->low = low;
+    _Info("Switched to %% profile%%", d->low ? u"low power"_q : u"normal"_q,
+          d->battery ? u" on battery"_q : QString());
+    emit lowPowerChanged(d->low);
+}
+
+auto PowerProfile::sample() -> void
+{
+    const auto wall = OS::systemTime(), cpu = OS::processTime();
+    d->playedUs += wall - d->wallStart;
+    d->cpuUs += cpu - d->cpuStart;
+    d->wallStart = wall;
+    d->cpuStart = cpu;
+    if (d->countSwitches) {
+        const auto switches = OS::contextSwitches();
+        if (d->switchStart >= 0 && switches >= d->switchStart)
+            d->switches += switches - d->switchStart;
+        d->switchStart = switches;
+    }
+}
+
+auto PowerProfile::setPlaying(bool playing) -> void
+{
+    if (d->playing == playing)
+        return;
+    if (playing) {
+        d->wallStart = OS::systemTime();
+        d->cpuStart = OS::processTime();
+        d->switchStart = d->countSwitches ? OS::contextSwitches() : -1;
+        d->playing = true;
+        d->poller.start();
+    } else {
+        sample();
+        d->playing = false;
+        if (!d->automatic)
+            d->poller.stop();
+        _Info("Playback cost: %%", report());
+    }
+}
+
+auto PowerProfile::wakeupsPerSecond() const -> double
+{
+    if (!d->countSwitches || d->playedUs < 1000000)
+        return -1;
+    return d->switches / (d->playedUs * 1e-6);
+}
+
+auto PowerProfile::cpuSecondsPerMinute() const -> double
+{
+    if (d->playedUs < 1000000)
+        return -1;
+    return d->cpuUs / (double)d->playedUs * 60.0;
+}
+
+auto PowerProfile::report() const -> QString
+{
+    const auto wakeups = wakeupsPerSecond();
+    return u"%1 wakeups/s, %2 cpu-s/min over %3s (%4)"_q
+            .arg(wakeups < 0 ? u"?"_q : QString::number(wakeups, 'f', 1))
+            .arg(cpuSecondsPerMinute(), 0, 'f', 2)
+            .arg(d->playedUs / 1000000)
+            .arg(d->low ? u"low power"_q : u"normal"_q);
+}
@@ -0,0 +1,32 @@
+#ifndef POWERPROFILE_HPP
+#define POWERPROFILE_HPP
+
+// decides when optional work should be cut down to save power and measures
+// what playback costs in wakeups and cpu time
+class PowerProfile : public QObject {
+    Q_OBJECT
+public:
+    PowerProfile(QObject *parent = nullptr);
+    ~PowerProfile();
+    // go low power automatically while running on battery
+    auto setAutomatic(bool on) -> void;
+    // go low power regardless of power source
+    auto setRequested(bool on) -> void;
+    auto isRequested() const -> bool;
+    auto isOnBattery() const -> bool;
+    auto isLowPower() const -> bool;
+    auto setPlaying(bool playing) -> void;
+    // averages over time spent playing, -1 if unknown
+    auto wakeupsPerSecond() const -> double;
+    auto cpuSecondsPerMinute() const -> double;
+    auto report() const -> QString;
+signals:
+    void lowPowerChanged(bool on);
+private:
+    auto update() -> void;
+    auto sample() -> void;
+    struct Data;
+    Data *d;
+};
+
+#endif // POWERPROFILE_HPP
@@ -0,0 +1,491 @@
+#include "probetuner.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <thread>
+#include <future>
+#include <atomic>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+DECLARE_LOG_CONTEXT(Probe)
+
+static constexpr int TableVersion = 1;
+static constexpr int MaxEntries = 300;
+// libavformat's own probesize
+static constexpr qint64 DefaultSize = 5000000;
+static constexpr qint64 MinSize = 64 * 1024;
+// libavformat reads URL by itself (e.g. HLS) so bytes are not known
+static constexpr qint64 UnknownSize = 1024 * 1024;
+static constexpr int Margin = 2;
+static constexpr double TunedDuration = 1.0;
+static constexpr int MaxFails = 2;
+// table is written from GUI thread this long after last change
+static constexpr int SaveDelay = 5000;
+
+struct Entry {
+    qint64 bytes = -1, time = 0;
+    QString format;
+    QStringList streams;
+    int opens = 0, fails = 0;
+    double defaultMs = -1, tunedMs = -1;
+};
+
+// kinds of streams every source of a container is expected to have; others
+// such as subtitles come and go between sources
+SIA mediaTypes(const QStringList &streams) -> QSet<QString>
+{
+    QSet<QString> types;
+    for (auto &stream : streams) {
+        const auto type = stream.section(':'_q, 0, 0);
+        if (type == "video"_a || type == "audio"_a)
+            types.insert(type);
+    }
+    return types;
+}
+
+struct ProbeTuner::Data {
+    mutable QMutex mutex;
+    bool enabled = true, loaded = false, dirty = false, retry = false;
+    QString fileName;
+    QTimer saver;
+    QHash<QString, Entry> table;
+    // current source: keys from most specific, key tuned from
+    QStringList keys;
+    QString tunedKey;
+    ProbeParams params;
+    // streams learned for same origin, and kinds of them for any origin
+    int expected = 0;
+    QSet<QString> types;
+
+    // origin and container hint taken from the path; pipes share one key
+    static auto keysOf(const QString &url) -> QStringList
+    {
+        if (url == "-"_a || url.startsWith("fd://"_a) || url.startsWith("pipe:"_a))
+            return { u"pipe|-"_q };
+        static const QStringList schemes = {
+            u"http"_q, u"https"_q, u"ftp"_q, u"hls"_q, u"tcp"_q, u"udp"_q,
+            u"rtp"_q, u"rtsp"_q, u"rtmp"_q, u"rtmps"_q, u"rtmpt"_q,
+            u"mms"_q, u"mmsh"_q, u"mmst"_q
+        };
+        const QUrl u(url);
+        const auto scheme = u.scheme().toLower();
+        if (!schemes.contains(scheme) || u.host().isEmpty())
+            return {};
+        const auto origin = scheme % "://"_a % u.host().toLower()
+                            % (u.port() > 0 ? ':'_q % _N(u.port()) : QString());
+        auto hint = QFileInfo(u.path()).suffix().toLower();
+        static const QRegEx rx(uR"(^[a-z0-9]{1,5}$)"_q);
+        if (!rx.match(hint).hasMatch())
+            hint = u"-"_q;
+        QStringList keys{origin % '|'_q % hint};
+        if (hint != "-"_a)
+            keys.push_back("*|"_a % hint);
+        return keys;
+    }
+    auto load() -> void
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        if (fileName.isEmpty())
+            return;
+        JsonStorage storage(fileName);
+        const auto json = storage.read();
+        if (storage.hasError() || json[u"version"_q].toInt() != TableVersion)
+            return;
+        const auto entries = json[u"entries"_q].toObject();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            const auto obj = it.value().toObject();
+            Entry e;
+            e.bytes = obj[u"bytes"_q].toVariant().toLongLong();
+            e.time = obj[u"time"_q].toVariant().toLongLong();
+            e.format = obj[u"format"_q].toString();
+            e.streams = obj[u"streams"_q].toVariant().toStringList();
+            e.opens = obj[u"opens"_q].toInt();
+            e.fails = obj[u"fails"_q].toInt();
+            e.defaultMs = obj[u"default_ms"_q].toDouble(-1);
+            e.tunedMs = obj[u"tuned_ms"_q].toDouble(-1);
+            if (e.opens > 0)
+                table.insert(it.key(), e);
+        }
+    }
+    // called with mutex locked from any thread
+    auto touch() -> void
+    {
+        if (_Change(dirty, true))
+            QMetaObject::invokeMethod(&saver, "start", Qt::QueuedConnection);
+    }
+    auto save() -> void
+    {
+        QMutexLocker locker(&mutex);
+        if (!dirty || fileName.isEmpty())
+            return;
+        while (table.size() > MaxEntries) {
+            auto oldest = table.begin();
+            for (auto it = table.begin(); it != table.end(); ++it) {
+                if (it->time < oldest->time)
+                    oldest = it;
+            }
+            table.erase(oldest);
+        }
+        QJsonObject entries;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            QJsonObject obj;
+            obj[u"bytes"_q] = (double)it->bytes;
+            obj[u"time"_q] = (double)it->time;
+            obj[u"format"_q] = it->format;
+            obj[u"streams"_q] = QJsonArray::fromStringList(it->streams);
+            obj[u"opens"_q] = it->opens;
+            obj[u"fails"_q] = it->fails;
+            obj[u"default_ms"_q] = it->defaultMs;
+            obj[u"tuned_ms"_q] = it->tunedMs;
+            entries.insert(it.key(), obj);
+        }
+        QJsonObject json;
+        json[u"version"_q] = TableVersion;
+        json[u"entries"_q] = entries;
+        dirty = false;
+        JsonStorage storage(fileName);
+        locker.unlock();
+        if (!storage.write(json)) {
+            locker.relock();
+            dirty = true;
+        }
+    }
+};
+
+ProbeTuner::ProbeTuner()
+    : d(new Data)
+{
+    d->fileName = _WritablePath(Location::Cache) % "/stream-probe.json"_a;
+    d->saver.setSingleShot(true);
+    d->saver.setInterval(SaveDelay);
+    QObject::connect(&d->saver, &QTimer::timeout, [this] () { d->save(); });
+}
+
+ProbeTuner::~ProbeTuner()
+{
+    d->saver.stop();
+    d->save();
+    delete d;
+}
+
+auto ProbeTuner::setEnabled(bool enabled) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->enabled = enabled;
+}
+
+auto ProbeTuner::isEnabled() const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    return d->enabled;
+}
+
+auto ProbeTuner::isActive() const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    return !d->keys.isEmpty();
+}
+
+auto ProbeTuner::start(const QString &url) -> ProbeParams
+{
+    QMutexLocker locker(&d->mutex);
+    d->keys.clear();
+    d->tunedKey.clear();
+    d->params = ProbeParams();
+    d->expected = 0;
+    d->types.clear();
+    if (!d->enabled)
+        return d->params;
+    d->keys = Data::keysOf(url);
+    if (d->keys.isEmpty())
+        return d->params;
+    if (_Change(d->retry, false))
+        return d->params;
+    d->load();
+    for (int i = 0; i < d->keys.size(); ++i) {
+        const auto it = d->table.constFind(d->keys[i]);
+        if (it == d->table.cend() || it->opens < 1 || it->fails >= MaxFails)
+            continue;
+        // other origins only tell the container; give them more room
+        const int margin = i ? Margin * 2 : Margin;
+        const qint64 size = it->bytes < 0 ? UnknownSize
+                                          : qMax(MinSize, it->bytes * margin);
+        if (size >= DefaultSize)
+            break;
+        d->params.size = size;
+        d->params.duration = TunedDuration;
+        d->tunedKey = it.key();
+        // stream count varies between sources of other origins
+        d->expected = i ? 0 : it->streams.size();
+        d->types = mediaTypes(it->streams);
+        _Debug("Probe %% bytes for %% learned from %%", size, url, d->tunedKey);
+        break;
+    }
+    return d->params;
+}
+
+auto ProbeTuner::finish(const ProbeOutcome &outcome, int msec) -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->keys.isEmpty())
+        return true;
+    const auto keys = d->keys;
+    d->keys.clear();
+    const bool tuned = d->params.isTuned();
+    const bool complete = outcome.complete && !outcome.streams.isEmpty();
+    const auto now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    const bool missed = outcome.streams.size() < d->expected
+            || !mediaTypes(outcome.streams).contains(d->types);
+    if (tuned && (!complete || missed)) {
+        auto &e = d->table[d->tunedKey];
+        ++e.fails;
+        e.time = now;
+        d->retry = true;
+        d->touch();
+        _Info("Probing %% bytes missed streams of %%, open again with defaults",
+              d->params.size, d->tunedKey);
+        return false;
+    }
+    if (!complete)
+        return true;
+    for (auto &key : keys) {
+        auto &e = d->table[key];
+        // keep the largest recent need; decay lets one odd source fade out
+        if (outcome.bytes >= 0)
+            e.bytes = e.bytes < 0 ? outcome.bytes : qMax(outcome.bytes, e.bytes * 3 / 4);
+        e.format = outcome.format;
+        e.streams = outcome.streams;
+        ++e.opens;
+        if (tuned)
+            e.fails = 0;
+        auto &ms = tuned ? e.tunedMs : e.defaultMs;
+        ms = ms < 0 ? msec : ms * 0.7 + msec * 0.3;
+        e.time = now;
+    }
+    d->touch();
+    _Debug("Probed %% in %%ms with %% bytes: %% [%%]", keys.first(), msec,
+           outcome.bytes, outcome.format, outcome.streams.join(','_q));
+    return true;
+}
+
+/******************************************************************************/
+
+// stand-in for a remote HTTP server with range requests, fixed round trip
+// and limited bandwidth; one thread per connection because libavformat
+// opens a new connection before closing the old one when it seeks
+class LocalHttp {
+public:
+    static constexpr int Latency = 50;                // msec
+    static constexpr int Bandwidth = 2 * 1024 * 1024; // bytes per sec
+    LocalHttp(const QString &file): m_file(file) { }
+    ~LocalHttp() { stop(); }
+    auto start() -> quint16
+    {
+        std::promise<quint16> port;
+        auto ready = port.get_future();
+        m_thread = std::thread([this, &port] () {
+            Listener listener(this);
+            const bool ok = listener.listen(QHostAddress::LocalHost);
+            port.set_value(ok ? listener.serverPort() : 0);
+            while (ok && !m_stop)
+                listener.waitForNewConnection(100);
+        });
+        return ready.get();
+    }
+    auto stop() -> void
+    {
+        m_stop = true;
+        if (m_thread.joinable())
+            m_thread.join();
+        for (auto &thread : m_threads)
+            thread.join();
+        m_threads.clear();
+    }
+private:
+    class Listener : public QTcpServer {
+    public:
+        Listener(LocalHttp *http): m_http(http) { }
+    private:
+        auto incomingConnection(qintptr fd) -> void final
+        {
+            auto http = m_http;
+            http->m_threads.emplace_back([http, fd] () { http->serve(fd); });
+        }
+        LocalHttp *m_http;
+    };
+    auto serve(qintptr fd) -> void
+    {
+        QTcpSocket socket;
+        QFile file(m_file);
+        if (!socket.setSocketDescriptor(fd) || !file.open(QFile::ReadOnly))
+            return;
+        QByteArray request;
+        while (!request.contains("\r\n\r\n")) {
+            if (m_stop || socket.state() != QTcpSocket::ConnectedState)
+                return;
+            if (socket.waitForReadyRead(100))
+                request += socket.readAll();
+        }
+        QThread::msleep(Latency);
+        const qint64 size = file.size();
+        qint64 from = 0, to = size - 1;
+        static const QRegEx rx(uR"(\r\nRange:\s*bytes=(\d+)-(\d*))"_q,
+                               QRegEx::CaseInsensitiveOption);
+        const auto m = rx.match(QString::fromLatin1(request));
+        if (m.hasMatch()) {
+            from = qMin(m.capturedRef(1).toLongLong(), size);
+            if (!m.capturedRef(2).isEmpty())
+                to = qMin(m.capturedRef(2).toLongLong(), size - 1);
+        }
+        QByteArray header = m.hasMatch() ? "HTTP/1.1 206 Partial Content\r\n"
+                                         : "HTTP/1.1 200 OK\r\n";
+        header += "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\n"
+                  "Connection: close\r\nContent-Length: "
+                  + QByteArray::number(to - from + 1) + "\r\n";
+        if (m.hasMatch())
+            header += "Content-Range: bytes " + QByteArray::number(from) + '-'
+                      + QByteArray::number(to) + '/' + QByteArray::number(size) + "\r\n";
+        socket.write(header + "\r\n");
+        file.seek(from);
+        QElapsedTimer timer;
+        timer.start();
+        qint64 sent = 0;
+        while (!m_stop && from + sent <= to) {
+            const auto chunk = file.read(qMin<qint64>(16 * 1024, to - from - sent + 1));
+            if (chunk.isEmpty() || socket.write(chunk) < 0)
+                return;
+            sent += chunk.size();
+            while (!m_stop && socket.bytesToWrite() > 0) {
+                if (!socket.waitForBytesWritten(100)
+                        && socket.state() != QTcpSocket::ConnectedState)
+                    return;
+            }
+            const qint64 due = sent * 1000 / Bandwidth - timer.elapsed();
+            if (due > 0)
+                QThread::msleep(due);
+        }
+        socket.disconnectFromHost();
+        if (socket.state() != QTcpSocket::UnconnectedState)
+            socket.waitForDisconnected(1000);
+    }
+    QString m_file;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    // touched only by listener thread until it is joined
+    std::vector<std::thread> m_threads;
+};
+
+struct OpenResult {
+    ProbeOutcome outcome;
+    double open = -1, info = -1; // msec
+};
+
+SIA openUrl(const QByteArray &url, const ProbeParams &params) -> OpenResult
+{
+    OpenResult result;
+    AVFormatContext *fmt = nullptr;
+    AVDictionary *options = nullptr;
+    if (params.isTuned()) {
+        av_dict_set(&options, "probesize", QByteArray::number(params.size), 0);
+        av_dict_set(&options, "analyzeduration",
+                    QByteArray::number(qRound64(params.duration * AV_TIME_BASE)), 0);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    const int ret = avformat_open_input(&fmt, url.constData(), nullptr, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+        return result;
+    result.open = timer.nsecsElapsed() * 1e-6;
+    const qint64 header = fmt->pb ? avio_tell(fmt->pb) : -1;
+    if (avformat_find_stream_info(fmt, nullptr) >= 0) {
+        result.info = timer.nsecsElapsed() * 1e-6 - result.open;
+        auto &outcome = result.outcome;
+        outcome.format = _L(fmt->iformat->name);
+        if (header >= 0)
+            outcome.bytes = avio_tell(fmt->pb) - header;
+        for (unsigned i = 0; i < fmt->nb_streams; ++i) {
+            const auto st = fmt->streams[i];
+            const auto codec = st->codec;
+            if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
+                continue;
+            const auto type = av_get_media_type_string(codec->codec_type);
+            outcome.streams.push_back(_L(type ? type : "unknown")
+                                      % ':'_q % _L(avcodec_get_name(codec->codec_id)));
+            if (codec->codec_id == AV_CODEC_ID_NONE
+                    || (codec->codec_type == AVMEDIA_TYPE_VIDEO && codec->width <= 0)
+                    || (codec->codec_type == AVMEDIA_TYPE_AUDIO
+                        && (codec->sample_rate <= 0 || codec->channels <= 0)))
+                outcome.complete = false;
+        }
+    }
+    avformat_close_input(&fmt);
+    return result;
+}
+
+auto ProbeTuner::benchmark(const QString &file) -> void
+{
+    const QFileInfo info(file);
+    if (!info.isFile()) {
+        _Error("'%%' is not a file.", file);
+        return;
+    }
+    av_register_all();
+    avformat_network_init();
+    LocalHttp http(info.absoluteFilePath());
+    const auto port = http.start();
+    if (!port) {
+        _Error("Cannot listen on local port.");
+        return;
+    }
+    const auto suffix = info.suffix().isEmpty() ? u"bin"_q : info.suffix();
+    const auto url = ("http://127.0.0.1:"_a % _N(port) % "/media."_a % suffix).toUtf8();
+
+    QString line;
+    auto print = [&] () { qDebug().nospace() << line.toLocal8Bit().constData(); };
+    line.sprintf("%-8s %10s %9s %9s %9s %10s  %s", "probe", "size",
+                 "open(ms)", "info(ms)", "total(ms)", "read", "streams");
+    print();
+    auto run = [&] (const char *mode, const ProbeParams &params) {
+        const auto r = openUrl(url, params);
+        line.sprintf("%-8s %10d %9.1f %9.1f %9.1f %10lld  %s", mode, params.size,
+                     r.open, r.info, r.open + r.info, r.outcome.bytes,
+                     r.outcome.streams.join(','_q).toLatin1().constData());
+        print();
+        return r;
+    };
+    // in-memory table only
+    ProbeTuner tuner;
+    tuner.d->fileName.clear();
+    constexpr int rounds = 3;
+    double def = 0, tuned = 0;
+    int tunedRuns = 0;
+    for (int i = 0; i < rounds; ++i) {
+        const auto r = run("default", ProbeParams());
+        def += r.open + r.info;
+    }
+    for (int i = 0; i < rounds + 1; ++i) {
+        const auto params = tuner.start(QString::fromUtf8(url));
+        const auto r = run(params.isTuned() ? "tuned" : "learn", params);
+        const auto total = r.open + r.info;
+        if (!tuner.finish(r.outcome, qRound(total))) {
+            line = u"  tuned probing missed streams; falls back to default"_q;
+            print();
+        } else if (params.isTuned()) {
+            tuned += total;
+            ++tunedRuns;
+        }
+    }
+    line.sprintf("default %.1fms, tuned %.1fms over local HTTP with %dms latency and %d KiB/s",
+                 def / rounds, tunedRuns ? tuned / tunedRuns : -1.0,
+                 LocalHttp::Latency, LocalHttp::Bandwidth / 1024);
+    print();
+    http.stop();
+    avformat_network_deinit();
+}
@@ -0,0 +1,42 @@
+#ifndef PROBETUNER_HPP
+#define PROBETUNER_HPP
+
+struct ProbeParams {
+    int size = 0;           // bytes, 0 for libavformat default
+    double duration = 0.0;  // sec, 0 for libavformat default
+    auto isTuned() const -> bool { return size > 0; }
+};
+
+// what the demuxer found while opening a source
+struct ProbeOutcome {
+    QString format;
+    QStringList streams;    // type:codec in stream order
+    qint64 bytes = -1;      // read for stream parameters, -1 if unknown
+    bool complete = true;   // every stream has its codec parameters
+};
+
+// shortens libavformat probing of network and pipe sources from what
+// earlier opens of the same origin and container needed
+class ProbeTuner {
+public:
+    ProbeTuner();
+    ~ProbeTuner();
+    auto setEnabled(bool enabled) -> void;
+    auto isEnabled() const -> bool;
+    // returns probe options to open url with; default ones if not tunable
+    auto start(const QString &url) -> ProbeParams;
+    // true between start() of a tunable source and finish()
+    auto isActive() const -> bool;
+    // returns false if tuned probing missed streams and the source should
+    // be opened again; next start() uses default probing then. Safe in any
+    // thread: table is written later in thread of tuner
+    auto finish(const ProbeOutcome &outcome, int msec) -> bool;
+    // serves file over local HTTP with network-like latency and compares
+    // opening it with default and tuned probing
+    static auto benchmark(const QString &file) -> void;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // PROBETUNER_HPP
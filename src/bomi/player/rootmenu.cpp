@@ -1,5 +1,6 @@
 #include "rootmenu.hpp"
 #include "shortcutmap.hpp"
+#include "sessiontrace.hpp"
 #include "video/videocolor.hpp"
 #include "misc/windowsize.hpp"
 #include "misc/log.hpp"
@@ -491,6 +492,7 @@ RootMenu::RootMenu()
             d->group()->setExclusive(true);
             d->separator();
             d->action(u"cycle"_q, QT_TR_NOOP("Select Next"));
+            d->action(u"mix"_q, QT_TR_NOOP("Mix Next"));
             d->separator();
         })->setEnabled(false);
         d->menuStepReset(u"sync"_q, QT_TR_NOOP("Sync"));
@@ -604,6 +606,11 @@ RootMenu::RootMenu()
             d->separator();
             d->action(u"move-up"_q, QT_TR_NOOP("Move Up"));
             d->action(u"move-down"_q, QT_TR_NOOP("Move Down"));
+            d->action(u"sort-name"_q, QT_TR_NOOP("Sort by Name"));
+            d->action(u"sort-duration"_q, QT_TR_NOOP("Sort by Duration"));
+            d->action(u"sort-resolution"_q, QT_TR_NOOP("Sort by Resolution"));
+            d->action(u"filter-duration"_q, QT_TR_NOOP("Remove Shorter Than..."));
+            d->action(u"filter-resolution"_q, QT_TR_NOOP("Remove Lower Resolution Than..."));
             d->separator();
             d->action(u"shuffle"_q, QT_TR_NOOP("Shuffle"), true);
             d->action(u"repeat"_q, QT_TR_NOOP("Repeat"), true);
@@ -613,6 +620,7 @@ RootMenu::RootMenu()
             d->action(u"clear"_q, QT_TR_NOOP("Clear"));
         });
         d->action(u"find-subtitle"_q, QT_TR_NOOP("Find Subtitle"));
+        d->action(u"contact-sheet"_q, QT_TR_NOOP("Export Contact Sheets"));
         d->action(u"subtitle"_q, QT_TR_NOOP("Subtitle Viewer"));
         d->action(u"playinfo"_q, QT_TR_NOOP("Playback Information"));
         d->action(u"log"_q, QT_TR_NOOP("Log Viewer"));
@@ -628,6 +636,7 @@ RootMenu::RootMenu()
 
         d->action(u"auto-exit"_q, QT_TR_NOOP("Auto-exit"), true);
         d->action(u"auto-shutdown"_q, QT_TR_NOOP("Auto-shutdown"), true);
+        d->action(u"low-power"_q, QT_TR_NOOP("Low Power Mode"), true);
     });
 
     d->menu(u"window"_q, QT_TR_NOOP("Window"), [=] () {
@@ -661,6 +670,14 @@ RootMenu::RootMenu()
     d->action(u"exit"_q, QT_TR_NOOP("Exit"))->setMenuRole(QAction::QuitRole);
 
     Q_ASSERT(d->parent == this);
+
+    for (auto it = d->actions.cbegin(); it != d->actions.cend(); ++it) {
+        if (it->action->menu())
+            continue;
+        const auto id = it.key();
+        connect(it->action, &QAction::triggered, it->action, [=] ()
+            { SessionTrace::instance().record(TraceEvent::Action, id); });
+    }
 }
 
 RootMenu::~RootMenu()
@@ -0,0 +1,377 @@
+#include "sessiontrace.hpp"
+#include "app.hpp"
+#include "mrl.hpp"
+#include "mainwindow.hpp"
+#include "playengine.hpp"
+#include "rootmenu.hpp"
+#include "jrplayer.hpp"
+#include "avinfoobject.hpp"
+#include "json/jrcommon.hpp"
+#include "misc/log.hpp"
+#include "os/os.hpp"
+#include <QElapsedTimer>
+#include <QDateTime>
+
+DECLARE_LOG_CONTEXT(Trace)
+
+// time to let the last command settle before the report is written
+static constexpr int SettleTime = 2000;
+
+struct TraceStep {
+    qint64 at = 0;
+    TraceEvent event = TraceEvent::Action;
+    QString name, expect;
+    QJsonValue args{QJsonValue::Undefined};
+    bool skipped = false;
+    qint64 dispatched = -1, latency = -1, wall = 0;
+    quint64 cpuStart = 0, cpu = 0;
+    int droppedStart = 0, dropped = 0;
+    double rss = 0;
+};
+
+struct SessionTrace::Data {
+    MainWindow *mw = nullptr;
+    QFile file;
+    QElapsedTimer clock;
+
+    QVector<TraceStep> steps;
+    int current = -1, calls = 0, dispatching = 0;
+    qint64 end = 0;
+    quint64 cpuStart = 0;
+    bool replaying = false;
+    QString trace, report;
+    QTimer timer;
+    JrPlayer *jr = nullptr;
+
+    static auto name(TraceEvent event) -> QString
+    {
+        switch (event) {
+        case TraceEvent::Open:   return u"open"_q;
+        case TraceEvent::Action: return u"action"_q;
+        case TraceEvent::Call:   return u"call"_q;
+        case TraceEvent::State:  return u"state"_q;
+        }
+        return QString();
+    }
+    static auto event(const QString &name, bool *ok) -> TraceEvent
+    {
+        *ok = true;
+        for (auto e : { TraceEvent::Open, TraceEvent::Action,
+                        TraceEvent::Call, TraceEvent::State }) {
+            if (name == Data::name(e))
+                return e;
+        }
+        *ok = false;
+        return TraceEvent::Action;
+    }
+    static auto stateName(PlayEngine::State state) -> QString
+    {
+        const auto &mo = PlayEngine::staticMetaObject;
+        const auto e = mo.enumerator(mo.indexOfEnumerator("State"));
+        return _L(e.valueToKey(state));
+    }
+    // actions which only open a dialog or a popup cannot be fed back;
+    // whatever they lead to is recorded as a separate step
+    static auto isInteractive(const QString &id) -> bool
+    {
+        return id.startsWith("open/"_a) || id == "context-menu"_a;
+    }
+    auto dropped() const -> int
+        { return mw ? mw->engine()->video()->droppedFrames() : 0; }
+};
+
+SessionTrace::SessionTrace()
+    : d(new Data)
+{
+    d->timer.setSingleShot(true);
+    connect(&d->timer, &QTimer::timeout, this, [=] () {
+        if (d->current + 1 < d->steps.size())
+            next();
+        else
+            finish();
+    });
+}
+
+SessionTrace::~SessionTrace()
+{
+    stopRecording();
+    delete d->jr;
+    delete d;
+}
+
+SessionTrace::CallScope::CallScope()
+{
+    ++instance().d->dispatching;
+}
+
+SessionTrace::CallScope::~CallScope()
+{
+    --instance().d->dispatching;
+}
+
+static SessionTrace *obj = nullptr;
+
+auto SessionTrace::instance() -> SessionTrace&
+{
+    if (!obj)
+        obj = new SessionTrace;
+    return *obj;
+}
+
+auto SessionTrace::finalize() -> void
+{
+    _Delete(obj);
+}
+
+auto SessionTrace::attach(MainWindow *mw) -> void
+{
+    d->mw = mw;
+    connect(mw->engine(), &PlayEngine::stateChanged,
+            this, [=] (PlayEngine::State state) {
+        const auto name = Data::stateName(state);
+        record(TraceEvent::State, name);
+        if (d->current < 0 || d->current >= d->steps.size())
+            return;
+        auto &step = d->steps[d->current];
+        if (step.latency < 0 && step.expect == name)
+            step.latency = d->clock.elapsed() - step.dispatched;
+    });
+}
+
+auto SessionTrace::startRecording(const QString &fileName) -> bool
+{
+    stopRecording();
+    d->file.setFileName(fileName);
+    if (!d->file.open(QFile::WriteOnly | QFile::Truncate)) {
+        _Error("Cannot open trace file '%%'.", fileName);
+        return false;
+    }
+    QJsonObject header;
+    header[u"bomi"_q] = _L(App::version());
+    header[u"date"_q] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    d->file.write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    d->file.write("\n");
+    d->clock.start();
+    _Info("Start recording session trace to '%%'.", fileName);
+    return true;
+}
+
+auto SessionTrace::stopRecording() -> void
+{
+    if (d->file.isOpen())
+        d->file.close();
+}
+
+auto SessionTrace::isRecording() const -> bool
+{
+    return d->file.isOpen();
+}
+
+auto SessionTrace::record(TraceEvent event, const QString &name,
+                          const QJsonValue &args) -> void
+{
+    if (!d->file.isOpen())
+        return;
+    if (d->dispatching && (event == TraceEvent::Action || event == TraceEvent::Open))
+        return;
+    QJsonObject json;
+    json[u"t"_q] = (double)d->clock.elapsed();
+    json[u"e"_q] = Data::name(event);
+    json[u"n"_q] = name;
+    if (!args.isUndefined())
+        json[u"a"_q] = args;
+    d->file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    d->file.write("\n");
+    d->file.flush();
+}
+
+auto SessionTrace::isReplaying() const -> bool
+{
+    return d->replaying;
+}
+
+auto SessionTrace::replay(const QString &trace, const QString &report) -> bool
+{
+    if (d->replaying)
+        return false;
+    QFile file(trace);
+    if (!file.open(QFile::ReadOnly)) {
+        _Error("Cannot open trace file '%%'.", trace);
+        return false;
+    }
+    d->steps.clear();
+    d->end = 0;
+    while (!file.atEnd()) {
+        const auto json = QJsonDocument::fromJson(file.readLine()).object();
+        bool ok = false;
+        const auto event = Data::event(json[u"e"_q].toString(), &ok);
+        if (!ok)
+            continue;
+        const auto at = (qint64)json[u"t"_q].toDouble();
+        d->end = qMax(d->end, at);
+        if (event == TraceEvent::State) {
+            if (!d->steps.isEmpty() && d->steps.last().expect.isEmpty())
+                d->steps.last().expect = json[u"n"_q].toString();
+            continue;
+        }
+        TraceStep step;
+        step.at = at;
+        step.event = event;
+        step.name = json[u"n"_q].toString();
+        step.args = json[u"a"_q];
+        d->steps.push_back(step);
+    }
+    if (d->steps.isEmpty()) {
+        _Error("No command found in trace file '%%'.", trace);
+        return false;
+    }
+    if (!d->jr)
+        d->jr = new JrPlayer;
+    d->trace = trace;
+    d->report = report.isEmpty() ? QString(trace % ".report"_a) : report;
+    d->current = -1;
+    d->calls = 0;
+    d->replaying = true;
+    _Info("Replay %% steps from '%%'.", d->steps.size(), trace);
+    d->cpuStart = OS::processTime();
+    d->clock.start();
+    d->timer.start(d->steps.first().at);
+    return true;
+}
+
+auto SessionTrace::next() -> void
+{
+    close();
+    auto &step = d->steps[++d->current];
+    step.dispatched = d->clock.elapsed();
+    step.cpuStart = OS::processTime();
+    step.droppedStart = d->dropped();
+    _Debug("Replay step %%: %% %%", d->current, Data::name(step.event), step.name);
+    switch (step.event) {
+    case TraceEvent::Open:
+        if (d->mw)
+            d->mw->openFromFileManager(Mrl(step.name));
+        else
+            step.skipped = true;
+        break;
+    case TraceEvent::Action:
+        if (Data::isInteractive(step.name))
+            step.skipped = true;
+        else
+            step.skipped = !RootMenu::execute(step.name);
+        break;
+    case TraceEvent::Call: {
+        QJsonObject json;
+        json[u"jsonrpc"_q] = u"2.0"_q;
+        json[u"method"_q] = step.name;
+        json[u"id"_q] = ++d->calls;
+        if (!step.args.isUndefined())
+            json[u"params"_q] = step.args;
+        const auto request = JrRequest::fromJson(json);
+        if (request.isValid())
+            static_cast<JrIface*>(d->jr)->request(request);
+        else
+            step.skipped = true;
+        break;
+    } case TraceEvent::State:
+        break;
+    }
+    const auto now = d->clock.elapsed();
+    if (d->current + 1 < d->steps.size())
+        d->timer.start(qMax<qint64>(0, d->steps[d->current + 1].at - now));
+    else
+        d->timer.start(qMax<qint64>(0, d->end - now) + SettleTime);
+}
+
+auto SessionTrace::close() -> void
+{
+    if (d->current < 0 || d->current >= d->steps.size())
+        return;
+    auto &step = d->steps[d->current];
+    step.wall = d->clock.elapsed() - step.dispatched;
+    step.cpu = OS::processTime() - step.cpuStart;
+    step.dropped = d->dropped() - step.droppedStart;
+    step.rss = OS::usingMemory();
+}
+
+auto SessionTrace::finish() -> void
+{
+    close();
+    QJsonArray steps;
+    int missed = 0;
+    for (auto &step : d->steps) {
+        QJsonObject json;
+        json[u"at"_q] = (double)step.at;
+        json[u"event"_q] = Data::name(step.event);
+        json[u"name"_q] = step.name;
+        json[u"skipped"_q] = step.skipped;
+        json[u"expect"_q] = step.expect;
+        json[u"latency"_q] = (double)step.latency;
+        json[u"wall"_q] = (double)step.wall;
+        json[u"cpu"_q] = step.cpu * 1e-3;
+        json[u"rss"_q] = step.rss;
+        json[u"dropped"_q] = step.dropped;
+        if (!step.skipped && !step.expect.isEmpty() && step.latency < 0)
+            ++missed;
+        steps.push_back(json);
+    }
+    QJsonObject report;
+    report[u"bomi"_q] = _L(App::version());
+    report[u"trace"_q] = d->trace;
+    report[u"wall"_q] = (double)d->clock.elapsed();
+    report[u"cpu"_q] = (OS::processTime() - d->cpuStart) * 1e-3;
+    report[u"missed"_q] = missed;
+    report[u"steps"_q] = steps;
+    QFile file(d->report);
+    if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+        file.write(QJsonDocument(report).toJson());
+        _Info("Replay report has been written to '%%'.", d->report);
+    } else
+        _Error("Cannot write replay report to '%%'.", d->report);
+    if (missed)
+        _Warn("%% step(s) did not reach the recorded state.", missed);
+    d->replaying = false;
+    if (d->mw)
+        d->mw->exit();
+}
+
+auto SessionTrace::compare(const QString &before, const QString &after) -> bool
+{
+    auto load = [] (const QString &fileName) {
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly))
+            return QJsonObject();
+        return QJsonDocument::fromJson(file.readAll()).object();
+    };
+    const auto a = load(before), b = load(after);
+    const auto sa = a[u"steps"_q].toArray(), sb = b[u"steps"_q].toArray();
+    if (sa.isEmpty() || sb.isEmpty()) {
+        _Error("Cannot read replay reports '%%' and '%%'.", before, after);
+        return false;
+    }
+    if (sa.size() != sb.size() || a[u"trace"_q] != b[u"trace"_q])
+        _Warn("Replay reports were not made from the same trace.");
+    QString line;
+    auto print = [&] () { qDebug().nospace() << line.toLocal8Bit().constData(); };
+    line.sprintf("%-4s %-32s %21s %21s %13s", "#", "step",
+                 "latency(ms)", "cpu(ms)", "rss(MB)");
+    print();
+    const int count = qMin(sa.size(), sb.size());
+    for (int i = 0; i < count; ++i) {
+        const auto x = sa[i].toObject(), y = sb[i].toObject();
+        const auto name = x[u"name"_q].toString().left(32).toLocal8Bit();
+        const auto lx = x[u"latency"_q].toDouble(), ly = y[u"latency"_q].toDouble();
+        const auto cx = x[u"cpu"_q].toDouble(), cy = y[u"cpu"_q].toDouble();
+        const auto rx = x[u"rss"_q].toDouble(), ry = y[u"rss"_q].toDouble();
+        line.sprintf("%-4d %-32s %6.0f %6.0f %+7.0f %6.1f %6.1f %+7.1f %6.1f %+6.1f",
+                     i, name.constData(), lx, ly, ly - lx, cx, cy, cy - cx, ry, ry - rx);
+        print();
+    }
+    const auto cx = a[u"cpu"_q].toDouble(), cy = b[u"cpu"_q].toDouble();
+    const auto wx = a[u"wall"_q].toDouble(), wy = b[u"wall"_q].toDouble();
+    line.sprintf("total cpu %.1f -> %.1f ms (%+.1f%%), wall %.0f -> %.0f ms, missed %d -> %d",
+                 cx, cy, cx > 0 ? (cy - cx) / cx * 100.0 : 0.0, wx, wy,
+                 a[u"missed"_q].toInt(), b[u"missed"_q].toInt());
+    print();
+    return true;
+}
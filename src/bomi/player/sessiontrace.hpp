@@ -0,0 +1,45 @@
+#ifndef SESSIONTRACE_HPP
+#define SESSIONTRACE_HPP
+
+class MainWindow;
+
+enum class TraceEvent { Open, Action, Call, State };
+
+// records user-level commands and engine state transitions of a session
+// and plays them back later to measure how long each step takes
+class SessionTrace : public QObject {
+public:
+    // while alive, actions and opens are not recorded because replaying the
+    // json-rpc call being dispatched issues them again
+    class CallScope {
+    public:
+        CallScope();
+        ~CallScope();
+    };
+    static auto instance() -> SessionTrace&;
+    static auto finalize() -> void;
+    auto attach(MainWindow *mw) -> void;
+    // trace file has one compact json object per line
+    auto startRecording(const QString &fileName) -> bool;
+    auto stopRecording() -> void;
+    auto isRecording() const -> bool;
+    auto record(TraceEvent event, const QString &name,
+                const QJsonValue &args = QJsonValue(QJsonValue::Undefined)) -> void;
+    // feed recorded commands at their original offsets and write per-step
+    // metrics to report, then quit; without main window, opens are skipped
+    // and nothing quits
+    auto replay(const QString &trace, const QString &report) -> bool;
+    auto isReplaying() const -> bool;
+    // print per-step differences of two replay reports to stdout
+    static auto compare(const QString &before, const QString &after) -> bool;
+private:
+    SessionTrace();
+    ~SessionTrace();
+    auto next() -> void;
+    auto close() -> void;
+    auto finish() -> void;
+    struct Data;
+    Data *d;
+};
+
+#endif // SESSIONTRACE_HPP
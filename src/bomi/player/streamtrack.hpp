@@ -30,6 +30,7 @@ public:
     auto isInclusive() const -> bool { return !isExclusive(); }
     auto isExternalByMpv() const -> bool { return isExclusive() && isExternal(); }
     auto file() const -> QString { return m_file; }
+    auto ffIndex() const -> int { return m_ffIndex; }
     auto toJson() const -> QJsonObject;
     auto setFromJson(const QJsonObject &json) -> bool;
     auto isValid() const -> bool { return m_type != StreamUnknown; }
@@ -41,7 +42,7 @@ private:
     friend class PlayEngine;
     friend class StreamList;
     StreamType m_type = StreamUnknown;
-    int m_id = -1;
+    int m_id = -1, m_ffIndex = -1;
     QString m_title, m_lang, m_file, m_codec, m_displayLang;
     EncodingInfo m_encoding;
     bool m_selected = false, m_default = false, m_albumart = false;
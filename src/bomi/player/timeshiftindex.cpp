@@ -0,0 +1,61 @@
+#include "timeshiftindex.hpp"
+
+static constexpr qint64 SampleDistance = 64 * 1024;
+
+auto TimeshiftIndex::clear() -> void
+{
+    m_samples.clear();
+    m_end = m_firstEnd = -1;
+    m_live = false;
+}
+
+auto TimeshiftIndex::add(qint64 pos, int time, qint64 end) -> void
+{
+    if (end <= 0 || pos < 0)
+        return;
+    if (m_firstEnd < 0)
+        m_firstEnd = end;
+    else if (end > m_firstEnd)
+        m_live = true;
+    m_end = end;
+    // seeked back: samples ahead of us will be replaced while playing again
+    while (!m_samples.isEmpty() && m_samples.last().pos >= pos) {
+        if (m_samples.last().pos - pos < SampleDistance)
+            return;
+        m_samples.removeLast();
+    }
+    if (!m_samples.isEmpty() && pos - m_samples.last().pos < SampleDistance)
+        return;
+    m_samples.push_back({pos, time});
+    // keep one sample before ring start for interpolation
+    const qint64 start = m_end - m_ring;
+    int drop = 0;
+    while (drop + 2 < m_samples.size() && m_samples[drop + 1].pos < start)
+        ++drop;
+    if (drop)
+        m_samples.remove(0, drop);
+}
+
+auto TimeshiftIndex::timeAt(qint64 pos) const -> int
+{
+    const int size = m_samples.size();
+    if (size < 2)
+        return size ? m_samples.front().time : 0;
+    auto it = std::lower_bound(m_samples.begin(), m_samples.end(), pos,
+                               [] (const Sample &s, qint64 p) { return s.pos < p; });
+    int i = it - m_samples.begin();
+    // extrapolate from the outermost pair if outside of known range
+    i = qBound(1, i, size - 1);
+    const auto &a = m_samples[i - 1], &b = m_samples[i];
+    const double rate = (b.time - a.time) / double(b.pos - a.pos);
+    return a.time + qRound((pos - a.pos) * rate);
+}
+
+auto TimeshiftIndex::window() const -> QPair<int, int>
+{
+    if (!m_live || m_ring <= 0 || m_samples.size() < 2)
+        return qMakePair(0, 0);
+    const int end = timeAt(m_end);
+    const int begin = timeAt(qMax<qint64>(0, m_end - m_ring));
+    return qMakePair(qMin(begin, end), end);
+}
@@ -0,0 +1,25 @@
+#ifndef TIMESHIFTINDEX_HPP
+#define TIMESHIFTINDEX_HPP
+
+// maps byte offsets of a live stream recorded into the timeshift ring to
+// playback time, so the seekable window can be shown in msec
+class TimeshiftIndex {
+public:
+    auto clear() -> void;
+    auto setRingSize(qint64 bytes) -> void { m_ring = bytes; }
+    // pos: demuxer read position in bytes, time: demuxed time in msec,
+    // end: bytes written to ring so far
+    auto add(qint64 pos, int time, qint64 end) -> void;
+    // true once the stream turned out to be growing, i.e. ring is in use
+    auto isLive() const -> bool { return m_live; }
+    auto timeAt(qint64 pos) const -> int;
+    // seekable window in msec; begin == end if unknown
+    auto window() const -> QPair<int, int>;
+private:
+    struct Sample { qint64 pos; int time; };
+    QVector<Sample> m_samples;
+    qint64 m_end = -1, m_firstEnd = -1, m_ring = 0;
+    bool m_live = false;
+};
+
+#endif // TIMESHIFTINDEX_HPP
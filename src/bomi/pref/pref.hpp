@@ -67,6 +67,10 @@ private:
     P0(QString, jr_address, u"localhost"_q)
     P0(int, jr_port, 2020)
 
+    P0(bool, media_server_use, false)
+    P0(QString, media_server_address, u"*"_q)
+    P0(int, media_server_port, 8020)
+
     P0(bool, load_last, true)
     P0(bool, fit_to_video, false)
     P0(bool, use_mpris2, true)
@@ -75,6 +79,7 @@ private:
     P0(bool, remember_stopped, true)
     P0(bool, resume_ignore_in_playlist, false)
     P0(bool, precise_seeking, false)
+    P0(bool, frame_pacing, false)
     P0(bool, remember_image, false)
     P0(bool, enable_generate_playlist, true)
     P0(QStringList, restore_properties, defaultRestoreProperties())
@@ -124,6 +129,7 @@ private:
 
     P0(bool, enable_hwaccel, false)
     P0(QList<CodecId>, hwaccel_codecs, OS::hwAcc()->fullCodecList())
+    P0(bool, auto_decoder_threads, true)
     P0(DeintOptionSet, deinterlacing, {})
 
     P0(bool, audio_filter_resync, true)
@@ -150,6 +156,12 @@ private:
     P0(int, cache_min_playback_kb, 0)
     P0(int, cache_min_seeking_kb, 500)
     P0(double, cache_file_size_mb, 1024)
+    P0(bool, cache_timeshift, true)
+    P0(bool, adaptive_probe, true)
+    P0(bool, live_low_latency, false)
+    P0(int, memory_budget_mb, 0)
+    P0(bool, power_save_on_battery, true)
+    P0(bool, power_save_hwdec, false)
     P0(QStringList, network_folders, {})
 
     P0(QString, yt_user_agent, u"Mozilla/5.0 (X11; Linux x86_64; rv:10.0) Gecko/20100101 Firefox/10.0 (Chrome)"_q)
@@ -8,6 +8,9 @@
 #include "player/skin.hpp"
 #include "player/mrlstate.hpp"
 #include "misc/simplelistmodel.hpp"
+#include "misc/log.hpp"
+#include "widget/fontcombobox.hpp"
+#include "widget/localecombobox.hpp"
 #include "ui_prefdialog.h"
 #include <QQmlProperty>
 #include <QElapsedTimer>
@@ -16,9 +19,12 @@
 #undef None
 #endif
 
+DECLARE_LOG_CONTEXT(Pref)
+
 struct ValueWatcher {
     QMetaProperty property;
     QQmlProperty editor;
+    QWidget *page = nullptr;
     std::function<bool()> isModified = nullptr;
 };
 
@@ -32,7 +38,51 @@ struct PrefDialog::Data {
     QSet<ValueWatcher*> modified;
     QHash<QObject*, QList<ValueWatcher*>> editorToWatcher;
     Pref orig;
-    bool filling = false;
+    bool filling = false, painted = false;
+    QElapsedTimer elapsed;
+    // pages fill their data when shown first; nullptr is always ready
+    QSet<QWidget*> built;
+    QHash<QWidget*, QList<std::function<void()>>> deferred;
+
+    auto pageOf(QObject *object) const -> QWidget*
+    {
+        if (auto group = qobject_cast<QButtonGroup*>(object))
+            object = group->buttons().value(0);
+        auto w = qobject_cast<QWidget*>(object);
+        while (w && w->parentWidget() != ui.stack)
+            w = w->parentWidget();
+        return w;
+    }
+
+    auto defer(QWidget *widget, std::function<void()> &&init) -> void
+    {
+        deferred[pageOf(widget)].push_back(std::move(init));
+    }
+
+    auto build(QWidget *page) -> void
+    {
+        if (built.contains(page))
+            return;
+        QElapsedTimer timer;
+        timer.start();
+        built.insert(page);
+        const auto prev = filling;
+        filling = true;
+        for (auto &init : deferred.take(page))
+            init();
+        for (auto &w : watchers) {
+            if (w.page == page && w.editor.isValid())
+                w.editor.write(w.property.read(&orig));
+        }
+        filling = prev;
+        _Debug("Page '%%' built in %%ms.", page->objectName(), timer.elapsed());
+    }
+
+    auto buildAll() -> void
+    {
+        for (int i = 0; i < ui.stack->count(); ++i)
+            build(ui.stack->widget(i));
+    }
 
     auto retranslate() -> void
     {
@@ -42,15 +92,19 @@ struct PrefDialog::Data {
     auto fillEditors(const Pref *pref) -> void
     {
         for (auto &w : watchers) {
-            if (w.editor.isValid())
+            if (!w.editor.isValid())
+                continue;
+            if (built.contains(w.page))
                 w.editor.write(w.property.read(pref));
+            else
+                w.property.write(&orig, w.property.read(pref));
         }
     }
 
     auto sync() -> void
     {
         for (auto &w : watchers) {
-            if (!w.editor.isValid())
+            if (!w.editor.isValid() || !built.contains(w.page))
                 continue;
             w.property.write(&orig, w.editor.read());
             if (w.isModified())
@@ -64,6 +118,8 @@ struct PrefDialog::Data {
 PrefDialog::PrefDialog(QWidget *parent)
 : QDialog(parent), d(new Data) {
     d->p = this;
+    d->elapsed.start();
+    d->built.insert(nullptr);
     d->properties = new MrlStatePropertyListModel(this);
     d->properties->setObjectName(u"restore_properties"_q);
     d->ui.setupUi(this);
@@ -80,6 +136,8 @@ PrefDialog::PrefDialog(QWidget *parent)
         const QString text = item->parent()->text(0) % " > "_a % item->text(0);
         const auto widget = item->data(0, WidgetRole).value<QWidget*>();
         d->ui.page_name->setText(text);
+        if (!d->watchers.isEmpty())
+            d->build(widget);
         d->ui.stack->setCurrentWidget(widget);
     });
 
@@ -136,9 +194,13 @@ PrefDialog::PrefDialog(QWidget *parent)
     addPage(tr("Control step"), d->ui.ui_step, u":/img/run-build-32.png"_q);
 
     d->ui.app_fixed_font->setFixedFontOnly(true);
-    d->ui.enable_hwaccel->setEnabled(OS::hwAcc()->isAvailable());
-    d->ui.screensaver_method->addItems(OS::screensaverMethods());
-    d->ui.screensaver_method->setVisible(d->ui.screensaver_method->count() > 1);
+    d->defer(d->ui.enable_hwaccel, [this] () {
+        d->ui.enable_hwaccel->setEnabled(OS::hwAcc()->isAvailable());
+    });
+    d->defer(d->ui.screensaver_method, [this] () {
+        d->ui.screensaver_method->addItems(OS::screensaverMethods());
+        d->ui.screensaver_method->setVisible(d->ui.screensaver_method->count() > 1);
+    });
     d->ui.quick_snapshot_folder_browse->setEditor(d->ui.quick_snapshot_folder);
 
     d->saveQuickSnapshot = new DataButtonGroup(this);
@@ -151,14 +213,20 @@ PrefDialog::PrefDialog(QWidget *parent)
     d->saveQuickSnapshot->addButton(d->ui.save_quick_snapshot_ask,
                                     QVariant::fromValue(QuickSnapshotSave::Ask));
     d->saveQuickSnapshot->setCurrentData(QVariant::fromValue(QuickSnapshotSave::Current));
-    d->ui.quick_snapshot_format->addItems(_ExtList(WritableImageExt));
-    d->ui.quick_snapshot_template->setToolTip(FileNameGenerator::toolTip());
+    d->defer(d->ui.quick_snapshot_format, [this] () {
+        d->ui.quick_snapshot_format->addItems(_ExtList(WritableImageExt));
+        d->ui.quick_snapshot_template->setToolTip(FileNameGenerator::toolTip());
+    });
 
     d->ui.sub_ext->addItem(QString(), QString());
-    d->ui.sub_ext->addItemTextData(_ExtList(SubtitleExt));
-    d->ui.app_style->addItems(cApp.availableStyleNames());
-    for (int i = 0; i < d->ui.app_style->count(); ++i)
-        d->ui.app_style->setItemData(i, d->ui.app_style->itemText(i).toLower());
+    d->defer(d->ui.sub_ext, [this] () {
+        d->ui.sub_ext->addItemTextData(_ExtList(SubtitleExt));
+    });
+    d->defer(d->ui.app_style, [this] () {
+        d->ui.app_style->addItems(cApp.availableStyleNames());
+        for (int i = 0; i < d->ui.app_style->count(); ++i)
+            d->ui.app_style->setItemData(i, d->ui.app_style->itemText(i).toLower());
+    });
 
     d->shortcutGroup = new QButtonGroup(this);
     d->shortcutGroup->addButton(d->ui.shortcut1, 0);
@@ -167,24 +235,28 @@ PrefDialog::PrefDialog(QWidget *parent)
     d->shortcutGroup->addButton(d->ui.shortcut4, 3);
     d->shortcutGroup->addButton(d->ui.shortcut_default, 4);
 
-    d->ui.mouse_action_map->setActionList(&d->ui.shortcut_map->actionInfoList());
+    d->defer(d->ui.mouse_action_map, [this] () {
+        d->ui.mouse_action_map->setActionList(&d->ui.shortcut_map->actionInfoList());
+    });
 
     connect(SIGNAL_VT(d->ui.audio_device, currentIndexChanged, int), [this] (int idx)
         { d->ui.audio_device_desc->setText(d->ui.audio_device->itemData(idx).toString()); });
 
-    d->ui.yt_height->addItem("4k"_a, 2160);
-    d->ui.yt_height->addItem("1080p"_a, 1080);
-    d->ui.yt_height->addItem("720p"_a, 720);
-    d->ui.yt_height->addItem("480p"_a, 480);
-    d->ui.yt_height->addItem("360p"_a, 360);
-    d->ui.yt_height->addItem("240p"_a, 240);
+    d->defer(d->ui.yt_height, [this] () {
+        d->ui.yt_height->addItem("4k"_a, 2160);
+        d->ui.yt_height->addItem("1080p"_a, 1080);
+        d->ui.yt_height->addItem("720p"_a, 720);
+        d->ui.yt_height->addItem("480p"_a, 480);
+        d->ui.yt_height->addItem("360p"_a, 360);
+        d->ui.yt_height->addItem("240p"_a, 240);
 
-    d->ui.yt_fps->addItem(tr("Ignore"), 0);
-    d->ui.yt_fps->addItem(u"60 fps"_q, 60);
-    d->ui.yt_fps->addItem(u"30 fps"_q, 30);
-    d->ui.yt_fps->addItem(u"15 fps"_q, 15);
+        d->ui.yt_fps->addItem(tr("Ignore"), 0);
+        d->ui.yt_fps->addItem(u"60 fps"_q, 60);
+        d->ui.yt_fps->addItem(u"30 fps"_q, 30);
+        d->ui.yt_fps->addItem(u"15 fps"_q, 15);
 
-    d->ui.yt_container->addItems( { u"mp4"_q, u"webm"_q } );
+        d->ui.yt_container->addItems( { u"mp4"_q, u"webm"_q } );
+    });
 
     d->ui.network_folders->setAddingAndErasingEnabled(true);
 
@@ -208,8 +280,10 @@ PrefDialog::PrefDialog(QWidget *parent)
         }
     };
 
-    d->ui.skin_name->addItems(Skin::names(true));
-    updateSkinPath(d->ui.skin_name->currentIndex());
+    d->defer(d->ui.skin_name, [=] () {
+        d->ui.skin_name->addItems(Skin::names(true));
+        updateSkinPath(d->ui.skin_name->currentIndex());
+    });
 
     connect(SIGNAL_VT(d->ui.skin_name, currentIndexChanged, int), this, updateSkinPath);
 
@@ -260,7 +334,9 @@ PrefDialog::PrefDialog(QWidget *parent)
     d->ui.sub_priority->setDragEnabled(true);
 
     d->retranslate();
-    d->ui.restore_properties_view->setModel(d->properties);
+    d->defer(d->ui.restore_properties_view, [this] () {
+        d->ui.restore_properties_view->setModel(d->properties);
+    });
 #ifdef Q_OS_MAC
     d->ui.system_tray_group->hide();
 #endif
@@ -281,14 +357,6 @@ PrefDialog::PrefDialog(QWidget *parent)
     auto &mo = Pref::staticMetaObject;
     d->watchers.resize(mo.propertyCount() - mo.propertyOffset());
 
-    // 526
-//    remove(17); // skin
-    // 395
-//    remove(16); // osd
-    // 284
-//    remove(12); // sub_appearance
-    // 120
-
     auto invoke = [&] (const char *funcName) -> QString
     {
         QString ret;
@@ -310,6 +378,7 @@ PrefDialog::PrefDialog(QWidget *parent)
         }
         d->editorToWatcher[editor].push_back(&w);
         w.editor = QQmlProperty(editor, editorProp);
+        w.page = d->pageOf(editor == d->properties ? d->ui.restore_properties_view : editor);
         if (!w.editor.hasNotifySignal())
             qDebug() << "No notify signal in" << editor->metaObject()->className() << "for" << w.property.name();
         else
@@ -344,6 +413,7 @@ PrefDialog::PrefDialog(QWidget *parent)
             d->fillEditors(&d->orig);
             break;
         case BBox::RestoreDefaults: {
+            d->buildAll();
             Pref pref;
             d->fillEditors(&pref);
             break;
@@ -351,6 +421,9 @@ PrefDialog::PrefDialog(QWidget *parent)
             break;
         }
     });
+
+    d->build(d->ui.stack->currentWidget());
+    _Debug("Constructed in %%ms.", d->elapsed.elapsed());
 }
 
 PrefDialog::~PrefDialog() {
@@ -366,6 +439,8 @@ auto PrefDialog::checkModified() -> void
         return;
     for (auto w : ws) {
         Q_ASSERT(w);
+        if (!d->built.contains(w->page))
+            continue;
         if (w->isModified())
             d->modified.insert(w);
         else
@@ -375,6 +450,12 @@ auto PrefDialog::checkModified() -> void
         setWindowModified(!d->modified.isEmpty());
 }
 
+auto PrefDialog::prefetch() -> void
+{
+    FontComboBox::prefetch();
+    LocaleComboBox::prefetch();
+}
+
 auto PrefDialog::setAudioDeviceList(const QList<AudioDevice> &devices) -> void {
     d->ui.audio_device->clear();
     for (auto &dev : devices)
@@ -417,4 +498,12 @@ auto PrefDialog::showEvent(QShowEvent *event) -> void
 {
     QDialog::showEvent(event);
     d->ui.stack->show();
+    d->build(d->ui.stack->currentWidget());
+}
+
+auto PrefDialog::paintEvent(QPaintEvent *event) -> void
+{
+    QDialog::paintEvent(event);
+    if (_Change(d->painted, true))
+        _Info("Time to first paint: %%ms", d->elapsed.elapsed());
 }
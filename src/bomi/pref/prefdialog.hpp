@@ -11,6 +11,8 @@ public:
     auto setAudioDeviceList(const QList<AudioDevice> &devices) -> void;
     auto set(const Pref *pref) -> void;
     auto get(Pref *p) -> void;
+    // warm up slow enumerations so that the first opening is quick
+    static auto prefetch() -> void;
 signals:
     void applyRequested();
 private slots:
@@ -18,6 +20,7 @@ private slots:
 private:
     auto changeEvent(QEvent *event) -> void;
     auto showEvent(QShowEvent *event) -> void;
+    auto paintEvent(QPaintEvent *event) -> void;
     struct Data;
     Data *d;
 };
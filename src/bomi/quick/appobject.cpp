@@ -21,8 +21,10 @@ MemoryObject::MemoryObject()
     connect(&m_timer, &QTimer::timeout, this, [=] () {
         if (_Change(m_usage, OS::usingMemory()))
             emit usageChanged();
+        if (m_timer.interval() != AppObject::pollingInterval())
+            m_timer.setInterval(AppObject::pollingInterval());
     });
-    m_timer.setInterval(500);
+    m_timer.setInterval(AppObject::pollingInterval());
     m_timer.start();
 }
 
@@ -51,8 +53,10 @@ CpuObject::CpuObject()
         }
         if (_Change(m_usage, usage))
             emit usageChanged();
+        if (m_timer.interval() != AppObject::pollingInterval())
+            m_timer.setInterval(AppObject::pollingInterval());
     });
-    m_timer.setInterval(500);
+    m_timer.setInterval(AppObject::pollingInterval());
     m_timer.start();
 }
 
@@ -65,6 +69,11 @@ CpuObject::~CpuObject()
 
 AppObject::StaticData AppObject::s;
 
+auto AppObject::bindings() const -> PropertyBatch*
+{
+    return PropertyBatch::instance();
+}
+
 auto AppObject::setWindow(MainWindow *window) -> void
 {
     static WindowObject o;
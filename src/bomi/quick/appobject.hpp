@@ -1,6 +1,7 @@
 #ifndef APPOBJECT_HPP
 #define APPOBJECT_HPP
 
+#include "propertybatch.hpp"
 #include <QQuickItem>
 
 class PlayEngine;                       class HistoryModel;
@@ -55,6 +56,7 @@ class AppObject : public QObject {
     Q_PROPERTY(WindowObject *window READ window CONSTANT FINAL)
     Q_PROPERTY(MemoryObject *memory READ memory CONSTANT FINAL)
     Q_PROPERTY(CpuObject *cpu READ cpu CONSTANT FINAL)
+    Q_PROPERTY(PropertyBatch *bindings READ bindings CONSTANT FINAL)
     Q_PROPERTY(QString displayName READ displayName NOTIFY displayNameChanged)
 public:
     static const int MouseEvent = 0x1000;
@@ -73,6 +75,7 @@ public:
     auto window() const -> WindowObject* { return s.window; }
     auto memory() const -> MemoryObject* { return &m_memory; }
     auto cpu() const -> CpuObject* { return &m_cpu; }
+    auto bindings() const -> PropertyBatch*;
     auto displayName() const -> QString;
     Q_INVOKABLE void registerToAccept(QQuickItem *item, Events e);
     Q_INVOKABLE QString description(const QString &actionId) const;
@@ -84,6 +87,9 @@ public:
     Q_INVOKABLE void delete_(QObject *o);
 
     static auto setTheme(ThemeObject *theme) -> void { s.theme = theme; }
+    // for memory and cpu usage; applied from next update
+    static auto setPollingInterval(int ms) -> void { s.pollInterval = ms; }
+    static auto pollingInterval() -> int { return s.pollInterval; }
     static auto setEngine(PlayEngine *engine) -> void { s.engine = engine; }
     static auto setHistory(HistoryModel *history) -> void { s.history = history; }
     static auto setPlaylist(PlaylistModel *pl) -> void { s.playlist = pl; }
@@ -110,6 +116,7 @@ private:
         QLinkedList<QQuickItem*> orderToAccept;
         QQmlEngine *qml = nullptr;
         MainWindow *mw = nullptr;
+        int pollInterval = 500;
     };
     static StaticData s;
     mutable MemoryObject m_memory;
@@ -0,0 +1,135 @@
+#include "propertybatch.hpp"
+#include <QQuickWindow>
+#include <QPointer>
+
+struct Notification {
+    const QObject *key = nullptr;
+    QPointer<QObject> object;
+    int index = -1;
+    std::function<void()> emitter;
+};
+
+// QObject::receivers() counts QML bindings and handlers connected to signal
+// as well; it is protected but can be reached by member pointer of derived
+// class which makes it public
+struct ReceiversAccess : public QObject { using QObject::receivers; };
+
+SIA receivers(const QObject *obj, int index) -> int
+{
+    static const auto get = &ReceiversAccess::receivers;
+    const auto signal = QByteArray::number(QSIGNAL_CODE)
+            + obj->metaObject()->method(index).methodSignature();
+    return (obj->*get)(signal.constData());
+}
+
+struct PropertyBatch::Data {
+    QPointer<QQuickWindow> window;
+    QVector<Notification> pending, flushing;
+    bool requested = false;
+    int delivered = 0, evaluations = 0;
+    QTimer *timer = nullptr;
+    auto deliver(QObject *obj, int index, const std::function<void()> &emitter) -> void
+    {
+        // bindings are evaluated during emission, so count them before
+        delivered += receivers(obj, index);
+        emitter();
+    }
+    auto request() -> void
+    {
+        requested = window && !pending.isEmpty();
+        if (requested)
+            window->update();
+    }
+};
+
+PropertyBatch::PropertyBatch(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->timer = new QTimer(this);
+    d->timer->setInterval(1000);
+    connect(d->timer, &QTimer::timeout, this, [=] () {
+        if (_Change(d->evaluations, d->delivered))
+            emit evaluationsChanged();
+        d->delivered = 0;
+    });
+    d->timer->start();
+}
+
+PropertyBatch::~PropertyBatch()
+{
+    delete d;
+}
+
+auto PropertyBatch::instance() -> PropertyBatch*
+{
+    // owned by application so that timer does not outlive event dispatcher
+    static QPointer<PropertyBatch> batch;
+    if (!batch) {
+        Q_ASSERT(qApp);
+        batch = new PropertyBatch(qApp);
+    }
+    return batch;
+}
+
+auto PropertyBatch::setWindow(QQuickWindow *window) -> void
+{
+    if (d->window)
+        disconnect(d->window, nullptr, this, nullptr);
+    d->window = window;
+    if (window) {
+        connect(window, &QQuickWindow::afterAnimating,
+                this, &PropertyBatch::flush, Qt::DirectConnection);
+        // update() of hidden window may never render a frame, so request is
+        // dropped on hide and made again on show
+        connect(window, &QWindow::visibilityChanged, this, [=] (QWindow::Visibility v) {
+            if (v == QWindow::Hidden || v == QWindow::Minimized)
+                d->requested = false;
+            else if (!d->requested)
+                d->request();
+        });
+        d->request();
+    } else
+        flush();
+}
+
+auto PropertyBatch::evaluations() const -> int
+{
+    return d->evaluations;
+}
+
+auto PropertyBatch::post(QObject *obj, int index,
+                         std::function<void()> &&emitter) -> void
+{
+    if (!d->window || QThread::currentThread() != thread()) {
+        d->deliver(obj, index, emitter);
+        return;
+    }
+    auto it = std::find_if(d->pending.begin(), d->pending.end(),
+                           [&] (const Notification &n)
+        { return n.key == obj && n.index == index; });
+    if (it == d->pending.end()) {
+        d->pending.push_back(Notification());
+        it = d->pending.end() - 1;
+        it->key = obj;
+        it->index = index;
+    }
+    it->object = obj;
+    it->emitter = std::move(emitter);
+    // no frame is rendered while hidden and nothing should be evaluated
+    if (!d->requested && d->window->isExposed())
+        d->request();
+}
+
+auto PropertyBatch::flush() -> void
+{
+    d->requested = false;
+    if (d->pending.isEmpty())
+        return;
+    // bindings may notify again which goes to next frame
+    d->flushing.swap(d->pending);
+    for (auto &n : d->flushing) {
+        if (n.object)
+            d->deliver(n.object, n.index, n.emitter);
+    }
+    d->flushing.clear();
+}
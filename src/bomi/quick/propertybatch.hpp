@@ -0,0 +1,43 @@
+#ifndef PROPERTYBATCH_HPP
+#define PROPERTYBATCH_HPP
+
+#include <QMetaMethod>
+
+class QQuickWindow;
+
+// collects NOTIFY signals of engine-facing properties and emits them once per
+// scene graph frame so that bindings depending on them are evaluated at most
+// once per displayed frame
+class PropertyBatch : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int evaluations READ evaluations NOTIFY evaluationsChanged)
+public:
+    ~PropertyBatch();
+    static auto instance() -> PropertyBatch*;
+    // without window, notifications are delivered immediately
+    auto setWindow(QQuickWindow *window) -> void;
+    // bindings and handlers evaluated by delivered notifications in last second
+    auto evaluations() const -> int;
+    // latest one replaces pending notification of same signal and object
+    template<class T, class... Params, class... Args>
+    static auto notify(T *obj, void (T::*signal)(Params...),
+                       const Args&... args) -> void;
+signals:
+    void evaluationsChanged();
+private:
+    PropertyBatch(QObject *parent);
+    auto post(QObject *obj, int index, std::function<void()> &&emitter) -> void;
+    auto flush() -> void;
+    struct Data;
+    Data *d;
+};
+
+template<class T, class... Params, class... Args>
+inline auto PropertyBatch::notify(T *obj, void (T::*signal)(Params...),
+                                  const Args&... args) -> void
+{
+    const int index = QMetaMethod::fromSignal(signal).methodIndex();
+    instance()->post(obj, index, [=] () { emit (obj->*signal)(args...); });
+}
+
+#endif // PROPERTYBATCH_HPP
@@ -0,0 +1,231 @@
+#include "opensubtitlescache.hpp"
+#include "opensubtitlesfinder.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+static constexpr int MaxEntries = 2000;
+static constexpr int MaxHashes = 5000;
+static constexpr int CacheVersion = 1;
+
+struct Entry {
+    qint64 time = 0; // secs since epoch
+    QVector<SubtitleLink> links;
+};
+
+struct HashEntry {
+    qint64 size = 0, mtime = 0, time = 0;
+    QString hash;
+};
+
+struct OpenSubtitlesCache::Data {
+    QString fileName;
+    qint64 expiry = 3*24*60*60;
+    QHash<QString, Entry> entries;
+    QHash<QString, HashEntry> hashes;
+    bool dirty = false, loaded = false;
+
+    static auto now() -> qint64
+        { return QDateTime::currentMSecsSinceEpoch() / 1000; }
+    auto isExpired(qint64 time) const -> bool
+        { return expiry > 0 && now() - time > expiry; }
+    template<class T>
+    static auto prune(QHash<QString, T> &hash, int max) -> void
+    {
+        if (hash.size() <= max)
+            return;
+        QVector<qint64> times; times.reserve(hash.size());
+        for (auto &e : hash)
+            times.push_back(e.time);
+        std::nth_element(times.begin(), times.begin() + (hash.size() - max),
+                         times.end());
+        const auto limit = times[hash.size() - max];
+        for (auto it = hash.begin(); it != hash.end(); ) {
+            if (it->time < limit)
+                it = hash.erase(it);
+            else
+                ++it;
+        }
+    }
+};
+
+OpenSubtitlesCache::OpenSubtitlesCache()
+    : d(new Data)
+{
+    d->fileName = _WritablePath(Location::Cache) % "/opensubtitles.json"_a;
+}
+
+OpenSubtitlesCache::~OpenSubtitlesCache()
+{
+    save();
+    delete d;
+}
+
+auto OpenSubtitlesCache::setExpiry(qint64 secs) -> void
+{
+    d->expiry = secs;
+}
+
+auto OpenSubtitlesCache::expiry() const -> qint64
+{
+    return d->expiry;
+}
+
+auto OpenSubtitlesCache::setFileName(const QString &fileName) -> void
+{
+    if (_Change(d->fileName, fileName)) {
+        d->entries.clear();
+        d->hashes.clear();
+        d->loaded = d->dirty = false;
+    }
+}
+
+auto OpenSubtitlesCache::fileName() const -> QString
+{
+    return d->fileName;
+}
+
+auto OpenSubtitlesCache::key(const QVariantMap &query) -> QString
+{
+    QStringList list;
+    for (auto it = query.begin(); it != query.end(); ++it)
+        list.push_back(it.key() % '='_q % it->toString());
+    return list.join('&'_q);
+}
+
+auto OpenSubtitlesCache::find(const QString &key,
+                              QVector<SubtitleLink> *links) const -> bool
+{
+    const auto it = d->entries.constFind(key);
+    if (it == d->entries.cend() || d->isExpired(it->time))
+        return false;
+    *links = it->links;
+    return true;
+}
+
+auto OpenSubtitlesCache::insert(const QString &key,
+                                const QVector<SubtitleLink> &links) -> void
+{
+    auto &e = d->entries[key];
+    e.time = d->now();
+    e.links = links;
+    d->dirty = true;
+}
+
+auto OpenSubtitlesCache::hash(const QFileInfo &file) const -> QString
+{
+    const auto it = d->hashes.constFind(file.absoluteFilePath());
+    if (it == d->hashes.cend() || it->size != file.size()
+            || it->mtime != file.lastModified().toMSecsSinceEpoch())
+        return QString();
+    return it->hash;
+}
+
+auto OpenSubtitlesCache::setHash(const QFileInfo &file,
+                                 const QString &hash) -> void
+{
+    auto &e = d->hashes[file.absoluteFilePath()];
+    e.size = file.size();
+    e.mtime = file.lastModified().toMSecsSinceEpoch();
+    e.time = d->now();
+    e.hash = hash;
+    d->dirty = true;
+}
+
+auto OpenSubtitlesCache::clear() -> void
+{
+    d->entries.clear();
+    d->hashes.clear();
+    d->dirty = true;
+}
+
+auto OpenSubtitlesCache::load() -> bool
+{
+    if (d->loaded)
+        return true;
+    d->loaded = true;
+    JsonStorage storage(d->fileName);
+    const auto json = storage.read();
+    if (storage.hasError())
+        return false;
+    if (json[u"version"_q].toInt() != CacheVersion)
+        return false;
+    const auto entries = json[u"search"_q].toObject();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        const auto obj = it.value().toObject();
+        Entry e;
+        e.time = obj[u"time"_q].toVariant().toLongLong();
+        if (d->isExpired(e.time))
+            continue;
+        const auto links = obj[u"links"_q].toArray();
+        e.links.reserve(links.size());
+        for (const auto &v : links) {
+            const auto l = v.toObject();
+            SubtitleLink link;
+            link.fileName = l[u"file"_q].toString();
+            link.date = l[u"date"_q].toString();
+            link.langCode = l[u"lang"_q].toString();
+            link.url = l[u"url"_q].toString();
+            e.links.push_back(link);
+        }
+        d->entries.insert(it.key(), e);
+    }
+    const auto hashes = json[u"hash"_q].toObject();
+    for (auto it = hashes.begin(); it != hashes.end(); ++it) {
+        const auto obj = it.value().toObject();
+        HashEntry e;
+        e.size = obj[u"size"_q].toVariant().toLongLong();
+        e.mtime = obj[u"mtime"_q].toVariant().toLongLong();
+        e.time = obj[u"time"_q].toVariant().toLongLong();
+        e.hash = obj[u"hash"_q].toString();
+        d->hashes.insert(it.key(), e);
+    }
+    _Debug("Loaded %% search results and %% hashes from cache.",
+           d->entries.size(), d->hashes.size());
+    return true;
+}
+
+auto OpenSubtitlesCache::save() -> bool
+{
+    if (!d->dirty)
+        return true;
+    Data::prune(d->entries, MaxEntries);
+    Data::prune(d->hashes, MaxHashes);
+    QJsonObject entries;
+    for (auto it = d->entries.begin(); it != d->entries.end(); ++it) {
+        if (d->isExpired(it->time))
+            continue;
+        QJsonArray links;
+        for (auto &link : it->links) {
+            QJsonObject l;
+            l[u"file"_q] = link.fileName;
+            l[u"date"_q] = link.date;
+            l[u"lang"_q] = link.langCode;
+            l[u"url"_q] = link.url.toString();
+            links.push_back(l);
+        }
+        QJsonObject obj;
+        obj[u"time"_q] = QString::number(it->time);
+        obj[u"links"_q] = links;
+        entries.insert(it.key(), obj);
+    }
+    QJsonObject hashes;
+    for (auto it = d->hashes.begin(); it != d->hashes.end(); ++it) {
+        QJsonObject obj;
+        obj[u"size"_q] = QString::number(it->size);
+        obj[u"mtime"_q] = QString::number(it->mtime);
+        obj[u"time"_q] = QString::number(it->time);
+        obj[u"hash"_q] = it->hash;
+        hashes.insert(it.key(), obj);
+    }
+    QJsonObject json;
+    json[u"version"_q] = CacheVersion;
+    json[u"search"_q] = entries;
+    json[u"hash"_q] = hashes;
+    JsonStorage storage(d->fileName);
+    if (!storage.write(json))
+        return false;
+    d->dirty = false;
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef OPENSUBTITLESCACHE_HPP
+#define OPENSUBTITLESCACHE_HPP
+
+struct SubtitleLink;
+
+class OpenSubtitlesCache {
+public:
+    OpenSubtitlesCache();
+    ~OpenSubtitlesCache();
+    auto setExpiry(qint64 secs) -> void;
+    auto expiry() const -> qint64;
+    auto setFileName(const QString &fileName) -> void;
+    auto fileName() const -> QString;
+    // key is generated from the whole SearchSubtitles query
+    static auto key(const QVariantMap &query) -> QString;
+    auto find(const QString &key, QVector<SubtitleLink> *links) const -> bool;
+    auto insert(const QString &key, const QVector<SubtitleLink> &links) -> void;
+    // movie hash is valid while size and mtime of file are unchanged
+    auto hash(const QFileInfo &file) const -> QString;
+    auto setHash(const QFileInfo &file, const QString &hash) -> void;
+    auto clear() -> void;
+    auto load() -> bool;
+    auto save() -> bool;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // OPENSUBTITLESCACHE_HPP
@@ -1,17 +1,82 @@
 #include "opensubtitlesfinder.hpp"
+#include "opensubtitlescache.hpp"
 #include "player/mrl.hpp"
 #include "misc/xmlrpcclient.hpp"
 #include "misc/locale.hpp"
+#include "misc/dataevent.hpp"
+#include <QtEndian>
 
 SIA _Args() -> QVariantList { return QVariantList(); }
 auto translator_display_language(const QString &iso) -> QString;
 
+// OpenSubtitles accepts multiple queries per SearchSubtitles call
+static constexpr int QueriesPerCall = 10;
+
+static auto toLink(const QVariantMap &map) -> SubtitleLink
+{
+    SubtitleLink link;
+    link.fileName = map[u"SubFileName"_q].toString();
+    link.date = map[u"SubAddDate"_q].toString();
+    link.url = map[u"SubDownloadLink"_q].toString();
+    link.langCode = map[u"SubLanguageID"_q].toString();
+    if (link.langCode.isEmpty())
+        link.langCode = map[u"ISO639"_q].toString();
+    if (link.langCode.isEmpty())
+        link.langCode = map[u"LanguageName"_q].toString();
+    return link;
+}
+
+static auto toData(const QVariantList &results) -> QVariantList
+{
+    if (results.isEmpty() || results.first().type() != QVariant::Map)
+        return QVariantList();
+    return results.first().toMap()[u"data"_q].toList();
+}
+
+struct BatchItem {
+    QString key;
+    QVariantMap query;
+};
+
+struct FileHash {
+    QString fileName, hash;
+    qint64 bytes = 0;
+};
+
+enum { HashFiles = QEvent::User + 1, FilesHashed };
+
+// prefetched files are hashed here since reading them could stall GUI
+class HashThread : public QThread {
+public:
+    QObject *p = nullptr;
+private:
+    auto customEvent(QEvent *event) -> void final
+    {
+        if ((int)event->type() != HashFiles)
+            return;
+        const auto files = _MoveData<QStringList>(event);
+        QVector<FileHash> hashes;
+        hashes.reserve(files.size());
+        for (auto &file : files) {
+            FileHash h;
+            h.fileName = file;
+            h.hash = OpenSubtitlesFinder::movieHash(file, &h.bytes);
+            hashes.push_back(h);
+        }
+        _PostEvent(p, FilesHashed, hashes);
+    }
+};
+
 struct OpenSubtitlesFinder::Data {
     State state = Unavailable;
     OpenSubtitlesFinder *p = nullptr;
     XmlRpcClient client;
+    OpenSubtitlesCache cache;
     QString token, error;
     QTimer timer;
+    HashThread thread;
+    QSet<QString> hashing;
+    int pending = 0;
 
     void setState(State s) {
         if (_Change(state, s)) {
@@ -49,43 +114,134 @@ struct OpenSubtitlesFinder::Data {
         this->error = error;
         setState(Error);
     }
-    auto call(const QVariantMap &map) -> void
+    auto finish() -> void
     {
-        const auto args = _Args() << token << QVariant(QVariantList() << map);
-        client.call(u"SearchSubtitles"_q, args, p, [this] (const QVariantList &results) {
-            setState(Available);
-            if (results.isEmpty() || results.first().type() != QVariant::Map) {
-                emit p->found(QVector<SubtitleLink>());
-            } else {
-                const auto list = results.first().toMap()[u"data"_q].toList();
-                QVector<SubtitleLink> links;
-                for (auto &it : list) {
-                    if (it.type() != QVariant::Map)
-                        continue;
-                    auto const map = it.toMap();
-                    SubtitleLink link;
-                    link.fileName = map[u"SubFileName"_q].toString();
-                    link.date = map[u"SubAddDate"_q].toString();
-                    link.url = map[u"SubDownloadLink"_q].toString();
-                    link.langCode = map[u"SubLanguageID"_q].toString();
-                    if (link.langCode.isEmpty())
-                        link.langCode = map[u"ISO639"_q].toString();
-                    if (link.langCode.isEmpty())
-                        link.langCode = map[u"LanguageName"_q].toString();
-                    links.append(link);
-                }
-                emit p->found(links);
-            }
+        if (--pending <= 0) {
+            pending = 0;
+            cache.save();
+            if (state == Finding)
+                setState(Available);
+        }
+    }
+    auto send(const QVariantList &queries,
+              std::function<void(const QVariantList&)> &&done) -> void
+    {
+        ++pending;
+        setState(Finding);
+        const auto args = _Args() << token << QVariant(queries);
+        client.call(u"SearchSubtitles"_q, args, p,
+                    [this, done] (const QVariantList &results) {
+            done(toData(results));
+            finish();
         });
         timer.stop();
         timer.start();
     }
+    auto call(const QVariantMap &map) -> void
+    {
+        const auto key = OpenSubtitlesCache::key(map);
+        send(QVariantList() << map, [this, key] (const QVariantList &list) {
+            QVector<SubtitleLink> links;
+            for (auto &it : list) {
+                if (it.type() == QVariant::Map)
+                    links.append(toLink(it.toMap()));
+            }
+            if (!list.isEmpty())
+                cache.insert(key, links);
+            emit p->found(links);
+        });
+    }
+    auto search(const QVariantMap &map) -> bool
+    {
+        QVector<SubtitleLink> links;
+        if (cache.find(OpenSubtitlesCache::key(map), &links)) {
+            emit p->found(links);
+            return true;
+        }
+        if (state != Available)
+            return false;
+        call(map);
+        return true;
+    }
+    static auto hashQuery(const QString &hash, qint64 bytes) -> QVariantMap
+    {
+        QVariantMap map;
+        map[u"sublanguageid"_q] = u"all"_q;
+        map[u"moviehash"_q] = hash;
+        map[u"moviebytesize"_q] = bytes;
+        return map;
+    }
+    auto hashQuery(const QString &fileName) -> QVariantMap
+    {
+        const QFileInfo info(fileName);
+        auto hash = cache.hash(info);
+        qint64 bytes = info.size();
+        if (hash.isEmpty()) {
+            hash = movieHash(fileName, &bytes);
+            if (hash.isEmpty())
+                return QVariantMap();
+            cache.setHash(info, hash);
+        }
+        return hashQuery(hash, bytes);
+    }
+    // sends queries whose results are not cached yet; returns their count
+    auto prefetch(const QVector<QVariantMap> &queries) -> int
+    {
+        int count = 0;
+        QVector<BatchItem> batch;
+        for (auto &query : queries) {
+            BatchItem item;
+            item.query = query;
+            item.key = OpenSubtitlesCache::key(item.query);
+            QVector<SubtitleLink> links;
+            if (cache.find(item.key, &links))
+                continue;
+            ++count;
+            batch.push_back(item);
+            if (batch.size() >= QueriesPerCall) {
+                sendBatch(batch);
+                batch.clear();
+            }
+        }
+        if (!batch.isEmpty())
+            sendBatch(batch);
+        return count;
+    }
+    auto sendBatch(const QVector<BatchItem> &items) -> void
+    {
+        QVariantList queries;
+        for (auto &item : items)
+            queries.push_back(item.query);
+        send(queries, [this, items] (const QVariantList &list) {
+            QHash<QString, QVector<SubtitleLink>> links;
+            for (auto &it : list) {
+                if (it.type() != QVariant::Map)
+                    continue;
+                const auto map = it.toMap();
+                links[map[u"MovieHash"_q].toString()].append(toLink(map));
+            }
+            if (list.isEmpty())
+                return;
+            for (auto &item : items)
+                cache.insert(item.key, links.value(item.query[u"moviehash"_q].toString()));
+        });
+    }
 };
 
 OpenSubtitlesFinder::OpenSubtitlesFinder(QObject *parent)
+    : OpenSubtitlesFinder(QUrl(), QString(), parent) { }
+
+OpenSubtitlesFinder::OpenSubtitlesFinder(const QUrl &server, const QString &cacheFile,
+                                         QObject *parent)
 : QObject(parent), d(new Data) {
     d->p = this;
-    d->client.setUrl(QUrl(u"http://api.opensubtitles.org/xml-rpc"_q));
+    d->thread.p = this;
+    d->thread.start();
+    d->thread.moveToThread(&d->thread);
+    if (!cacheFile.isEmpty())
+        d->cache.setFileName(cacheFile);
+    d->cache.load();
+    d->client.setUrl(server.isEmpty() ? QUrl(u"http://api.opensubtitles.org/xml-rpc"_q) : server);
     d->client.setCompressed(true);
     d->login();
     d->timer.setInterval(13 * 60 * 1000);
@@ -113,28 +269,28 @@ OpenSubtitlesFinder::OpenSubtitlesFinder(QObject *parent)
 }
 
 OpenSubtitlesFinder::~OpenSubtitlesFinder() {
+    d->thread.quit();
+    d->thread.wait();
     d->timer.stop();
     d->logout();
+    d->cache.save();
     delete d;
 }
 
 auto OpenSubtitlesFinder::find(const QString &tag) -> bool
 {
-    if (d->state != Available || tag.isEmpty())
+    if (tag.isEmpty())
         return false;
-    d->setState(Finding);
     QVariantMap map;
     map[u"sublanguageid"_q] = u"all"_q;
     map[u"tag"_q] = tag;
-    d->call(map);
-    return true;
+    return d->search(map);
 }
 
 auto OpenSubtitlesFinder::find(const QString &query, int season, int episode) -> bool
 {
-    if (d->state != Available || query.isEmpty())
+    if (query.isEmpty())
         return false;
-    d->setState(Finding);
     QVariantMap map;
     map[u"sublanguageid"_q] = u"all"_q;
     map[u"query"_q] = query;
@@ -142,46 +298,98 @@ auto OpenSubtitlesFinder::find(const QString &query, int season, int episode) ->
         map[u"season"_q] = season;
     if (episode >= 0)
         map[u"episode"_q] = episode;
-    d->call(map);
-    return true;
+    return d->search(map);
 }
 
 auto OpenSubtitlesFinder::find(const Mrl &mrl) -> bool
 {
-    if (d->state != Available)
-        return false;
-    auto fileName = mrl.toLocalFile();
+    const auto fileName = mrl.toLocalFile();
     if (fileName.isEmpty())
         return false;
+    const auto map = d->hashQuery(fileName);
+    if (map.isEmpty())
+        return false;
+    return d->search(map);
+}
+
+auto OpenSubtitlesFinder::prefetch(const QStringList &files) -> int
+{
+    if (d->state != Available && d->state != Finding)
+        return 0;
+    QVector<QVariantMap> queries;
+    QStringList unhashed;
+    for (auto &file : files) {
+        const QFileInfo info(file);
+        const auto hash = d->cache.hash(info);
+        if (!hash.isEmpty())
+            queries.push_back(Data::hashQuery(hash, info.size()));
+        else if (!d->hashing.contains(file)) {
+            d->hashing.insert(file);
+            unhashed.push_back(file);
+        }
+    }
+    if (!unhashed.isEmpty())
+        _PostEvent(&d->thread, HashFiles, unhashed);
+    return d->prefetch(queries) + unhashed.size();
+}
+
+auto OpenSubtitlesFinder::customEvent(QEvent *event) -> void
+{
+    if ((int)event->type() != FilesHashed)
+        return;
+    const auto hashes = _MoveData<QVector<FileHash>>(event);
+    QVector<QVariantMap> queries;
+    for (auto &h : hashes) {
+        d->hashing.remove(h.fileName);
+        if (h.hash.isEmpty())
+            continue;
+        d->cache.setHash(QFileInfo(h.fileName), h.hash);
+        queries.push_back(Data::hashQuery(h.hash, h.bytes));
+    }
+    if (d->state == Available || d->state == Finding)
+        d->prefetch(queries);
+    d->cache.save();
+}
+
+auto OpenSubtitlesFinder::movieHash(const QString &fileName,
+                                    qint64 *bytes) -> QString
+{
     QFile file(fileName);
     if (!file.open(QFile::ReadOnly))
-        return false;
-    const auto bytes = file.size();
+        return QString();
+    *bytes = file.size();
     constexpr int len = 64*1024;
-    if (bytes < len)
-        return false;
-    d->setState(Finding);
+    if (*bytes < len)
+        return QString();
     constexpr int chunks = len/sizeof(quint64);
-    QDataStream in(&file);
-    in.setByteOrder(QDataStream::LittleEndian);
-    auto sum = [&chunks, &file, &in] (qint64 offset) {
-        file.seek(offset); quint64 hash = 0, chunk = 0;
-        for (int i=0; i<chunks; ++i) { in >> chunk; hash += chunk; } return hash;
+    // short read means file changed or is unreadable; no hash is better
+    // than a wrong one
+    auto sum = [&] (qint64 offset, quint64 *hash) -> bool {
+        if (!file.seek(offset))
+            return false;
+        const auto data = file.read(len);
+        if (data.size() != len)
+            return false;
+        auto p = reinterpret_cast<const uchar*>(data.constData());
+        for (int i=0; i<chunks; ++i, p += sizeof(quint64))
+            *hash += qFromLittleEndian<quint64>(p);
+        return true;
     };
-    quint64 h = bytes + sum(0) + sum(bytes-len);
+    quint64 h = *bytes;
+    if (!sum(0, &h) || !sum(*bytes - len, &h))
+        return QString();
     auto hash = QString::number(h, 16);
     if (hash.size() < 16)
         hash = _N(0, 10, 16-hash.size(), '0'_q) + hash;
-
-    QVariantMap map;
-    map[u"sublanguageid"_q] = u"all"_q;
-    map[u"moviehash"_q] = hash;
-    map[u"moviebytesize"_q] = bytes;
-    d->call(map);
-    return true;
+    return hash;
 }
 
 auto OpenSubtitlesFinder::state() const -> OpenSubtitlesFinder::State
 {
     return d->state;
 }
+
+auto OpenSubtitlesFinder::error() const -> QString
+{
+    return d->error;
+}
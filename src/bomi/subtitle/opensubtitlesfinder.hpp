@@ -15,17 +15,26 @@ public:
         Unavailable = 1, Error = 16, Connecting = 8, Available = 2, Finding = 4
     };
     OpenSubtitlesFinder(QObject *parent = nullptr);
+    // empty server or cache file for defaults
+    OpenSubtitlesFinder(const QUrl &server, const QString &cacheFile,
+                        QObject *parent = nullptr);
     ~OpenSubtitlesFinder();
     auto find(const Mrl &mrl) -> bool;
     auto find(const QString &tag) -> bool;
     auto find(const QString &query, int season, int episode) -> bool;
+    // looks up files in batches and caches results for later find() without
+    // reporting them; files are hashed in background if not hashed before;
+    // returns number of files which are looked up or hashed for it
+    auto prefetch(const QStringList &files) -> int;
     auto state() const -> State;
     auto isAvailable() const -> bool { return state() == Available; }
     auto error() const -> QString;
+    static auto movieHash(const QString &fileName, qint64 *bytes) -> QString;
 signals:
     void stateChanged();
     void found(const QVector<SubtitleLink> &links);
 private:
+    auto customEvent(QEvent *event) -> void final;
     struct Data;
     Data *d;
 };
@@ -1,4 +1,97 @@
 #include "subtitledrawer.hpp"
+#include "misc/cpukernel.hpp"
+
+template<int>
+CPU_INLINE auto accumulateBody(int *__restrict sums, const uchar *__restrict add,
+                               const uchar *__restrict sub, int width) -> void
+{
+    for (int x = 0; x < width; ++x)
+        sums[x] += add[x] - sub[x];
+}
+
+CPU_KERNEL_VARIANTS(accumulate, void, (int *sums, const uchar *add, const uchar *sub, int width),
+                    (sums, add, sub, width))
+
+static CpuKernel<auto (int*, const uchar*, const uchar*, int) -> void>
+s_accumulate("blur-accumulate", CPU_KERNEL_LIST(accumulate), [] (auto accumulate) {
+    static const auto rows = CpuKernels::noise<uchar>(1920 * 2);
+    static std::vector<int> sums(1920);
+    accumulate(sums.data(), rows.data(), rows.data() + 1920, 1920);
+}, [] (auto accumulate, auto generic) {
+    const auto rows = CpuKernels::noise<uchar>(2051 * 2);
+    std::vector<int> out(2051, 1000), ref = out;
+    accumulate(out.data(), rows.data(), rows.data() + 2051, 2051);
+    generic(ref.data(), rows.data(), rows.data() + 2051, 2051);
+    return CpuKernels::same(out, ref);
+});
+
+auto FastAlphaBlur::applyTo(QImage &mask, const QColor &color, int radius) -> void
+{
+    if (radius < 1 || mask.isNull())
+        return;
+    setSize(mask.size());
+    setRadius(radius);
+    const int w = s.width();
+    const int h = s.height();
+
+    uchar *a = valpha.data();
+    const uchar *inv = vinv.constData();
+    int *min = vmin.data();
+    int *max = vmax.data();
+
+    const int xmax = mask.width()-1;
+    for (int x=0; x<w; ++x) {
+        min[x] = qMin(x + radius + 1, xmax);
+        max[x] = qMax(x - radius, 0);
+    }
+
+    const uchar *c_bits = mask.constBits()+3;
+    uchar *it = a;
+    for (int y=0; y<h; ++y, c_bits += (mask.width() << 2)) {
+        int sum = 0;
+        for(int i=-radius; i<=radius; ++i)
+            sum += c_bits[qBound(0, i, xmax) << 2];
+        for (int x=0; x<w; ++x, ++it) {
+            sum += c_bits[min[x] << 2];
+            sum -= c_bits[max[x] << 2];
+            *it = inv[sum];
+        }
+    }
+
+    const int ymax = mask.height()-1;
+    for (int y=0; y<h; ++y){
+        min[y] = qMin(y + radius + 1, ymax)*w;
+        max[y] = qMax(y - radius, 0)*w;
+    }
+
+    // vertical pass runs along rows with running sum of every column
+    // so that consecutive columns are updated together
+    int *sums = vsum.data();
+    std::fill_n(sums, w, 0);
+    for (int i=-radius; i<=radius; ++i) {
+        const uchar *row = a + qMax(0, i*w);
+        for (int x=0; x<w; ++x)
+            sums[x] += row[x];
+    }
+
+    uchar *bits = mask.bits();
+    const double r = color.redF();
+    const double g = color.greenF();
+    const double b = color.blueF();
+    for (int y=0; y<h; ++y, bits += (mask.width() << 2)) {
+        uchar *p = bits;
+        for (int x=0; x<w; ++x, p += 4) {
+            if (p[3] < 255) {
+                const uchar alpha = inv[sums[x]];
+                p[0] = alpha*b;
+                p[1] = alpha*g;
+                p[2] = alpha*r;
+                p[3] = alpha;
+            }
+        }
+        s_accumulate(sums, a + min[y], a + max[y], w);
+    }
+}
 
 SubCompImage::SubCompImage(const SubComp *comp, Iterator it, void *creator)
     : m_comp(comp)
@@ -57,6 +150,7 @@ auto SubtitleDrawer::setStyle(const OsdStyle &style) -> void
 auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
                           const QRectF &area, double dpr) -> QVector<QRectF>
 {
+    AllocScope scope("subtitle-draw");
     QVector<QRectF> bboxes;
     gap = 0;
     if (!(m_drawn = text.hasWords()))
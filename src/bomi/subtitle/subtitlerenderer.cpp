@@ -4,6 +4,10 @@
 #include "enum/autoselectmode.hpp"
 #include "opengl/opengltexture2d.hpp"
 #include "opengl/opengltexturebinder.hpp"
+#include <QElapsedTimer>
+
+// time-pos ticks are ignored while video frames drive subtitles
+static constexpr int PresentTimeout = 500;
 
 struct SubtitleShaderData : public SubtitleRenderer::ShaderData {
     const OpenGLTexture2D *texture, *bbox;
@@ -60,13 +64,17 @@ struct SubtitleRenderer::Data {
     QList<SubComp*> loaded;
     QSize imageSize{0, 0};
     SubtitleDrawer drawer;
-    int delay = 0, msec = 0, lastTime = -1;
-    bool selecting = false, textChanged = true;
+    int delay = 0, msec = -1, lastTime = -1;
+    // content version and version in texture
+    int version = 0, uploaded = -1;
+    bool selecting = false, textChanged = true, frameQueued = false;
     bool top = false, hidden = false, empty = true;
     double pos = 1.0;
     QMap<QString, int> langMap;
     QMutex mutex;
     QWaitCondition wait;
+    QElapsedTimer presented;
+    FrameTimeFunc frameTime;
     RichTextDocument text;
     int language_priority(const SubComp &comp) const {
 //        return langMap.value(r->comp->language().id(), -1);
@@ -99,6 +107,10 @@ struct SubtitleRenderer::Data {
         drawer.setMargin(margin);
         p->reserve(UpdateGeometry);
     }
+    void changed() {
+        textChanged = true;
+        ++version;
+    }
     void applySelection() {
         empty = selection.isEmpty();
         emit p->selectionChanged();
@@ -106,12 +118,22 @@ struct SubtitleRenderer::Data {
             render(SubCompSelection::Rerender);
         else
             p->setVisible(false);
-        textChanged = true;
+        changed();
     }
     void render(int flags) {
-        if (!hidden && !empty && msec > 0)
+        if (!hidden && !empty && msec >= 0)
             selection.render(msec - delay, flags);
     }
+    // ms is time of the frame which is drawn next
+    void present(int ms) {
+        presented.start();
+        msec = ms;
+        if (hidden || empty || ms < 0)
+            return;
+        if (selection.present(ms - delay))
+            changed();
+        render(SubCompSelection::Tick);
+    }
     void updateVisible() {
         p->setVisible(!hidden && !empty && !imageSize.isEmpty());
     }
@@ -137,10 +159,26 @@ auto SubtitleRenderer::isTopAligned() const -> bool
 
 auto SubtitleRenderer::render(int ms) -> void
 {
+    if (d->presented.isValid() && d->presented.elapsed() < PresentTimeout)
+        return;
+    d->selection.present(-1);
     d->msec = ms;
     d->render(SubCompSelection::Tick);
 }
 
+auto SubtitleRenderer::setFrameTimeFunction(FrameTimeFunc &&func) -> void
+{
+    d->frameTime = std::move(func);
+}
+
+auto SubtitleRenderer::syncToFrame() -> void
+{
+    if (d->hidden || d->empty || !d->frameTime)
+        return;
+    d->frameQueued = true;
+    reserve(UpdateMaterial);
+}
+
 auto SubtitleRenderer::rerender() -> void
 {
     d->render(SubCompSelection::Rerender);
@@ -156,6 +194,7 @@ auto SubtitleRenderer::initializeGL() -> void
     SimpleTextureItem::initializeGL();
     texture().create();
     d->bbox.create();
+    d->uploaded = -1;
 }
 
 auto SubtitleRenderer::finalizeGL() -> void
@@ -266,7 +305,7 @@ auto SubtitleRenderer::unload() -> void
     d->loaded.clear();
     setVisible(false);
     d->empty = true;
-    d->textChanged = true;
+    d->changed();
     emit selectionChanged();
 }
 
@@ -289,7 +328,18 @@ auto SubtitleRenderer::createData() const -> ShaderData*
 auto SubtitleRenderer::updateData(ShaderData *sd) -> void
 {
     auto data = static_cast<SubtitleShaderData*>(sd);
-    updateTexture(&texture());
+    // caption is picked here, while GUI thread is blocked, for the frame
+    // which this render of scene graph draws
+    if (d->frameQueued) {
+        d->frameQueued = false;
+        int ms = -1;
+        if (d->frameTime(&ms))
+            d->present(ms);
+    }
+    if (d->uploaded != d->version) {
+        d->uploaded = d->version;
+        updateTexture(&texture());
+    }
     data->bboxColor = d->drawer.style().bbox.color;
 }
 
@@ -574,10 +624,22 @@ auto SubtitleRenderer::selection() const -> QVector<SubComp>
 
 auto SubtitleRenderer::customEvent(QEvent *event) -> void
 {
-    if (event->type() == SubCompSelection::ImagePrepared) {
-        if (d->selection.update(_GetData<SubCompImage>(event)))
-            d->textChanged = true;
-        reserve(UpdateMaterial);
+    switch (static_cast<int>(event->type())) {
+    case SubCompSelection::ImagePrepared: {
+        SubCompImage image(nullptr); int from, to;
+        _TakeData(event, image, from, to);
+        if (d->selection.update(image, from, to)) {
+            d->changed();
+            reserve(UpdateMaterial);
+        }
+        break;
+    } case SubCompSelection::NextImagePrepared: {
+        SubCompImage image(nullptr); int from, to;
+        _TakeData(event, image, from, to);
+        d->selection.prefetch(image, from, to);
+        break;
+    } default:
+        break;
     }
 }
 
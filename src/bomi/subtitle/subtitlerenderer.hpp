@@ -12,6 +12,8 @@ enum class AutoselectMode;
 class SubtitleRenderer : public SimpleTextureItem  {
     Q_OBJECT
 public:
+    // time in msec of the video frame which scene graph draws next
+    using FrameTimeFunc = std::function<bool(int *ms)>;
     SubtitleRenderer(QQuickItem *parent = nullptr);
     ~SubtitleRenderer();
     auto previous() const -> int;
@@ -43,6 +45,10 @@ public:
     auto updateVertexOnGeometryChanged() const -> bool override { return true; }
     auto setHidden(bool hidden) -> void;
     auto render(int ms) -> void;
+    // called in scene graph sync, not in GUI thread
+    auto setFrameTimeFunction(FrameTimeFunc &&func) -> void;
+    // new video frame is queued; caption for it is picked in next sync
+    auto syncToFrame() -> void;
     auto setTopAligned(bool top) -> void;
     auto setFPS(double fps) -> void;
     auto toTrackList() const -> StreamList;
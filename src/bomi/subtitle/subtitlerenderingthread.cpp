@@ -1,5 +1,28 @@
 #include "subtitlerenderingthread.hpp"
 #include "misc/dataevent.hpp"
+#include "misc/memorygovernor.hpp"
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+// images prepared ahead of time are dropped while memory is tight
+static QAtomicInt s_lean;
+// no images are prepared ahead of time in low power mode
+static QAtomicInt s_noPrefetch;
+
+static auto memory() -> MemoryConsumer&
+{
+    struct Consumer : public MemoryConsumer {
+        Consumer(): MemoryConsumer(u"subtitle images"_q,
+                                   MemoryPriority::SubtitleCache)
+        {
+            setReclaim([this] (qint64) -> qint64
+                { s_lean.store(1); return usage(); });
+            setRestore([] () { s_lean.store(0); });
+        }
+    };
+    static Consumer consumer;
+    return consumer;
+}
 
 template<>
 inline bool qMapLessThanKey(const SubCompItMapIt &lhs,
@@ -20,6 +43,26 @@ struct SubCompSelection::Thread::Data {
     QMutex *mutex; QWaitCondition *wait;
     QRectF rect; SubtitleDrawer drawer;
     SubCompSelection *selection = nullptr;
+    qint64 bytes = 0;
+
+    auto account() -> void
+    {
+        qint64 sum = 0;
+        for (auto &pic : pool)
+            sum += pic.byteCount();
+        memory().addUsage(sum - bytes);
+        bytes = sum;
+    }
+    auto trim() -> void
+    {
+        auto iit = pool.begin();
+        while (iit != pool.end()) {
+            if (iit.key() != it)
+                iit = pool.erase(iit);
+            else
+                ++iit;
+        }
+    }
 
     SubComp::ConstIt iterator(int time) const { return comp->start(time, fps); }
     auto newPicture(SubCompItMapIt it)
@@ -28,24 +71,31 @@ struct SubCompSelection::Thread::Data {
         drawer.draw(*pic, rect, dpr);
         return pic;
     }
+    auto end(SubCompItMapIt key) const -> int
+        { return ++key == its.end() ? _Max<int>() : key.key(); }
     auto update()
     {
         if (quit)
             return;
-        auto post = [this] (const SubCompImage &pic)
-            { _PostEvent(receiver, ImagePrepared, pic); };
-        if (it != its.end()) {
-            auto cache = pool.find(it);
+        auto post = [this] (int type, SubCompItMapIt key) {
+            auto cache = pool.find(key);
             if (cache == pool.end())
-                cache = newPicture(it);
-            post(*cache);
+                cache = newPicture(key);
+            _PostEvent(receiver, type, *cache, key.key(), end(key));
+        };
+        if (it != its.end()) {
+            post(ImagePrepared, it);
+            // renderer switches to next one by itself at the exact frame
+            auto next = it;
+            if (++next != its.end() && !s_lean.load() && !s_noPrefetch.load())
+                post(NextImagePrepared, next);
         } else
-            post(comp);
+            _PostEvent(receiver, ImagePrepared, SubCompImage(comp), -1, -1);
     }
 
     auto fillCache()
     {
-        if (it == its.end())
+        if (it == its.end() || s_lean.load() || s_noPrefetch.load())
             return;
         auto iit = pool.begin();
         while (iit != pool.end() && iit.key().key() < it.key())
@@ -104,6 +154,8 @@ SubCompSelection::Thread::Thread(QMutex *mutex, QWaitCondition *wait,
 SubCompSelection::Thread::~Thread()
 {
     finish();
+    d->pool.clear();
+    d->account();
     delete d;
 }
 
@@ -155,6 +207,9 @@ auto SubCompSelection::Thread::run() -> void
             break;
         if (d->time > 0 && d->fps > 0.0 && !d->its.isEmpty())
             d->draw(flags & ForceUpdate);
+        if (s_lean.load() || s_noPrefetch.load())
+            d->trim();
+        d->account();
     }
 }
 
@@ -167,6 +222,12 @@ struct SubCompSelection::Data {
     SubtitleDrawer drawer;
     QRectF rect;
     double dpr = 1.0, fps = 30.0;
+    int presented = -1, interval = 0;
+    // on/off error of captions against displayed frames
+    struct {
+        int count = 0, late = 0, max = 0;
+        qint64 sum = 0;
+    } error;
 };
 
 SubCompSelection::SubCompSelection(QObject *renderer)
@@ -206,6 +267,7 @@ auto SubCompSelection::clear() -> void
         item.thread->finish();
     wait.wakeAll();
     qApp->removePostedEvents(d->renderer, ImagePrepared);
+    qApp->removePostedEvents(d->renderer, NextImagePrepared);
     for (auto &item : items)
         item.release();
     items.clear();
@@ -254,15 +316,78 @@ auto SubCompSelection::setFPS(double fps) -> void
         forThreads([this, fps] (Thread *t) { t->setFPS(fps); });
 }
 
-auto SubCompSelection::update(const SubCompImage &image) -> bool
+auto SubCompSelection::update(const SubCompImage &image,
+                              int from, int to) -> bool
 {
     auto item = this->item(image);
     if (!item)
         return false;
+    const int time = d->presented;
+    // late one which was prepared before switching to prefetched image
+    if (time >= 0 && from < item->from
+            && item->from <= time && time < item->to)
+        return false;
+    if (time >= 0 && from >= 0 && from != item->from && from <= time)
+        measure(from);
     item->image = image;
+    item->from = from;
+    item->to = to;
     return true;
 }
 
+auto SubCompSelection::prefetch(const SubCompImage &image,
+                                int from, int to) -> void
+{
+    auto item = this->item(image);
+    if (!item)
+        return;
+    item->next = image;
+    item->nextFrom = from;
+    item->nextTo = to;
+}
+
+auto SubCompSelection::present(int ms) -> bool
+{
+    if (ms >= 0 && d->presented >= 0 && ms > d->presented)
+        d->interval = ms - d->presented;
+    d->presented = ms;
+    if (ms < 0)
+        return false;
+    bool changed = false;
+    for (auto &item : items) {
+        if (item.nextFrom < 0 || ms < item.nextFrom)
+            continue;
+        if (ms < item.nextTo && item.nextFrom != item.from) {
+            measure(item.nextFrom);
+            item.image = item.next;
+            item.from = item.nextFrom;
+            item.to = item.nextTo;
+            changed = true;
+        }
+        item.next = SubCompImage(nullptr);
+        item.nextFrom = item.nextTo = -1;
+    }
+    return changed;
+}
+
+auto SubCompSelection::measure(int from) -> void
+{
+    static constexpr int ReportCount = 100;
+    auto &e = d->error;
+    const int error = d->presented - from;
+    ++e.count;
+    e.sum += error;
+    e.max = qMax(e.max, error);
+    if (d->interval > 0 && error >= d->interval)
+        ++e.late;
+    if (e.count < ReportCount)
+        return;
+    _Debug("Caption on/off error for %% transitions: mean %%ms, max %%ms, "
+           "%% later than a frame(%%ms)", e.count, e.sum/e.count, e.max,
+           e.late, d->interval);
+    e = {};
+}
+
 auto SubCompSelection::setMargin(double top, double bottom,
                                  double right, double left) -> void
 {
@@ -271,3 +396,8 @@ auto SubCompSelection::setMargin(double top, double bottom,
     margin.right = right; margin.left = left;
     d->drawer.setMargin(margin);
 }
+
+auto SubCompSelection::setPrefetchEnabled(bool enabled) -> void
+{
+    s_noPrefetch.store(!enabled);
+}
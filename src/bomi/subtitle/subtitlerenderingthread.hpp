@@ -9,6 +9,8 @@ using SubCompItMapIt = SubCompItMap::const_iterator;
 class SubCompSelection {
 public:
     static constexpr int ImagePrepared = QEvent::User+1;
+    // image of next caption which will be shown from its start time
+    static constexpr int NextImagePrepared = QEvent::User+2;
     enum Flag {
         NewDrawer = 1, NewArea = 2, Rebuild = 4, Rerender = 8, Tick = 16
     };
@@ -36,7 +38,9 @@ private:
         auto release() -> void;
         Thread *thread  = nullptr;
         const SubComp *comp = nullptr;
-        SubCompImage image{nullptr};
+        SubCompImage image{nullptr}, next{nullptr};
+        // time range in ms where image is shown
+        int from = -1, to = -1, nextFrom = -1, nextTo = -1;
     };
     using List = std::list<Item>;
 public:
@@ -57,13 +61,20 @@ public:
     auto isEmpty() const -> bool;
     auto prepend(const SubComp *comp) -> bool;
     auto contains(const SubComp *comp) const -> bool;
-    auto update(const SubCompImage &pic) -> bool;
+    auto update(const SubCompImage &pic, int from, int to) -> bool;
+    auto prefetch(const SubCompImage &pic, int from, int to) -> void;
+    // ms is time of the frame to be displayed or negative if unknown;
+    // switch to prefetched images which should appear in that frame
+    auto present(int ms) -> bool;
     auto fps() const -> double;
     auto setFPS(double fps) -> void;
     auto setMargin(double top, double bottom,
                    double right, double left) -> void;
+    // render next images ahead of time; global for all selections
+    static auto setPrefetchEnabled(bool enabled) -> void;
 private:
     auto item(const SubCompImage &image) -> Item*;
+    auto measure(int from) -> void;
     auto find(const SubComp *comp) -> List::iterator;
     auto find(const SubComp *comp) const -> List::const_iterator;
     template<class Func>
@@ -0,0 +1,50 @@
+#include "selftest.hpp"
+#include "audio/audioanalyzer.hpp"
+
+SELF_TEST(AudioAnalyzer, "normalizer-continuity")
+{
+    auto pool = mp_audio_pool_create(nullptr);
+    mp_chmap stereo;
+    mp_chmap_from_channels(&stereo, 2);
+    AudioAnalyzer analyzer;
+    analyzer.setPool(pool);
+    AudioNormalizerOption option;
+    option.smoothing = 3;
+    option.chunk_sec = 0.1;
+    analyzer.setNormalizerActive(true);
+    analyzer.setNormalizerOption(option);
+
+    // quiet sine; returns gains of pulled buffers
+    qint64 t = 0;
+    auto play = [&] (int fps, double sec) {
+        const AudioBufferFormat format(AF_FORMAT_FLOAT, stereo, fps);
+        analyzer.setFormat(format);
+        QVector<double> gains;
+        for (int frames = 0; frames < fps * sec; frames += 1024) {
+            auto buffer = analyzer.newBuffer(format, 1024);
+            auto view = buffer->view<float>();
+            auto p = view.begin();
+            for (int i = 0; i < 1024; ++i, ++t)
+                p[2*i] = p[2*i + 1] = 0.1 * std::sin(t * 2 * M_PI * 440 / fps);
+            analyzer.push(buffer);
+            while (analyzer.pull())
+                gains.push_back(analyzer.gain());
+        }
+        return gains;
+    };
+    const auto first = play(48000, 3.0);
+    const double before = analyzer.gain();
+    if (SELF_VERIFY(test, !first.isEmpty() && before > 2.0)) {
+        // track switch: chain is torn down and rebuilt in another rate
+        analyzer.reset();
+        const auto second = play(44100, 1.0);
+        SELF_VERIFY(test, !second.isEmpty());
+        double prev = before, jump = 0.0;
+        for (auto gain : second) {
+            jump = qMax(jump, qAbs(gain - prev) / prev);
+            prev = gain;
+        }
+        SELF_VERIFY(test, jump < 0.01);
+    }
+    talloc_free(pool);
+}
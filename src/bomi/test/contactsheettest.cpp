@@ -0,0 +1,45 @@
+#include "selftest.hpp"
+#include "fixture.hpp"
+#include "video/contactsheet.hpp"
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+// headless batch over folder as --contact-sheets does
+SELF_TEST(ContactSheets, "contact-sheets")
+{
+    QTemporaryDir dir;
+    QStringList files;
+    for (int i = 0; i < 4; ++i) {
+        files.push_back(dir.path() % "/video"_a % _N(i) % ".mkv"_a);
+        if (!SELF_VERIFY(test, fixture::writeVideo(files.last(), 10000)))
+            return;
+    }
+    const auto broken = fixture::createFile(dir.path() % "/broken.mkv"_a,
+                                            fixture::pattern(4096));
+    ContactSheetOption option;
+    option.columns = option.rows = 3;
+    option.width = 160;
+    option.format = u"png"_q;
+
+    ContactSheetEngine engine;
+    engine.setOption(option);
+    bool finished = false;
+    QObject::connect(&engine, &ContactSheetEngine::finished, [&] () { finished = true; });
+    if (!SELF_VERIFY(test, engine.start(QStringList(files) << broken, QString())))
+        return;
+    SELF_VERIFY(test, SelfTest::wait([&] () { return finished; }, 60000));
+    QThreadPool::globalInstance()->waitForDone();
+    const auto result = engine.result();
+    SELF_VERIFY(test, result.total == 5 && result.made == 4 && result.failed == 1);
+    SELF_VERIFY(test, result.filesPerMinute() > 0);
+    for (int i = 0; i < 4; ++i) {
+        const QImage sheet(ContactSheetEngine::sheetFileName(files[i], QString(), option));
+        SELF_VERIFY(test, !sheet.isNull() && sheet.width() > 3 * 160);
+    }
+    test.result(u"throughput"_q, result.toString());
+
+    // single file through the same entry as command line
+    SELF_VERIFY(test, ContactSheetEngine::run(files[0], option) == 0);
+    SELF_VERIFY(test, ContactSheetEngine::run(dir.path(), option) == 1);
+    SELF_VERIFY(test, ContactSheetEngine::run(dir.path() % "/none"_a, option) == 1);
+}
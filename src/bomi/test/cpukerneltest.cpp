@@ -0,0 +1,21 @@
+#include "selftest.hpp"
+#include "misc/cpukernel.hpp"
+
+// variants must agree with generic one on every level this CPU runs
+SELF_TEST(CpuKernels, "cpukernels")
+{
+    const auto detected = CpuKernels::detect();
+    for (auto kernel : CpuKernels::list()) {
+        const auto name = _L(kernel->name());
+        if (!kernel->isCheckable()) {
+            test.fail(name % " has no check"_a);
+            continue;
+        }
+        for (int i = 0; i <= (int)detected; ++i) {
+            const auto level = (CpuLevel)i;
+            if (kernel->has(level) && !kernel->check(level))
+                test.fail(name % ' '_q % CpuKernels::levelName(level)
+                          % " differs from generic"_a);
+        }
+    }
+}
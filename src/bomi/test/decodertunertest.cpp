@@ -0,0 +1,92 @@
+#include "selftest.hpp"
+#include "player/decodertuner.hpp"
+
+SELF_TEST(DecoderTuner, "decodertuner")
+{
+    DecoderTuner tuner{QString()};
+    tuner.setMaximum(16);
+    const int max = tuner.maximum();
+    double time = 0;
+    qint64 decoded = 0, dropped = 0;
+    auto play = [&] (const QString &codec, int height) {
+        time = decoded = dropped = 0;
+        return tuner.start(codec, QSize(height * 16 / 9, height), 30);
+    };
+    // playback of 30fps waited given msec per frame over a window of frames
+    auto feed = [&] (double wait, int frames = 60) {
+        time += wait * 1e-3 * frames;
+        decoded += frames;
+        return tuner.update(time, decoded, dropped);
+    };
+    auto restart = [&] () { time = decoded = 0; };
+    auto raised = [&] (int threads) {
+        const int next = qMin(threads * 2, max);
+        return next > threads ? next : 0;
+    };
+
+    // first guess from pixel rate and codec
+    SELF_VERIFY(test, play(u"h264"_q, 1080) == qMin(2, max));
+    SELF_VERIFY(test, play(u"mpeg2video"_q, 480) == 1);
+    SELF_VERIFY(test, play(u"vp9"_q, 1080) == qMin(4, max));
+    SELF_VERIFY(test, tuner.threads() == qMin(4, max));
+    tuner.stop();
+
+    // waiting a part of frame interval is not a reason to change; with frame
+    // threads this says nothing about cost of a frame
+    int threads = play(u"vp9"_q, 1080);
+    for (int i = 0; i < 3; ++i)
+        SELF_VERIFY(test, feed(15) == 0);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"vp9"_q, 1080) == threads);
+    tuner.stop();
+
+    // too few frames to judge
+    play(u"hevc"_q, 720);
+    SELF_VERIFY(test, feed(40, 30) == 0);
+
+    // falling behind doubles threads, at most twice per stream
+    threads = play(u"hevc"_q, 720);
+    SELF_VERIFY(test, threads == qMin(2, max));
+    for (int i = 0; i < 2; ++i) {
+        const int next = raised(threads);
+        SELF_VERIFY(test, feed(30) == next);
+        threads = qMax(threads, next);
+        restart();
+    }
+    SELF_VERIFY(test, feed(30) == 0);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"hevc"_q, 720) == threads);
+    // spare time never lowers below a count which fell behind
+    SELF_VERIFY(test, feed(1) == 0 && feed(1) == 0);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"hevc"_q, 720) == threads);
+    tuner.stop();
+
+    // spare time lowers count for next stream, but not below one
+    threads = play(u"h264"_q, 1080);
+    SELF_VERIFY(test, feed(1) == 0 && feed(1) == 0);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"h264"_q, 1080) == qMax(1, threads - 1));
+    SELF_VERIFY(test, feed(1) == 0);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"h264"_q, 1080) == qMax(1, threads - 2));
+    tuner.stop();
+
+    // dropped frames mean falling behind; raised count is kept even if
+    // stream ends before next window
+    threads = play(u"av1"_q, 720);
+    SELF_VERIFY(test, feed(5) == 0);
+    dropped += 3;
+    const int next = raised(threads);
+    SELF_VERIFY(test, feed(5) == next);
+    tuner.stop();
+    SELF_VERIFY(test, play(u"av1"_q, 720) == qMax(threads, next));
+    tuner.stop();
+
+    // low power cap
+    tuner.setMaximum(1);
+    SELF_VERIFY(test, play(u"vp9"_q, 1080) == 1);
+    tuner.stop();
+    tuner.setEnabled(false);
+    SELF_VERIFY(test, play(u"vp9"_q, 1080) == 0);
+}
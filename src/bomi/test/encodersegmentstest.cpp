@@ -0,0 +1,126 @@
+#include "selftest.hpp"
+#include "fixture.hpp"
+#include "dialog/encodersegments.hpp"
+#include "player/mpv.hpp"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+static constexpr int Length = 40000;
+
+struct Probe { int duration = -1, packets = 0; };
+
+SIA probe(const QString &path) -> Probe
+{
+    Probe probe;
+    AVFormatContext *in = nullptr;
+    if (avformat_open_input(&in, path.toLocal8Bit().constData(), nullptr, nullptr) < 0)
+        return probe;
+    const int idx = avformat_find_stream_info(in, nullptr) < 0 ? -1
+        : av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (idx >= 0) {
+        probe.duration = in->duration / 1000;
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr; pkt.size = 0;
+        while (av_read_frame(in, &pkt) >= 0) {
+            probe.packets += pkt.stream_index == idx;
+            av_free_packet(&pkt);
+        }
+    }
+    avformat_close_input(&in);
+    return probe;
+}
+
+// encodes [points[i], points[i + 1]) into files[i] at once as encoder dialog does
+SIA encode(const QString &source, const QStringList &files,
+           const QVector<int> &points) -> bool
+{
+    std::vector<std::unique_ptr<Mpv>> mpvs;
+    for (int i = 0; i < files.size(); ++i) {
+        mpvs.emplace_back(new Mpv);
+        auto mpv = mpvs.back().get();
+        mpv->setLogContext("mpv/encoder-test/"_b + QByteArray::number(i));
+        mpv->create();
+        mpv->setOption("o", MpvFile(files[i]).toMpv());
+        mpv->setOption("ovc", "mpeg4");
+        mpv->setOption("ovcopts", "qscale=4");
+        mpv->setOption("start", QByteArray::number(points[i] * 1e-3));
+        mpv->setOption("end", QByteArray::number(points[i + 1] * 1e-3));
+        mpv->request(MPV_EVENT_END_FILE, [=] () { mpv->tellAsync("quit"); });
+        mpv->initialize(Log::Warn, false);
+        mpv->start();
+        mpv->tell("loadfile", MpvFile(source).toMpv());
+    }
+    const bool done = SelfTest::wait([&] () {
+        for (auto &mpv : mpvs) {
+            if (!mpv->isFinished())
+                return false;
+        }
+        return true;
+    }, 120000);
+    for (auto &mpv : mpvs) {
+        mpv->wait();
+        mpv->destroy();
+    }
+    return done;
+}
+
+// segmented path of encoder dialog against single pass on same range
+SELF_TEST(EncoderSegments, "encoder-segments")
+{
+    QTemporaryDir dir;
+    const auto source = dir.path() % "/source.mkv"_a;
+    if (!SELF_VERIFY(test, fixture::writeVideo(source, Length)))
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto single = dir.path() % "/single.mkv"_a;
+    if (!SELF_VERIFY(test, encode(source, { single }, { 0, Length })))
+        return;
+    const quint64 singleTime = timer.restart();
+
+    QVector<int> ticks;
+    const auto progress = [&] (int msec) { ticks.push_back(msec); return true; };
+    const auto points = _KeyframeSplits(source.toLocal8Bit(), 0, Length, 4, 5000, progress);
+    SELF_VERIFY(test, points.size() == 5 && std::is_sorted(points.begin(), points.end()));
+    SELF_VERIFY(test, std::is_sorted(ticks.begin(), ticks.end()));
+    SELF_VERIFY(test, !ticks.isEmpty() && ticks.last() == Length);
+    const quint64 splitTime = timer.restart();
+
+    QStringList segments;
+    QVector<int> lengths;
+    for (int i = 0; i < points.size() - 1; ++i) {
+        segments.push_back(dir.path() % "/segment-"_a % _N(i) % ".mkv"_a);
+        lengths.push_back(points[i + 1] - points[i]);
+    }
+    if (!SELF_VERIFY(test, encode(source, segments, points)))
+        return;
+    const quint64 encodeTime = timer.restart();
+
+    ticks.clear();
+    const auto joined = dir.path() % "/joined.mkv"_a;
+    SELF_VERIFY(test, _ConcatSegments(segments, lengths, joined, progress).isEmpty());
+    SELF_VERIFY(test, std::is_sorted(ticks.begin(), ticks.end()));
+    SELF_VERIFY(test, !ticks.isEmpty() && ticks.last() <= Length);
+    const quint64 concatTime = timer.restart();
+
+    // same frames and length come out of both paths
+    const auto expected = probe(single), actual = probe(joined);
+    SELF_VERIFY(test, expected.packets > 0 && qAbs(expected.packets - actual.packets) <= 2);
+    SELF_VERIFY(test, expected.duration > 0 && qAbs(expected.duration - actual.duration) <= 100);
+
+    // progress returning false stops joining
+    const auto canceled = _ConcatSegments(segments, lengths, dir.path() % "/canceled.mkv"_a,
+                                          [] (int) { return false; });
+    SELF_VERIFY(test, !canceled.isEmpty());
+
+    const auto total = splitTime + encodeTime + concatTime;
+    test.result(u"single pass"_q, _N(singleTime) % "ms"_a);
+    test.result(u"segmented"_q, _N(total) % "ms (split "_a % _N(splitTime)
+                % "ms, encode "_a % _N(encodeTime) % "ms, join "_a % _N(concatTime) % "ms)"_a);
+    test.result(u"speedup"_q, _N(singleTime / double(qMax<quint64>(total, 1)), 2) % 'x'_q);
+}
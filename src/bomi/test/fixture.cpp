@@ -0,0 +1,161 @@
+#include "fixture.hpp"
+#include <QTcpSocket>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace fixture {
+
+auto pattern(int size, int seed) -> QByteArray
+{
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = char((i * 131 + i / 251 + seed * 7) & 0xff);
+    return data;
+}
+
+auto createFile(const QString &path, const QByteArray &data) -> QString
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(data) != data.size())
+        return QString();
+    return file.fileName();
+}
+
+static constexpr int Fps = 25;
+
+auto writeVideo(const QString &path, int msec) -> bool
+{
+    av_register_all();
+    const auto file = path.toLocal8Bit();
+    AVFormatContext *out = nullptr;
+    if (avformat_alloc_output_context2(&out, nullptr, nullptr, file.constData()) < 0)
+        return false;
+    auto codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    auto st = codec ? avformat_new_stream(out, codec) : nullptr;
+    auto frame = av_frame_alloc();
+    bool ok = st && frame;
+    if (ok) {
+        auto c = st->codec;
+        c->width = 320;
+        c->height = 240;
+        c->pix_fmt = AV_PIX_FMT_YUV420P;
+        c->time_base = { 1, Fps };
+        c->gop_size = Fps;
+        st->time_base = c->time_base;
+        if (out->oformat->flags & AVFMT_GLOBALHEADER)
+            c->flags |= CODEC_FLAG_GLOBAL_HEADER;
+        frame->format = c->pix_fmt;
+        frame->width = c->width;
+        frame->height = c->height;
+        ok = avcodec_open2(c, codec, nullptr) >= 0
+             && av_frame_get_buffer(frame, 32) >= 0
+             && avio_open(&out->pb, file.constData(), AVIO_FLAG_WRITE) >= 0
+             && avformat_write_header(out, nullptr) >= 0;
+    }
+    // returns false on error or when nothing came out of encoder
+    auto encode = [&] (AVFrame *frame) -> bool {
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr; pkt.size = 0;
+        int got = 0;
+        if (avcodec_encode_video2(st->codec, &pkt, frame, &got) < 0 || !got)
+            return false;
+        av_packet_rescale_ts(&pkt, st->codec->time_base, st->time_base);
+        pkt.stream_index = st->index;
+        ok = av_interleaved_write_frame(out, &pkt) >= 0;
+        return ok;
+    };
+    for (int i = 0; ok && i < msec * Fps / 1000; ++i) {
+        ok = av_frame_make_writable(frame) >= 0;
+        for (int y = 0; y < frame->height; ++y) {
+            for (int x = 0; x < frame->width; ++x)
+                frame->data[0][y * frame->linesize[0] + x] = x + y + i * 3;
+        }
+        for (int p = 1; p < 3; ++p) {
+            for (int y = 0; y < frame->height / 2; ++y)
+                memset(frame->data[p] + y * frame->linesize[p], 128, frame->width / 2);
+        }
+        frame->pts = i;
+        encode(frame);
+    }
+    while (ok && encode(nullptr)) ;
+    if (ok)
+        ok = av_write_trailer(out) >= 0;
+    av_frame_free(&frame);
+    if (st)
+        avcodec_close(st->codec);
+    avio_closep(&out->pb);
+    avformat_free_context(out);
+    return ok;
+}
+
+auto takeHttp(QByteArray &buffer, HttpMessage *msg, bool bodyless) -> bool
+{
+    const int end = buffer.indexOf("\r\n\r\n");
+    if (end < 0)
+        return false;
+    HttpMessage m;
+    const auto lines = buffer.left(end).split('\n');
+    m.start = lines[0].trimmed();
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0)
+            m.headers.insert(lines[i].left(colon).trimmed().toLower(),
+                             lines[i].mid(colon + 1).trimmed());
+    }
+    const int length = bodyless ? 0 : m.headers.value("content-length").toInt();
+    if (buffer.size() < end + 4 + length)
+        return false;
+    m.body = buffer.mid(end + 4, length);
+    buffer.remove(0, end + 4 + length);
+    *msg = std::move(m);
+    return true;
+}
+
+auto readHttp(QTcpSocket &socket, QByteArray &buffer, bool bodyless) -> HttpMessage
+{
+    HttpMessage msg;
+    while (!takeHttp(buffer, &msg, bodyless)) {
+        if (!socket.waitForReadyRead(3000))
+            return HttpMessage();
+        buffer += socket.readAll();
+    }
+    return msg;
+}
+
+auto httpReply(const QByteArray &body, const QByteArray &headers) -> QByteArray
+{
+    return "HTTP/1.1 200 OK\r\n" + headers + "Content-Length: "
+            + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+}
+
+HttpServer::HttpServer(Handler &&handler)
+    : m_handler(std::move(handler))
+{
+    m_server.listen(QHostAddress::LocalHost);
+    QObject::connect(&m_server, &QTcpServer::newConnection, [this] () {
+        while (auto socket = m_server.nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::disconnected,
+                             socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead,
+                             socket, [this, socket] () { read(socket); });
+        }
+    });
+}
+
+auto HttpServer::url(const QString &path) const -> QUrl
+{
+    return QUrl("http://127.0.0.1:"_a % _N(m_server.serverPort()) % path);
+}
+
+auto HttpServer::read(QTcpSocket *socket) -> void
+{
+    auto buffer = socket->property("buffer").toByteArray() + socket->readAll();
+    HttpMessage request;
+    while (takeHttp(buffer, &request))
+        socket->write(m_handler(request));
+    socket->setProperty("buffer", buffer);
+}
+
+}
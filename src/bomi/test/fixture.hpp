@@ -0,0 +1,49 @@
+#ifndef FIXTURE_HPP
+#define FIXTURE_HPP
+
+#include <QTcpServer>
+#include <functional>
+
+class QTcpSocket;
+
+// helpers shared by self-tests
+namespace fixture {
+
+// deterministic bytes which differ for each seed
+auto pattern(int size, int seed = 0) -> QByteArray;
+// returns path or empty string if it could not be written
+auto createFile(const QString &path, const QByteArray &data) -> QString;
+// writes moving gradient of msec in mpeg4 at 25fps with keyframe at every
+// second; container is chosen by extension of path
+auto writeVideo(const QString &path, int msec) -> bool;
+
+struct HttpMessage {
+    QByteArray start;                       // request or status line
+    QHash<QByteArray, QByteArray> headers;  // lower case names
+    QByteArray body;
+    auto status() const -> int { return start.split(' ').value(1).toInt(); }
+};
+
+// takes one complete message from front of buffer; no body is expected for
+// bodyless, e.g. response to HEAD
+auto takeHttp(QByteArray &buffer, HttpMessage *msg, bool bodyless = false) -> bool;
+// reads one response from buffer and socket leaving the rest in buffer;
+// status is 0 if it did not arrive in time
+auto readHttp(QTcpSocket &socket, QByteArray &buffer, bool bodyless = false) -> HttpMessage;
+auto httpReply(const QByteArray &body, const QByteArray &headers = QByteArray()) -> QByteArray;
+
+// answers requests on loopback with handler; requests may be pipelined
+class HttpServer {
+public:
+    using Handler = std::function<QByteArray(const HttpMessage &request)>;
+    HttpServer(Handler &&handler);
+    auto url(const QString &path) const -> QUrl;
+private:
+    auto read(QTcpSocket *socket) -> void;
+    QTcpServer m_server;
+    Handler m_handler;
+};
+
+}
+
+#endif // FIXTURE_HPP
@@ -0,0 +1,95 @@
+#include "selftest.hpp"
+#include "video/framepacer.hpp"
+#include <random>
+
+// deterministic vsync source for evaluating FramePacer without a display
+class SimulatedVSyncClock {
+public:
+    SimulatedVSyncClock(double hz, double jitter = 0.0, quint32 seed = 1);
+    auto interval() const -> double { return m_interval; }
+    // presents frames of fps on this clock for duration and returns stats;
+    // takes over the ratio callback, so pass a dedicated pacer
+    auto run(FramePacer *pacer, double fps, double seconds) -> FramePacingStats;
+private:
+    double m_interval = 0.0, m_jitter = 0.0;
+    quint32 m_seed = 1;
+};
+
+SimulatedVSyncClock::SimulatedVSyncClock(double hz, double jitter, quint32 seed)
+    : m_interval(1e6 / hz), m_jitter(jitter), m_seed(seed)
+{
+
+}
+
+auto SimulatedVSyncClock::run(FramePacer *pacer, double fps, double seconds)
+-> FramePacingStats
+{
+    std::mt19937 rng(m_seed);
+    std::normal_distribution<double> noise(0.0, m_jitter * m_interval);
+    double ratio = 1.0;
+    pacer->setRatioCallback([&] (double r) { ratio = r; });
+    pacer->setFrameRate(fps);
+    pacer->reset();
+
+    // media clock follows audio, which plays at the pacer's ratio
+    const double frameTime = 1e6 / fps;
+    const qint64 vsyncs = seconds * 1e6 / m_interval;
+    double media = 0.0;
+    qint64 next = 0;
+    for (qint64 v = 0; v < vsyncs; ++v) {
+        media += m_interval * ratio;
+        if (media < next * frameTime)
+            continue;
+        while ((next + 1) * frameTime <= media)
+            ++next; // late frames are dropped by the player
+        ++next;
+        const double swap = v * m_interval + (m_jitter > 0 ? noise(rng) : 0.0);
+        pacer->frameSwapped(qRound64(swap), true);
+    }
+    pacer->setRatioCallback(nullptr);
+    return pacer->stats();
+}
+
+SELF_TEST(FramePacer, "framepacer")
+{
+    auto around = [] (double value, double expected, double tolerance)
+        { return qAbs(value - expected) <= tolerance; };
+    auto pace = [] (double display, double estimate, double fps, bool active,
+                    double jitter = 0.0) {
+        FramePacer pacer;
+        pacer.setDisplayRate(estimate);
+        pacer.setActive(active);
+        return SimulatedVSyncClock(display, jitter).run(&pacer, fps, 120);
+    };
+
+    // 23.976 fps on 24 Hz repeats a frame every 1001 frames unless paced
+    const auto unpaced = pace(24, 24, 24/1.001, false);
+    SELF_VERIFY(test, unpaced.repeats >= 2);
+    const auto locked = pace(24, 24, 24/1.001, true);
+    SELF_VERIFY(test, locked.frames > 2800);
+    SELF_VERIFY(test, locked.cadence == 1.0);
+    SELF_VERIFY(test, locked.repeats == 0 && locked.drops == 0);
+    SELF_VERIFY(test, locked.judder < 0.01);
+    SELF_VERIFY(test, around(locked.ratio, 1.001, 0.0003));
+
+    // 3:2 pulldown judders by design, but nothing is repeated or dropped
+    const auto pulldown = pace(60, 60, 24/1.001, true);
+    SELF_VERIFY(test, pulldown.cadence == 2.5);
+    SELF_VERIFY(test, pulldown.repeats == 0 && pulldown.drops == 0);
+    SELF_VERIFY(test, around(pulldown.judder, 0.5, 0.01));
+
+    // vsync interval is learned from swaps even if initial rate is off
+    const auto ntsc = pace(60/1.001, 60, 24, true);
+    SELF_VERIFY(test, around(ntsc.vsync, 1001.0/60, 0.005));
+    SELF_VERIFY(test, ntsc.cadence == 2.5);
+    SELF_VERIFY(test, around(ntsc.ratio, 1/1.001, 0.0003));
+    // noisy swap times must not make it repeat or drop frames
+    const auto noisy = pace(60/1.001, 60, 24, true, 0.05);
+    SELF_VERIFY(test, noisy.cadence == 2.5);
+    SELF_VERIFY(test, noisy.repeats == 0 && noisy.drops == 0);
+
+    // 25 fps on 60 Hz needs 4% speed change which would be audible
+    const auto pal = pace(60, 60, 25, true);
+    SELF_VERIFY(test, pal.cadence == 0.0);
+    SELF_VERIFY(test, pal.ratio == 1.0);
+}
@@ -0,0 +1,96 @@
+#include "selftest.hpp"
+#include "fixture.hpp"
+#include "player/mediaserver.hpp"
+#include "player/mrl.hpp"
+#include <QTcpSocket>
+#include <QTemporaryFile>
+
+#ifndef Q_OS_WIN
+
+SELF_TEST(MediaServer, "mediaserver")
+{
+    QTemporaryFile file;
+    const auto data = fixture::pattern(100000);
+    if (!SELF_VERIFY(test, file.open() && file.write(data) == data.size() && file.flush()))
+        return;
+    MediaServer server;
+    if (!SELF_VERIFY(test, server.listen(u"127.0.0.1"_q, 0)))
+        return;
+    const QList<Mrl> list = { Mrl(file.fileName()),
+                              Mrl(u"http://example.com/a.mp4#xywh=0,0,9,9&t=5"_q) };
+    server.setPlaylist(list, 0);
+    server.setPosition(12500);
+    const auto port = server.serverName().section(':'_q, -1).toUShort();
+    const QByteArray size = QByteArray::number(data.size());
+    const QByteArray media = "/media/0/x";
+
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, port);
+    if (!SELF_VERIFY(test, socket.waitForConnected(3000)))
+        return;
+    QByteArray buffer;
+    auto get = [&] (const QByteArray &path, const QByteArray &headers = QByteArray(),
+                    const QByteArray &method = "GET") {
+        socket.write(method + ' ' + path + " HTTP/1.1\r\nHost: test\r\n" + headers + "\r\n");
+        return fixture::readHttp(socket, buffer, method == "HEAD");
+    };
+    auto range = [&] (const QByteArray &spec) { return "Range: bytes=" + spec + "\r\n"; };
+
+    // ranges on one kept-alive connection
+    auto r = get(media, range("10-19"));
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.mid(10, 10));
+    SELF_VERIFY(test, r.headers.value("content-range") == "bytes 10-19/" + size);
+    SELF_VERIFY(test, r.headers.value("connection") == "keep-alive");
+    r = get(media, range("-5"));
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.right(5));
+    r = get(media, range("99990-"));
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.mid(99990));
+    r = get(media, range("99995-200000"));
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.mid(99995));
+    r = get(media);
+    SELF_VERIFY(test, r.status() == 200 && r.body == data);
+
+    r = get(media, range(size + '-'));
+    SELF_VERIFY(test, r.status() == 416 && r.body.isEmpty());
+    SELF_VERIFY(test, r.headers.value("content-range") == "bytes */" + size);
+    r = get(media, range("20-10"));
+    SELF_VERIFY(test, r.status() == 416);
+
+    // no body follows HEAD even though length is announced
+    r = get(media, QByteArray(), "HEAD");
+    SELF_VERIFY(test, r.status() == 200 && r.headers.value("content-length") == size);
+    r = get(media, range("0-3"));
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.left(4));
+
+    // pipelined requests are answered in order
+    socket.write("GET " + media + " HTTP/1.1\r\nRange: bytes=0-4\r\n\r\n"
+                 "HEAD " + media + " HTTP/1.1\r\n\r\n"
+                 "GET /nothing HTTP/1.1\r\n\r\n"
+                 "GET " + media + " HTTP/1.1\r\nRange: bytes=5-9\r\n\r\n");
+    r = fixture::readHttp(socket, buffer);
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.left(5));
+    r = fixture::readHttp(socket, buffer, true);
+    SELF_VERIFY(test, r.status() == 200 && r.headers.value("content-length") == size);
+    r = fixture::readHttp(socket, buffer);
+    SELF_VERIFY(test, r.status() == 404);
+    r = fixture::readHttp(socket, buffer);
+    SELF_VERIFY(test, r.status() == 206 && r.body == data.mid(5, 5));
+
+    // fragment of remote location is kept and its time replaced
+    r = get("/live");
+    SELF_VERIFY(test, r.status() == 302);
+    SELF_VERIFY(test, r.headers.value("location").startsWith("http://test/media/0/"));
+    SELF_VERIFY(test, r.headers.value("location").endsWith("#t=12.500"));
+    server.setPlaylist(list, 1);
+    r = get("/live");
+    SELF_VERIFY(test, r.headers.value("location") == "http://example.com/a.mp4#xywh=0,0,9,9&t=12.500");
+
+    // closed after reply when asked
+    r = get(media, "Connection: close\r\n" + range("0-0"));
+    SELF_VERIFY(test, r.status() == 206 && r.headers.value("connection") == "close");
+    SELF_VERIFY(test, socket.state() == QTcpSocket::UnconnectedState
+                || socket.waitForDisconnected(3000));
+    server.close();
+}
+
+#endif
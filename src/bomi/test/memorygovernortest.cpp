@@ -0,0 +1,30 @@
+#include "selftest.hpp"
+#include "misc/memorygovernor.hpp"
+
+// callbacks run without lock so that they may query governor and drop
+// consumers, which used to deadlock
+SELF_TEST(MemoryGovernor, "memory-governor")
+{
+    auto &governor = MemoryGovernor::instance();
+    const auto budget = governor.budget();
+    auto other = new MemoryConsumer(u"other"_q, MemoryPriority::History);
+    MemoryConsumer preview(u"preview"_q, MemoryPriority::Preview);
+    int reclaims = 0, restores = 0;
+    preview.setUsage(1024 * 1024);
+    preview.setReclaim([&] (qint64 excess) -> qint64 {
+        ++reclaims;
+        SELF_VERIFY(test, governor.budget() == 1);
+        _Delete(other);
+        preview.setUsage(0);
+        return excess;
+    });
+    preview.setRestore([&] () { ++restores; });
+
+    // any process is over budget of one byte
+    governor.setBudget(1);
+    SELF_VERIFY(test, reclaims == 1 && !other);
+    governor.setBudget(0);
+    SELF_VERIFY(test, restores == 1);
+    governor.setBudget(budget);
+    delete other;
+}
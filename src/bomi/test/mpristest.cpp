@@ -0,0 +1,150 @@
+#include "selftest.hpp"
+#include "player/mpris_p.hpp"
+#include "player/playengine.hpp"
+#include "player/playlistmodel.hpp"
+#include <QProcess>
+
+namespace mpris {
+
+// private bus on which dbus-monitor records names of properties in every
+// PropertiesChanged signal on MPRIS path
+struct MonitoredBus {
+    QProcess daemon, monitor;
+    QString address;
+    QVector<QStringList> changes;
+    ~MonitoredBus()
+    {
+        monitor.kill();
+        monitor.waitForFinished();
+        daemon.kill();
+        daemon.waitForFinished();
+    }
+    auto start() -> bool
+    {
+        daemon.start(u"dbus-daemon"_q, { u"--session"_q, u"--nofork"_q,
+                                         u"--print-address"_q });
+        if (!daemon.waitForReadyRead(5000))
+            return false;
+        address = QString::fromLocal8Bit(daemon.readLine()).trimmed();
+        QObject::connect(&monitor, &QProcess::readyReadStandardOutput,
+                         [this] () { read(); });
+        monitor.start(u"dbus-monitor"_q, { u"--address"_q, address,
+                                           u"type='signal'"_q });
+        return SelfTest::wait([this] () { return ready; });
+    }
+    auto names(int i) const -> QStringList
+    {
+        auto names = changes.value(i);
+        names.sort();
+        return names;
+    }
+    // waits for expected signals in total and makes sure no more follow
+    auto settle(int expected) -> bool
+    {
+        SelfTest::wait([&] () { return changes.size() >= expected; });
+        // give late or duplicated signals a chance to show up
+        SelfTest::sleep(PropertiesPublisher::Window * 5);
+        return changes.size() == expected;
+    }
+private:
+    auto read() -> void
+    {
+        buffer += monitor.readAllStandardOutput();
+        int eol = -1;
+        while ((eol = buffer.indexOf('\n')) >= 0) {
+            const auto line = buffer.left(eol);
+            buffer.remove(0, eol + 1);
+            const auto body = line.trimmed();
+            if (!line.startsWith(' ')) {
+                // monitor drops its own name once it starts eavesdropping
+                ready = ready || line.endsWith("member=NameLost");
+                record = line.contains("path=/org/mpris/MediaPlayer2;")
+                         && line.endsWith("member=PropertiesChanged");
+                if (record)
+                    changes.push_back(QStringList());
+            } else if (key && body.startsWith("string \""))
+                changes.last().push_back(QString::fromUtf8(body.mid(8, body.size() - 9)));
+            key = record && body == "dict entry(";
+        }
+    }
+    QByteArray buffer;
+    bool ready = false, record = false, key = false;
+};
+
+SELF_TEST(Mpris, "mpris")
+{
+    MonitoredBus bus;
+    if (!SELF_VERIFY(test, bus.start()))
+        return;
+    {
+        const auto connection = QDBusConnection::connectToBus(bus.address, u"bomi-self-test"_q);
+        SELF_VERIFY(test, connection.isConnected());
+        PropertiesPublisher publisher(u"org.mpris.MediaPlayer2.Player"_q, connection);
+        auto settle = [&] (int expected)
+            { return bus.settle(expected) && publisher.signalCount() == expected; };
+
+        // state change touches several properties at once
+        publisher.set("PlaybackStatus", u"Playing"_q);
+        publisher.set("CanPause", true);
+        publisher.set("CanPlay", true);
+        publisher.set("Rate", 1.0);
+        SELF_VERIFY(test, settle(1));
+        SELF_VERIFY(test, bus.names(0) == QStringList({ u"CanPause"_q, u"CanPlay"_q,
+                                                         u"PlaybackStatus"_q, u"Rate"_q }));
+
+        // nothing is sent for values already published
+        publisher.set("PlaybackStatus", u"Playing"_q);
+        publisher.set("Rate", 1.0);
+        SELF_VERIFY(test, settle(1));
+
+        // dragging volume slider yields one signal per window
+        for (int i = 0; i <= 100; ++i)
+            publisher.set("Volume", i / 100.0);
+        SELF_VERIFY(test, settle(2));
+
+        // change and revert within window cancels out
+        publisher.set("Rate", 2.0);
+        publisher.set("Rate", 1.0);
+        SELF_VERIFY(test, settle(2));
+    }
+    QDBusConnection::disconnectFromBus(u"bomi-self-test"_q);
+}
+
+// Player adaptor publishes changes which engine reports
+SELF_TEST(MprisPlayer, "mpris-player")
+{
+    MonitoredBus bus;
+    if (!SELF_VERIFY(test, bus.start()))
+        return;
+    {
+        const auto connection = QDBusConnection::connectToBus(bus.address, u"bomi-self-test"_q);
+        SELF_VERIFY(test, connection.isConnected());
+        PlayEngine engine;
+        PlaylistModel playlist;
+        QObject root;
+        Player player(&engine, &playlist, connection, &root);
+
+        for (int i = 1; i <= 50; ++i)
+            engine.setAudioVolume(i / 100.0);
+        SELF_VERIFY(test, bus.settle(1));
+        SELF_VERIFY(test, bus.names(0) == QStringList(u"Volume"_q));
+        SELF_VERIFY(test, player.volume() == 0.5);
+
+        engine.setSpeed(1.5);
+        engine.setAudioVolume(0.3);
+        SELF_VERIFY(test, bus.settle(2));
+        SELF_VERIFY(test, bus.names(1) == QStringList({ u"Rate"_q, u"Volume"_q }));
+        SELF_VERIFY(test, player.rate() == 1.5);
+
+        // nothing can be played or paused after error
+        emit engine.stateChanged(PlayEngine::Error);
+        SELF_VERIFY(test, bus.settle(3));
+        SELF_VERIFY(test, bus.names(2) == QStringList({ u"CanPause"_q, u"CanPlay"_q,
+                                                         u"PlaybackStatus"_q }));
+        emit engine.stateChanged(PlayEngine::Error);
+        SELF_VERIFY(test, bus.settle(3));
+    }
+    QDBusConnection::disconnectFromBus(u"bomi-self-test"_q);
+}
+
+}
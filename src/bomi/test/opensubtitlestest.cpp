@@ -0,0 +1,123 @@
+#include "selftest.hpp"
+#include "fixture.hpp"
+#include "subtitle/opensubtitlesfinder.hpp"
+#include "player/mrl.hpp"
+#include "misc/xmlrpcclient.hpp"
+#include <QTemporaryDir>
+#include <zlib.h>
+
+SIA gzip(const QByteArray &data) -> QByteArray
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return QByteArray();
+    QByteArray out(deflateBound(&strm, data.size()), 0);
+    strm.next_in = (Bytef*)data.data();
+    strm.avail_in = data.size();
+    strm.next_out = (Bytef*)out.data();
+    strm.avail_out = out.size();
+    deflate(&strm, Z_FINISH);
+    out.resize(out.size() - strm.avail_out);
+    deflateEnd(&strm);
+    return out;
+}
+
+// answers like api.opensubtitles.org with one link per movie hash and
+// counts calls
+struct MockXmlRpcServer {
+    QMap<QString, int> calls;
+    int queries = 0;
+    fixture::HttpServer server{[this] (const fixture::HttpMessage &request) {
+        return fixture::httpReply(gzip(answer(request.body)),
+                                  "Content-Type: text/xml\r\n");
+    }};
+
+    auto url() const -> QUrl { return server.url(u"/xml-rpc"_q); }
+    auto answer(const QByteArray &call) -> QByteArray
+    {
+        QString method;
+        const auto args = XmlRpcClient::parseCall(call, &method);
+        ++calls[method];
+        QVariantMap result;
+        result[u"status"_q] = u"200 OK"_q;
+        if (method == "LogIn"_a)
+            result[u"token"_q] = u"mock"_q;
+        else if (method == "SearchSubtitles"_a) {
+            QVariantList data;
+            for (auto &var : args.value(1).toList()) {
+                const auto hash = var.toMap()[u"moviehash"_q].toString();
+                QVariantMap link;
+                link[u"MovieHash"_q] = hash;
+                link[u"SubFileName"_q] = QString(hash % ".srt"_a);
+                link[u"SubDownloadLink"_q] = QString("http://127.0.0.1/"_a % hash);
+                link[u"SubLanguageID"_q] = u"eng"_q;
+                data.push_back(link);
+                ++queries;
+            }
+            result[u"data"_q] = data;
+        }
+        return XmlRpcClient::serializeResponse(QVariantList() << result);
+    }
+};
+
+SELF_TEST(OpenSubtitles, "opensubtitles")
+{
+    QTemporaryDir dir;
+    MockXmlRpcServer server;
+    auto create = [&] (const QString &name, int size) {
+        return fixture::createFile(dir.path() % '/'_q % name,
+                                   fixture::pattern(size, qHash(name)));
+    };
+    const QStringList files = {
+        create(u"e01.mkv"_q, 200000), create(u"e02.mkv"_q, 300000),
+        create(u"e03.mkv"_q, 400000), create(u"e04.mkv"_q, 500000)
+    };
+    qint64 bytes = 0;
+    SELF_VERIFY(test, OpenSubtitlesFinder::movieHash(create(u"short.mkv"_q, 100), &bytes).isEmpty());
+    SELF_VERIFY(test, OpenSubtitlesFinder::movieHash(files[0], &bytes).size() == 16);
+
+    const auto cacheFile = dir.path() % "/cache.json"_a;
+    int found = 0;
+    QVector<SubtitleLink> links;
+    {
+        OpenSubtitlesFinder finder(server.url(), cacheFile);
+        QObject::connect(&finder, &OpenSubtitlesFinder::found,
+                         [&] (const QVector<SubtitleLink> &l) { ++found; links = l; });
+        if (!SELF_VERIFY(test, SelfTest::wait([&] () { return finder.isAvailable(); })))
+            return;
+        SELF_VERIFY(test, finder.find(Mrl(files[0])));
+        SELF_VERIFY(test, SelfTest::wait([&] () { return found == 1; }));
+        SELF_VERIFY(test, links.size() == 1);
+        SELF_VERIFY(test, server.calls[u"SearchSubtitles"_q] == 1);
+
+        // repeated search is answered from cache at once
+        SELF_VERIFY(test, finder.find(Mrl(files[0])));
+        SELF_VERIFY(test, found == 2);
+        SELF_VERIFY(test, server.calls[u"SearchSubtitles"_q] == 1);
+
+        // rest of folder is hashed in background and goes out in one call
+        SELF_VERIFY(test, finder.prefetch(files) == 3);
+        SELF_VERIFY(test, finder.prefetch(files) == 0);
+        SELF_VERIFY(test, server.calls[u"SearchSubtitles"_q] == 1);
+        SELF_VERIFY(test, SelfTest::wait([&] () {
+            return server.calls[u"SearchSubtitles"_q] == 2 && finder.isAvailable();
+        }));
+        SELF_VERIFY(test, server.queries == 4);
+        SELF_VERIFY(test, finder.prefetch(files) == 0);
+        SELF_VERIFY(test, finder.find(Mrl(files[2])));
+        SELF_VERIFY(test, found == 3);
+        SELF_VERIFY(test, server.calls[u"SearchSubtitles"_q] == 2);
+    }
+    // results persist across sessions
+    OpenSubtitlesFinder finder(server.url(), cacheFile);
+    QObject::connect(&finder, &OpenSubtitlesFinder::found,
+                     [&] (const QVector<SubtitleLink> &l) { ++found; links = l; });
+    SELF_VERIFY(test, SelfTest::wait([&] () { return finder.isAvailable(); }));
+    SELF_VERIFY(test, finder.find(Mrl(files[3])));
+    SELF_VERIFY(test, found == 4);
+    SELF_VERIFY(test, links.size() == 1 && links[0].fileName.endsWith(".srt"_a));
+    SELF_VERIFY(test, server.calls[u"SearchSubtitles"_q] == 2);
+    SELF_VERIFY(test, server.calls[u"LogIn"_q] == 2);
+}
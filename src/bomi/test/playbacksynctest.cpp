@@ -0,0 +1,63 @@
+#include "selftest.hpp"
+#include "player/playbacksync.hpp"
+#include <QElapsedTimer>
+
+// exact clock moving at speed times ratio while playing
+struct FakePlayer : public PlaybackSync::Player {
+    FakePlayer(double pos, quint64 media = 1): pos(pos), id(media) { clock.start(); }
+    auto isPlaying() const -> bool final { return playing; }
+    auto isPaused() const -> bool final { return !playing; }
+    auto clockTime() const -> double final
+        { return pos + (playing ? (clock.nsecsElapsed() * 1e-9 - since) * ratio : 0.0); }
+    auto speed() const -> double final { return 1.0; }
+    auto media() const -> quint64 final { return id; }
+    auto pause() -> void final { rebase(); playing = false; }
+    auto unpause() -> void final { rebase(); playing = true; }
+    auto seek(int msec) -> void final { rebase(); pos = msec * 1e-3; ++seeks; }
+    auto setClockRatio(double ratio) -> void final { rebase(); this->ratio = ratio; }
+    auto rebase() -> void { pos = clockTime(); since = clock.nsecsElapsed() * 1e-9; }
+    QElapsedTimer clock;
+    double pos = 0.0, since = 0.0, ratio = 1.0;
+    bool playing = true;
+    quint64 id = 1;
+    int seeks = 0;
+};
+
+SELF_TEST(PlaybackSync, "playbacksync")
+{
+    FakePlayer main(100.0), peer(99.9), late(20.0), stray(50.0, 2);
+    PlaybackSync leader(&main), f1(&peer), f2(&late), f3(&stray);
+    if (!SELF_VERIFY(test, leader.lead(u"0"_q)))
+        return;
+    SELF_VERIFY(test, leader.role() == PlaybackSync::Leader);
+    const auto port = _N(leader.port());
+    // name is resolved in background
+    SELF_VERIFY(test, f1.follow(u"localhost:"_q % port));
+    SELF_VERIFY(test, f2.follow(u"127.0.0.1:"_q % port));
+    SELF_VERIFY(test, f3.follow(u"127.0.0.1:"_q % port));
+    SELF_VERIFY(test, !f3.follow(u"127.0.0.1"_q) && f3.role() == PlaybackSync::Off);
+    SELF_VERIFY(test, f3.follow(u"127.0.0.1:"_q % port));
+    SELF_VERIFY(test, SelfTest::wait([&] () {
+        return f1.role() == PlaybackSync::Follower;
+    }));
+
+    // every follower converges to the same leader
+    auto synced = [&] (FakePlayer &p, double tolerance)
+        { return qAbs(p.clockTime() - main.clockTime()) < tolerance; };
+    SELF_VERIFY(test, SelfTest::wait([&] () {
+        return synced(peer, 0.005) && synced(late, 0.005);
+    }, 10000));
+    SELF_VERIFY(test, late.seeks > 0);
+    SELF_VERIFY(test, f1.delay() >= 0 && f1.delay() < 50);
+
+    // other media is left alone
+    SELF_VERIFY(test, stray.seeks == 0 && stray.ratio == 1.0);
+    SELF_VERIFY(test, !synced(stray, 1.0));
+
+    // pause follows leader
+    main.pause();
+    SELF_VERIFY(test, SelfTest::wait([&] () {
+        return !peer.playing && !late.playing;
+    }));
+    SELF_VERIFY(test, stray.playing);
+}
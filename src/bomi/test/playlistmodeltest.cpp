@@ -0,0 +1,31 @@
+#include "selftest.hpp"
+#include "fixture.hpp"
+#include "player/playlistmodel.hpp"
+#include <QTemporaryDir>
+
+// total follows probing and every change of list
+SELF_TEST(PlaylistTotal, "playlist-total")
+{
+    QTemporaryDir dir;
+    Playlist list;
+    for (int sec : { 4, 10 }) {
+        const auto file = dir.path() % '/'_q % _N(sec) % ".mkv"_a;
+        if (!SELF_VERIFY(test, fixture::writeVideo(file, sec * 1000)))
+            return;
+        list.push_back(Mrl(file));
+    }
+    PlaylistModel model;
+    int changed = 0;
+    QObject::connect(&model, &PlaylistModel::totalDurationChanged, [&] () { ++changed; });
+    auto around = [&] (qint64 msec) { return qAbs(model.totalDuration() - msec) < 200; };
+
+    model.setList(list);
+    SELF_VERIFY(test, SelfTest::wait([&] () { return around(14000); }, 20000));
+    SELF_VERIFY(test, changed > 0);
+
+    changed = 0;
+    SELF_VERIFY(test, model.filter(PlaylistModel::DurationRole, 8000) == 1);
+    SELF_VERIFY(test, around(10000) && changed == 1);
+    model.clear();
+    SELF_VERIFY(test, model.totalDuration() == 0 && changed == 2);
+}
@@ -0,0 +1,89 @@
+#include "selftest.hpp"
+#include <QElapsedTimer>
+
+struct Entry { const char *name; SelfTest::Run run; };
+
+SIA registry() -> std::vector<Entry>&
+{
+    static std::vector<Entry> tests;
+    return tests;
+}
+
+SIA print(const QString &line) -> void
+{
+    qDebug().nospace() << line.toLocal8Bit().constData();
+}
+
+SelfTest::Register::Register(const char *name, Run &&run)
+{
+    registry().push_back({ name, std::move(run) });
+}
+
+auto SelfTest::verify(bool ok, const char *expr, const char *file, int line) -> bool
+{
+    if (!ok)
+        fail(_L(expr) % " at "_a % QFileInfo(_L(file)).fileName() % ':'_q % _N(line));
+    return ok;
+}
+
+auto SelfTest::fail(const QString &message) -> void
+{
+    m_failed = true;
+    print("  FAIL "_a % message);
+}
+
+auto SelfTest::result(const QString &name, const QString &value) -> void
+{
+    print("  RESULT "_a % name % ": "_a % value);
+}
+
+auto SelfTest::wait(const std::function<bool()> &done, int msec) -> bool
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > msec)
+            return false;
+        qApp->processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 10);
+    }
+    return true;
+}
+
+auto SelfTest::sleep(int msec) -> void
+{
+    QElapsedTimer timer;
+    timer.start();
+    wait([&] () { return timer.elapsed() >= msec; }, msec + 1000);
+}
+
+auto SelfTest::names() -> QStringList
+{
+    QStringList names;
+    for (auto &entry : registry())
+        names.push_back(_L(entry.name));
+    names.sort();
+    return names;
+}
+
+auto SelfTest::run(const QStringList &filters) -> int
+{
+    auto tests = registry();
+    std::sort(tests.begin(), tests.end(), [] (const Entry &lhs, const Entry &rhs)
+        { return qstrcmp(lhs.name, rhs.name) < 0; });
+    int failed = 0, count = 0;
+    for (auto &entry : tests) {
+        const auto name = _L(entry.name);
+        if (!filters.isEmpty() && !filters.contains(u"all"_q) && !filters.contains(name))
+            continue;
+        ++count;
+        SelfTest test;
+        QElapsedTimer timer;
+        timer.start();
+        entry.run(test);
+        print((test.isFailed() ? "FAIL "_a : "PASS "_a) % name
+              % " ("_a % _N((quint64)timer.elapsed()) % "ms)"_a);
+        failed += test.isFailed();
+    }
+    print(_N(count - failed) % " passed, "_a % _N(failed) % " failed"_a);
+    return failed;
+}
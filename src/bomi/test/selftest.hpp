@@ -0,0 +1,39 @@
+#ifndef SELFTEST_HPP
+#define SELFTEST_HPP
+
+#include <functional>
+
+// checks run by --self-test inside application so that they exercise real
+// objects with event loop, network and platform services of the process;
+// define them in test/ with SELF_TEST() and shared helpers of fixture.hpp,
+// which are built only with self_test config
+class SelfTest {
+public:
+    using Run = std::function<void(SelfTest &test)>;
+    struct Register { Register(const char *name, Run &&run); };
+    // records failure of expression; returns ok so that test can stop early
+    auto verify(bool ok, const char *expr, const char *file, int line) -> bool;
+    auto fail(const QString &message) -> void;
+    // prints measurement, e.g. timing, along with test outcome
+    auto result(const QString &name, const QString &value) -> void;
+    auto isFailed() const -> bool { return m_failed; }
+    // runs event loop until done() returns true or msec passes
+    static auto wait(const std::function<bool()> &done, int msec = 5000) -> bool;
+    static auto sleep(int msec) -> void;
+    static auto names() -> QStringList;
+    // runs tests whose names match one of filters or all for empty list;
+    // returns number of failed tests
+    static auto run(const QStringList &filters) -> int;
+private:
+    SelfTest() { }
+    bool m_failed = false;
+};
+
+#define SELF_VERIFY(test, expr) (test).verify(bool(expr), #expr, __FILE__, __LINE__)
+
+#define SELF_TEST(id, name) \
+    static auto selfTest##id(SelfTest &test) -> void; \
+    static const SelfTest::Register selfTestRegister##id(name, selfTest##id); \
+    static auto selfTest##id(SelfTest &test) -> void
+
+#endif // SELFTEST_HPP
@@ -0,0 +1,47 @@
+#include "selftest.hpp"
+#include "player/sessiontrace.hpp"
+#include "player/jrplayer.hpp"
+#include "player/rootmenu.hpp"
+#include "json/jrcommon.hpp"
+#include <QTemporaryDir>
+
+// action which json-rpc execute triggers is recorded only as the call;
+// otherwise replay runs it twice
+SELF_TEST(SessionTrace, "session-trace")
+{
+    const auto id = u"video/move/reset"_q;
+    const auto action = RootMenu::instance().action(id);
+    if (!SELF_VERIFY(test, action))
+        return;
+    int triggered = 0;
+    QObject counter;
+    QObject::connect(action, &QAction::triggered, &counter, [&] () { ++triggered; });
+
+    QTemporaryDir dir;
+    const auto file = dir.path() % "/trace.jsonl"_a;
+    auto &trace = SessionTrace::instance();
+    if (!SELF_VERIFY(test, trace.startRecording(file)))
+        return;
+    {
+        QJsonObject json;
+        json[u"jsonrpc"_q] = u"2.0"_q;
+        json[u"method"_q] = u"execute"_q;
+        json[u"params"_q] = QJsonArray({ id });
+        json[u"id"_q] = 1;
+        JrPlayer jr;
+        static_cast<JrIface&>(jr).request(JrRequest::fromJson(json));
+    }
+    trace.stopRecording();
+    SELF_VERIFY(test, triggered == 1);
+
+    QFile recorded(file);
+    recorded.open(QFile::ReadOnly);
+    const auto lines = recorded.readAll().trimmed().split('\n');
+    SELF_VERIFY(test, lines.size() == 2 && lines[1].contains("\"e\":\"call\""));
+
+    triggered = 0;
+    if (!SELF_VERIFY(test, trace.replay(file, dir.path() % "/report.json"_a)))
+        return;
+    SELF_VERIFY(test, SelfTest::wait([&] () { return !trace.isReplaying(); }, 10000));
+    SELF_VERIFY(test, triggered == 1);
+}
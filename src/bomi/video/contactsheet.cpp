@@ -0,0 +1,394 @@
+#include "contactsheet.hpp"
+#include "dialog/snapshotdialog.hpp"
+#include "misc/dataevent.hpp"
+#include "misc/log.hpp"
+#include <QThreadPool>
+#include <QElapsedTimer>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+DECLARE_LOG_CONTEXT(ContactSheet)
+
+enum EventType { SheetDone = QEvent::User + 1 };
+
+static constexpr AVRational USec = { 1, AV_TIME_BASE };
+static constexpr int MaxPacketsPerFrame = 1000;
+static constexpr int Margin = 4;
+
+class SheetDecoder {
+public:
+    struct Frame { QImage image; qint64 usec = -1; };
+    ~SheetDecoder()
+    {
+        if (m_sws)
+            sws_freeContext(m_sws);
+        if (m_frame)
+            av_frame_free(&m_frame);
+        if (m_codec)
+            avcodec_close(m_codec);
+        if (m_fmt)
+            avformat_close_input(&m_fmt);
+    }
+    auto open(const QString &file) -> bool
+    {
+        if (avformat_open_input(&m_fmt, file.toLocal8Bit().constData(), nullptr, nullptr) < 0)
+            return false;
+        if (avformat_find_stream_info(m_fmt, nullptr) < 0)
+            return false;
+        AVCodec *dec = nullptr;
+        m_idx = av_find_best_stream(m_fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &dec, 0);
+        if (m_idx < 0 || !dec)
+            return false;
+        m_stream = m_fmt->streams[m_idx];
+        // parallelism is per file; keyframes decode independently
+        m_stream->codec->thread_count = 1;
+        m_stream->codec->skip_frame = AVDISCARD_NONKEY;
+        m_stream->codec->skip_loop_filter = AVDISCARD_ALL;
+        if (avcodec_open2(m_stream->codec, dec, nullptr) < 0)
+            return false;
+        m_codec = m_stream->codec;
+        m_frame = av_frame_alloc();
+        return m_frame;
+    }
+    // container duration or that of video stream if container has none
+    auto duration() const -> qint64
+    {
+        if (m_fmt->duration > 0 && m_fmt->duration != AV_NOPTS_VALUE)
+            return m_fmt->duration;
+        if (m_stream->duration > 0 && m_stream->duration != AV_NOPTS_VALUE)
+            return av_rescale_q(m_stream->duration, m_stream->time_base, USec);
+        return 0;
+    }
+    auto size() const -> QSize { return { m_codec->width, m_codec->height }; }
+    auto codecName() const -> QString { return _L(m_codec->codec->name); }
+    auto grab(qint64 usec, int width) -> Frame
+    {
+        const auto start = m_stream->start_time != AV_NOPTS_VALUE ? m_stream->start_time : 0;
+        const auto ts = av_rescale_q(usec, USec, m_stream->time_base) + start;
+        av_seek_frame(m_fmt, m_idx, ts, AVSEEK_FLAG_BACKWARD);
+        avcodec_flush_buffers(m_codec);
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr; pkt.size = 0;
+        int got = 0;
+        for (int i = 0; i < MaxPacketsPerFrame && !got; ++i) {
+            if (av_read_frame(m_fmt, &pkt) < 0)
+                break;
+            if (pkt.stream_index == m_idx)
+                avcodec_decode_video2(m_codec, m_frame, &got, &pkt);
+            av_free_packet(&pkt);
+        }
+        if (!got) {
+            pkt.data = nullptr; pkt.size = 0;
+            avcodec_decode_video2(m_codec, m_frame, &got, &pkt);
+        }
+        Frame frame;
+        if (!got || m_frame->width <= 0 || m_frame->height <= 0)
+            return frame;
+        const auto pts = av_frame_get_best_effort_timestamp(m_frame);
+        if (pts != AV_NOPTS_VALUE)
+            frame.usec = av_rescale_q(pts - start, m_stream->time_base, USec);
+        auto sar = av_guess_sample_aspect_ratio(m_fmt, m_stream, m_frame);
+        double aspect = m_frame->width / (double)m_frame->height;
+        if (sar.num > 0 && sar.den > 0)
+            aspect *= av_q2d(sar);
+        const int height = qMax(2, qRound(width / aspect));
+        m_sws = sws_getCachedContext(m_sws, m_frame->width, m_frame->height,
+                                     (AVPixelFormat)m_frame->format, width, height,
+                                     AV_PIX_FMT_RGB32, SWS_BILINEAR,
+                                     nullptr, nullptr, nullptr);
+        if (!m_sws)
+            return frame;
+        frame.image = QImage(width, height, QImage::Format_RGB32);
+        uint8_t *dst[4] = { frame.image.bits(), nullptr, nullptr, nullptr };
+        int stride[4] = { frame.image.bytesPerLine(), 0, 0, 0 };
+        sws_scale(m_sws, m_frame->data, m_frame->linesize, 0, m_frame->height, dst, stride);
+        return frame;
+    }
+private:
+    AVFormatContext *m_fmt = nullptr;
+    AVCodecContext *m_codec = nullptr;
+    AVStream *m_stream = nullptr;
+    AVFrame *m_frame = nullptr;
+    SwsContext *m_sws = nullptr;
+    int m_idx = -1;
+};
+
+SIA timeText(qint64 usec) -> QString
+{
+    return _MSecToString(int(usec / 1000), usec >= 3600000000LL ? u"h:mm:ss"_q : u"mm:ss"_q);
+}
+
+auto ContactSheetEngine::grab(const QString &file, const ContactSheetOption &option,
+                              const QAtomicInt *canceled) -> ContactSheetFrames
+{
+    ContactSheetFrames frames;
+    SheetDecoder decoder;
+    if (!decoder.open(file)) {
+        _Error("Cannot open video stream in '%%'.", file);
+        return frames;
+    }
+    // positions are fractions of duration; without it every seek would
+    // land on the first keyframe
+    const auto duration = decoder.duration();
+    if (duration <= 0) {
+        _Error("Cannot find duration of '%%'.", file);
+        return frames;
+    }
+    const int count = qMax(1, option.columns * option.rows);
+    frames.images.reserve(count);
+    frames.times.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (canceled && canceled->load())
+            return ContactSheetFrames();
+        const qint64 usec = duration * (2*i + 1) / (2*count);
+        auto frame = decoder.grab(usec, option.width);
+        frames.images.push_back(frame.image);
+        frames.times.push_back(frame.usec < 0 ? usec : frame.usec);
+    }
+    frames.file = file;
+    frames.codec = decoder.codecName();
+    frames.size = decoder.size();
+    frames.duration = duration;
+    return frames;
+}
+
+auto ContactSheetEngine::compose(const ContactSheetFrames &frames,
+                                 const ContactSheetOption &option) -> QImage
+{
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
+    int thumbHeight = 0;
+    for (auto &image : frames.images)
+        thumbHeight = qMax(thumbHeight, image.height());
+    if (thumbHeight <= 0)
+        return QImage();
+
+    QFont font = qApp->font();
+    font.setPixelSize(qBound(10, option.width / 20, 24));
+    const QFontMetrics fm(font);
+    const int header = fm.height() * 2 + Margin * 2;
+    const int w = option.columns * (option.width + Margin) + Margin;
+    const int h = header + option.rows * (thumbHeight + Margin) + Margin;
+    QImage sheet(w, h, QImage::Format_RGB32);
+    sheet.fill(QColor(32, 32, 32));
+
+    QPainter painter(&sheet);
+    painter.setFont(font);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    const QFileInfo info(frames.file);
+    painter.setPen(Qt::white);
+    painter.drawText(Margin, Margin + fm.ascent(), info.fileName());
+    painter.drawText(Margin, Margin + fm.height() + fm.ascent(),
+                     u"%1 MiB, %2x%3 %4, %5"_q
+                     .arg(info.size() / (1024.0*1024.0), 0, 'f', 1)
+                     .arg(frames.size.width()).arg(frames.size.height())
+                     .arg(frames.codec).arg(timeText(frames.duration)));
+    for (int i = 0; i < frames.images.size(); ++i) {
+        const QRect rect(Margin + (i % option.columns) * (option.width + Margin),
+                         header + (i / option.columns) * (thumbHeight + Margin),
+                         option.width, thumbHeight);
+        const auto &image = frames.images[i];
+        if (image.isNull()) {
+            painter.fillRect(rect, Qt::black);
+            continue;
+        }
+        painter.drawImage(rect.x(), rect.y() + (thumbHeight - image.height())/2, image);
+        if (!option.timestamp)
+            continue;
+        const auto text = timeText(frames.times[i]);
+        const QPoint pos(rect.right() - fm.width(text) - Margin,
+                         rect.bottom() - fm.descent() - Margin);
+        painter.setPen(Qt::black);
+        painter.drawText(pos + QPoint(1, 1), text);
+        painter.setPen(Qt::white);
+        painter.drawText(pos, text);
+    }
+    painter.end();
+    return sheet;
+}
+
+class SheetJob : public QRunnable {
+public:
+    SheetJob(QObject *engine, int serial, const QString &file,
+             const QString &output, const ContactSheetOption &option,
+             const QAtomicInt *canceled)
+        : m_engine(engine), m_serial(serial), m_file(file)
+        , m_output(output), m_option(option), m_canceled(canceled) { }
+private:
+    auto run() -> void final
+    {
+        auto frames = ContactSheetEngine::grab(m_file, m_option, m_canceled);
+        _PostEvent(m_engine, SheetDone, m_serial, m_output, frames);
+    }
+    QObject *m_engine = nullptr;
+    int m_serial = 0;
+    QString m_file, m_output;
+    ContactSheetOption m_option;
+    const QAtomicInt *m_canceled = nullptr;
+};
+
+auto ContactSheetResult::toString() const -> QString
+{
+    return u"%1 of %2 contact sheets made (%3 failed) in %4s with %5 threads: "
+           "%6 files/min"_q.arg(made).arg(total).arg(failed).arg(msec / 1000.0)
+            .arg(threads).arg(filesPerMinute(), 0, 'f', 1);
+}
+
+struct ContactSheetEngine::Data {
+    ContactSheetOption option;
+    QThreadPool pool;
+    QAtomicInt canceled;
+    QElapsedTimer elapsed;
+    ContactSheetResult result;
+    int serial = 0;
+    bool running = false;
+};
+
+ContactSheetEngine::ContactSheetEngine(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+ContactSheetEngine::~ContactSheetEngine()
+{
+    cancel();
+    delete d;
+}
+
+auto ContactSheetEngine::setOption(const ContactSheetOption &option) -> void
+{
+    d->option = option;
+}
+
+auto ContactSheetEngine::option() const -> const ContactSheetOption&
+{
+    return d->option;
+}
+
+auto ContactSheetEngine::setMaxThreadCount(int count) -> void
+{
+    d->pool.setMaxThreadCount(qMax(1, count));
+}
+
+auto ContactSheetEngine::isRunning() const -> bool
+{
+    return d->running;
+}
+
+auto ContactSheetEngine::result() const -> ContactSheetResult
+{
+    auto result = d->result;
+    if (d->running)
+        result.msec = d->elapsed.elapsed();
+    return result;
+}
+
+auto ContactSheetEngine::run(const QString &path,
+                             const ContactSheetOption &option) -> int
+{
+    const QFileInfo info(path);
+    QStringList files;
+    if (info.isDir()) {
+        const auto filter = _ToNameFilter(VideoExt);
+        for (auto &entry : QDir(path).entryInfoList(filter, QDir::Files, QDir::Name))
+            files.push_back(entry.absoluteFilePath());
+    } else if (info.isFile())
+        files.push_back(info.absoluteFilePath());
+    if (files.isEmpty()) {
+        _Error("No video file found in '%%'.", path);
+        return 1;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    ContactSheetEngine engine;
+    engine.setOption(option);
+    QEventLoop loop;
+    connect(&engine, &ContactSheetEngine::finished, &loop, &QEventLoop::quit);
+    engine.start(files, QString());
+    loop.exec();
+    // sheets are still being written when the last one is composed
+    QThreadPool::globalInstance()->waitForDone();
+    auto result = engine.result();
+    result.msec = timer.elapsed();
+    qDebug().nospace() << result.toString().toLocal8Bit().constData();
+    return result.failed;
+}
+
+auto ContactSheetEngine::sheetFileName(const QString &file, const QString &folder,
+                                       const ContactSheetOption &option) -> QString
+{
+    const QFileInfo info(file);
+    const auto dir = folder.isEmpty() ? info.absolutePath() : folder;
+    return dir % '/'_q % info.completeBaseName() % "_sheet."_a % option.format;
+}
+
+auto ContactSheetEngine::start(const QStringList &files, const QString &folder) -> bool
+{
+    if (d->running || files.isEmpty())
+        return false;
+    d->canceled = 0;
+    d->result = ContactSheetResult();
+    d->result.total = files.size();
+    d->result.threads = d->pool.maxThreadCount();
+    d->running = true;
+    ++d->serial;
+    d->elapsed.start();
+    for (auto &file : files) {
+        const auto output = sheetFileName(file, folder, d->option);
+        d->pool.start(new SheetJob(this, d->serial, file, output,
+                                   d->option, &d->canceled));
+    }
+    _Info("Start to make contact sheets for %% files with %% threads.",
+          d->result.total, d->result.threads);
+    return true;
+}
+
+auto ContactSheetEngine::cancel() -> void
+{
+    if (!d->running)
+        return;
+    d->canceled = 1;
+    d->pool.clear();
+    d->pool.waitForDone();
+    d->running = false;
+    d->result.msec = d->elapsed.elapsed();
+    _Info("Contact sheets canceled after %% files.", d->result.made + d->result.failed);
+    emit finished();
+}
+
+auto ContactSheetEngine::customEvent(QEvent *event) -> void
+{
+    if (event->type() != SheetDone)
+        return;
+    int serial; QString output; ContactSheetFrames frames;
+    _TakeData(event, serial, output, frames);
+    if (serial != d->serial || !d->running)
+        return;
+    bool ok = false;
+    const auto image = compose(frames, d->option);
+    if (!image.isNull()) {
+        auto saver = new SnapshotSaver(image, output, d->option.quality);
+        if ((ok = saver->isWritable()))
+            QThreadPool::globalInstance()->start(saver);
+        else
+            delete saver;
+    }
+    auto &result = d->result;
+    if (ok)
+        ++result.made;
+    else
+        ++result.failed;
+    const int done = result.made + result.failed;
+    emit progressed(done, result.total);
+    if (done < result.total)
+        return;
+    d->running = false;
+    result.msec = d->elapsed.elapsed();
+    _Info("%%", result.toString());
+    emit finished();
+}
@@ -0,0 +1,62 @@
+#ifndef CONTACTSHEET_HPP
+#define CONTACTSHEET_HPP
+
+struct ContactSheetOption {
+    int columns = 4, rows = 5, width = 320; // width of each thumbnail
+    bool timestamp = true;
+    QString format = u"jpg"_q;
+    int quality = -1;
+};
+
+// thumbnails of one video decoded by worker
+struct ContactSheetFrames {
+    QString file, codec;
+    QSize size;
+    qint64 duration = 0; // usec
+    QVector<QImage> images;
+    QVector<qint64> times; // usec of each image
+};
+
+// outcome of last batch
+struct ContactSheetResult {
+    int total = 0, made = 0, failed = 0, threads = 0;
+    qint64 msec = 0;
+    auto filesPerMinute() const -> double
+        { return msec > 0 ? (made + failed) * 60000.0 / msec : 0.0; }
+    auto toString() const -> QString;
+};
+
+class ContactSheetEngine : public QObject {
+    Q_OBJECT
+public:
+    ContactSheetEngine(QObject *parent = nullptr);
+    ~ContactSheetEngine();
+    auto setOption(const ContactSheetOption &option) -> void;
+    auto option() const -> const ContactSheetOption&;
+    auto setMaxThreadCount(int count) -> void;
+    auto start(const QStringList &files, const QString &folder) -> bool;
+    auto cancel() -> void;
+    auto isRunning() const -> bool;
+    // filled in as files are done and final once finished() is emitted
+    auto result() const -> ContactSheetResult;
+    // makes sheets for video file or every video in folder without window,
+    // waits until all are written and prints result; returns failed count
+    static auto run(const QString &path, const ContactSheetOption &option) -> int;
+    static auto sheetFileName(const QString &file, const QString &folder,
+                              const ContactSheetOption &option) -> QString;
+    // decodes keyframes only; safe to call in any thread
+    static auto grab(const QString &file, const ContactSheetOption &option,
+                     const QAtomicInt *canceled = nullptr) -> ContactSheetFrames;
+    // lays out text with fonts, so call in GUI thread only
+    static auto compose(const ContactSheetFrames &frames,
+                        const ContactSheetOption &option) -> QImage;
+signals:
+    void progressed(int done, int total);
+    void finished();
+private:
+    auto customEvent(QEvent *event) -> void final;
+    struct Data;
+    Data *d;
+};
+
+#endif // CONTACTSHEET_HPP
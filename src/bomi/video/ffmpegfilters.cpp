@@ -1,5 +1,6 @@
 #include "ffmpegfilters.hpp"
 #include "global.hpp"
+#include "misc/cpukernel.hpp"
 extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
@@ -137,6 +138,64 @@ auto FFmpegFilterGraph::release() -> void
 
 /******************************************************************************/
 
+template<int>
+CPU_INLINE auto linearBody(uchar *__restrict out, const uchar *__restrict in1,
+                           const uchar *__restrict in2, int width) -> void
+{
+    for (int x = 0; x < width; ++x)
+        out[x] = (in1[x] + in2[x]) / 2;
+}
+
+template<int>
+CPU_INLINE auto cubicBody(uchar *__restrict out, const uchar *__restrict in0,
+                          const uchar *__restrict in1, const uchar *__restrict in2,
+                          const uchar *__restrict in3, int width) -> void
+{
+    for (int x = 0; x < width; ++x) {
+        const int p0 = in0[x], p1 = in1[x], p2 = in2[x], p3 = in3[x];
+        const auto a =  -p0 + 3*p1 - 3*p2 + p3;
+        const auto b = 2*p0 - 5*p1 + 4*p2 - p3;
+        const auto c =  -p0        +   p2;
+        const auto d =        2*p1;
+        out[x] = (uchar)qBound(0, (a + 2*b + 4*c + 8*d)/16, 255);
+    }
+}
+
+CPU_KERNEL_VARIANTS(linear, void, (uchar *out, const uchar *in1, const uchar *in2, int width),
+                    (out, in1, in2, width))
+CPU_KERNEL_VARIANTS(cubic, void, (uchar *out, const uchar *in0, const uchar *in1,
+                                  const uchar *in2, const uchar *in3, int width),
+                    (out, in0, in1, in2, in3, width))
+
+static CpuKernel<auto (uchar*, const uchar*, const uchar*, int) -> void>
+s_linear("bob-linear", CPU_KERNEL_LIST(linear), [] (auto linear) {
+    static const auto rows = CpuKernels::noise<uchar>(1920 * 2);
+    static std::vector<uchar> out(1920);
+    linear(out.data(), rows.data(), rows.data() + 1920, 1920);
+}, [] (auto linear, auto generic) {
+    const auto rows = CpuKernels::noise<uchar>(2051 * 2);
+    std::vector<uchar> out(2051), ref(2051);
+    linear(out.data(), rows.data(), rows.data() + 2051, 2051);
+    generic(ref.data(), rows.data(), rows.data() + 2051, 2051);
+    return CpuKernels::same(out, ref);
+});
+
+static CpuKernel<auto (uchar*, const uchar*, const uchar*,
+                       const uchar*, const uchar*, int) -> void>
+s_cubic("bob-cubic", CPU_KERNEL_LIST(cubic), [] (auto cubic) {
+    static const auto rows = CpuKernels::noise<uchar>(1920 * 4);
+    static std::vector<uchar> out(1920);
+    const auto p = rows.data();
+    cubic(out.data(), p, p + 1920, p + 1920 * 2, p + 1920 * 3, 1920);
+}, [] (auto cubic, auto generic) {
+    const auto rows = CpuKernels::noise<uchar>(2051 * 4);
+    std::vector<uchar> out(2051), ref(2051);
+    const auto p = rows.data();
+    cubic(out.data(), p, p + 2051, p + 2051 * 2, p + 2051 * 3, 2051);
+    generic(ref.data(), p, p + 2051, p + 2051 * 2, p + 2051 * 3, 2051);
+    return CpuKernels::same(out, ref);
+});
+
 auto BobDeinterlacer::field(DeintMethod method, const MpImage &src, bool top) const -> MpImage
 {
     if (src->num_planes < 1)
@@ -180,10 +239,9 @@ auto BobDeinterlacer::field(DeintMethod method, const MpImage &src, bool top) co
         for (int i = 0; i < count ; ++i) {
             memcpy(out, in, stride);
             out += stride;
-            auto in1 = in;
-            auto in2 = in += stride * 2;
-            for (int x = 0; x < stride; ++x)
-                *out++ = (*in1++ + *in2++) / 2 ;
+            s_linear(out, in, in + stride * 2, stride);
+            out += stride;
+            in += stride * 2;
         }
         break;
     } case DeintMethod::CubicBob: {
@@ -208,18 +266,9 @@ auto BobDeinterlacer::field(DeintMethod method, const MpImage &src, bool top) co
         for (int i = 0; i < count ; ++i) {
             memcpy(out, in, stride);
             out += stride;
-            auto in0 = in - stride * 2;
-            auto in1 = in;
-            auto in2 = in += stride * 2;
-            auto in3 = in + stride * 2;
-            for (int x = 0; x < stride; ++x) {
-                const int p0 = *in0++, p1 = *in1++, p2 = *in2++, p3 = *in3++;
-                const auto a =  -p0 + 3*p1 - 3*p2 + p3;
-                const auto b = 2*p0 - 5*p1 + 4*p2 - p3;
-                const auto c =  -p0        +   p2;
-                const auto d =        2*p1;
-                *out++ = (uchar)qBound(0, (a + 2*b + 4*c + 8*d)/16, 255);
-            }
+            s_cubic(out, in - stride * 2, in, in + stride * 2, in + stride * 4, stride);
+            out += stride;
+            in += stride * 2;
         }
         break;
     } default:
@@ -0,0 +1,176 @@
+#include "framepacer.hpp"
+
+static constexpr double MaxRatioDeviation = 0.01;   // beyond this, pitch is noticeable
+static constexpr double MaxCorrection = 0.002;      // phase correction on top of ratio
+static constexpr double CorrectionGain = 0.0005;
+static constexpr double DebtLeak = 0.995;
+static constexpr double IntervalGain = 0.02;
+static constexpr qint64 MaxGap = 500000;            // paused or seeked
+
+auto FramePacingStats::toString() const -> QString
+{
+    return u"frames=%1 repeats=%2 drops=%3 judder=%4 phase=%5 "
+            "vsync=%6ms cadence=%7 ratio=%8"_q
+            .arg(frames).arg(repeats).arg(drops).arg(judder, 0, 'f', 3)
+            .arg(phase, 0, 'f', 3).arg(vsync, 0, 'f', 3).arg(cadence)
+            .arg(ratio, 0, 'f', 5);
+}
+
+struct FramePacer::Data {
+    mutable QMutex mutex;
+    std::function<void(double)> notify;
+    bool active = false;
+    double interval = 1e6/60.0, fps = 0.0;
+    double cadence = 0.0, target = 1.0, ratio = 1.0, reported = 1.0;
+    double debt = 0.0, sumSq = 0.0, sumPhase = 0.0;
+    qint64 last = -1, frames = 0, repeats = 0, drops = 0;
+    auto updateTarget() -> void
+    {
+        cadence = 0.0;
+        target = 1.0;
+        if (fps <= 0.0 || interval <= 0.0)
+            return;
+        const double exact = 1e6 / (interval * fps);
+        // allow 3:2 pulldown-like cadences
+        const double c = qMax(1.0, qRound(exact * 2.0) * 0.5);
+        const double r = exact / c;
+        if (qAbs(r - 1.0) > MaxRatioDeviation)
+            return;
+        cadence = c;
+        target = r;
+    }
+    auto stats() const -> FramePacingStats
+    {
+        FramePacingStats s;
+        s.frames = frames;
+        s.repeats = repeats;
+        s.drops = drops;
+        s.judder = frames > 0 ? qSqrt(sumSq / frames) : 0.0;
+        s.phase = frames > 0 ? sumPhase / frames : 0.0;
+        s.vsync = interval * 1e-3;
+        s.cadence = cadence;
+        s.ratio = ratio;
+        return s;
+    }
+};
+
+FramePacer::FramePacer()
+    : d(new Data)
+{
+
+}
+
+FramePacer::~FramePacer()
+{
+    delete d;
+}
+
+auto FramePacer::setActive(bool active) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->active = active;
+    d->debt = 0.0;
+}
+
+auto FramePacer::isActive() const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    return d->active;
+}
+
+auto FramePacer::setDisplayRate(double hz) -> void
+{
+    if (hz <= 1.0)
+        return;
+    QMutexLocker locker(&d->mutex);
+    d->interval = 1e6 / hz;
+    d->updateTarget();
+}
+
+auto FramePacer::setFrameRate(double fps) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    if (_Change(d->fps, fps)) {
+        d->debt = 0.0;
+        d->updateTarget();
+    }
+}
+
+auto FramePacer::setRatioCallback(std::function<void(double)> &&cb) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->notify = std::move(cb);
+}
+
+auto FramePacer::ratio() const -> double
+{
+    QMutexLocker locker(&d->mutex);
+    return d->ratio;
+}
+
+auto FramePacer::stats() const -> FramePacingStats
+{
+    QMutexLocker locker(&d->mutex);
+    return d->stats();
+}
+
+auto FramePacer::reset() -> FramePacingStats
+{
+    QMutexLocker locker(&d->mutex);
+    const auto stats = d->stats();
+    d->last = -1;
+    d->frames = d->repeats = d->drops = 0;
+    d->debt = d->sumSq = d->sumPhase = 0.0;
+    return stats;
+}
+
+auto FramePacer::frameSwapped(qint64 usec, bool newFrame) -> void
+{
+    // swaps without new frame are osd updates and off the video cadence
+    if (!newFrame)
+        return;
+    std::function<void(double)> notify;
+    double ratio = 1.0;
+    {
+        QMutexLocker locker(&d->mutex);
+        const qint64 dt = usec - d->last;
+        const bool first = d->last < 0;
+        d->last = usec;
+        if (first || dt <= 0 || dt > MaxGap) {
+            d->debt = 0.0;
+            return;
+        }
+        // scene graph swaps only when something changed, so a gap spans
+        // several vsyncs; refine the interval from its integral fraction
+        const double vsyncs = dt / d->interval;
+        const int n = qRound(vsyncs);
+        if (n >= 1 && n <= 8) {
+            const double sample = dt / (double)n;
+            if (qAbs(sample - d->interval) < d->interval * 0.1) {
+                d->interval += (sample - d->interval) * IntervalGain;
+                d->updateTarget();
+            }
+        }
+        ++d->frames;
+        d->sumPhase += qAbs(vsyncs - n);
+        if (d->cadence > 0.0) {
+            const double error = n - d->cadence;
+            d->sumSq += error * error;
+            if (n > qCeil(d->cadence))
+                ++d->repeats;
+            else if (n < qFloor(d->cadence))
+                d->drops += qMax(1, qRound(d->cadence) - n);
+            d->debt = d->debt * DebtLeak + error;
+        }
+        double correction = 0.0;
+        if (d->active && d->cadence > 0.0)
+            correction = qBound(-MaxCorrection, d->debt * CorrectionGain, MaxCorrection);
+        d->ratio = d->active && d->cadence > 0.0 ? d->target * (1.0 + correction) : 1.0;
+        if (qAbs(d->ratio - d->reported) > 1e-5) {
+            d->reported = ratio = d->ratio;
+            notify = d->notify;
+        }
+    }
+    if (notify)
+        notify(ratio);
+}
@@ -0,0 +1,34 @@
+#ifndef FRAMEPACER_HPP
+#define FRAMEPACER_HPP
+
+struct FramePacingStats {
+    qint64 frames = 0, repeats = 0, drops = 0;
+    double judder = 0.0; // rms of vsync count error per frame
+    double phase = 0.0;  // mean distance of swaps from vsync grid, [0, 0.5]
+    double vsync = 0.0;  // measured vsync interval in msec
+    double cadence = 0.0;// target vsyncs per frame
+    double ratio = 1.0;  // current playback ratio applied to audio
+    auto toString() const -> QString;
+};
+
+// slaves playback to display refresh by playing slightly faster or slower;
+// fed with swap times from render thread, thread-safe otherwise
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+    auto setActive(bool active) -> void;
+    auto isActive() const -> bool;
+    auto setDisplayRate(double hz) -> void;
+    auto setFrameRate(double fps) -> void;
+    auto setRatioCallback(std::function<void(double)> &&cb) -> void;
+    auto frameSwapped(qint64 usec, bool newFrame) -> void;
+    auto ratio() const -> double;
+    auto stats() const -> FramePacingStats;
+    auto reset() -> FramePacingStats;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // FRAMEPACER_HPP
@@ -0,0 +1,514 @@
+#include "renderbenchmark.hpp"
+#include "videorenderer.hpp"
+#include "mpvosdrenderer.hpp"
+#include "subtitle/subtitle.hpp"
+#include "subtitle/subtitlerenderer.hpp"
+#include "opengl/openglframebufferobject.hpp"
+#include "misc/log.hpp"
+#include <QQuickWindow>
+#include <QOpenGLTimerQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QElapsedTimer>
+extern "C" {
+#include <sub/osd.h>
+}
+
+// scene graph is rendered into FBO by QQuickRenderControl in GUI thread so
+// that nothing shows up and compositor or vsync does not get in measurement;
+// older Qt falls back to a window on screen
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+#define USE_RENDER_CONTROL
+#include "opengl/opengloffscreencontext.hpp"
+#include <QQuickRenderControl>
+#include <QOpenGLFramebufferObject>
+#endif
+
+DECLARE_LOG_CONTEXT(OpenGL)
+
+// every scene is drawn at least MinFrames times and for TimeBudget ms after
+// WarmUp ms in which VideoRenderer settles size of its FBOs (300 ms)
+static constexpr int MinFrames = 10, MaxFrames = 1000;
+static constexpr qint64 TimeBudget = 500, WarmUp = 400;
+// a new caption for each synthetic frame
+static constexpr int FrameTime = 40, Captions = 1000;
+
+struct FrameFormat {
+    QString name;
+    OGL::TextureFormat format;
+};
+
+// precisions which VideoRenderer can be configured for
+static const FrameFormat s_formats[] = {
+    { u"rgba8"_q,   OGL::RGBA8_UNorm  },
+    { u"rgba16"_q,  OGL::RGBA16_UNorm },
+    { u"rgba16f"_q, OGL::RGBA16F      },
+    { u"rgba32f"_q, OGL::RGBA32F      }
+};
+
+static const QSize s_sizes[] = { {1280, 720}, {1920, 1080}, {3840, 2160} };
+
+struct Scene {
+    QString name;
+    int osd; // SUBBITMAP_EMPTY to hide OSD
+    bool subtitle;
+};
+
+static const Scene s_scenes[] = {
+    { u"frame"_q,       SUBBITMAP_EMPTY,  false },
+    { u"osd-libass"_q,  SUBBITMAP_LIBASS, false },
+    { u"osd-rgba"_q,    SUBBITMAP_RGBA,   false },
+    { u"subtitle"_q,    SUBBITMAP_EMPTY,  true  },
+    { u"all"_q,         SUBBITMAP_LIBASS, true  }
+};
+
+SIA isRenderable(OGL::TextureFormat format) -> bool
+{
+    switch (format) {
+    case OGL::RGBA8_UNorm:
+        return true;
+    case OGL::RGBA16_UNorm:
+        return OGL::is16bitFramebufferFormatSupported();
+    default:
+        return OGL::hasExtension(OGL::TextureFloat);
+    }
+}
+
+struct PassResult {
+    QString stage, format;
+    QSize size, window;
+    int loops = 0;
+    double cpu = 0, sync = 0, gpu = 0, wall = 0; // ns per frame
+    double uploads = 0;                          // subtitle uploads per frame
+    qint64 bytes = 0;                            // uploaded per frame
+};
+
+// gradient in r and g, pattern in b and opaque alpha as BGRA
+SIA synthesize(const QSize &size) -> QByteArray
+{
+    const int w = size.width(), h = size.height();
+    QByteArray data(w * h * 4, Qt::Uninitialized);
+    auto p = reinterpret_cast<uchar*>(data.data());
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x, p += 4) {
+            p[0] = (x ^ y) & 255;
+            p[1] = 255 * y / h;
+            p[2] = 255 * x / w;
+            p[3] = 255;
+        }
+    }
+    return data;
+}
+
+SIA srtTime(int ms) -> QString
+{
+    return QTime(0, 0).addMSecs(ms).toString(u"hh:mm:ss,zzz"_q);
+}
+
+// two lines which change on every frame
+SIA synthesizeSubtitle(const QString &fileName) -> QVector<SubComp>
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return QVector<SubComp>();
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    for (int i = 0; i < Captions; ++i) {
+        out << i + 1 << '\n' << srtTime(i * FrameTime) << " --> "
+            << srtTime((i + 1) * FrameTime) << '\n'
+            << "Caption <b>" << i << "</b> of synthetic subtitle\n"
+            << "with <i>second line</i> " << QString(i % 20 + 1, '*'_q) << "\n\n";
+    }
+    file.close();
+    Subtitle sub;
+    QVector<SubComp> comps;
+    if (sub.load(fileName, EncodingInfo::utf8())) {
+        for (int i = 0; i < sub.size(); ++i) {
+            comps.push_back(sub[i]);
+            comps.back().selection() = true;
+        }
+    }
+    return comps;
+}
+
+// drives VideoRenderer and SubtitleRenderer like PlayEngine does and times
+// scene graph frames in the thread which renders them
+struct Bench {
+#ifdef USE_RENDER_CONTROL
+    OpenGLOffscreenContext gl;
+    QScopedPointer<QQuickRenderControl> control;
+    QScopedPointer<QOpenGLFramebufferObject> fbo;
+#endif
+    QScopedPointer<QQuickWindow> window;
+    VideoRenderer *video = nullptr;
+    SubtitleRenderer *subtitle = nullptr;
+    QVector<PassResult> results;
+    QAtomicInt frameTime, uploads, hasQuery;
+
+    // shared with render thread
+    QMutex mutex;
+    QByteArray frame;
+    QSize frameSize;
+    int osdFormat = SUBBITMAP_EMPTY;
+    QVector<sub_bitmap> parts;
+    QByteArray glyph;
+    bool measuring = false;
+    int frames = 0;
+    double cpu = 0, sync = 0, gpu = 0, wall = 0;
+
+    // render thread only
+    MpvOsdRenderer *osd = nullptr;
+    QOpenGLTimerQuery *query = nullptr;
+    bool querying = false;
+    int changeId = 0;
+    QElapsedTimer timer;
+    qint64 synced = 0;
+
+    Bench()
+    {
+#ifdef USE_RENDER_CONTROL
+        control.reset(new QQuickRenderControl);
+        window.reset(new QQuickWindow(control.data()));
+#else
+        window.reset(new QQuickWindow);
+        auto format = QSurfaceFormat::defaultFormat();
+        format.setSwapInterval(0);
+        window->setFormat(format);
+        window->setFlags(Qt::FramelessWindowHint);
+#endif
+
+        subtitle = new SubtitleRenderer;
+        video = new VideoRenderer(window->contentItem());
+        video->setOverlay(subtitle);
+        video->setRenderFrameFunction([this] (Fbo *frame, Fbo *osd, const QMargins &)
+            { renderFrame(frame, osd); });
+        subtitle->setFrameTimeFunction([this] (int *ms) {
+            *ms = frameTime.load() % (Captions * FrameTime);
+            return true;
+        });
+        QObject::connect(video, &VideoRenderer::frameQueued,
+                         subtitle, &SubtitleRenderer::syncToFrame);
+        QObject::connect(subtitle, &SubtitleRenderer::updated,
+                         subtitle, [this] () { uploads.ref(); }, Qt::DirectConnection);
+
+        auto w = window.data();
+        auto direct = [&] (void (QQuickWindow::*signal)(), std::function<void()> &&slot)
+            { QObject::connect(w, signal, w, slot, Qt::DirectConnection); };
+        direct(&QQuickWindow::sceneGraphInitialized, [this] () {
+            query = new QOpenGLTimerQuery;
+            if (!query->create())
+                _Delete(query);
+            hasQuery = !!query;
+        });
+        direct(&QQuickWindow::sceneGraphInvalidated, [this] () {
+            if (osd)
+                osd->finalize();
+            _Delete(osd);
+            _Delete(query);
+        });
+        direct(&QQuickWindow::beforeSynchronizing, [this] () {
+            if (querying)
+                query->end(); // previous sync was not rendered
+            timer.start();
+            if ((querying = query))
+                query->begin();
+        });
+        direct(&QQuickWindow::afterSynchronizing, [this] ()
+            { synced = timer.nsecsElapsed(); });
+        direct(&QQuickWindow::afterRendering, [this] () {
+            const auto submitted = timer.nsecsElapsed();
+            if (querying)
+                query->end();
+            glFinish();
+            const auto finished = timer.nsecsElapsed();
+            const double gpuTime = querying ? query->waitForResult() : finished;
+            querying = false;
+            QMutexLocker locker(&mutex);
+            if (!measuring)
+                return;
+            cpu += submitted;
+            sync += synced;
+            gpu += gpuTime;
+            wall += finished;
+            ++frames;
+        });
+    }
+    ~Bench()
+    {
+        // scene graph is invalidated here while members are still alive
+#ifdef USE_RENDER_CONTROL
+        gl.makeCurrent();
+        control.reset();
+        window.reset();
+        fbo.reset();
+        gl.doneCurrent();
+#else
+        window.reset();
+#endif
+    }
+
+    // sceneGraphInitialized is emitted here
+    auto start() -> bool
+    {
+#ifdef USE_RENDER_CONTROL
+        gl.setFormat(QSurfaceFormat::defaultFormat());
+        if (!gl.createContext())
+            return false;
+        gl.createSurface();
+        if (!gl.makeCurrent())
+            return false;
+        control->initialize(gl.context());
+#else
+        window->show();
+#endif
+        return true;
+    }
+
+    auto resize(const QSize &size) -> void
+    {
+        window->resize(size);
+        video->setSize(size);
+#ifdef USE_RENDER_CONTROL
+        gl.makeCurrent();
+        fbo.reset(new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::CombinedDepthStencil));
+        window->setRenderTarget(fbo.data());
+#endif
+    }
+
+    // stands in for mpv which renders decoded frame into frame FBO
+    auto renderFrame(Fbo *fbo, Fbo *osdFbo) -> void
+    {
+        QMutexLocker locker(&mutex);
+        if (fbo && fbo->isValid() && fbo->size() == frameSize) {
+            auto texture = fbo->texture();
+            texture.bind();
+            texture.upload(frame.constData());
+        }
+        if (osdFbo && osdFormat != SUBBITMAP_EMPTY) {
+            if (!osd) {
+                osd = new MpvOsdRenderer;
+                osd->initialize();
+            }
+            sub_bitmaps imgs{};
+            imgs.format = osdFormat;
+            imgs.parts = parts.data();
+            imgs.num_parts = parts.size();
+            imgs.change_id = ++changeId; // like karaoke, changes every frame
+            osd->prepare(osdFbo);
+            osd->draw(&imgs);
+            osd->end();
+        }
+    }
+
+    // two lines of glyph-sized bitmaps at the bottom of window
+    auto setOsd(int format, const QSize &window) -> void
+    {
+        QMutexLocker locker(&mutex);
+        osdFormat = format;
+        parts.clear();
+        if (format == SUBBITMAP_EMPTY)
+            return;
+        const int bpp = format == SUBBITMAP_RGBA ? 4 : 1;
+        const int gw = 24 * window.width() / 1280, gh = gw * 3 / 2;
+        glyph = QByteArray(gw * gh * bpp, Qt::Uninitialized);
+        for (int i = 0; i < glyph.size(); ++i)
+            glyph[i] = ((i / bpp % gw) * (i / bpp / gw)) & 255;
+        for (int line = 0; line < 2; ++line) {
+            for (int i = 0; i < 50; ++i) {
+                sub_bitmap part{};
+                part.bitmap = glyph.data();
+                part.stride = gw * bpp;
+                part.w = part.dw = gw;
+                part.h = part.dh = gh;
+                part.x = (i + 1) * gw * 9 / 10;
+                part.y = window.height() - (3 - line) * gh;
+                part.libass.color = 0xffffff00;
+                parts.push_back(part);
+            }
+        }
+    }
+
+    // queues next frame like PlayEngine and waits until it is rendered
+    auto next() -> void
+    {
+#ifdef USE_RENDER_CONTROL
+        frameTime.fetchAndAddRelaxed(FrameTime);
+        video->updateForNewFrame(frameSize);
+        // deliver queued signals, e.g. frameQueued to subtitle renderer
+        qApp->processEvents();
+        gl.makeCurrent();
+        control->polishItems();
+        control->sync();
+        control->render();
+#else
+        QEventLoop loop;
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        QObject::connect(window.data(), &QQuickWindow::frameSwapped,
+                         &loop, &QEventLoop::quit, Qt::QueuedConnection);
+        frameTime.fetchAndAddRelaxed(FrameTime);
+        video->updateForNewFrame(frameSize);
+        timeout.start(1000);
+        loop.exec();
+#endif
+    }
+
+    auto measure(const Scene &scene, const FrameFormat &format) -> void
+    {
+        video->setFramebufferObjectFormat(format.format);
+        video->setOsdVisible(scene.osd != SUBBITMAP_EMPTY);
+        subtitle->setHidden(!scene.subtitle);
+        setOsd(scene.osd, window->size());
+
+        QElapsedTimer total;
+        total.start();
+        while (total.elapsed() < WarmUp)
+            next();
+        mutex.lock();
+        measuring = true;
+        frames = 0;
+        cpu = sync = gpu = wall = 0;
+        mutex.unlock();
+        uploads = 0;
+        int count = 0;
+        total.restart();
+        while (count < MinFrames || (count < MaxFrames && total.elapsed() < TimeBudget)) {
+            // hidden or minimized window renders nothing
+            if (total.elapsed() > TimeBudget * 10)
+                break;
+            next();
+            QMutexLocker locker(&mutex);
+            count = frames;
+        }
+
+        QMutexLocker locker(&mutex);
+        measuring = false;
+        if (!frames) {
+            _Error("No frame was rendered for %% %%.", scene.name, format.name);
+            return;
+        }
+        PassResult r;
+        r.stage = scene.name;
+        r.format = format.name;
+        r.size = frameSize;
+        r.window = window->size();
+        r.loops = frames;
+        r.cpu = cpu / frames;
+        r.sync = sync / frames;
+        r.gpu = gpu / frames;
+        r.wall = wall / frames;
+        r.uploads = uploads.load() / double(frames);
+        r.bytes = frame.size();
+        OGL::logError("RenderBenchmark: " + scene.name.toLatin1());
+
+        QString line;
+        line.sprintf("%-10s %-8s %5dx%-5d %9.3f %9.3f %9.3f %9.3f %10.1f %7.2f",
+                     qPrintable(r.stage), qPrintable(r.format), r.size.width(),
+                     r.size.height(), r.sync * 1e-6, r.cpu * 1e-6, r.gpu * 1e-6,
+                     r.wall * 1e-6, r.bytes / (r.wall * 1e-9) / 1048576.0, r.uploads);
+        qDebug().nospace() << line.toLocal8Bit().constData();
+        results.push_back(r);
+    }
+
+    auto run(const QVector<SubComp> &captions) -> void
+    {
+        subtitle->setComponents(captions);
+        QString line;
+        line.sprintf("%-10s %-8s %11s %9s %9s %9s %9s %10s %7s", "stage", "format",
+                     "size", "sync(ms)", "cpu(ms)", "gpu(ms)", "wall(ms)",
+                     "MiB/s", "subs");
+        qDebug().nospace() << line.toLocal8Bit().constData();
+        // OSD and subtitles are rendered in window size which letterboxes
+        // frame into 4:3
+        if (!start()) {
+            _Error("Cannot create OpenGL context for benchmark.");
+            return;
+        }
+        for (const auto &size : s_sizes) {
+            resize({ size.width(), size.width() * 3 / 4 });
+            mutex.lock();
+            frameSize = size;
+            frame = synthesize(size);
+            mutex.unlock();
+            for (const auto &format : s_formats) {
+                if (!isRenderable(format.format)) {
+                    _Info("Skip %% frames: not renderable", format.name);
+                    continue;
+                }
+                for (const auto &scene : s_scenes)
+                    measure(scene, format);
+            }
+        }
+#ifndef USE_RENDER_CONTROL
+        window->hide();
+#endif
+    }
+};
+
+SIA toJson(const PassResult &r) -> QJsonObject
+{
+    QJsonObject json;
+    json.insert(u"stage"_q, r.stage);
+    json.insert(u"format"_q, r.format);
+    json.insert(u"width"_q, r.size.width());
+    json.insert(u"height"_q, r.size.height());
+    json.insert(u"window_width"_q, r.window.width());
+    json.insert(u"window_height"_q, r.window.height());
+    json.insert(u"loops"_q, r.loops);
+    json.insert(u"sync_ms"_q, r.sync * 1e-6);
+    json.insert(u"cpu_ms"_q, r.cpu * 1e-6);
+    json.insert(u"gpu_ms"_q, r.gpu * 1e-6);
+    json.insert(u"wall_ms"_q, r.wall * 1e-6);
+    json.insert(u"subtitle_uploads"_q, r.uploads);
+    json.insert(u"bytes"_q, r.bytes);
+    json.insert(u"upload_mib_s"_q, r.bytes / (r.wall * 1e-9) / 1048576.0);
+    return json;
+}
+
+auto RenderBenchmark::run(const QString &fileName) -> bool
+{
+    const auto error = OGL::check();
+    if (!error.isEmpty()) {
+        _Error("%%", error);
+        return false;
+    }
+    QTemporaryDir dir;
+    const auto captions = synthesizeSubtitle(dir.path() % "/benchmark.srt"_a);
+    if (captions.isEmpty()) {
+        _Error("Cannot create subtitle for benchmark.");
+        return false;
+    }
+
+    QJsonObject json;
+    {
+        Bench bench;
+        auto w = bench.window.data();
+        QObject::connect(w, &QQuickWindow::sceneGraphInitialized, w, [&] () {
+            auto string = [] (GLenum name) {
+                return QString::fromLatin1(reinterpret_cast<const char*>(glGetString(name)));
+            };
+            json.insert(u"renderer"_q, string(GL_RENDERER));
+            json.insert(u"vendor"_q, string(GL_VENDOR));
+            json.insert(u"version"_q, string(GL_VERSION));
+        }, Qt::DirectConnection);
+        bench.run(captions);
+        _Info("Ran render benchmark on %%", json.value(u"renderer"_q).toString());
+        // without timer query, GPU time is the time until glFinish() returns
+        json.insert(u"timer"_q, bench.hasQuery.load() ? u"query"_q : u"finish"_q);
+        QJsonArray passes;
+        for (const auto &r : bench.results)
+            passes.append(toJson(r));
+        json.insert(u"passes"_q, passes);
+    }
+
+    QFile file(fileName);
+    const bool console = fileName.isEmpty() || fileName == u"-"_q;
+    if (console ? !file.open(stdout, QFile::WriteOnly)
+                : !file.open(QFile::WriteOnly | QFile::Truncate)) {
+        _Error("Cannot write benchmark results into %%", fileName);
+        return false;
+    }
+    file.write(QJsonDocument(json).toJson());
+    return true;
+}
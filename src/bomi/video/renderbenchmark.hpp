@@ -0,0 +1,13 @@
+#ifndef RENDERBENCHMARK_HPP
+#define RENDERBENCHMARK_HPP
+
+// draws synthetic frames, OSD and subtitles through VideoRenderer and
+// SubtitleRenderer offscreen and writes per-frame timings of scene graph
+// as JSON into fileName or stdout if it's empty or -; Qt older than 5.4
+// renders in a window instead
+class RenderBenchmark {
+public:
+    static auto run(const QString &fileName) -> bool;
+};
+
+#endif // RENDERBENCHMARK_HPP
@@ -4,21 +4,33 @@
 #include "opengl/opengltexturebinder.hpp"
 #include "misc/dataevent.hpp"
 #include "misc/log.hpp"
+#include "misc/memorygovernor.hpp"
 #include "player/mpv.hpp"
 #include <QQuickWindow>
 
 DECLARE_LOG_CONTEXT(Video)
 
-enum EventType {NewFrame = QEvent::User + 1 };
+enum EventType {NewFrame = QEvent::User + 1, LoadedChanged };
 
 struct VideoPreview::Data {
     VideoPreview *p = nullptr;
     int id = 0;
     bool redraw = false, active = false, keyframe = true, video = false;
-    bool loaded = false;
+    bool loaded = false, suspended = false;
     QSize displaySize{0, 0};
     double rate = 0.0, aspect = 0, percent = 0;
+    QByteArray path;
     Mpv mpv;
+    MemoryConsumer memory{u"seek preview"_q, MemoryPriority::Preview};
+    // GUI thread only because of item size
+    auto updateMemory() -> void
+    {
+        // decoded frames in flight (420p) and the target fbo, roughly
+        static constexpr int Frames = 8;
+        const qint64 pixels = qint64(displaySize.width()) * displaySize.height();
+        const qint64 fbo = qint64(p->width()) * p->height() * 4;
+        memory.setUsage(loaded ? pixels * 3 / 2 * Frames + fbo : 0);
+    }
     auto vo() const -> QByteArray { return "opengl-cb"_b; }
     auto hasVideo() -> bool { return id > 0 && !displaySize.isEmpty(); }
     auto sizeAspect() const -> double
@@ -46,8 +58,19 @@ VideoPreview::VideoPreview(QQuickItem *parent)
         if (_Change(d->id, id) && _Change(d->video, d->hasVideo()))
             emit hasVideoChanged(d->video);
     });
-    d->mpv.request(MPV_EVENT_START_FILE, [=] () { d->loaded = true; });
-    d->mpv.request(MPV_EVENT_END_FILE, [=] () { d->loaded = false; });
+    d->mpv.request(MPV_EVENT_START_FILE, [=] () { _PostEvent(this, LoadedChanged, true); });
+    d->mpv.request(MPV_EVENT_END_FILE, [=] () { _PostEvent(this, LoadedChanged, false); });
+    d->memory.setReclaim([=] (qint64) -> qint64 {
+        const auto usage = d->memory.usage();
+        d->suspended = true;
+        unload();
+        return usage;
+    });
+    d->memory.setRestore([=] () {
+        d->suspended = false;
+        if (!d->path.isEmpty())
+            load(d->path);
+    });
     d->mpv.setOption("hwdec", "no");
     d->mpv.setOption("aid", "no");
     d->mpv.setOption("sid", "no");
@@ -116,6 +139,10 @@ auto VideoPreview::customEvent(QEvent *event) -> void
         d->redraw = true;
         reserve(UpdateMaterial);
         break;
+    } case LoadedChanged: {
+        d->loaded = _GetData<bool>(event);
+        d->updateMemory();
+        break;
     } default:
         d->mpv.process(event);
         break;
@@ -138,6 +165,8 @@ auto VideoPreview::setSizeHint(const QSize &size) -> void
         emit aspectRatioChanged();
     if (hv)
         emit hasVideoChanged(d->video);
+    if (dp)
+        d->updateMemory();
 }
 
 auto VideoPreview::sizeHint() const -> QSize
@@ -164,12 +193,15 @@ auto VideoPreview::load(const QByteArray &path) -> void
 {
     if (path.contains("bomi-yle-"_b))
         return;
-    if (d->active)
+    d->path = path;
+    if (d->active && !d->suspended)
         d->mpv.tellAsync("loadfile", path);
 }
 
 auto VideoPreview::unload() -> void
 {
+    if (!d->suspended)
+        d->path.clear();
     d->mpv.tellAsync("stop");
 }
 
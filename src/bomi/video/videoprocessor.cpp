@@ -8,6 +8,7 @@
 #include "player/mpv_helper.hpp"
 #include "opengl/opengloffscreencontext.hpp"
 #include "os/os.hpp"
+#include "misc/cpukernel.hpp"
 #include "enum/colorrange.hpp"
 #include "enum/colorspace.hpp"
 extern "C" {
@@ -94,6 +95,7 @@ struct VideoProcessor::Data {
     QMutex mutex; // must be locked
     double ptsSkipStart = MP_NOPTS_VALUE, ptsLastSkip = MP_NOPTS_VALUE;
     bool skip = false;
+    QAtomicInt scanStride{1}; int scanned = 0;
 
     auto reset() -> void
     {
@@ -262,6 +264,11 @@ auto VideoProcessor::stopSkipping() -> void
     d->mutex.unlock();
 }
 
+auto VideoProcessor::setScanStride(int n) -> void
+{
+    d->scanStride.store(qMax(1, n));
+}
+
 auto VideoProcessor::isSkipping() const -> bool
 {
     return d->skip;
@@ -282,13 +289,51 @@ static auto avgLuma(const mp_image *mpi, F &&addLine) -> double
     return avg;
 }
 
+// integer sums are exact in any order so whole row can be vectorized
+template<class T>
+CPU_INLINE auto sumRow(const T *p, int w) -> quint64
+{
+    quint64 sum = 0;
+    for (int x = 0; x < w; ++x)
+        sum += p[x];
+    return sum;
+}
+
+template<int>
+CPU_INLINE auto sum8Body(const quint8 *p, int w) -> quint64 { return sumRow(p, w); }
+
+template<int>
+CPU_INLINE auto sum16Body(const quint16 *p, int w) -> quint64 { return sumRow(p, w); }
+
+CPU_KERNEL_VARIANTS(sum8, quint64, (const quint8 *p, int w), (p, w))
+CPU_KERNEL_VARIANTS(sum16, quint64, (const quint16 *p, int w), (p, w))
+
 template<class T>
-static auto lumaYCbCrPlanar(const mp_image *mpi) -> double
+SIA benchSum(auto (*sum)(const T*, int) -> quint64) -> void
+{
+    static const auto row = CpuKernels::noise<T>(1920);
+    sum(row.data(), row.size());
+}
+
+template<class T>
+SIA checkSum(auto (*sum)(const T*, int) -> quint64,
+             auto (*generic)(const T*, int) -> quint64) -> bool
+{
+    const auto row = CpuKernels::noise<T>(2051);
+    return sum(row.data(), row.size()) == generic(row.data(), row.size());
+}
+
+static CpuKernel<auto (const quint8*, int) -> quint64>
+s_sum8("luma-sum8", CPU_KERNEL_LIST(sum8), benchSum<quint8>, checkSum<quint8>);
+
+static CpuKernel<auto (const quint16*, int) -> quint64>
+s_sum16("luma-sum16", CPU_KERNEL_LIST(sum16), benchSum<quint16>, checkSum<quint16>);
+
+template<class T, class Sum>
+static auto lumaYCbCrPlanar(const mp_image *mpi, const Sum &sum) -> double
 {
-    return avgLuma(mpi, [] (double &sum, const uchar *data, int w) {
-        const T *p = (const T*)data;
-        for (int x = 0; x < w; ++x)
-            sum += *p++;
+    return avgLuma(mpi, [&] (double &avg, const uchar *data, int w) {
+        avg += sum((const T*)data, w);
     });
 }
 
@@ -299,14 +344,14 @@ static auto luminance(const mp_image *mpi) -> double
     case IMGFMT_444P:   case IMGFMT_422P:   case IMGFMT_440P:
     case IMGFMT_411P:   case IMGFMT_410P:   case IMGFMT_Y8:
     case IMGFMT_444AP:  case IMGFMT_422AP:  case IMGFMT_420AP:
-        return lumaYCbCrPlanar<quint8>(mpi);
+        return lumaYCbCrPlanar<quint8>(mpi, s_sum8);
     case IMGFMT_444P16: case IMGFMT_444P14: case IMGFMT_444P12:
     case IMGFMT_444P10: case IMGFMT_444P9:  case IMGFMT_422P16:
     case IMGFMT_422P14: case IMGFMT_422P12: case IMGFMT_422P10:
     case IMGFMT_422P9:  case IMGFMT_420P16: case IMGFMT_420P14:
     case IMGFMT_420P12: case IMGFMT_420P10: case IMGFMT_420P9:
     case IMGFMT_Y16:
-        return lumaYCbCrPlanar<quint16>(mpi);
+        return lumaYCbCrPlanar<quint16>(mpi, s_sum16);
     case IMGFMT_YUYV:   case IMGFMT_UYVY: {
         const int offset = mpi->imgfmt == IMGFMT_UYVY;
         return avgLuma(mpi, [&] (double &sum, const uchar *p, int w) {
@@ -372,6 +417,8 @@ auto VideoProcessor::filterIn(mp_image *_mpi) -> int
                     if (mpi->pts - start > 5*60)// 5min
                         return false;
                 }
+                if (++d->scanned % d->scanStride.load())
+                    return true;
                 MpImage img;
                 if (IMGFMT_IS_HWACCEL(mpi->imgfmt)) {
                     Q_ASSERT(d->hwdec);
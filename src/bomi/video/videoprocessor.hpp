@@ -19,6 +19,8 @@ public:
     auto skipToNextBlackFrame() -> void;
     auto stopSkipping() -> void;
     auto isSkipping() const -> bool;
+    // measure every n-th frame only while skipping to black frame
+    auto setScanStride(int n) -> void;
     auto hwdec() const -> QString;
     auto setMotionIntrplOption(const MotionIntrplOption &option) -> void;
     auto inputColorSpace() const -> ColorSpace;
@@ -6,6 +6,7 @@
 #include "opengl/opengltexturebinder.hpp"
 #include "misc/dataevent.hpp"
 #include "misc/log.hpp"
+#include "misc/memorygovernor.hpp"
 #include "enum/rotation.hpp"
 #include <QQmlProperty>
 #include <QQuickWindow>
@@ -39,6 +40,21 @@ struct FboSet {
         _Renew(fbo, size, format);
         return true;
     }
+    auto bytes() const -> qint64
+    {
+        if (!fbo)
+            return 0;
+        int bpp = 4;
+        switch (format) {
+        case OGL::RGBA16_UNorm: case OGL::RGBA16F:
+            bpp = 8; break;
+        case OGL::RGBA32F:
+            bpp = 16; break;
+        default:
+            break;
+        }
+        return qint64(fbo->width()) * fbo->height() * bpp;
+    }
 };
 
 struct VideoRenderer::VideoShaderData : public VideoRenderer::ShaderData {
@@ -147,6 +163,7 @@ struct VideoRenderer::Data {
     int dirty = 0;
 
     FboSet frame, osd;
+    MemoryConsumer memory{u"video buffers"_q, MemoryPriority::Video};
 
     QSize sourceSize{0, 1};
     QTimer sizeChecker;
@@ -312,6 +329,7 @@ auto VideoRenderer::finalizeGL() -> void
     Super::finalizeGL();
     d->frame.fallback.destroy();
     _Delete(d->frame.fbo);
+    d->memory.setUsage(0);
 }
 
 auto VideoRenderer::customEvent(QEvent *event) -> void
@@ -327,6 +345,7 @@ auto VideoRenderer::customEvent(QEvent *event) -> void
         }
         d->redraw = true;
         reserve(UpdateMaterial);
+        emit frameQueued();
         break;
     } default:
         break;
@@ -533,8 +552,8 @@ auto VideoRenderer::updateData(ShaderData *_data) -> void
         _Trace("VideoRendererItem::updateTexture(): no queued frame");
     } else if (!d->frame.size.isEmpty()) {
         d->redraw = false;
-        d->frame.renew();
-        d->osd.renew();
+        if (d->frame.renew() | d->osd.renew())
+            d->memory.setUsage(d->frame.bytes() + d->osd.bytes());
         data->redraw = true;
         data->osdMargins = d->osd.margins;
         data->osdVisible = d->osd.visible;
@@ -66,6 +66,8 @@ signals:
     void screenRectChanged(const QRectF &rect);
     void overlayOnLetterboxChanged(bool on);
     void alignmentChanged(int alignment);
+    // new frame will be drawn in next sync
+    void frameQueued();
 private:
     auto initializeGL() -> void final;
     auto finalizeGL() -> void final;
@@ -144,45 +144,83 @@ class FontFamilyModel : public SimpleListModel<FontData> {
     auto fontData(int row, int) const -> QFont { return at(row).font; }
 };
 
-static auto generateList(bool fixedOnly) -> QList<FontData>
+static auto fontData(QFontDatabase &db, const QString &family,
+                     const QFont &def) -> FontData
 {
-    QList<FontData> list;
-    QFontDatabase db;
-    const auto type = fixedOnly ? QFontDatabase::FixedFont : QFontDatabase::GeneralFont;
-    const auto def = QFontDatabase::systemFont(type);
-    for (auto &family : db.families()) {
-        if (fixedOnly && !db.isFixedPitch(family))
-            continue;
-        FontData data;
-        data.font = def;
-        data.font.setFamily(family);
-        data.sys = QFontInfo(data.font).family();
-        bool hasLatin = false;
-        const auto system = writingSystemForFont(&db, data.font, &hasLatin);
-        const auto sample = db.writingSystemSample(system);
-        if (!sample.isEmpty())
-            data.display = data.font.family() % " ("_a % sample % ")"_a;
-        list.push_back(data);
+    FontData data;
+    data.font = def;
+    data.font.setFamily(family);
+    data.sys = QFontInfo(data.font).family();
+    bool hasLatin = false;
+    const auto system = writingSystemForFont(&db, data.font, &hasLatin);
+    const auto sample = db.writingSystemSample(system);
+    if (!sample.isEmpty())
+        data.display = data.font.family() % " ("_a % sample % ")"_a;
+    return data;
+}
+
+// font enumeration is slow with many families installed and QFontInfo
+// belongs to GUI thread; the lists are generated once, a few families per
+// turn of event loop if prefetched
+struct FontCache {
+    static constexpr int FamiliesPerTurn = 16;
+    QList<FontData> lists[2];
+    bool ready[2] = { false, false };
+    QStringList families;
+    int next = 0;
+    QTimer *timer = nullptr; // owned by qApp
+    // returns true when done
+    auto generate(int count) -> bool
+    {
+        Q_ASSERT(QThread::currentThread() == qApp->thread());
+        if (ready[0] && ready[1])
+            return true;
+        QFontDatabase db;
+        if (!next)
+            families = db.families();
+        const QFont defs[] = { QFontDatabase::systemFont(QFontDatabase::GeneralFont),
+                               QFontDatabase::systemFont(QFontDatabase::FixedFont) };
+        for (int end = qMin(families.size(), next + count); next < end; ++next) {
+            const auto &family = families[next];
+            lists[0].push_back(fontData(db, family, defs[0]));
+            if (db.isFixedPitch(family))
+                lists[1].push_back(fontData(db, family, defs[1]));
+        }
+        if (next < families.size())
+            return false;
+        ready[0] = ready[1] = true;
+        families.clear();
+        if (timer)
+            timer->stop();
+        return true;
     }
-    return list;
+};
+
+static auto fontCache() -> FontCache&
+{
+    static FontCache cache;
+    return cache;
 }
 
 static auto getFontDataList(bool fixedOnly) -> QList<FontData>
 {
-    if (fixedOnly) {
-        static const auto list = generateList(true);
-        return list;
-    } else {
-        static const auto all = generateList(false);
-        return all;
-    }
+    auto &cache = fontCache();
+    cache.generate(std::numeric_limits<int>::max());
+    return cache.lists[fixedOnly];
 }
 
 struct FontComboBox::Data {
     FontComboBox *p = nullptr;
     FontFamilyModel *model = nullptr;
-    bool fixedOnly = false;
-    auto generateList() -> QList<FontData> { return getFontDataList(fixedOnly); }
+    bool fixedOnly = false, loaded = false;
+    auto load() -> void
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        model->setList(getFontDataList(fixedOnly));
+        p->setCurrentIndex(0);
+    }
 };
 
 FontComboBox::FontComboBox(QWidget *parent)
@@ -198,9 +236,7 @@ FontComboBox::FontComboBox(QWidget *parent)
         setFont(d->model->at(idx).font);
     });
     d->model = new FontFamilyModel;
-    d->model->setList(d->generateList());
     setModel(d->model);
-    setCurrentIndex(0);
 }
 
 FontComboBox::~FontComboBox()
@@ -209,16 +245,29 @@ FontComboBox::~FontComboBox()
     delete d;
 }
 
+auto FontComboBox::prefetch() -> void
+{
+    auto &cache = fontCache();
+    if (cache.timer || cache.ready[0])
+        return;
+    cache.timer = new QTimer(qApp);
+    cache.timer->setInterval(0);
+    QObject::connect(cache.timer, &QTimer::timeout, [&cache] ()
+        { cache.generate(FontCache::FamiliesPerTurn); });
+    cache.timer->start();
+}
+
 auto FontComboBox::setFixedFontOnly(bool fixed) -> void
 {
-    if (_Change(d->fixedOnly, fixed)) {
-        d->model->setList(d->generateList());
-        setCurrentIndex(0);
+    if (_Change(d->fixedOnly, fixed) && d->loaded) {
+        d->loaded = false;
+        d->load();
     }
 }
 
 auto FontComboBox::setCurrentFont(const QFont &font) -> void
 {
+    d->load();
     const auto family = QFontInfo(font).family();
     for (int i = 0; i < d->model->size(); ++i) {
         if (d->model->at(i).sys == family) {
@@ -230,5 +279,12 @@ auto FontComboBox::setCurrentFont(const QFont &font) -> void
 
 auto FontComboBox::currentFont() const -> QFont
 {
+    d->load();
     return d->model->value(currentIndex()).font;
 }
+
+auto FontComboBox::showEvent(QShowEvent *event) -> void
+{
+    d->load();
+    QComboBox::showEvent(event);
+}
@@ -10,9 +10,13 @@ public:
     auto setCurrentFont(const QFont &font) -> void;
     auto currentFont() const -> QFont;
     auto setFixedFontOnly(bool fixed) -> void;
+    // enumerate font families bit by bit in GUI thread before any box is
+    // created; font queries are not safe in other threads
+    static auto prefetch() -> void;
 signals:
     void currentFontChanged();
 private:
+    auto showEvent(QShowEvent *event) -> void final;
     struct Data;
     Data *d;
 };
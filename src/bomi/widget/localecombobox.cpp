@@ -1,5 +1,7 @@
 #include "localecombobox.hpp"
 #include "player/translator.hpp"
+#include <QThreadPool>
+#include <QRunnable>
 
 struct LocaleComboBox::Item {
     bool operator == (const Item &rhs) const { return locale == rhs.locale; }
@@ -15,13 +17,37 @@ struct LocaleComboBox::Data {
     LocaleComboBox *p = nullptr;
     QList<Item> items;
     Item system;
+    bool loaded = false;
+    // native names don't depend on the ui language; resolve them once
+    static auto available() -> QList<Item>
+    {
+        static QMutex mutex;
+        static QList<Item> items;
+        static bool ready = false;
+        QMutexLocker locker(&mutex);
+        if (!ready) {
+            const auto locales = Translator::availableLocales();
+            items.reserve(locales.size());
+            for (auto &locale : locales) {
+                items.append(Item{locale});
+                items.last().update();
+            }
+            qSort(items);
+            ready = true;
+        }
+        return items;
+    }
+    auto load() -> void
+    {
+        if (_Change(loaded, true)) {
+            items = available();
+            reset();
+        }
+    }
     auto reset() -> void
     {
         auto locale = p->currentLocale();
         p->clear();
-        for (auto &it : items)
-            it.update();
-        qSort(items);
         auto s = Locale::system();
         p->addItem(tr("System locale[%1]").arg(s.nativeName()),
                    system.locale.toVariant());
@@ -31,16 +57,19 @@ struct LocaleComboBox::Data {
     }
 };
 
+class LocalePrefetcher : public QRunnable {
+public:
+    LocalePrefetcher(std::function<void()> &&func): m_func(std::move(func)) { }
+private:
+    auto run() -> void final { m_func(); }
+    std::function<void()> m_func;
+};
+
 LocaleComboBox::LocaleComboBox(QWidget *parent)
     : QComboBox(parent)
     , d(new Data)
 {
     d->p = this;
-    auto locales = Translator::availableLocales();
-    d->items.reserve(locales.size());
-    for (auto &locale : locales)
-        d->items.append(Item{locale});
-    d->reset();
     auto signal = &LocaleComboBox::currentLocaleChanged;
     PLUG_CHANGED(this);
 }
@@ -53,16 +82,31 @@ LocaleComboBox::~LocaleComboBox()
 auto LocaleComboBox::changeEvent(QEvent *event) -> void
 {
     QComboBox::changeEvent(event);
-    if (event->type() == QEvent::LanguageChange)
+    if (event->type() == QEvent::LanguageChange && d->loaded)
         d->reset();
 }
 
+auto LocaleComboBox::showEvent(QShowEvent *event) -> void
+{
+    d->load();
+    QComboBox::showEvent(event);
+}
+
+auto LocaleComboBox::prefetch() -> void
+{
+    QThreadPool::globalInstance()->start(new LocalePrefetcher([] () {
+        Data::available();
+    }));
+}
+
 auto LocaleComboBox::currentLocale() const -> Locale
 {
+    d->load();
     return Locale::fromVariant(itemData(currentIndex()));
 }
 
 auto LocaleComboBox::setCurrentLocale(const Locale &locale) -> void
 {
+    d->load();
     setCurrentIndex(findData(locale.toVariant()));
 }
@@ -11,10 +11,13 @@ public:
     ~LocaleComboBox();
     auto currentLocale() const -> Locale;
     auto setCurrentLocale(const Locale &locale) -> void;
+    // resolve locale names in background before any box is created
+    static auto prefetch() -> void;
 signals:
     void currentLocaleChanged();
 private:
     auto changeEvent(QEvent *event) -> void;
+    auto showEvent(QShowEvent *event) -> void final;
     struct Item;
     struct Data;
     Data *d;
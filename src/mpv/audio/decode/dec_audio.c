@@ -243,6 +243,9 @@ int audio_decode(struct dec_audio *da, struct mp_audio_buffer *outbuf,
 
         struct mp_audio *mpa = da->waiting;
         da->waiting = NULL;
+        afs->pts = MP_NOPTS_VALUE;
+        if (da->pts != MP_NOPTS_VALUE)
+            afs->pts = da->pts + da->pts_offset / (double)mpa->rate;
         if (af_filter_frame(afs, mpa) < 0)
             return AD_ERR;
     }
@@ -209,6 +209,7 @@ static struct af_instance *af_create(struct af_stream *s, char *name,
         .log = mp_log_new(af, s->log, name),
         .replaygain_data = s->replaygain_data,
         .out_pool = mp_audio_pool_create(af),
+        .stream = s,
     };
     struct m_config *config = m_config_from_obj_desc(af, s->log, &desc);
     if (m_config_apply_defaults(config, name, s->opts->af_defs) < 0)
@@ -550,6 +551,7 @@ struct af_stream *af_new(struct mpv_global *global)
 {
     struct af_stream *s = talloc_zero(NULL, struct af_stream);
     s->log = mp_log_new(s, global->log, "!af");
+    s->pts = MP_NOPTS_VALUE;
 
     static const struct af_info in = { .name = "in" };
     s->first = talloc(s, struct af_instance);
@@ -830,4 +832,5 @@ void af_seek_reset(struct af_stream *s)
 {
     af_control_all(s, AF_CONTROL_RESET, NULL);
     af_chain_forget_frames(s);
+    s->pts = MP_NOPTS_VALUE;
 }
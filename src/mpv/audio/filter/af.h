@@ -83,6 +83,8 @@ struct af_instance {
     int num_out_queued;
 
     struct mp_audio_pool *out_pool;
+
+    struct af_stream *stream;
 };
 
 // Current audio stream
@@ -101,6 +103,9 @@ struct af_stream {
     struct mp_log *log;
     struct MPOpts *opts;
     struct replaygain_data *replaygain_data;
+
+    // End pts of the last frame passed to af_filter_frame(), or MP_NOPTS_VALUE
+    double pts;
 };
 
 // Return values
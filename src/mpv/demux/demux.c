@@ -832,6 +832,7 @@ static void demux_copy(struct demuxer *dst, struct demuxer *src)
         dst->rel_seeks = src->rel_seeks;
         dst->allow_refresh_seeks = src->allow_refresh_seeks;
         dst->fully_read = src->fully_read;
+        dst->probe_bytes = src->probe_bytes;
         dst->start_time = src->start_time;
         dst->priv = src->priv;
     }
@@ -930,6 +931,7 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         .stream = stream,
         .seekable = stream->seekable,
         .filepos = -1,
+        .probe_bytes = -1,
         .opts = global->opts,
         .global = global,
         .log = mp_log_new(demuxer, log, desc->name),
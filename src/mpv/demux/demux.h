@@ -197,6 +197,9 @@ typedef struct demuxer {
     // packets is not slow either (unlike e.g. libavdevice pseudo-demuxers).
     // Typical examples: text subtitles, playlists
     bool fully_read;
+    // Bytes read while looking for stream parameters after the headers,
+    // -1 if unknown (e.g. libavformat opened the URL itself)
+    int64_t probe_bytes;
 
     // Bitmask of DEMUX_EVENT_*
     int events;
@@ -165,6 +165,7 @@ typedef struct lavf_priv {
     int cur_program;
     char *mime_type;
     bool merge_track_metadata;
+    int64_t read_bytes;
 } lavf_priv_t;
 
 // At least mp4 has name="mov,mp4,m4a,3gp,3g2,mj2", so we split the name
@@ -191,6 +192,8 @@ static int mp_read(void *opaque, uint8_t *buf, int size)
     int ret;
 
     ret = stream_read(stream, buf, size);
+    if (ret > 0)
+        ((lavf_priv_t *)demuxer->priv)->read_bytes += ret;
 
     MP_TRACE(demuxer, "%d=mp_read(%p, %p, %d), pos: %"PRId64", eof:%d\n",
              ret, stream, buf, size, stream_tell(stream), stream->eof);
@@ -799,6 +802,7 @@ static int demux_open_lavf(demuxer_t *demuxer, enum demux_check check)
     av_dict_free(&dopts);
 
     priv->avfc = avfc;
+    int64_t header_bytes = priv->read_bytes;
     if (avformat_find_stream_info(avfc, NULL) < 0) {
         MP_ERR(demuxer, "av_find_stream_info() failed\n");
         return -1;
@@ -806,6 +810,8 @@ static int demux_open_lavf(demuxer_t *demuxer, enum demux_check check)
 
     MP_VERBOSE(demuxer, "avformat_find_stream_info() finished after %"PRId64
                " bytes.\n", stream_tell(demuxer->stream));
+    if (priv->pb)
+        demuxer->probe_bytes = priv->read_bytes - header_bytes;
 
     for (i = 0; i < avfc->nb_chapters; i++) {
         AVChapter *c = avfc->chapters[i];
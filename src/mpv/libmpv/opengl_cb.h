@@ -216,6 +216,17 @@ int mpv_opengl_cb_render_osd(struct mpv_opengl_cb_context *ctx,
                              int w, int h, int ml, int mt, int mr, int mb, double dpar,
                              void(*cb)(void*,struct sub_bitmaps*), void *octx);
 
+/**
+ * Get the presentation timestamp of a video frame, in seconds.
+ *
+ * @param next If 0, the frame drawn by the most recent mpv_opengl_cb_draw()
+ *             call. Otherwise, the frame which the next call will draw, which
+ *             is the same as the most recent one if nothing is queued.
+ * @param pts Set to the timestamp on success.
+ * @return error code; MPV_ERROR_PROPERTY_UNAVAILABLE if no frame was known
+ */
+int mpv_opengl_cb_frame_pts(mpv_opengl_cb_context *ctx, int next, double *pts);
+
 /**
  * Tell the renderer that a frame was flipped at the given time. This is
  * optional, but can help the player to achieve better timing.
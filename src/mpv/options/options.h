@@ -52,6 +52,7 @@ struct mp_cache_opts {
     int seek_min;
     char *file;
     int file_max;
+    int file_ring;
 };
 
 typedef struct MPOpts {
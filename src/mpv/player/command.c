@@ -426,6 +426,16 @@ static int mp_property_file_format(void *ctx, struct m_property *prop,
     return m_property_strdup_ro(action, arg, name);
 }
 
+static int mp_property_demuxer_probe_bytes(void *ctx, struct m_property *prop,
+                                           int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    struct demuxer *demuxer = mpctx->master_demuxer;
+    if (!demuxer)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_int64_ro(action, arg, demuxer->probe_bytes);
+}
+
 /// Position in the stream (RW)
 static int mp_property_stream_pos(void *ctx, struct m_property *prop,
                                   int action, void *arg)
@@ -535,6 +545,26 @@ static int mp_property_drop_frame_cnt(void *ctx, struct m_property *prop,
     return m_property_int_ro(action, arg, mpctx->dropped_frames_total);
 }
 
+static int mp_property_decoder_frame_count(void *ctx, struct m_property *prop,
+                                           int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->d_video)
+        return M_PROPERTY_UNAVAILABLE;
+
+    return m_property_int64_ro(action, arg, mpctx->d_video->num_decoded);
+}
+
+static int mp_property_decoder_time(void *ctx, struct m_property *prop,
+                                    int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->d_video)
+        return M_PROPERTY_UNAVAILABLE;
+
+    return m_property_double_ro(action, arg, mpctx->d_video->decode_time / 1e6);
+}
+
 static int mp_property_vo_drop_frame_count(void *ctx, struct m_property *prop,
                                            int action, void *arg)
 {
@@ -1858,6 +1888,8 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
     struct track *track = mpctx->tracks[item];
 
     const char *codec = track->stream ? track->stream->codec : NULL;
+    struct sh_video *v = track->stream ? track->stream->video : NULL;
+    struct sh_audio *a = track->stream ? track->stream->audio : NULL;
 
     struct m_sub_property props[] = {
         {"id",          SUB_PROP_INT(track->user_tid)},
@@ -1878,6 +1910,11 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
         {"codec",       SUB_PROP_STR(codec),
                         .unavailable = !codec},
         {"ff-index",    SUB_PROP_INT(track->ff_index)},
+        {"demux-w",     SUB_PROP_INT(v ? v->disp_w : 0), .unavailable = !v},
+        {"demux-h",     SUB_PROP_INT(v ? v->disp_h : 0), .unavailable = !v},
+        {"demux-fps",   SUB_PROP_FLOAT(v ? v->fps : 0), .unavailable = !v},
+        {"demux-samplerate", SUB_PROP_INT(a ? a->samplerate : 0), .unavailable = !a},
+        {"demux-channels", SUB_PROP_INT(a ? a->channels.num : 0), .unavailable = !a},
         {0}
     };
 
@@ -2042,6 +2079,28 @@ static int mp_property_hwdec(void *ctx, struct m_property *prop,
     return mp_property_generic_option(mpctx, prop, action, arg);
 }
 
+/// Decoder threads (RW); the decoder is restarted to apply a new count.
+static int mp_property_vd_lavc_threads(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+
+    if (action == M_PROPERTY_SET) {
+        int old = 0;
+        mp_property_generic_option(mpctx, prop, M_PROPERTY_GET, &old);
+        int r = mp_property_generic_option(mpctx, prop, action, arg);
+        if (r != M_PROPERTY_OK || old == *(int *)arg || !mpctx->d_video)
+            return r;
+        double last_pts = mpctx->last_vo_pts;
+        uninit_video_chain(mpctx);
+        reinit_video_chain(mpctx);
+        if (last_pts != MP_NOPTS_VALUE)
+            queue_seek(mpctx, MPSEEK_ABSOLUTE, last_pts, MPSEEK_EXACT, true);
+        return M_PROPERTY_OK;
+    }
+    return mp_property_generic_option(mpctx, prop, action, arg);
+}
+
 static int mp_property_hwdec_active(void *ctx, struct m_property *prop,
                                     int action, void *arg)
 {
@@ -3302,6 +3361,7 @@ static const struct m_property mp_properties[] = {
     {"stream-capture", mp_property_stream_capture},
     {"demuxer", mp_property_demuxer},
     {"file-format", mp_property_file_format},
+    {"demuxer-probe-bytes", mp_property_demuxer_probe_bytes},
     {"stream-pos", mp_property_stream_pos},
     {"stream-end", mp_property_stream_end},
     {"duration", mp_property_duration},
@@ -3310,6 +3370,8 @@ static const struct m_property mp_properties[] = {
     {"total-avsync-change", mp_property_total_avsync_change},
     {"drop-frame-count", mp_property_drop_frame_cnt},
     {"vo-drop-frame-count", mp_property_vo_drop_frame_count},
+    {"decoder-frame-count", mp_property_decoder_frame_count},
+    {"decoder-time", mp_property_decoder_time},
     {"percent-pos", mp_property_percent_pos},
     {"time-start", mp_property_time_start},
     {"time-pos", mp_property_time_pos},
@@ -3415,6 +3477,7 @@ static const struct m_property mp_properties[] = {
     {"vid", mp_property_video},
     {"program", mp_property_program},
     {"hwdec", mp_property_hwdec},
+    {"vd-lavc-threads", mp_property_vd_lavc_threads},
     {"hwdec-active", mp_property_hwdec_active},
     {"hwdec-detected", mp_property_detected_hwdec},
 
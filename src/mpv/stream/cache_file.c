@@ -16,8 +16,11 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #include "osdep/io.h"
+#include "osdep/timer.h"
+#include "osdep/threads.h"
 
 #include "common/common.h"
 #include "common/msg.h"
@@ -35,8 +38,26 @@ struct priv {
     uint8_t *block_bits;    // 1 bit for each BLOCK_SIZE, whether block was read
     int64_t size;           // currently known size
     int64_t max_size;       // max. size for block_bits and cache_file
+
+    // Ring mode (unseekable streams only): a writer thread appends everything
+    // read from the original stream at head % max_size, so the last max_size
+    // bytes stay seekable. Fields below are protected by the mutex.
+    bool ring;
+    pthread_t thread;
+    // The original stream reads with this instead of the player's cancel, so
+    // closing can abort a read the writer is blocked in without affecting
+    // anything else. Cancellation by the player is forwarded by the reader.
+    struct mp_cancel *cancel;
+    struct mp_cancel *original_cancel;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    int64_t head;           // total number of bytes written to the ring
+    bool eof;
+    bool terminate;
 };
 
+#define RING_WAIT_TIME 0.1
+
 static bool test_bit(struct priv *p, int64_t pos)
 {
     if (pos < 0 || pos >= p->size)
@@ -106,6 +127,107 @@ static int seek(stream_t *s, int64_t newpos)
     return 1;
 }
 
+// Runs in the ring writer thread
+static bool ring_write(struct priv *p, const char *buf, int len)
+{
+    // The file is only written here, and only read by the reader with the
+    // mutex held, so the writer has to take it for the actual I/O as well.
+    pthread_mutex_lock(&p->mutex);
+    bool ok = true;
+    while (len > 0 && ok) {
+        int64_t off = p->head % p->max_size;
+        int chunk = MPMIN(len, p->max_size - off);
+        ok = !fseeko(p->cache_file, off, SEEK_SET)
+             && fwrite(buf, chunk, 1, p->cache_file) == 1;
+        if (ok) {
+            p->head += chunk;
+            buf += chunk;
+            len -= chunk;
+        }
+    }
+    pthread_cond_signal(&p->wakeup);
+    pthread_mutex_unlock(&p->mutex);
+    return ok;
+}
+
+static void *ring_thread(void *arg)
+{
+    stream_t *s = arg;
+    struct priv *p = s->priv;
+    mpthread_set_name("cache-file");
+    char buf[STREAM_BUFFER_SIZE];
+    for (;;) {
+        pthread_mutex_lock(&p->mutex);
+        bool stop = p->terminate;
+        pthread_mutex_unlock(&p->mutex);
+        if (stop || mp_cancel_test(s->cancel))
+            break;
+        int r = stream_read_partial(p->original, buf, sizeof(buf));
+        if (r <= 0)
+            break;
+        if (!ring_write(p, buf, r)) {
+            MP_ERR(s, "error writing to cache file\n");
+            break;
+        }
+    }
+    pthread_mutex_lock(&p->mutex);
+    p->eof = true;
+    pthread_cond_signal(&p->wakeup);
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+static int ring_fill_buffer(stream_t *s, char *buffer, int max_len)
+{
+    struct priv *p = s->priv;
+    int r = -1;
+    pthread_mutex_lock(&p->mutex);
+    while (s->pos >= p->head && !p->eof && !mp_cancel_test(s->cancel)) {
+        struct timespec ts = mp_rel_time_to_timespec(RING_WAIT_TIME);
+        pthread_cond_timedwait(&p->wakeup, &p->mutex, &ts);
+    }
+    if (mp_cancel_test(s->cancel))
+        mp_cancel_trigger(p->cancel);
+    int64_t start = MPMAX(0, p->head - p->max_size);
+    if (s->pos < start) {
+        MP_WARN(s, "position dropped out of timeshift buffer\n");
+    } else if (s->pos >= p->head) {
+        r = 0;
+    } else {
+        int64_t off = s->pos % p->max_size;
+        // never wrap around within a single read
+        max_len = MPMIN(max_len, p->head - s->pos);
+        max_len = MPMIN(max_len, p->max_size - off);
+        if (!fseeko(p->cache_file, off, SEEK_SET))
+            r = fread(buffer, 1, max_len, p->cache_file);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return r;
+}
+
+static int ring_seek(stream_t *s, int64_t newpos)
+{
+    struct priv *p = s->priv;
+    pthread_mutex_lock(&p->mutex);
+    bool ok = newpos >= MPMAX(0, p->head - p->max_size);
+    pthread_mutex_unlock(&p->mutex);
+    return ok;
+}
+
+static int ring_control(stream_t *s, int cmd, void *arg)
+{
+    struct priv *p = s->priv;
+    // The original stream belongs to the writer thread now; only report what
+    // the ring knows itself. The size grows while the stream is live.
+    if (cmd == STREAM_CTRL_GET_SIZE) {
+        pthread_mutex_lock(&p->mutex);
+        *(int64_t *)arg = p->head;
+        pthread_mutex_unlock(&p->mutex);
+        return STREAM_OK;
+    }
+    return STREAM_UNSUPPORTED;
+}
+
 static int control(stream_t *s, int cmd, void *arg)
 {
     struct priv *p = s->priv;
@@ -115,6 +237,17 @@ static int control(stream_t *s, int cmd, void *arg)
 static void s_close(stream_t *s)
 {
     struct priv *p = s->priv;
+    if (p->ring) {
+        pthread_mutex_lock(&p->mutex);
+        p->terminate = true;
+        pthread_mutex_unlock(&p->mutex);
+        // The writer may be blocked in a read that only returns on cancel.
+        mp_cancel_trigger(p->cancel);
+        pthread_join(p->thread, NULL);
+        p->original->cancel = p->original_cancel;
+        pthread_mutex_destroy(&p->mutex);
+        pthread_cond_destroy(&p->wakeup);
+    }
     if (p->cache_file)
         fclose(p->cache_file);
     talloc_free(p);
@@ -127,7 +260,8 @@ int stream_file_cache_init(stream_t *cache, stream_t *stream,
     if (!opts->file || !opts->file[0] || opts->file_max < 1)
         return 0;
 
-    if (!stream->seekable) {
+    bool ring = !stream->seekable && opts->file_ring;
+    if (!stream->seekable && !ring) {
         MP_ERR(cache, "can't cache unseekable stream\n");
         return -1;
     }
@@ -146,6 +280,33 @@ int stream_file_cache_init(stream_t *cache, stream_t *stream,
     p->cache_file = file;
     p->max_size = opts->file_max * 1024LL;
 
+    if (ring) {
+        p->ring = true;
+        p->cancel = mp_cancel_new(p);
+        p->original_cancel = stream->cancel;
+        stream->cancel = p->cancel;
+        pthread_mutex_init(&p->mutex, NULL);
+        pthread_cond_init(&p->wakeup, NULL);
+        cache->seek = ring_seek;
+        cache->fill_buffer = ring_fill_buffer;
+        cache->control = ring_control;
+        cache->close = s_close;
+        if (pthread_create(&p->thread, NULL, ring_thread, cache)) {
+            stream->cancel = p->original_cancel;
+            p->ring = false;
+            pthread_mutex_destroy(&p->mutex);
+            pthread_cond_destroy(&p->wakeup);
+            fclose(file);
+            talloc_free(p);
+            cache->priv = NULL;
+            cache->close = NULL;
+            return -1;
+        }
+        MP_VERBOSE(cache, "timeshift ring of %lld KiB\n",
+                   (long long)(p->max_size / 1024));
+        return 1;
+    }
+
     // file_max can be INT_MAX, so this is at most about 256MB
     p->block_bits = talloc_zero_size(p, (p->max_size / BLOCK_SIZE + 1) / 8 + 1);
 
@@ -0,0 +1,337 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Size of a single positioned read issued by a worker.
+#define BLOCK_SIZE (256 * 1024)
+
+// Upper limit of blocks kept ahead of the reader (16 MiB).
+#define MAX_BLOCKS 64
+#define MIN_DEPTH 2
+
+#define MAX_WORKERS 16
+
+// Number of consecutive sequential reads before reading ahead. Random access
+// (e.g. probing or index lookups) only fetches the block it touches.
+#define SEQUENTIAL_READS 2
+
+// Time in seconds the reader waits for workers before checking for aborts.
+#define WAIT_TIME 0.1
+
+// Time in seconds without stalls before read-ahead depth may shrink again.
+#define SHRINK_TIME 2.0
+
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "talloc.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+#include "stream.h"
+#include "readahead.h"
+
+enum block_state {
+    BLOCK_FREE,
+    BLOCK_QUEUED,       // waiting for a worker
+    BLOCK_READING,      // a worker reads into data without holding the lock
+    BLOCK_DONE,
+};
+
+struct block {
+    enum block_state state;
+    bool discard;       // not wanted anymore; freed when its read finishes
+    int64_t pos;        // multiple of BLOCK_SIZE
+    int len;            // valid bytes when done, <0 on error
+    char *data;
+};
+
+struct mp_readahead {
+    struct mp_log *log;
+    mp_readahead_fn fn;
+    void *ctx;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // signaled when blocks are queued
+    pthread_cond_t done;        // signaled when blocks are finished
+    pthread_t threads[MAX_WORKERS];
+    int num_threads;
+    bool quit;
+
+    // --- Protected by lock
+    struct block blocks[MAX_BLOCKS];
+    int depth;                  // blocks read ahead of the reader
+    int64_t next_pos;           // end of the previous read
+    int sequential;             // number of consecutive sequential reads
+    int64_t eof;                // end of the source as last seen, else -1
+
+    double service;             // smoothed seconds per block read
+    double rate;                // smoothed bytes/second taken by the reader
+    int64_t last_read;          // mp_time_us() of the previous read
+    int64_t last_stall;         // mp_time_us() of the last wait for a block
+    int64_t bytes, reads, stalls;
+};
+
+static struct block *find_block(struct mp_readahead *ra, int64_t pos)
+{
+    for (int n = 0; n < MAX_BLOCKS; n++) {
+        struct block *b = &ra->blocks[n];
+        if (b->state != BLOCK_FREE && !b->discard && b->pos == pos)
+            return b;
+    }
+    return NULL;
+}
+
+static struct block *queue_block(struct mp_readahead *ra, int64_t pos)
+{
+    for (int n = 0; n < MAX_BLOCKS; n++) {
+        struct block *b = &ra->blocks[n];
+        if (b->state != BLOCK_FREE)
+            continue;
+        if (!b->data)
+            b->data = talloc_size(ra, BLOCK_SIZE);
+        *b = (struct block){
+            .state = BLOCK_QUEUED,
+            .pos = pos,
+            .data = b->data,
+        };
+        pthread_cond_signal(&ra->work);
+        return b;
+    }
+    return NULL;
+}
+
+// Drop blocks outside of [start, end).
+static void discard_blocks(struct mp_readahead *ra, int64_t start, int64_t end)
+{
+    for (int n = 0; n < MAX_BLOCKS; n++) {
+        struct block *b = &ra->blocks[n];
+        if (b->state == BLOCK_FREE || (b->pos >= start && b->pos < end))
+            continue;
+        if (b->state == BLOCK_READING) {
+            b->discard = true;
+        } else {
+            b->state = BLOCK_FREE;
+        }
+    }
+}
+
+// Blocks needed to cover the reader during one block request, doubled for
+// jitter. Grows at once; shrinks one by one if the reader didn't stall lately.
+static void update_depth(struct mp_readahead *ra, int64_t now)
+{
+    int need = MIN_DEPTH;
+    if (ra->service > 0 && ra->rate > 0)
+        need = ceil(2 * ra->rate * ra->service / BLOCK_SIZE) + 1;
+    need = MPCLAMP(need, MIN_DEPTH, MAX_BLOCKS);
+    if (need > ra->depth) {
+        ra->depth = need;
+    } else if (need < ra->depth && now - ra->last_stall > SHRINK_TIME * 1e6) {
+        ra->depth--;
+        ra->last_stall = now;
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    struct mp_readahead *ra = arg;
+    mpthread_set_name("readahead");
+
+    pthread_mutex_lock(&ra->lock);
+    while (!ra->quit) {
+        // lowest position first; that's where the reader is waiting
+        struct block *b = NULL;
+        for (int n = 0; n < MAX_BLOCKS; n++) {
+            struct block *cur = &ra->blocks[n];
+            if (cur->state == BLOCK_QUEUED && (!b || cur->pos < b->pos))
+                b = cur;
+        }
+        if (!b) {
+            pthread_cond_wait(&ra->work, &ra->lock);
+            continue;
+        }
+        b->state = BLOCK_READING;
+        int64_t pos = b->pos;
+        char *data = b->data;
+        pthread_mutex_unlock(&ra->lock);
+
+        int64_t start = mp_time_us();
+        int total = 0, r = 0;
+        while (total < BLOCK_SIZE) {
+            r = ra->fn(ra->ctx, data + total, BLOCK_SIZE - total, pos + total);
+            if (r <= 0)
+                break;
+            total += r;
+        }
+        double time = (mp_time_us() - start) / 1e6;
+
+        pthread_mutex_lock(&ra->lock);
+        // growing files may have more data than an earlier read saw
+        if (r == 0 && (ra->eof < 0 || pos + total < ra->eof)) {
+            ra->eof = pos + total;
+        } else if (ra->eof >= 0 && pos + total > ra->eof) {
+            ra->eof = -1;
+        }
+        if (total > 0)
+            ra->service = ra->service > 0 ? ra->service * 0.8 + time * 0.2 : time;
+        b->len = total > 0 ? total : r;
+        b->state = b->discard ? BLOCK_FREE : BLOCK_DONE;
+        b->discard = false;
+        pthread_cond_broadcast(&ra->done);
+    }
+    pthread_mutex_unlock(&ra->lock);
+    return NULL;
+}
+
+static void destroy(void *ptr)
+{
+    struct mp_readahead *ra = ptr;
+    pthread_mutex_lock(&ra->lock);
+    ra->quit = true;
+    pthread_cond_broadcast(&ra->work);
+    pthread_mutex_unlock(&ra->lock);
+    for (int n = 0; n < ra->num_threads; n++)
+        pthread_join(ra->threads[n], NULL);
+    if (ra->reads) {
+        MP_VERBOSE(ra, "Read-ahead: %"PRId64" KiB in %"PRId64" reads, "
+                   "%"PRId64" stalls, %.1f ms per block, depth %d\n",
+                   ra->bytes / 1024, ra->reads, ra->stalls,
+                   ra->service * 1e3, ra->depth);
+    }
+    pthread_cond_destroy(&ra->done);
+    pthread_cond_destroy(&ra->work);
+    pthread_mutex_destroy(&ra->lock);
+}
+
+struct mp_readahead *mp_readahead_create(void *talloc_ctx, struct mp_log *log,
+                                         mp_readahead_fn fn, void *ctx,
+                                         int workers)
+{
+    struct mp_readahead *ra = talloc_zero(talloc_ctx, struct mp_readahead);
+    ra->log = log;
+    ra->fn = fn;
+    ra->ctx = ctx;
+    ra->depth = MIN_DEPTH;
+    ra->next_pos = -1;
+    ra->eof = -1;
+    pthread_mutex_init(&ra->lock, NULL);
+    pthread_cond_init(&ra->work, NULL);
+    pthread_cond_init(&ra->done, NULL);
+    talloc_set_destructor(ra, destroy);
+
+    workers = MPCLAMP(workers, 1, MAX_WORKERS);
+    for (int n = 0; n < workers; n++) {
+        if (pthread_create(&ra->threads[n], NULL, worker_thread, ra) != 0)
+            break;
+        ra->num_threads++;
+    }
+    if (!ra->num_threads) {
+        MP_ERR(ra, "Starting read-ahead threads failed.\n");
+        talloc_free(ra);
+        return NULL;
+    }
+    return ra;
+}
+
+int mp_readahead_read(struct mp_readahead *ra, char *buf, int len, int64_t pos,
+                      struct mp_cancel *cancel)
+{
+    if (len <= 0)
+        return 0;
+
+    pthread_mutex_lock(&ra->lock);
+
+    int64_t now = mp_time_us();
+    ra->sequential = pos == ra->next_pos ? ra->sequential + 1 : 0;
+    bool ahead = ra->sequential >= SEQUENTIAL_READS;
+    if (ahead)
+        update_depth(ra, now);
+
+    // The block at pos is read even past the known end, so a file which
+    // grows meanwhile can be read further; only read-ahead stops there.
+    int r = 0;
+    int64_t start = pos - pos % BLOCK_SIZE;
+    int count = ahead ? ra->depth : 1;
+    discard_blocks(ra, start, start + (int64_t)count * BLOCK_SIZE);
+    for (int n = 0; n < count; n++) {
+        int64_t bpos = start + (int64_t)n * BLOCK_SIZE;
+        if (n > 0 && ra->eof >= 0 && bpos >= ra->eof)
+            break;
+        if (!find_block(ra, bpos) && !queue_block(ra, bpos))
+            break;
+    }
+
+    struct block *b = find_block(ra, start);
+    bool again = b && b->state == BLOCK_DONE && b->len >= 0 &&
+                 pos - start >= b->len;
+    if (again) {
+        // The short block may be from before the file grew; ask the source
+        // again rather than report the end it saw back then.
+        b->state = BLOCK_FREE;
+        b = queue_block(ra, start);
+    }
+    if (!b) {
+        // every block is still owned by a discarded read; don't wait for them
+        pthread_mutex_unlock(&ra->lock);
+        r = ra->fn(ra->ctx, buf, len, pos);
+        pthread_mutex_lock(&ra->lock);
+        goto done;
+    }
+
+    if (b->state != BLOCK_DONE) {
+        if (ahead && !again) {
+            ra->depth = MPMIN(ra->depth * 2, MAX_BLOCKS);
+            ra->last_stall = now;
+            ra->stalls++;
+        }
+        while (b->state != BLOCK_DONE) {
+            if (mp_cancel_test(cancel)) {
+                r = -1;
+                goto done;
+            }
+            struct timespec ts = mp_rel_time_to_timespec(WAIT_TIME);
+            pthread_cond_timedwait(&ra->done, &ra->lock, &ts);
+        }
+    }
+
+    if (b->len < 0) {
+        r = -1;
+        b->state = BLOCK_FREE; // retry on next attempt
+    } else {
+        int offset = pos - start;
+        r = MPMAX(MPMIN(len, b->len - offset), 0);
+        memcpy(buf, b->data + offset, r);
+        if (offset + r >= b->len)
+            b->state = BLOCK_FREE; // consumed
+    }
+
+done:
+    if (r > 0) {
+        if (ra->last_read > 0 && now > ra->last_read) {
+            double rate = r / ((now - ra->last_read) / 1e6);
+            ra->rate = ra->rate > 0 ? ra->rate * 0.9 + rate * 0.1 : rate;
+        }
+        ra->last_read = now;
+        ra->bytes += r;
+        ra->reads++;
+    }
+    ra->next_pos = pos + MPMAX(r, 0);
+    pthread_mutex_unlock(&ra->lock);
+    return r;
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPLAYER_STREAM_READAHEAD_H
+#define MPLAYER_STREAM_READAHEAD_H
+
+#include <stdint.h>
+
+struct mp_log;
+struct mp_cancel;
+struct mp_readahead;
+
+// Read up to len bytes at pos. Return the number of bytes read, 0 on EOF and
+// <0 on error. It's called from several worker threads at once, so it must not
+// depend on a shared file position.
+typedef int (*mp_readahead_fn)(void *ctx, char *buf, int len, int64_t pos);
+
+// Keep several positioned reads in flight on a pool of worker threads for
+// sources with high per-request latency, such as network filesystems.
+// Sequential access is detected and read-ahead depth follows the measured
+// request latency and consumption rate. Freed with talloc.
+struct mp_readahead *mp_readahead_create(void *talloc_ctx, struct mp_log *log,
+                                         mp_readahead_fn fn, void *ctx,
+                                         int workers);
+
+// Same return value as mp_readahead_fn. Served from completed read-ahead
+// buffers if possible; otherwise waits for the read covering pos. Returns -1
+// if cancel is triggered while waiting. Reading at or past the end asks the
+// source again, so growing files can be followed. Only one caller at a time.
+int mp_readahead_read(struct mp_readahead *ra, char *buf, int len, int64_t pos,
+                      struct mp_cancel *cancel);
+
+#endif
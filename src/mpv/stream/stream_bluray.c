@@ -757,9 +757,12 @@ static int bluray_stream_open(stream_t *s)
             return STREAM_UNSUPPORTED;
         }
 
-        /* parse titles information */
+        /* parse titles information; not needed when the title is given,
+         * which saves reading every playlist of the disc again */
         uint64_t max_duration = 0;
-        for (int i = 0; i < b->num_titles; i++) {
+        const int guess_titles =
+            b->cfg_title == BLURAY_DEFAULT_TITLE ? b->num_titles : 0;
+        for (int i = 0; i < guess_titles; i++) {
             BLURAY_TITLE_INFO *ti = bd_get_title_info(bd, i, 0);
             if (!ti)
                 continue;
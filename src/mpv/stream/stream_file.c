@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -31,12 +32,14 @@
 #endif
 
 #include "osdep/io.h"
+#include "osdep/timer.h"
 
 #include "common/common.h"
 #include "common/msg.h"
 #include "stream.h"
 #include "options/m_option.h"
 #include "options/path.h"
+#include "readahead.h"
 
 #if HAVE_BSD_FSTATFS
 #include <sys/param.h>
@@ -57,15 +60,35 @@
 #endif
 #endif
 
+// Concurrent reads kept in flight on network filesystems.
+#define READAHEAD_WORKERS 4
+
 struct priv {
     int fd;
     bool close;
     bool regular;
+    int latency; // ms added to each read; for latency:// only
+    struct mp_readahead *ra;
 };
 
+#ifndef __MINGW32__
+static int read_at(void *ctx, char *buffer, int len, int64_t pos)
+{
+    struct priv *p = ctx;
+    if (p->latency > 0)
+        mp_sleep_us(p->latency * 1000LL);
+    int r = pread(p->fd, buffer, len, pos);
+    return r < 0 ? -1 : r;
+}
+#endif
+
 static int fill_buffer(stream_t *s, char *buffer, int max_len)
 {
     struct priv *p = s->priv;
+    if (p->ra) {
+        int r = mp_readahead_read(p->ra, buffer, max_len, s->pos, s->cancel);
+        return (r <= 0) ? -1 : r;
+    }
 #ifndef __MINGW32__
     if (!p->regular) {
         int c = s->cancel ? mp_cancel_get_fd(s->cancel) : -1;
@@ -100,6 +123,8 @@ static int write_buffer(stream_t *s, char *buffer, int len)
 static int seek(stream_t *s, int64_t newpos)
 {
     struct priv *p = s->priv;
+    if (p->ra)
+        return newpos >= 0; // reads are positioned
     return lseek(p->fd, newpos, SEEK_SET) != (off_t)-1;
 }
 
@@ -123,6 +148,8 @@ static int control(stream_t *s, int cmd, void *arg)
 static void s_close(stream_t *s)
 {
     struct priv *p = s->priv;
+    talloc_free(p->ra);
+    p->ra = NULL;
     if (p->close && p->fd >= 0)
         close(p->fd);
 }
@@ -227,12 +254,13 @@ static bool check_stream_network(int fd)
 }
 #endif
 
-static int open_f(stream_t *stream)
+static int open_file(stream_t *stream, int latency)
 {
     int fd;
     struct priv *priv = talloc_ptrtype(stream, priv);
     *priv = (struct priv) {
-        .fd = -1
+        .fd = -1,
+        .latency = latency,
     };
     stream->priv = priv;
     stream->type = STREAMTYPE_FILE;
@@ -307,12 +335,28 @@ static int open_f(stream_t *stream)
     stream->read_chunk = 64 * 1024;
     stream->close = s_close;
 
-    if (check_stream_network(fd))
+    if (check_stream_network(fd) || priv->latency > 0)
         stream->streaming = true;
 
+#ifndef __MINGW32__
+    // Network filesystems answer one request per round trip; keep several
+    // in flight so throughput isn't bounded by latency.
+    if (stream->streaming && priv->regular && !write) {
+        priv->ra = mp_readahead_create(stream, stream->log, read_at, priv,
+                                       READAHEAD_WORKERS);
+        if (priv->ra)
+            MP_VERBOSE(stream, "Using concurrent read-ahead.\n");
+    }
+#endif
+
     return STREAM_OK;
 }
 
+static int open_f(stream_t *stream)
+{
+    return open_file(stream, 0);
+}
+
 const stream_info_t stream_info_file = {
     .name = "file",
     .open = open_f,
@@ -320,3 +364,28 @@ const stream_info_t stream_info_file = {
     .can_write = true,
     .is_safe = true,
 };
+
+#if HAVE_TEST
+// latency://MS/path opens a local file like a network share which takes MS
+// milliseconds for each read. Only for test/readahead.c; it's not in the list
+// of protocols, so URLs of users never reach it.
+static int open_latency(stream_t *stream)
+{
+    char *end = NULL;
+    const char *url = stream->url + strlen("latency://");
+    long latency = strtol(url, &end, 10);
+    if (end == url || *end != '/' || latency < 0) {
+        MP_ERR(stream, "Use latency://MS/path.\n");
+        return STREAM_ERROR;
+    }
+    stream->path = talloc_strdup(stream, end);
+    stream->url = stream->path;
+    return open_file(stream, latency);
+}
+
+const stream_info_t stream_info_file_latency = {
+    .name = "latency",
+    .open = open_latency,
+    .protocols = (const char*const[]){ "latency", NULL },
+};
+#endif
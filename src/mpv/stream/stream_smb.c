@@ -21,15 +21,23 @@
 
 #include <libsmbclient.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "common/msg.h"
 #include "stream.h"
+#include "readahead.h"
 #include "options/m_option.h"
 
 struct priv {
     int fd;
+    struct mp_readahead *ra;
 };
 
+// libsmbclient's default context can't be used from several threads at once,
+// so every smbc_* call takes this lock, also across streams, and read-ahead
+// runs a single worker which still overlaps with demuxing.
+static pthread_mutex_t smb_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static void smb_auth_fn(const char *server, const char *share,
              char *workgroup, int wgmaxlen, char *username, int unmaxlen,
              char *password, int pwmaxlen)
@@ -41,8 +49,10 @@ static int control(stream_t *s, int cmd, void *arg) {
   struct priv *p = s->priv;
   switch(cmd) {
     case STREAM_CTRL_GET_SIZE: {
+      pthread_mutex_lock(&smb_lock);
       off_t size = smbc_lseek(p->fd,0,SEEK_END);
       smbc_lseek(p->fd,s->pos,SEEK_SET);
+      pthread_mutex_unlock(&smb_lock);
       if(size != (off_t)-1) {
         *(int64_t *)arg = size;
         return 1;
@@ -53,17 +63,36 @@ static int control(stream_t *s, int cmd, void *arg) {
   return STREAM_UNSUPPORTED;
 }
 
+static int read_at(void *ctx, char *buffer, int len, int64_t pos) {
+  struct priv *p = ctx;
+  int r = -1;
+  pthread_mutex_lock(&smb_lock);
+  if (smbc_lseek(p->fd, pos, SEEK_SET) >= 0)
+    r = smbc_read(p->fd, buffer, len);
+  pthread_mutex_unlock(&smb_lock);
+  return r < 0 ? -1 : r;
+}
+
 static int seek(stream_t *s,int64_t newpos) {
   struct priv *p = s->priv;
-  if(smbc_lseek(p->fd,newpos,SEEK_SET)<0) {
-    return 0;
-  }
-  return 1;
+  if (p->ra)
+    return newpos >= 0;
+  pthread_mutex_lock(&smb_lock);
+  off_t r = smbc_lseek(p->fd,newpos,SEEK_SET);
+  pthread_mutex_unlock(&smb_lock);
+  return r >= 0;
 }
 
 static int fill_buffer(stream_t *s, char* buffer, int max_len){
   struct priv *p = s->priv;
-  int r = smbc_read(p->fd,buffer,max_len);
+  int r;
+  if (p->ra) {
+    r = mp_readahead_read(p->ra, buffer, max_len, s->pos, s->cancel);
+  } else {
+    pthread_mutex_lock(&smb_lock);
+    r = smbc_read(p->fd,buffer,max_len);
+    pthread_mutex_unlock(&smb_lock);
+  }
   return (r <= 0) ? -1 : r;
 }
 
@@ -72,7 +101,9 @@ static int write_buffer(stream_t *s, char* buffer, int len) {
   int r;
   int wr = 0;
   while (wr < len) {
+    pthread_mutex_lock(&smb_lock);
     r = smbc_write(p->fd,buffer,len);
+    pthread_mutex_unlock(&smb_lock);
     if (r <= 0)
       return -1;
     wr += r;
@@ -83,7 +114,11 @@ static int write_buffer(stream_t *s, char* buffer, int len) {
 
 static void close_f(stream_t *s){
   struct priv *p = s->priv;
+  talloc_free(p->ra); // joins the worker before the file goes away
+  p->ra = NULL;
+  pthread_mutex_lock(&smb_lock);
   smbc_close(p->fd);
+  pthread_mutex_unlock(&smb_lock);
 }
 
 static int open_f (stream_t *stream)
@@ -105,14 +140,17 @@ static int open_f (stream_t *stream)
     return STREAM_ERROR;
   }
 
+  pthread_mutex_lock(&smb_lock);
   err = smbc_init(smb_auth_fn, 1);
   if (err < 0) {
+    pthread_mutex_unlock(&smb_lock);
     MP_ERR(stream, "Cannot init the libsmbclient library: %d\n",err);
     return STREAM_ERROR;
   }
 
   fd = smbc_open(filename, m,0644);
   if (fd < 0) {
+    pthread_mutex_unlock(&smb_lock);
     MP_ERR(stream, "Could not open from LAN: '%s'\n", filename);
     return STREAM_ERROR;
   }
@@ -122,6 +160,7 @@ static int open_f (stream_t *stream)
     len = smbc_lseek(fd,0,SEEK_END);
     smbc_lseek (fd, 0, SEEK_SET);
   }
+  pthread_mutex_unlock(&smb_lock);
   if(len > 0 || write) {
     stream->seekable = true;
     stream->seek = seek;
@@ -133,6 +172,8 @@ static int open_f (stream_t *stream)
   stream->control = control;
   stream->read_chunk = 128 * 1024;
   stream->streaming = true;
+  if (!write)
+    priv->ra = mp_readahead_create(stream, stream->log, read_at, priv, 1);
 
   return STREAM_OK;
 }
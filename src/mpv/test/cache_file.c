@@ -0,0 +1,220 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "options/options.h"
+#include "osdep/timer.h"
+#include "stream/stream.h"
+
+#define RING_KB 64
+#define RING_SIZE (RING_KB * 1024)
+#define SOURCE_SIZE (RING_SIZE * 3 + 1234)
+#define CHUNK 5000
+
+// Stand-in for a live stream: unseekable, and only the first "avail" bytes
+// have arrived yet. Reading beyond that blocks until more data is released
+// or the read is canceled, like a network stream that went quiet.
+struct source {
+    pthread_mutex_t lock;
+    unsigned char *data;
+    int64_t size, avail, pos;
+    bool canceled;
+};
+
+static int source_fill(stream_t *s, char *buf, int len)
+{
+    struct source *src = s->priv;
+    pthread_mutex_lock(&src->lock);
+    while (src->pos >= src->avail && src->avail < src->size) {
+        pthread_mutex_unlock(&src->lock);
+        if (mp_cancel_wait(s->cancel, 0.01)) {
+            pthread_mutex_lock(&src->lock);
+            src->canceled = true;
+            pthread_mutex_unlock(&src->lock);
+            return -1;
+        }
+        pthread_mutex_lock(&src->lock);
+    }
+    int n = MPMIN(len, src->avail - src->pos);
+    memcpy(buf, src->data + src->pos, n);
+    src->pos += n;
+    pthread_mutex_unlock(&src->lock);
+    return n;
+}
+
+static void release(struct source *src, int64_t avail)
+{
+    pthread_mutex_lock(&src->lock);
+    src->avail = MPMIN(avail, src->size);
+    pthread_mutex_unlock(&src->lock);
+}
+
+static stream_t *alloc_stream(void *ctx)
+{
+    stream_t *s = talloc_zero_size(ctx, sizeof(stream_t) +
+                                   STREAM_MAX_BUFFER_SIZE + STREAM_MAX_SECTOR_SIZE);
+    s->log = mp_null_log;
+    s->mode = STREAM_READ;
+    return s;
+}
+
+struct fixture {
+    struct source *src;
+    stream_t *original, *cache;
+    struct mp_cancel *playback;
+};
+
+static struct fixture *create(int64_t avail)
+{
+    struct fixture *f = talloc_zero(NULL, struct fixture);
+    f->src = talloc_zero(f, struct source);
+    pthread_mutex_init(&f->src->lock, NULL);
+    f->src->size = SOURCE_SIZE;
+    f->src->data = talloc_size(f, SOURCE_SIZE);
+    for (int64_t n = 0; n < SOURCE_SIZE; n++)
+        f->src->data[n] = (n * 7 + n / 4093) & 0xff;
+    release(f->src, avail);
+
+    f->playback = mp_cancel_new(f);
+    f->original = alloc_stream(f);
+    f->original->fill_buffer = source_fill;
+    f->original->priv = f->src;
+    f->original->cancel = f->playback;
+    f->original->seekable = false;
+
+    f->cache = alloc_stream(f);
+    f->cache->cancel = f->playback;
+    struct mp_cache_opts opts = {
+        .file = "TMP",
+        .file_max = RING_KB,
+        .file_ring = 1,
+    };
+    assert_int_equal(stream_file_cache_init(f->cache, f->original, &opts), 1);
+    return f;
+}
+
+static void destroy(struct fixture *f)
+{
+    f->cache->close(f->cache);
+    pthread_mutex_destroy(&f->src->lock);
+    talloc_free(f);
+}
+
+static int64_t ring_size(stream_t *cache)
+{
+    int64_t size = -1;
+    assert_int_equal(cache->control(cache, STREAM_CTRL_GET_SIZE, &size),
+                     STREAM_OK);
+    return size;
+}
+
+static void wait_size(stream_t *cache, int64_t size)
+{
+    while (ring_size(cache) < size)
+        mp_sleep_us(1000);
+}
+
+static int ring_read(stream_t *cache, int64_t pos, char *buf, int len)
+{
+    cache->pos = pos;
+    return cache->fill_buffer(cache, buf, len);
+}
+
+// Only the last RING_SIZE bytes stay readable once the writer wrapped.
+static void test_wrap(void **state)
+{
+    struct fixture *f = create(SOURCE_SIZE);
+    wait_size(f->cache, SOURCE_SIZE);
+    int64_t start = SOURCE_SIZE - RING_SIZE;
+    char buf[CHUNK];
+
+    assert_false(f->cache->seek(f->cache, 0));
+    assert_false(f->cache->seek(f->cache, start - 1));
+    assert_int_equal(ring_read(f->cache, start - 1, buf, CHUNK), -1);
+    assert_true(f->cache->seek(f->cache, start));
+
+    // start is not aligned to the ring, so this crosses the wrap point
+    assert_true(start % RING_SIZE != 0);
+    int64_t pos = start;
+    while (pos < SOURCE_SIZE) {
+        int r = ring_read(f->cache, pos, buf, CHUNK);
+        assert_true(r > 0);
+        // a single read never wraps around
+        assert_true(pos / RING_SIZE == (pos + r - 1) / RING_SIZE);
+        assert_memory_equal(buf, f->src->data + pos, r);
+        pos += r;
+    }
+    assert_int_equal(ring_read(f->cache, SOURCE_SIZE, buf, CHUNK), 0);
+    destroy(f);
+}
+
+// Seeking back and forth within the window returns the same bytes.
+static void test_seek(void **state)
+{
+    struct fixture *f = create(SOURCE_SIZE);
+    wait_size(f->cache, SOURCE_SIZE);
+    int64_t start = SOURCE_SIZE - RING_SIZE;
+    char buf[CHUNK];
+    srand(1);
+    for (int i = 0; i < 200; i++) {
+        int64_t pos = start + rand() % RING_SIZE;
+        assert_true(f->cache->seek(f->cache, pos));
+        int r = ring_read(f->cache, pos, buf, 1 + rand() % CHUNK);
+        assert_true(r > 0);
+        assert_memory_equal(buf, f->src->data + pos, r);
+    }
+    destroy(f);
+}
+
+static void *release_later(void *arg)
+{
+    mp_sleep_us(20 * 1000);
+    release(arg, 20000); // less than the ring, so nothing is overwritten
+    return NULL;
+}
+
+// Reading at the live edge waits for the writer instead of failing.
+static void test_live_edge(void **state)
+{
+    struct fixture *f = create(10000);
+    wait_size(f->cache, 10000);
+    char buf[CHUNK];
+    assert_int_equal(ring_read(f->cache, 0, buf, CHUNK), CHUNK);
+    assert_memory_equal(buf, f->src->data, CHUNK);
+
+    pthread_t thread;
+    assert_int_equal(pthread_create(&thread, NULL, release_later, f->src), 0);
+    int r = ring_read(f->cache, 10000, buf, CHUNK);
+    assert_true(r > 0);
+    assert_memory_equal(buf, f->src->data + 10000, r);
+    pthread_join(thread, NULL);
+    destroy(f);
+}
+
+// Closing must not hang while the writer is blocked in a read of the
+// original stream, and must not cancel playback as a side effect.
+static void test_close_blocked(void **state)
+{
+    struct fixture *f = create(1000);
+    wait_size(f->cache, 1000);
+    mp_sleep_us(20 * 1000); // let the writer block in the next read
+    f->cache->close(f->cache);
+    assert_true(f->src->canceled);
+    assert_false(mp_cancel_test(f->playback));
+    assert_ptr_equal(f->original->cancel, f->playback);
+    pthread_mutex_destroy(&f->src->lock);
+    talloc_free(f);
+}
+
+int main(void) {
+    mp_time_init();
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_wrap),
+        cmocka_unit_test(test_seek),
+        cmocka_unit_test(test_live_edge),
+        cmocka_unit_test(test_close_blocked),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,239 @@
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "osdep/timer.h"
+#include "stream/readahead.h"
+#include "stream/stream.h"
+
+extern const stream_info_t stream_info_file_latency;
+
+// Stand-in for a file on a network share: every request takes the given
+// latency no matter how much is read.
+struct source {
+    pthread_mutex_t lock;
+    unsigned char *data;
+    int64_t size;       // may grow up to SOURCE_SIZE
+    int latency;        // us
+    int64_t fail_at;    // reads touching this position fail if >= 0
+    int in_flight, max_in_flight;
+};
+
+#define SOURCE_SIZE (5 * 1024 * 1024 + 1234)
+#define LATENCY (2 * 1000)
+#define CHUNK (64 * 1024)
+
+static int read_source(void *ctx, char *buf, int len, int64_t pos)
+{
+    struct source *s = ctx;
+    pthread_mutex_lock(&s->lock);
+    s->in_flight++;
+    s->max_in_flight = MPMAX(s->max_in_flight, s->in_flight);
+    pthread_mutex_unlock(&s->lock);
+
+    mp_sleep_us(s->latency);
+
+    pthread_mutex_lock(&s->lock);
+    int n = -1;
+    if (s->fail_at < 0 || pos > s->fail_at || s->fail_at >= pos + len) {
+        n = MPMAX(MPMIN(len, s->size - pos), 0);
+        if (n > 0)
+            memcpy(buf, s->data + pos, n);
+    }
+    s->in_flight--;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
+
+static struct source *create_source(int latency)
+{
+    struct source *s = talloc_zero(NULL, struct source);
+    pthread_mutex_init(&s->lock, NULL);
+    s->data = talloc_size(s, SOURCE_SIZE);
+    s->size = SOURCE_SIZE;
+    s->latency = latency;
+    s->fail_at = -1;
+    for (int64_t n = 0; n < s->size; n++)
+        s->data[n] = (n * 7 + n / 4093) & 0xff;
+    return s;
+}
+
+static void destroy_source(struct source *s)
+{
+    pthread_mutex_destroy(&s->lock);
+    talloc_free(s);
+}
+
+// Read the source from pos to its end with CHUNK sized requests like the
+// stream layer. Returns the end position.
+static int64_t read_from(struct source *s, struct mp_readahead *ra,
+                         int64_t pos)
+{
+    char *buf = talloc_size(NULL, CHUNK);
+    while (1) {
+        int r = mp_readahead_read(ra, buf, CHUNK, pos, NULL);
+        if (r <= 0)
+            break;
+        assert_memory_equal(buf, s->data + pos, r);
+        pos += r;
+    }
+    talloc_free(buf);
+    return pos;
+}
+
+static int64_t read_all(struct source *s, struct mp_readahead *ra)
+{
+    return read_from(s, ra, 0);
+}
+
+static void test_sequential(void **state)
+{
+    struct source *s = create_source(0);
+    struct mp_readahead *ra =
+        mp_readahead_create(NULL, mp_null_log, read_source, s, 4);
+    assert_non_null(ra);
+    assert_true(read_all(s, ra) == s->size);
+    char c;
+    assert_int_equal(mp_readahead_read(ra, &c, 1, s->size, NULL), 0);
+    talloc_free(ra);
+    destroy_source(s);
+}
+
+static void test_random(void **state)
+{
+    struct source *s = create_source(0);
+    struct mp_readahead *ra =
+        mp_readahead_create(NULL, mp_null_log, read_source, s, 4);
+    char *buf = talloc_size(NULL, CHUNK * 2);
+    srand(1);
+    for (int i = 0; i < 500; i++) {
+        int64_t pos = ((int64_t)rand() * 4096 + rand()) % (s->size + 100);
+        int len = 1 + rand() % (CHUNK * 2);
+        // a few sequential runs in between to start read-ahead
+        for (int n = 0; n < 1 + i % 4; n++) {
+            int r = mp_readahead_read(ra, buf, len, pos, NULL);
+            int expected = MPMAX(MPMIN(len, s->size - pos), 0);
+            assert_true(r > 0 || expected == 0);
+            assert_true(r <= expected);
+            if (r <= 0)
+                break;
+            assert_memory_equal(buf, s->data + pos, r);
+            pos += r;
+        }
+    }
+    talloc_free(buf);
+    talloc_free(ra);
+    destroy_source(s);
+}
+
+static void test_error(void **state)
+{
+    struct source *s = create_source(0);
+    s->fail_at = 3 * 1024 * 1024;
+    struct mp_readahead *ra =
+        mp_readahead_create(NULL, mp_null_log, read_source, s, 4);
+    int64_t pos = s->fail_at;
+    assert_true(read_all(s, ra) == pos);
+    char c;
+    assert_int_equal(mp_readahead_read(ra, &c, 1, pos, NULL), -1);
+    // failed reads are retried
+    s->fail_at = -1;
+    assert_int_equal(mp_readahead_read(ra, &c, 1, pos, NULL), 1);
+    assert_int_equal((unsigned char)c, s->data[pos]);
+    talloc_free(ra);
+    destroy_source(s);
+}
+
+// A file which grows after EOF was seen can be read further.
+static void test_grow(void **state)
+{
+    struct source *s = create_source(0);
+    s->size = SOURCE_SIZE / 2 + 100;
+    struct mp_readahead *ra =
+        mp_readahead_create(NULL, mp_null_log, read_source, s, 4);
+    int64_t pos = read_all(s, ra);
+    assert_true(pos == s->size);
+    char c;
+    assert_int_equal(mp_readahead_read(ra, &c, 1, pos, NULL), 0);
+    pthread_mutex_lock(&s->lock);
+    s->size = SOURCE_SIZE;
+    pthread_mutex_unlock(&s->lock);
+    assert_true(read_from(s, ra, pos) == SOURCE_SIZE);
+    talloc_free(ra);
+    destroy_source(s);
+}
+
+// Throughput must not be bounded by the latency of single requests, so
+// sequential reading has to keep several requests in flight, but never more
+// than there are workers.
+static void test_in_flight(void **state)
+{
+    struct source *s = create_source(LATENCY);
+    struct mp_readahead *ra =
+        mp_readahead_create(NULL, mp_null_log, read_source, s, 4);
+    assert_true(read_all(s, ra) == s->size);
+    talloc_free(ra);
+    assert_true(s->max_in_flight > 1);
+    assert_true(s->max_in_flight <= 4);
+
+    // a single worker for sources which can't take concurrent requests
+    s->max_in_flight = 0;
+    ra = mp_readahead_create(NULL, mp_null_log, read_source, s, 1);
+    assert_true(read_all(s, ra) == s->size);
+    talloc_free(ra);
+    assert_int_equal(s->max_in_flight, 1);
+    destroy_source(s);
+}
+
+// The same through the file stream with latency://, which read-ahead is
+// enabled for like on a network filesystem.
+static void test_file_stream(void **state)
+{
+    struct source *s = create_source(0);
+    char path[] = "/tmp/mpv-readahead-XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    assert_true(write(fd, s->data, s->size) == s->size);
+    close(fd);
+
+    stream_t *st = talloc_zero_size(NULL, sizeof(stream_t) +
+                                    STREAM_MAX_BUFFER_SIZE + STREAM_MAX_SECTOR_SIZE);
+    st->log = mp_null_log;
+    st->mode = STREAM_READ;
+    st->url = talloc_asprintf(st, "latency://1%s", path);
+    assert_int_equal(stream_info_file_latency.open(st), STREAM_OK);
+    assert_true(st->streaming);
+
+    char *buf = talloc_size(st, CHUNK);
+    int64_t pos = 0;
+    while (1) {
+        st->pos = pos;
+        int r = st->fill_buffer(st, buf, CHUNK);
+        if (r <= 0)
+            break;
+        assert_memory_equal(buf, s->data + pos, r);
+        pos += r;
+    }
+    assert_true(pos == s->size);
+    st->close(st);
+    talloc_free(st);
+    unlink(path);
+    destroy_source(s);
+}
+
+int main(void) {
+    mp_time_init();
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_sequential),
+        cmocka_unit_test(test_random),
+        cmocka_unit_test(test_error),
+        cmocka_unit_test(test_grow),
+        cmocka_unit_test(test_in_flight),
+        cmocka_unit_test(test_file_stream),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
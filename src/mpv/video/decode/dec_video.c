@@ -316,7 +316,9 @@ struct mp_image *video_decode(struct dec_video *d_video,
 
     MP_STATS(d_video, "start decode video");
 
+    int64_t start = mp_time_us();
     struct mp_image *mpi = d_video->vd_driver->decode(d_video, packet, drop_frame);
+    d_video->decode_time += mp_time_us() - start;
 
     MP_STATS(d_video, "end decode video");
 
@@ -325,6 +327,8 @@ struct mp_image *video_decode(struct dec_video *d_video,
         return NULL;            // error / skipped frame
     }
 
+    d_video->num_decoded++;
+
     if (opts->field_dominance == 0)
         mpi->fields |= MP_IMGFIELD_TOP_FIRST;
     else if (opts->field_dominance == 1)
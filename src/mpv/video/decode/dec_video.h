@@ -71,6 +71,10 @@ struct dec_video {
     // Final PTS of previously decoded image
     double decoded_pts;
 
+    // Time spent in the decoder and frames it returned since init
+    int64_t decode_time;
+    int64_t num_decoded;
+
     float fps;            // FPS from demuxer or from user override
     float initial_decoder_aspect;
 
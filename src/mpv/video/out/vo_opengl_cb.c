@@ -82,6 +82,7 @@ struct mpv_opengl_cb_context {
     int64_t recent_flip;
     int64_t approx_vsync;
     int64_t cur_pts;
+    double frame_pts; // pts of the frame drawn most recently
     bool vsync_timed;
 
     // --- All of these can only be accessed from the thread where the host
@@ -184,6 +185,7 @@ struct mpv_opengl_cb_context *mp_opengl_create(struct mpv_global *g,
     pthread_cond_init(&ctx->wakeup, NULL);
 
     ctx->gl = talloc_zero(ctx, GL);
+    ctx->frame_pts = MP_NOPTS_VALUE;
 
     ctx->log = mp_log_new(ctx, g->log, "opengl-cb");
     ctx->client_api = client_api;
@@ -368,6 +370,7 @@ int mpv_opengl_cb_draw(mpv_opengl_cb_context *ctx, int fbo, int vp_w, int vp_h)
         struct frame_timing *t = mpi->priv; // set by draw_image_timed
         if (t)
             ctx->cur_pts = t->pts;
+        ctx->frame_pts = mpi->pts;
     }
 
     struct frame_timing timing = {
@@ -396,6 +399,19 @@ int mpv_opengl_cb_draw(mpv_opengl_cb_context *ctx, int fbo, int vp_w, int vp_h)
     return left;
 }
 
+int mpv_opengl_cb_frame_pts(mpv_opengl_cb_context *ctx, int next, double *pts)
+{
+    pthread_mutex_lock(&ctx->lock);
+    double ret = ctx->frame_pts;
+    if (next && ctx->queued_frames > 0)
+        ret = ctx->frame_queue[0]->pts;
+    pthread_mutex_unlock(&ctx->lock);
+    if (ret == MP_NOPTS_VALUE)
+        return MPV_ERROR_PROPERTY_UNAVAILABLE;
+    *pts = ret;
+    return 0;
+}
+
 int mpv_opengl_cb_report_flip(mpv_opengl_cb_context *ctx, int64_t time)
 {
     pthread_mutex_lock(&ctx->lock);
@@ -238,6 +238,7 @@ def build(ctx):
         ( "stream/dvb_tune.c",                   "dvbin" ),
         ( "stream/frequencies.c",                "tv" ),
         ( "stream/rar.c" ),
+        ( "stream/readahead.c" ),
         ( "stream/stream.c" ),
         ( "stream/stream_avdevice.c" ),
         ( "stream/stream_bluray.c",              "libbluray" ),